@@ -0,0 +1,8 @@
+#!/bin/bash
+
+# common options
+# clean to remove the build
+# JNI=path to override the a3d/texgz tree
+
+cd project/jni/host
+make $@
@@ -9,8 +9,27 @@ include $(LOCAL_PATH)/a3d/Android.mk
 include $(CLEAR_VARS)
 LOCAL_MODULE    := LaserShark
 LOCAL_CFLAGS    := -Wall -D$(A3D_CLIENT_VERSION)
-LOCAL_SRC_FILES := android_jni.c lzs_renderer.c
+LOCAL_SRC_FILES := android_jni.c lzs_renderer.c lzs_tracker.c lzs_pipeline.c \
+                   lzs_kernel.c lzs_kernel_sse2.c lzs_kernel_avx2.c \
+                   lzs_pyramid.c lzs_motion.c lzs_reacquire.c \
+                   lzs_circle.c lzs_fusion.c lzs_sensors.c \
+                   lzs_control.c lzs_camera.c lzs_timing.c \
+                   lzs_recorder.c lzs_trackerset.c lzs_overlay.c \
+                   lzs_gate.c lzs_background.c lzs_color.c \
+                   lzs_particles.c lzs_budget.c lzs_config.c
 LOCAL_LDLIBS    := -Llibs/armeabi \
                    -llog -la3d -ltexgz
 
+# NEON is optional on armeabi-v7a and detected at runtime
+ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
+	LOCAL_CFLAGS           += -DLZS_KERNEL_HAVE_NEON
+	LOCAL_SRC_FILES        += lzs_kernel_neon.c.neon
+	LOCAL_STATIC_LIBRARIES := cpufeatures
+endif
+ifeq ($(TARGET_ARCH_ABI),arm64-v8a)
+	LOCAL_SRC_FILES += lzs_kernel_neon.c
+endif
+
 include $(BUILD_SHARED_LIBRARY)
+
+$(call import-module,android/cpufeatures)
@@ -36,6 +36,10 @@
 
 static lzs_renderer_t* lzs_renderer = NULL;
 
+// the sensor ring outlives the renderer and is drained
+// before each frame
+static lzs_sensors_t* volatile lzs_sensors = NULL;
+
 /***********************************************************
 * public                                                   *
 ***********************************************************/
@@ -57,7 +61,8 @@ JNIEXPORT void JNICALL Java_com_jeffboody_a3d_A3DNativeRenderer_NativeCreate(JNI
 		return;
 	}
 
-	lzs_renderer = lzs_renderer_new("/data/data/com.jeffboody.LaserShark/files/whitrabt.tex.gz");
+	lzs_renderer = lzs_renderer_new("/data/data/com.jeffboody.LaserShark/files/whitrabt.tex.gz",
+	                                "/sdcard/laser-shark/lasershark.cfg");
 }
 
 JNIEXPORT void JNICALL Java_com_jeffboody_a3d_A3DNativeRenderer_NativeDestroy(JNIEnv* env)
@@ -90,6 +95,12 @@ JNIEXPORT void JNICALL Java_com_jeffboody_a3d_A3DNativeRenderer_NativeDraw(JNIEn
 
 	if(lzs_renderer)
 	{
+		lzs_sensors_t* sensors = lzs_sensors;
+		if(sensors)
+		{
+			lzs_renderer_sensors(lzs_renderer, sensors);
+		}
+
 		a3d_GL_frame_begin();
 		lzs_renderer_draw(lzs_renderer);
 		a3d_GL_frame_end();
@@ -115,6 +126,36 @@ JNIEXPORT int JNICALL Java_com_jeffboody_LaserShark_LaserSharkRenderer_NativeGet
 	return 0;
 }
 
+JNIEXPORT void JNICALL Java_com_jeffboody_LaserShark_LaserSharkRenderer_NativeLuma(JNIEnv* env, jobject obj, jbyteArray data, jint width, jint height)
+{
+	assert(env);
+	LOGD("debug width=%i, height=%i", width, height);
+
+	if(lzs_renderer && data)
+	{
+		// the Y plane is the first width*height bytes of the
+		// NV21 preview followed by the VU plane. onPreviewFrame
+		// runs on the thread that opened the camera (the UI
+		// thread) so the window is copied into the pipeline ring
+		// and the critical array is released without waiting
+		// for the tracker
+		jsize          size = (*env)->GetArrayLength(env, data);
+		unsigned char* luma = (unsigned char*) (*env)->GetPrimitiveArrayCritical(env, data, NULL);
+		if(luma == NULL)
+		{
+			LOGE("GetPrimitiveArrayCritical failed");
+			return;
+		}
+		unsigned char* chroma = NULL;
+		if(size >= width*height + 2*((width + 1)/2)*((height + 1)/2))
+		{
+			chroma = &luma[width*height];
+		}
+		lzs_renderer_luma(lzs_renderer, luma, chroma, width, height, width);
+		(*env)->ReleasePrimitiveArrayCritical(env, data, luma, JNI_ABORT);
+	}
+}
+
 JNIEXPORT void JNICALL Java_com_jeffboody_LaserShark_LaserShark_NativeTouchOne(JNIEnv* env, jobject obj, jfloat x1, jfloat y1)
 {
 	assert(env);
@@ -139,54 +180,70 @@ JNIEXPORT void JNICALL Java_com_jeffboody_LaserShark_LaserShark_NativeTouchTwo(J
 	}
 }
 
-JNIEXPORT void JNICALL Java_com_jeffboody_LaserShark_LaserShark_NativeGyroEvent(JNIEnv* env, jobject obj, jfloat v1, jfloat v2, jfloat v3, jfloat dt)
+JNIEXPORT jint JNICALL Java_com_jeffboody_LaserShark_LaserShark_NativeAddSphero(JNIEnv* env, jobject obj, jfloat x, jfloat y)
 {
 	assert(env);
-	LOGD("debug v1=%f, v2=%f, v3=%f, dt=%f", v1, v2, v3, dt);
-}
-
-JNIEXPORT void JNICALL Java_com_jeffboody_LaserShark_LaserShark_NativeSpheroOrientation(JNIEnv* env, jobject obj, jfloat pitch, jfloat roll, jfloat yaw)
-{
-	assert(env);
-	LOGD("debug pitch=%f, roll=%f, roll=%f", pitch, roll, yaw);
+	LOGD("debug x=%f, y=%f", x, y);
 
+	// returns the index of the new ball or -1
 	if(lzs_renderer)
 	{
-		lzs_renderer_spheroorientation(lzs_renderer, pitch, roll, yaw);
+		return lzs_renderer_addsphero(lzs_renderer, x, y);
 	}
+	return -1;
 }
 
-JNIEXPORT void JNICALL Java_com_jeffboody_LaserShark_LaserShark_NativePhoneOrientation(JNIEnv* env, jobject obj, jfloat pitch, jfloat roll, jfloat yaw)
+JNIEXPORT void JNICALL Java_com_jeffboody_LaserShark_SensorRing_NativeAttach(JNIEnv* env, jobject obj, jobject buffer)
 {
 	assert(env);
-	LOGD("debug pitch=%f, roll=%f, roll=%f", pitch, roll, yaw);
+	LOGD("debug");
 
-	if(lzs_renderer)
+	// the ring is attached once and Java keeps the buffer
+	// for the life of the process
+	if(lzs_sensors || (buffer == NULL))
 	{
-		lzs_renderer_phoneorientation(lzs_renderer, pitch, roll, yaw);
+		return;
 	}
+
+	void* addr = (*env)->GetDirectBufferAddress(env, buffer);
+	jlong size = (*env)->GetDirectBufferCapacity(env, buffer);
+	if((addr == NULL) || (size <= 0))
+	{
+		LOGE("invalid buffer");
+		return;
+	}
+
+	lzs_sensors_t* sensors = lzs_sensors_attach(addr, (int) size);
+	__sync_synchronize();
+	lzs_sensors = sensors;
 }
 
-JNIEXPORT int JNICALL Java_com_jeffboody_LaserShark_LaserShark_NativeSpheroHeading(JNIEnv* env)
+JNIEXPORT void JNICALL Java_com_jeffboody_LaserShark_SensorRing_NativeCommit(JNIEnv* env, jobject obj, jint head)
 {
 	assert(env);
-	LOGD("debug");
+	LOGD("debug head=%i", head);
 
-	if(lzs_renderer)
+	lzs_sensors_t* sensors = lzs_sensors;
+	if(sensors)
 	{
-		return lzs_renderer_spheroheading(lzs_renderer);
+		lzs_sensors_commit(sensors, head);
 	}
-	return 0;
 }
 
-JNIEXPORT float JNICALL Java_com_jeffboody_LaserShark_LaserShark_NativeSpheroSpeed(JNIEnv* env)
+JNIEXPORT jboolean JNICALL Java_com_jeffboody_LaserShark_LaserShark_NativeSpheroCommand(JNIEnv* env, jobject obj, jint index, jfloatArray command)
 {
 	assert(env);
-	LOGD("debug");
-
-	if(lzs_renderer)
+	LOGD("debug index=%i", index);
+
+	// command is {heading, speed} of the ball at index
+	// (see lzs_renderer_spherocommand) and is only written
+	// when a new command was published
+	float c[2];
+	if(lzs_renderer && command &&
+	   lzs_renderer_spherocommand(lzs_renderer, index, &c[0], &c[1]))
 	{
-		return lzs_renderer_spherospeed(lzs_renderer);
+		(*env)->SetFloatArrayRegion(env, command, 0, 2, c);
+		return JNI_TRUE;
 	}
-	return 0.0f;
+	return JNI_FALSE;
 }
@@ -0,0 +1,435 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "lzs_scene.h"
+#include "lzs_pipeline.h"
+#include "lzs_camera.h"
+#include "a3d/a3d_time.h"
+
+#define LOG_TAG "lzs_bench"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+// incremented whenever the scenes or metrics change so
+// that results are only compared with the same version
+#define BENCH_VERSION 7
+
+#define BENCH_W      640
+#define BENCH_H      480
+#define BENCH_FRAMES 300
+
+static const lzs_scene_t SCENES[] =
+{
+	// name, path, speed, radius, ball, floor, contrast, seam,
+	// light, noise, blur, hide0, hide1, pan, slope, height
+	{ "static", LZS_SCENE_STATIC,   0.0f, 24.0f, 230,  90, 40,  0, 0.2f,  2.0f, 0, 0,   0,  0.0f, 45.0f, 4.5f },
+	{ "line",   LZS_SCENE_LINE,   120.0f, 24.0f, 230,  90, 40,  0, 0.2f,  2.0f, 0, 0,   0,  5.0f, 45.0f, 4.5f },
+	{ "circle", LZS_SCENE_CIRCLE, 150.0f, 20.0f, 220, 100, 50,  0, 0.3f,  3.0f, 0, 0,   0, 10.0f, 40.0f, 4.5f },
+	{ "eight",  LZS_SCENE_EIGHT,  400.0f, 24.0f, 230,  90, 40,  0, 0.2f,  3.0f, 2, 0,   0, 10.0f, 45.0f, 4.5f },
+	{ "dim",    LZS_SCENE_LINE,   120.0f, 24.0f, 150, 100, 40,  0, 0.5f, 12.0f, 1, 0,   0,  5.0f, 45.0f, 4.5f },
+	{ "vanish", LZS_SCENE_CIRCLE, 150.0f, 24.0f, 230,  90, 40,  0, 0.2f,  2.0f, 0, 100, 130, 0.0f, 45.0f, 4.5f },
+	{ "tile",   LZS_SCENE_LINE,   120.0f, 24.0f, 210, 140, 20, 30, 0.2f,  3.0f, 1, 0,   0,  5.0f, 45.0f, 4.5f },
+};
+#define SCENE_COUNT ((int) (sizeof(SCENES)/sizeof(lzs_scene_t)))
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return 1.0e9*((double) ts.tv_sec) + (double) ts.tv_nsec;
+}
+
+static int compare_float(const void* a, const void* b)
+{
+	float fa = *((const float*) a);
+	float fb = *((const float*) b);
+	return (fa < fb) ? -1 : ((fa > fb) ? 1 : 0);
+}
+
+static float percentile(float* v, int n, float p)
+{
+	if(n <= 0)
+	{
+		return 0.0f;
+	}
+	qsort(v, n, sizeof(float), compare_float);
+	int i = (int) (p*((float) (n - 1)) + 0.5f);
+	return v[i];
+}
+
+static void usage(const char* argv0)
+{
+	LOGE("usage: %s [-s scene] [-n frames] [-c] [-k] [-b] [-p] [-t ms] [-r ms] [-f config] [-o dir]", argv0);
+	LOGE("-s runs a single scene (default all)");
+	LOGE("-n sets the frames per scene (default %i)", BENCH_FRAMES);
+	LOGE("-c runs the circle detector only (default all)");
+	LOGE("-k runs the LED color detector only (default all)");
+	LOGE("-b enables the floor background model (background in the config)");
+	LOGE("-p tracks with the particle filter (circle is skipped)");
+	LOGE("-t sets the frame time budget of the scheduler (default %i ms)",
+	     LZS_BUDGET_NS/1000000);
+	LOGE("-r adds the cost of a draw to each frame for the scheduler (default 0 ms)");
+	LOGE("-f loads the tracker config (see lzs_config.h)");
+	LOGE("-o writes dir/scene.nv21 and dir/scene.txt for lzs_lumareplay");
+	LOGE("one JSON object is printed per scene and detector");
+}
+
+static FILE* open_output(const char* dir, const char* name, const char* ext)
+{
+	char fname[256];
+	snprintf(fname, 256, "%s/%s.%s", dir, name, ext);
+	FILE* f = fopen(fname, "w");
+	if(f == NULL)
+	{
+		LOGE("fopen %s failed", fname);
+	}
+	return f;
+}
+
+static int bench(const lzs_config_t* config, const lzs_scene_t* scene,
+                 int detector, int particles, float budget,
+                 float render, int frames, const char* dir)
+{
+	int            ret      = 0;
+	int            size     = BENCH_W*BENCH_H;
+	unsigned char* frame    = (unsigned char*) malloc(size + size/2);
+	float*         err      = (float*) malloc(frames*sizeof(float));
+	float*         dt       = (float*) malloc(frames*sizeof(float));
+	FILE*          fnv21    = NULL;
+	FILE*          ftxt     = NULL;
+	if((frame == NULL) || (err == NULL) || (dt == NULL))
+	{
+		LOGE("malloc failed");
+		goto fail_malloc;
+	}
+
+	if(dir)
+	{
+		fnv21 = open_output(dir, scene->name, "nv21");
+		ftxt  = open_output(dir, scene->name, "txt");
+		if((fnv21 == NULL) || (ftxt == NULL))
+		{
+			goto fail_output;
+		}
+	}
+
+	lzs_scenegen_t* gen = lzs_scenegen_new(scene, BENCH_W, BENCH_H);
+	if(gen == NULL)
+	{
+		goto fail_gen;
+	}
+
+	lzs_pipeline_t* pipeline = lzs_pipeline_new(config, detector);
+	if(pipeline == NULL)
+	{
+		goto fail_pipeline;
+	}
+
+	if(lzs_tracker_particles(pipeline->tracker, particles) == 0)
+	{
+		goto fail_camera;
+	}
+	lzs_pipeline_budget(pipeline, (unsigned int) (1.0e6f*budget));
+
+	// ground truth uses the same camera model as the tracker
+	// so the ground error only measures the pixel error
+	lzs_camera_t* camera = lzs_camera_new((int) config->screen_w,
+	                                      (int) config->screen_h,
+	                                      0.5f*config->screen_w,
+	                                      0.5f*config->screen_h,
+	                                      LZS_CAMERA_FOVX, LZS_CAMERA_FOVY);
+	if(camera == NULL)
+	{
+		goto fail_camera;
+	}
+
+	// tracker results are in screen coordinates
+	float       sx = config->screen_w/((float) BENCH_W);
+	float       sy = config->screen_h/((float) BENCH_H);
+	lzs_truth_t truth;
+	lzs_scenegen_truth(gen, 0, &truth);
+	lzs_pipeline_searchsphero(pipeline, sx*truth.x, sy*truth.y);
+
+	double       t0      = a3d_utime();
+	double       gsum    = 0.0;
+	double       esum    = 0.0;
+	double       dsum    = 0.0;
+	float        emax    = 0.0f;
+	int          visible = 0;
+	int          lost    = 0;
+	int          levels  = 0;
+	int          text_levels = 0;
+	float        heading = 0.0f;
+	float        slope   = 0.0f;
+	lzs_result_t result;
+	int n;
+	for(n = 0; n < frames; ++n)
+	{
+		lzs_scenegen_render(gen, n, frame, &frame[size], &truth);
+		if(fnv21)
+		{
+			fwrite(frame, size + size/2, 1, fnv21);
+			fprintf(ftxt, "%i %f %f %i %f %f %f\n", n, truth.x, truth.y,
+			        truth.visible, truth.heading, truth.slope, truth.height);
+		}
+
+		// the phone track replaces the fused orientation and
+		// the gyro rate is its derivative
+		if(n > 0)
+		{
+			float dh = truth.heading - heading;
+			float ds = truth.slope   - slope;
+			float w  = 30.0f*((float) M_PI/180.0f)*sqrtf(dh*dh + ds*ds);
+			lzs_pipeline_gyro(pipeline, w, 0.0f, 0.0f);
+		}
+		heading = truth.heading;
+		slope   = truth.slope;
+		lzs_pipeline_phonepose(pipeline, truth.heading, truth.slope, truth.height);
+
+		double t  = t0 + A3D_USEC*((double) (n + 1))/30.0;
+		double t1 = now_ns();
+		lzs_pipeline_luma(pipeline, frame, &frame[size], BENCH_W, BENCH_H, BENCH_W, t);
+		lzs_pipeline_flush(pipeline);
+		dt[n] = (float) (now_ns() - t1);
+		dsum += dt[n];
+
+		// the draw is simulated since the bench has no GL
+		lzs_budget_render(&pipeline->budget, (unsigned int) (1.0e6f*render));
+
+		lzs_pipeline_result(pipeline, &result);
+		levels      += pipeline->budget.vision.level;
+		text_levels += pipeline->budget.render.level;
+		if(truth.visible == 0)
+		{
+			continue;
+		}
+
+		// pixel error in preview pixels
+		float ex = result.sphero_x/sx - truth.x;
+		float ey = result.sphero_y/sy - truth.y;
+		float e  = sqrtf(ex*ex + ey*ey);
+		if(result.lost || (e > 2.0f*scene->radius))
+		{
+			++lost;
+		}
+		else
+		{
+			float x = sx*truth.x;
+			float y = sy*truth.y;
+			float X;
+			float Y;
+			lzs_camera_pose(camera, truth.heading, truth.slope, truth.height);
+			lzs_camera_ground(camera, 1, &x, &y, &X, &Y);
+			float eX = result.sphero_X - X;
+			float eY = result.sphero_Y - Y;
+			gsum += sqrt(eX*eX + eY*eY);
+		}
+		err[visible++] = e;
+		esum += e;
+		if(e > emax)
+		{
+			emax = e;
+		}
+	}
+
+	// the detect stage excludes the hand off to the worker
+	lzs_timingstats_t detect;
+	lzs_timing_stats(&pipeline->timing, LZS_TIMING_DETECT, &detect);
+
+	const char* name  = "peak";
+	int         found = visible - lost;
+	float       p95   = percentile(err, visible, 0.95f);
+	float       p50   = percentile(dt, frames, 0.5f);
+	if(detector == LZS_DETECTOR_CIRCLE)
+	{
+		name = "circle";
+	}
+	else if(detector == LZS_DETECTOR_COLOR)
+	{
+		name = "color";
+	}
+	printf("{\"version\":%i, \"scene\":\"%s\", \"detector\":\"%s\", "
+	       "\"filter\":\"%s\", \"frames\":%i, \"visible\":%i, "
+	       "\"px_mean\":%.3f, \"px_p95\":%.3f, \"px_max\":%.3f, "
+	       "\"ground_mean\":%.4f, \"loss\":%.4f, "
+	       "\"ns_mean\":%.0f, \"ns_p50\":%.0f, \"detect_p50\":%u, "
+	       "\"skipped\":%.4f, \"level_mean\":%.3f, \"misses\":%u, "
+	       "\"notext\":%.3f, \"render_misses\":%u}\n",
+	       BENCH_VERSION, scene->name, name,
+	       particles ? "particles" : "kalman", frames, visible,
+	       (visible > 0) ? esum/visible : 0.0, p95, emax,
+	       (found > 0) ? gsum/found : 0.0,
+	       (visible > 0) ? ((double) lost)/visible : 0.0,
+	       (frames > 0) ? dsum/frames : 0.0, p50, detect.p50,
+	       (pipeline->gate.frames > 0) ?
+	       ((double) pipeline->gate.skipped)/pipeline->gate.frames : 0.0,
+	       ((double) levels)/frames, pipeline->budget.vision.misses,
+	       ((double) text_levels)/frames, pipeline->budget.render.misses);
+	fflush(stdout);
+	ret = 1;
+
+	lzs_camera_delete(&camera);
+	fail_camera:
+		lzs_pipeline_delete(&pipeline);
+	fail_pipeline:
+		lzs_scenegen_delete(&gen);
+	fail_gen:
+	fail_output:
+		if(fnv21)
+		{
+			fclose(fnv21);
+		}
+		if(ftxt)
+		{
+			fclose(ftxt);
+		}
+	fail_malloc:
+		free(frame);
+		free(err);
+		free(dt);
+	return ret;
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+int main(int argc, char** argv)
+{
+	const char* name   = NULL;
+	const char* dir    = NULL;
+	int         frames = BENCH_FRAMES;
+	int         only   = -1;
+	int         particles  = 0;
+	float       budget     = LZS_BUDGET_NS/1.0e6f;
+	float       render     = 0.0f;
+
+	// the bench searches the whole window unless -f sets it
+	lzs_config_t config;
+	lzs_config_defaults(&config);
+	config.search_radius = (int) LZS_RADIUS_MAX;
+
+	int i;
+	for(i = 1; i < argc; ++i)
+	{
+		if((strcmp(argv[i], "-s") == 0) && (i + 1 < argc))
+		{
+			name = argv[++i];
+		}
+		else if((strcmp(argv[i], "-n") == 0) && (i + 1 < argc))
+		{
+			frames = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "-c") == 0)
+		{
+			only = LZS_DETECTOR_CIRCLE;
+		}
+		else if(strcmp(argv[i], "-k") == 0)
+		{
+			only = LZS_DETECTOR_COLOR;
+		}
+		else if(strcmp(argv[i], "-b") == 0)
+		{
+			config.background = 1;
+		}
+		else if(strcmp(argv[i], "-p") == 0)
+		{
+			particles = LZS_PARTICLES_COUNT;
+		}
+		else if((strcmp(argv[i], "-t") == 0) && (i + 1 < argc))
+		{
+			budget = (float) atof(argv[++i]);
+		}
+		else if((strcmp(argv[i], "-r") == 0) && (i + 1 < argc))
+		{
+			render = (float) atof(argv[++i]);
+		}
+		else if((strcmp(argv[i], "-f") == 0) && (i + 1 < argc))
+		{
+			if(lzs_config_load(&config, argv[++i]) == 0)
+			{
+				return EXIT_FAILURE;
+			}
+		}
+		else if((strcmp(argv[i], "-o") == 0) && (i + 1 < argc))
+		{
+			dir = argv[++i];
+		}
+		else
+		{
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if((frames <= 0) || (budget <= 0.0f) || (render < 0.0f))
+	{
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	int count = 0;
+	for(i = 0; i < SCENE_COUNT; ++i)
+	{
+		const lzs_scene_t* scene = &SCENES[i];
+		if(name && strcmp(name, scene->name))
+		{
+			continue;
+		}
+
+		// the frames are only written once
+		const char* out = dir;
+		int         d;
+		for(d = LZS_DETECTOR_PEAK; d <= LZS_DETECTOR_COLOR; ++d)
+		{
+			// the particles replace the peak and circle search
+			if(((only >= 0) && (d != only)) ||
+			   (particles && (d == LZS_DETECTOR_CIRCLE)))
+			{
+				continue;
+			}
+			if(bench(&config, scene, d, particles,
+			         budget, render, frames, out) == 0)
+			{
+				return EXIT_FAILURE;
+			}
+			out = NULL;
+		}
+		++count;
+	}
+
+	if(count == 0)
+	{
+		LOGE("unknown scene %s", name);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "lzs_control.h"
+#include "a3d/a3d_time.h"
+
+#define LOG_TAG "lzs_controlsim"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+// the simulated ball follows the command which reached it
+// with a first order lag and is seen by a 30 Hz camera whose
+// tracker output is available LATENCY_CAMERA seconds later
+// while each command reaches the ball LATENCY_LINK seconds
+// after Java takes it
+#define FRAME_HZ       30
+#define LATENCY_CAMERA 0.05f
+#define LATENCY_LINK   0.1f
+#define NOISE          0.05f   // ft
+#define ARRIVED        0.5f    // ft
+#define QUEUE          64
+
+typedef struct
+{
+	double t;
+	float  heading;
+	float  speed;
+} lzs_simcommand_t;
+
+typedef struct
+{
+	double t;
+	float  X;
+	float  Y;
+} lzs_simframe_t;
+
+typedef struct
+{
+	float t_arrived;
+	float mean;
+	float max;
+	int   commands;
+} lzs_simstats_t;
+
+static float gauss(float sigma)
+{
+	// Box-Muller
+	float u1 = ((float) (rand() + 1))/((float) RAND_MAX + 2.0f);
+	float u2 = ((float) rand())/((float) RAND_MAX);
+	return sigma*sqrtf(-2.0f*logf(u1))*cosf(2.0f*((float) M_PI)*u2);
+}
+
+// legacy steers with the tracker output at 10 Hz as the
+// Java handler did before the control thread
+static void simulate(int hz, int legacy, float seconds, lzs_simstats_t* stats)
+{
+	srand(1);
+	memset(stats, 0, sizeof(lzs_simstats_t));
+	stats->t_arrived = -1.0f;
+
+	// ball starts 6 ft from the target at the origin
+	float X  = 5.0f;
+	float Y  = -3.0f;
+	float vX = 0.0f;
+	float vY = 0.0f;
+
+	lzs_simcommand_t active = { .t = 0.0, .heading = 0.0f, .speed = 0.0f };
+	lzs_simcommand_t sent[QUEUE];
+	lzs_simframe_t   frames[QUEUE];
+	int sent_head   = 0;
+	int sent_tail   = 0;
+	int frames_head = 0;
+	int frames_tail = 0;
+
+	lzs_config_t config;
+	lzs_config_defaults(&config);
+
+	lzs_result_t result;
+	memset(&result, 0, sizeof(lzs_result_t));
+	result.sphero_X = X;
+	result.sphero_Y = Y;
+
+	lzs_motion_t motion;
+	lzs_motion_reset(&motion);
+
+	lzs_command_t last;
+	memset(&last, 0, sizeof(lzs_command_t));
+	unsigned int taken      = 0;
+	float        take_delay = 0.0f;
+
+	int    steps = (int) (1000.0f*seconds);
+	int    tick  = 1000/hz;
+	double sum   = 0.0;
+	int    n     = 0;
+	int    ms;
+	for(ms = 0; ms < steps; ++ms)
+	{
+		double t  = ((double) ms)/1000.0;
+		double tu = A3D_USEC*t;
+
+		// capture a frame and publish the tracker output
+		// once it has been processed
+		if((ms % (1000/FRAME_HZ)) == 0)
+		{
+			lzs_simframe_t* f = &frames[frames_head++ % QUEUE];
+			f->t = t;
+			f->X = X + gauss(NOISE);
+			f->Y = Y + gauss(NOISE);
+		}
+		while((frames_tail != frames_head) &&
+		      (frames[frames_tail % QUEUE].t + LATENCY_CAMERA <= t))
+		{
+			lzs_simframe_t* f  = &frames[frames_tail++ % QUEUE];
+			float           w  = active.heading*M_PI/180.0f;
+			float           uX = LZS_MOTION_FTPS*active.speed*sinf(w);
+			float           uY = LZS_MOTION_FTPS*active.speed*cosf(w);
+			double          tc = A3D_USEC*f->t;
+			lzs_motion_update(&motion, tc, f->X, f->Y, f->X, f->Y,
+			                  active.speed, uX, uY);
+			result.sphero_X       = f->X;
+			result.sphero_Y       = f->Y;
+			result.sphero_vX      = motion.X.v;
+			result.sphero_vY      = motion.Y.v;
+			result.sphero_heading = active.heading;
+			result.t_capture      = tc;
+		}
+
+		// publish and take the commands where Java polls
+		// half a tick after the control thread
+		if(legacy && ((ms % 100) == 0))
+		{
+			lzs_simcommand_t* c = &sent[sent_head++ % QUEUE];
+			c->t = t + LATENCY_LINK;
+			lzs_tracker_command(&config, -result.sphero_X, -result.sphero_Y,
+			                    result.sphero_heading, 0.0f,
+			                    &c->heading, &c->speed);
+			++stats->commands;
+		}
+		else if((legacy == 0) && ((ms % tick) == 0))
+		{
+			float horizon = (float) ((tu - result.t_capture)/A3D_USEC) +
+			                take_delay + LZS_CONTROL_LINK;
+			if(horizon > LZS_CONTROL_HORIZON)
+			{
+				horizon = LZS_CONTROL_HORIZON;
+			}
+
+			lzs_command_t command;
+			if(lzs_control_compute(&config, &result, &last, horizon, tu, &command))
+			{
+				last = command;
+			}
+		}
+		else if((legacy == 0) && ((ms % tick) == tick/2) && (last.id != taken))
+		{
+			taken = last.id;
+			take_delay += 0.1f*((float) ((tu - last.t_publish)/A3D_USEC) - take_delay);
+
+			lzs_simcommand_t* c = &sent[sent_head++ % QUEUE];
+			c->t       = t + LATENCY_LINK;
+			c->heading = last.heading;
+			c->speed   = last.speed;
+			++stats->commands;
+		}
+
+		// deliver the commands and move the ball
+		while((sent_tail != sent_head) && (sent[sent_tail % QUEUE].t <= t))
+		{
+			active = sent[sent_tail++ % QUEUE];
+		}
+
+		float dt = 0.001f;
+		float k  = dt/(LZS_MOTION_TAU + dt);
+		float w  = active.heading*M_PI/180.0f;
+		vX += k*(LZS_MOTION_FTPS*active.speed*sinf(w) - vX);
+		vY += k*(LZS_MOTION_FTPS*active.speed*cosf(w) - vY);
+		X  += vX*dt;
+		Y  += vY*dt;
+
+		float d = sqrtf(X*X + Y*Y);
+		if((stats->t_arrived < 0.0f) && (d < ARRIVED))
+		{
+			stats->t_arrived = (float) t;
+		}
+		else if(stats->t_arrived >= 0.0f)
+		{
+			sum += d;
+			++n;
+			if(d > stats->max)
+			{
+				stats->max = d;
+			}
+		}
+	}
+
+	if(n > 0)
+	{
+		stats->mean = (float) (sum/((double) n));
+	}
+}
+
+static void print_stats(const char* name, const lzs_simstats_t* s)
+{
+	printf("%s: arrived=%0.2f s, mean=%0.2f ft, max=%0.2f ft, commands=%i\n",
+	       name, s->t_arrived, s->mean, s->max, s->commands);
+}
+
+static void usage(const char* argv0)
+{
+	LOGE("usage: %s [-r hz] [-s seconds]", argv0);
+	LOGE("-r sets the control rate (default %i)", LZS_CONTROL_HZ);
+	LOGE("compares the legacy 10 Hz steering with the control thread");
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+int main(int argc, char** argv)
+{
+	int   hz      = LZS_CONTROL_HZ;
+	float seconds = 20.0f;
+	int i;
+	for(i = 1; i < argc; ++i)
+	{
+		if((strcmp(argv[i], "-r") == 0) && (i + 1 < argc))
+		{
+			hz = atoi(argv[++i]);
+		}
+		else if((strcmp(argv[i], "-s") == 0) && (i + 1 < argc))
+		{
+			seconds = (float) atof(argv[++i]);
+		}
+		else
+		{
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if((hz < 1) || (hz > 500) || (seconds <= 0.0f))
+	{
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	lzs_simstats_t legacy;
+	lzs_simstats_t control;
+	simulate(10, 1, seconds, &legacy);
+	simulate(hz, 0, seconds, &control);
+	print_stats("legacy ", &legacy);
+	print_stats("control", &control);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,480 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "lzs_fusion.h"
+#include "lzs_sensors.h"
+
+#define LOG_TAG "lzs_fusionreplay"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+// sensors.txt is written by the renderer when DEBUG_SENSORS
+// is defined and each line contains
+// type x y z dt
+// where type is g (rad/s), a (m/s^2) or m (uT)
+typedef struct
+{
+	char  type;
+	float v[3];
+	float dt;
+
+	// orientation of synthetic traces
+	int   truth;
+	float heading;
+	float pitch;
+	float roll;
+} lzs_sensorevent_t;
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return 1.0e9*((double) ts.tv_sec) + (double) ts.tv_nsec;
+}
+
+static float gauss(float sigma)
+{
+	// Box-Muller
+	float u1 = ((float) (rand() + 1))/((float) RAND_MAX + 2.0f);
+	float u2 = ((float) rand())/((float) RAND_MAX);
+	return sigma*sqrtf(-2.0f*logf(u1))*cosf(2.0f*((float) M_PI)*u2);
+}
+
+static float fixdelta(float a)
+{
+	while(a > 180.0f)
+	{
+		a -= 360.0f;
+	}
+	while(a < -180.0f)
+	{
+		a += 360.0f;
+	}
+	return a;
+}
+
+static int push_event(lzs_sensorevent_t** _events, int* count, int* size,
+                      const lzs_sensorevent_t* e)
+{
+	if(*count == *size)
+	{
+		*size = (*size == 0) ? 1024 : 2*(*size);
+		lzs_sensorevent_t* tmp = (lzs_sensorevent_t*) realloc(*_events, (*size)*sizeof(lzs_sensorevent_t));
+		if(tmp == NULL)
+		{
+			LOGE("realloc failed");
+			return 0;
+		}
+		*_events = tmp;
+	}
+	(*_events)[(*count)++] = *e;
+	return 1;
+}
+
+static lzs_sensorevent_t* load_events(const char* fname, int* _count)
+{
+	FILE* f = fopen(fname, "r");
+	if(f == NULL)
+	{
+		LOGE("fopen %s failed", fname);
+		return NULL;
+	}
+
+	int                count  = 0;
+	int                size   = 0;
+	lzs_sensorevent_t* events = NULL;
+	lzs_sensorevent_t  e;
+	memset(&e, 0, sizeof(lzs_sensorevent_t));
+	while(fscanf(f, " %c %f %f %f %f", &e.type,
+	             &e.v[0], &e.v[1], &e.v[2], &e.dt) == 5)
+	{
+		if(push_event(&events, &count, &size, &e) == 0)
+		{
+			break;
+		}
+	}
+	fclose(f);
+
+	*_count = count;
+	return events;
+}
+
+// device to world rotation for a phone that turns by
+// heading about Up after tilting by slope about East
+static void synth_rotation(float heading, float slope, float* R)
+{
+	float ch = cosf(heading);
+	float sh = sinf(heading);
+	float cs = cosf(slope);
+	float ss = sinf(slope);
+
+	// Rz(-heading)*Rx(slope)
+	R[0] = ch;
+	R[1] = sh*cs;
+	R[2] = -sh*ss;
+	R[3] = -sh;
+	R[4] = ch*cs;
+	R[5] = -ch*ss;
+	R[6] = 0.0f;
+	R[7] = ss;
+	R[8] = cs;
+}
+
+static void synth_pose(double t, float* R)
+{
+	// pan and tilt as if following the ball
+	float heading = (float) (0.6*sin(0.7*t) + 0.2*sin(2.3*t));
+	float slope   = (float) (1.1 + 0.2*sin(0.9*t));
+	synth_rotation(heading, slope, R);
+}
+
+// R^T v
+static void to_device(const float* R, const float* v, float* d)
+{
+	d[0] = R[0]*v[0] + R[3]*v[1] + R[6]*v[2];
+	d[1] = R[1]*v[0] + R[4]*v[1] + R[7]*v[2];
+	d[2] = R[2]*v[0] + R[5]*v[1] + R[8]*v[2];
+}
+
+// noisy 200 Hz gyro with a bias, 100 Hz accelerometer with
+// hand shake and 50 Hz magnetometer
+static lzs_sensorevent_t* synth_events(float seconds, int* _count)
+{
+	const float g[3] = { 0.0f, 0.0f, 9.81f };
+	const float b[3] = { 0.0f, 22.0f, -40.0f };
+	const float bias[3] = { 0.02f, -0.01f, 0.015f };
+
+	int                count  = 0;
+	int                size   = 0;
+	lzs_sensorevent_t* events = NULL;
+	int                steps  = (int) (200.0f*seconds);
+	float              dt     = 1.0f/200.0f;
+	int i;
+	int j;
+	for(i = 0; i < steps; ++i)
+	{
+		double t = ((double) i)*dt;
+		float  R0[9];
+		float  R1[9];
+		synth_pose(t, R0);
+		synth_pose(t + dt, R1);
+
+		lzs_sensorevent_t e;
+		memset(&e, 0, sizeof(lzs_sensorevent_t));
+		if((i%2) == 0)
+		{
+			e.type = 'a';
+			to_device(R1, g, e.v);
+			for(j = 0; j < 3; ++j)
+			{
+				e.v[j] += gauss(0.3f);
+			}
+			push_event(&events, &count, &size, &e);
+		}
+		if((i%4) == 0)
+		{
+			e.type = 'm';
+			to_device(R1, b, e.v);
+			for(j = 0; j < 3; ++j)
+			{
+				e.v[j] += gauss(1.5f);
+			}
+			push_event(&events, &count, &size, &e);
+		}
+
+		// R0^T R1 = I + [w]x dt
+		float S[9];
+		int   r;
+		int   c;
+		for(r = 0; r < 3; ++r)
+		{
+			for(c = 0; c < 3; ++c)
+			{
+				S[3*r + c] = R0[r]*R1[c] + R0[3 + r]*R1[3 + c] + R0[6 + r]*R1[6 + c];
+			}
+		}
+		e.type  = 'g';
+		e.dt    = dt;
+		e.v[0]  = 0.5f*(S[7] - S[5])/dt + bias[0] + gauss(0.01f);
+		e.v[1]  = 0.5f*(S[2] - S[6])/dt + bias[1] + gauss(0.01f);
+		e.v[2]  = 0.5f*(S[3] - S[1])/dt + bias[2] + gauss(0.01f);
+		e.truth = 1;
+		lzs_fusion_angles(R1, &e.heading, &e.pitch, &e.roll);
+		push_event(&events, &count, &size, &e);
+	}
+
+	*_count = count;
+	return events;
+}
+
+typedef struct
+{
+	int   n;
+	float last[3];
+	float jitter;
+	float error;
+} lzs_fusionstats_t;
+
+static void stats_update(lzs_fusionstats_t* s, const lzs_sensorevent_t* e,
+                         float heading, float pitch, float roll)
+{
+	float a[3] = { heading, pitch, roll };
+	float t[3] = { e->heading, e->pitch, e->roll };
+	int i;
+	for(i = 0; i < 3; ++i)
+	{
+		if(s->n > 0)
+		{
+			float d = fixdelta(a[i] - s->last[i]);
+			s->jitter += d*d;
+		}
+		if(e->truth)
+		{
+			float d = fixdelta(a[i] - t[i]);
+			s->error += d*d;
+		}
+		s->last[i] = a[i];
+	}
+	++s->n;
+}
+
+// passes the events through the sensor ring the way that
+// SensorRing.java appends and commits them and the renderer
+// drains them and returns the number of records that differ
+static int check_ring(const lzs_sensorevent_t* events, int count, int batch)
+{
+	int            capacity = 256;
+	int            size     = sizeof(lzs_sensors_t) + capacity*sizeof(lzs_sensor_t);
+	unsigned char* buffer   = (unsigned char*) calloc(1, size);
+	if(buffer == NULL)
+	{
+		LOGE("calloc failed");
+		return 1;
+	}
+	((lzs_sensors_t*) buffer)->capacity = capacity;
+
+	lzs_sensors_t* sensors = lzs_sensors_attach(buffer, size);
+	if(sensors == NULL)
+	{
+		free(buffer);
+		return 1;
+	}
+
+	lzs_sensor_t* ring = (lzs_sensor_t*) &sensors[1];
+	lzs_sensor_t  records[LZS_SENSORS_BATCH];
+	int           head    = 0;
+	int           drained = 0;
+	int           nerr    = 0;
+	double        t0      = now_ns();
+	int           i;
+	int           j;
+	int           n;
+	for(i = 0; i < count; ++i)
+	{
+		const lzs_sensorevent_t* e = &events[i];
+		lzs_sensor_t*            r = &ring[head & (capacity - 1)];
+		r->t    = 0.005*((double) i);
+		r->type = (e->type == 'g') ? LZS_SENSOR_GYRO :
+		          ((e->type == 'a') ? LZS_SENSOR_ACCEL : LZS_SENSOR_MAG);
+		r->v[0] = e->v[0];
+		r->v[1] = e->v[1];
+		r->v[2] = e->v[2];
+		r->v[3] = e->dt;
+		++head;
+
+		// commit a batch and drain it as a frame would
+		if(((head%batch) != 0) && (i + 1 < count))
+		{
+			continue;
+		}
+		lzs_sensors_commit(sensors, head);
+		do
+		{
+			n = lzs_sensors_drain(sensors, records, LZS_SENSORS_BATCH);
+			for(j = 0; j < n; ++j)
+			{
+				const lzs_sensorevent_t* f = &events[drained++];
+				if((records[j].v[0] != f->v[0]) ||
+				   (records[j].v[1] != f->v[1]) ||
+				   (records[j].v[2] != f->v[2]) ||
+				   (records[j].v[3] != f->dt))
+				{
+					++nerr;
+				}
+			}
+		} while(n == LZS_SENSORS_BATCH);
+	}
+	double dt = now_ns() - t0;
+
+	printf("ring: batch=%i, records=%i, drained=%i, errors=%i, avg=%.0lf ns\n",
+	       batch, count, drained, nerr, dt/((double) count));
+	free(buffer);
+	return nerr + (count - drained);
+}
+
+static void usage(const char* argv0)
+{
+	LOGE("usage: %s [-q] [-b batch] [-s seconds | sensors.txt]", argv0);
+	LOGE("-b sets the records per commit of the sensor ring (default 16)");
+	LOGE("-s replays a synthetic trace with known orientation");
+	LOGE("sensors.txt is recorded by the renderer with DEBUG_SENSORS");
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+int main(int argc, char** argv)
+{
+	int         quiet   = 0;
+	float       seconds = 0.0f;
+	int         batch   = 16;
+	const char* fname   = NULL;
+	int i;
+	for(i = 1; i < argc; ++i)
+	{
+		if(strcmp(argv[i], "-q") == 0)
+		{
+			quiet = 1;
+		}
+		else if((strcmp(argv[i], "-b") == 0) && (i + 1 < argc))
+		{
+			batch = atoi(argv[++i]);
+		}
+		else if((strcmp(argv[i], "-s") == 0) && (i + 1 < argc))
+		{
+			seconds = (float) atof(argv[++i]);
+		}
+		else
+		{
+			fname = argv[i];
+		}
+	}
+	if(((fname == NULL) && (seconds <= 0.0f)) ||
+	   (batch < 1) || (batch > 256))
+	{
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	int                count  = 0;
+	lzs_sensorevent_t* events;
+	if(fname)
+	{
+		events = load_events(fname, &count);
+	}
+	else
+	{
+		srand(1);
+		events = synth_events(seconds, &count);
+	}
+	if((events == NULL) || (count == 0))
+	{
+		LOGE("no events");
+		free(events);
+		return EXIT_FAILURE;
+	}
+
+	// the reference is the accelerometer/magnetometer
+	// orientation that SensorManager would report
+	lzs_fusion_t      fusion;
+	lzs_fusionstats_t sf;
+	lzs_fusionstats_t sr;
+	double            dtsum = 0.0;
+	int               truth = 0;
+	float             a[3]  = { 0.0f, 0.0f, 0.0f };
+	float             m[3]  = { 0.0f, 0.0f, 0.0f };
+	lzs_fusion_reset(&fusion);
+	memset(&sf, 0, sizeof(lzs_fusionstats_t));
+	memset(&sr, 0, sizeof(lzs_fusionstats_t));
+	for(i = 0; i < count; ++i)
+	{
+		lzs_sensorevent_t* e  = &events[i];
+		double             t0 = now_ns();
+		if(e->type == 'g')
+		{
+			lzs_fusion_gyro(&fusion, e->v[0], e->v[1], e->v[2], e->dt);
+		}
+		else if(e->type == 'a')
+		{
+			lzs_fusion_accel(&fusion, e->v[0], e->v[1], e->v[2]);
+			memcpy(a, e->v, sizeof(a));
+		}
+		else if(e->type == 'm')
+		{
+			lzs_fusion_mag(&fusion, e->v[0], e->v[1], e->v[2]);
+			memcpy(m, e->v, sizeof(m));
+		}
+		dtsum += now_ns() - t0;
+
+		// compare after each gyro sample once both agree
+		lzs_orientation_t o;
+		float             R[9];
+		lzs_fusion_orientation(&fusion, &o);
+		if((e->type != 'g') || (o.valid == 0) ||
+		   (lzs_fusion_rotation(a, m, R) == 0))
+		{
+			continue;
+		}
+
+		float heading;
+		float pitch;
+		float roll;
+		lzs_fusion_angles(R, &heading, &pitch, &roll);
+		stats_update(&sf, e, o.heading, o.pitch, o.roll);
+		stats_update(&sr, e, heading, pitch, roll);
+		truth += e->truth;
+
+		if(quiet == 0)
+		{
+			printf("fused=%0.2f,%0.2f,%0.2f, ref=%0.2f,%0.2f,%0.2f\n",
+			       o.heading, o.pitch, o.roll, heading, pitch, roll);
+		}
+	}
+
+	printf("events=%i, avg=%.0lf ns\n", count, dtsum/((double) count));
+	if(sf.n > 1)
+	{
+		printf("jitter: fused=%0.3f deg, ref=%0.3f deg\n",
+		       sqrtf(sf.jitter/(3.0f*(sf.n - 1))),
+		       sqrtf(sr.jitter/(3.0f*(sr.n - 1))));
+	}
+	if(truth > 0)
+	{
+		printf("error: fused=%0.3f deg, ref=%0.3f deg\n",
+		       sqrtf(sf.error/(3.0f*truth)),
+		       sqrtf(sr.error/(3.0f*truth)));
+	}
+
+	int nerr = check_ring(events, count, batch);
+	free(events);
+	return (nerr == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,1336 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lzs_kernel.h"
+#include "lzs_pyramid.h"
+#include "lzs_reacquire.h"
+#include "lzs_circle.h"
+#include "lzs_camera.h"
+#include "lzs_trackerset.h"
+#include "lzs_particles.h"
+#include <math.h>
+
+#define LOG_TAG "lzs_kernelcheck"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+#define PATTERN_RANDOM   0
+#define PATTERN_CONSTANT 1
+#define PATTERN_CHECKER  2
+#define PATTERN_BALL     3
+#define PATTERN_COUNT    4
+
+// candidates compared with the reference
+#define LZS_CHECK_PEAKS 8
+
+static const char* PATTERN_NAMES[PATTERN_COUNT] =
+{
+	"random",
+	"constant",
+	"checker",
+	"ball",
+};
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return 1.0e9*((double) ts.tv_sec) + (double) ts.tv_nsec;
+}
+
+static void fill_crop(unsigned char* bgra, int stride, int w, int h,
+                      int pattern)
+{
+	int cx = rand()%w;
+	int cy = rand()%h;
+	int x;
+	int y;
+	for(y = 0; y < h; ++y)
+	{
+		for(x = 0; x < stride/4; ++x)
+		{
+			unsigned char* p = &bgra[y*stride + 4*x];
+			int i;
+			for(i = 0; i < 4; ++i)
+			{
+				int v = rand()%256;
+				if(pattern == PATTERN_CONSTANT)
+				{
+					v = 128;
+				}
+				else if(pattern == PATTERN_CHECKER)
+				{
+					// saturates the sobel and creates many ties
+					v = ((x + y)%2) ? 255 : 0;
+				}
+				else if(pattern == PATTERN_BALL)
+				{
+					int dx = x - cx;
+					int dy = y - cy;
+					v = (dx*dx + dy*dy < 64) ? 220 : 60 + rand()%16;
+				}
+				p[i] = (unsigned char) v;
+			}
+		}
+	}
+}
+
+static int compare_peaks(const void* a, const void* b)
+{
+	const lzs_peak_t* pa = (const lzs_peak_t*) a;
+	const lzs_peak_t* pb = (const lzs_peak_t*) b;
+	if(pa->mag != pb->mag)
+	{
+		return (pa->mag > pb->mag) ? -1 : 1;
+	}
+	if(pa->y != pb->y)
+	{
+		return pa->y - pb->y;
+	}
+	return pa->x - pb->x;
+}
+
+// the reference sorts every local maximum of the whole
+// crop and returns at most max of them
+static int peaks_ref(const unsigned char* bgra, int stride, int w, int h,
+                     lzs_peak_t* peaks, int max)
+{
+	unsigned char* gray = (unsigned char*) malloc(w*h);
+	unsigned int*  mags = (unsigned int*) calloc(w*h, sizeof(unsigned int));
+	lzs_peak_t*    all  = (lzs_peak_t*) malloc(w*h*sizeof(lzs_peak_t));
+	if((gray == NULL) || (mags == NULL) || (all == NULL))
+	{
+		LOGE("malloc failed");
+		free(gray);
+		free(mags);
+		free(all);
+		return -1;
+	}
+	lzs_kernel_gray(bgra, stride, w, h, gray, w);
+
+	int x;
+	int y;
+	for(y = 1; y < h - 1; ++y)
+	{
+		for(x = 1; x < w - 1; ++x)
+		{
+			const unsigned char* a = &gray[(y - 1)*w];
+			const unsigned char* b = &gray[y*w];
+			const unsigned char* c = &gray[(y + 1)*w];
+			int sx = (a[x + 1] + 2*b[x + 1] + c[x + 1]) -
+			         (a[x - 1] + 2*b[x - 1] + c[x - 1]);
+			int sy = (c[x - 1] + 2*c[x] + c[x + 1]) -
+			         (a[x - 1] + 2*a[x] + a[x + 1]);
+			mags[y*w + x] = (unsigned int) (sx*sx + sy*sy);
+		}
+	}
+
+	// the neighbors before in row-major order must be
+	// smaller and the neighbors after may be equal
+	int n = 0;
+	int i;
+	int j;
+	for(y = 1; y < h - 1; ++y)
+	{
+		for(x = 1; x < w - 1; ++x)
+		{
+			unsigned int m     = mags[y*w + x];
+			int          local = (m > 0);
+			for(j = -1; j <= 1; ++j)
+			{
+				for(i = -1; i <= 1; ++i)
+				{
+					unsigned int q = mags[(y + j)*w + x + i];
+					if((j < 0) || ((j == 0) && (i < 0)))
+					{
+						local = local && (m > q);
+					}
+					else
+					{
+						local = local && (m >= q);
+					}
+				}
+			}
+			if(local)
+			{
+				all[n].x   = x;
+				all[n].y   = y;
+				all[n].mag = m;
+				++n;
+			}
+		}
+	}
+	qsort(all, n, sizeof(lzs_peak_t), compare_peaks);
+
+	n = (n > max) ? max : n;
+	memcpy(peaks, all, n*sizeof(lzs_peak_t));
+	free(gray);
+	free(mags);
+	free(all);
+	return n;
+}
+
+// returns the number of mismatches
+static int check(int w, int h, int pad, int pattern, int iters)
+{
+	int            stride  = 4*(w + pad);
+	unsigned char* bgra    = (unsigned char*) malloc(stride*h);
+	unsigned char* scratch = (unsigned char*) lzs_kernel_malloc(LZS_KERNEL_SCRATCH(w));
+	if((bgra == NULL) || (scratch == NULL))
+	{
+		LOGE("malloc failed");
+		free(bgra);
+		lzs_kernel_free(scratch);
+		return 1;
+	}
+
+	int nerr = 0;
+	int i;
+	int b;
+	for(i = 0; i < iters; ++i)
+	{
+		fill_crop(bgra, stride, w, h, pattern);
+
+		lzs_peak_t ref;
+		if(lzs_kernel_peakref(bgra, stride, w, h, &ref) == 0)
+		{
+			++nerr;
+			break;
+		}
+
+		lzs_peak_t refs[LZS_CHECK_PEAKS];
+		int        nref = peaks_ref(bgra, stride, w, h, refs, LZS_CHECK_PEAKS);
+		if(nref < 0)
+		{
+			++nerr;
+			break;
+		}
+
+		for(b = 0; b < LZS_KERNEL_COUNT; ++b)
+		{
+			if(lzs_kernel_supported(b) == 0)
+			{
+				continue;
+			}
+			lzs_kernel_select(b);
+
+			lzs_peak_t peak;
+			lzs_kernel_peak(bgra, stride, w, h, scratch, &peak);
+			if((peak.x != ref.x) || (peak.y != ref.y) || (peak.mag != ref.mag))
+			{
+				LOGE("%s %ix%i %s: peak=%u,%i,%i, ref=%u,%i,%i",
+				     lzs_kernel_name(b), w, h, PATTERN_NAMES[pattern],
+				     peak.mag, peak.x, peak.y, ref.mag, ref.x, ref.y);
+				++nerr;
+			}
+
+			// the first candidate is the peak
+			lzs_peak_t peaks[LZS_CHECK_PEAKS];
+			int        n = lzs_kernel_peaks(bgra, stride, w, h, scratch,
+			                                peaks, LZS_CHECK_PEAKS);
+			if((n > 0) && (ref.mag > 0) &&
+			   ((peaks[0].x != ref.x) || (peaks[0].y != ref.y) ||
+			    (peaks[0].mag != ref.mag)))
+			{
+				LOGE("%s %ix%i %s: peaks[0]=%u,%i,%i, ref=%u,%i,%i",
+				     lzs_kernel_name(b), w, h, PATTERN_NAMES[pattern],
+				     peaks[0].mag, peaks[0].x, peaks[0].y,
+				     ref.mag, ref.x, ref.y);
+				++nerr;
+			}
+			if((n != nref) ||
+			   (memcmp(peaks, refs, n*sizeof(lzs_peak_t)) != 0))
+			{
+				LOGE("%s %ix%i %s: peaks n=%i, ref n=%i",
+				     lzs_kernel_name(b), w, h, PATTERN_NAMES[pattern],
+				     n, nref);
+				++nerr;
+			}
+		}
+	}
+
+	free(bgra);
+	lzs_kernel_free(scratch);
+	return nerr;
+}
+
+static void bench(int w, int h, int iters)
+{
+	int            stride  = 4*w;
+	unsigned char* bgra    = (unsigned char*) malloc(stride*h);
+	unsigned char* scratch = (unsigned char*) lzs_kernel_malloc(LZS_KERNEL_SCRATCH(w));
+	if((bgra == NULL) || (scratch == NULL))
+	{
+		LOGE("malloc failed");
+		free(bgra);
+		lzs_kernel_free(scratch);
+		return;
+	}
+	fill_crop(bgra, stride, w, h, PATTERN_BALL);
+
+	int b;
+	for(b = 0; b < LZS_KERNEL_COUNT; ++b)
+	{
+		if(lzs_kernel_supported(b) == 0)
+		{
+			continue;
+		}
+		lzs_kernel_select(b);
+
+		lzs_peak_t peak;
+		double     t0 = now_ns();
+		int        i;
+		for(i = 0; i < iters; ++i)
+		{
+			lzs_kernel_peak(bgra, stride, w, h, scratch, &peak);
+		}
+		double dt = (now_ns() - t0)/((double) iters);
+
+		lzs_peak_t peaks[LZS_CHECK_PEAKS];
+		t0 = now_ns();
+		for(i = 0; i < iters; ++i)
+		{
+			lzs_kernel_peaks(bgra, stride, w, h, scratch,
+			                 peaks, LZS_CHECK_PEAKS);
+		}
+		double dt_peaks = (now_ns() - t0)/((double) iters);
+		printf("bench %s %ix%i: %.0lf ns, top %i %.0lf ns\n", lzs_kernel_name(b),
+		       w, h, dt, LZS_CHECK_PEAKS, dt_peaks);
+	}
+
+	free(bgra);
+	lzs_kernel_free(scratch);
+}
+
+// compares the fixed width rows with the generic rows for
+// the gray kernels and returns the number of mismatches
+static int check_fixed(int w, int h, int iters)
+{
+	int            stride  = w + 5;
+	unsigned char* bgra    = (unsigned char*) malloc(4*stride*h);
+	unsigned char* gray    = (unsigned char*) malloc(stride*h);
+	unsigned int*  mags    = (unsigned int*) malloc(2*w*h*sizeof(unsigned int));
+	unsigned char* scratch = (unsigned char*) lzs_kernel_malloc(LZS_KERNEL_SCRATCH(w));
+	if((bgra == NULL) || (gray == NULL) || (mags == NULL) || (scratch == NULL))
+	{
+		LOGE("malloc failed");
+		free(bgra);
+		free(gray);
+		free(mags);
+		lzs_kernel_free(scratch);
+		return 1;
+	}
+
+	int nerr = 0;
+	int i;
+	int b;
+	for(i = 0; i < iters; ++i)
+	{
+		fill_crop(bgra, 4*stride, w, h, i%PATTERN_COUNT);
+		lzs_kernel_select(LZS_KERNEL_SCALAR);
+		lzs_kernel_gray(bgra, 4*stride, w, h, gray, stride);
+
+		for(b = 0; b < LZS_KERNEL_COUNT; ++b)
+		{
+			if(lzs_kernel_supported(b) == 0)
+			{
+				continue;
+			}
+			lzs_kernel_select(b);
+
+			lzs_peak_t peak[2];
+			lzs_peak_t peaks[2][LZS_CHECK_PEAKS];
+			int        n[2];
+			int        j;
+			for(j = 0; j < 2; ++j)
+			{
+				lzs_kernel_specialize(j == 0);
+				lzs_kernel_peakgray(gray, stride, w, h, scratch, &peak[j]);
+				n[j] = lzs_kernel_peaksgray(gray, stride, w, h, scratch,
+				                            peaks[j], LZS_CHECK_PEAKS);
+				lzs_kernel_magsgray(gray, stride, w, h, &mags[j*w*h], w);
+			}
+			lzs_kernel_specialize(1);
+
+			if((peak[0].x != peak[1].x) || (peak[0].y != peak[1].y) ||
+			   (peak[0].mag != peak[1].mag))
+			{
+				LOGE("%s %ix%i: fixed peak=%u,%i,%i, generic=%u,%i,%i",
+				     lzs_kernel_name(b), w, h,
+				     peak[0].mag, peak[0].x, peak[0].y,
+				     peak[1].mag, peak[1].x, peak[1].y);
+				++nerr;
+			}
+			if((n[0] != n[1]) ||
+			   (memcmp(peaks[0], peaks[1], n[0]*sizeof(lzs_peak_t)) != 0))
+			{
+				LOGE("%s %ix%i: fixed peaks n=%i, generic n=%i",
+				     lzs_kernel_name(b), w, h, n[0], n[1]);
+				++nerr;
+			}
+			if(memcmp(&mags[0], &mags[w*h], w*h*sizeof(unsigned int)) != 0)
+			{
+				LOGE("%s %ix%i: fixed mags differ", lzs_kernel_name(b), w, h);
+				++nerr;
+			}
+		}
+	}
+
+	free(bgra);
+	free(gray);
+	free(mags);
+	lzs_kernel_free(scratch);
+	return nerr;
+}
+
+static void bench_fixed(int w, int iters)
+{
+	unsigned char* bgra    = (unsigned char*) malloc(4*w*w);
+	unsigned char* gray    = (unsigned char*) malloc(w*w);
+	unsigned char* scratch = (unsigned char*) lzs_kernel_malloc(LZS_KERNEL_SCRATCH(w));
+	if((bgra == NULL) || (gray == NULL) || (scratch == NULL))
+	{
+		LOGE("malloc failed");
+		free(bgra);
+		free(gray);
+		lzs_kernel_free(scratch);
+		return;
+	}
+	fill_crop(bgra, 4*w, w, w, PATTERN_BALL);
+	lzs_kernel_gray(bgra, 4*w, w, w, gray, w);
+
+	int b;
+	for(b = 0; b < LZS_KERNEL_COUNT; ++b)
+	{
+		if(lzs_kernel_supported(b) == 0)
+		{
+			continue;
+		}
+		lzs_kernel_select(b);
+		if(lzs_kernel_specialized(w) == 0)
+		{
+			continue;
+		}
+
+		double dt[2][2];
+		int    j;
+		for(j = 0; j < 2; ++j)
+		{
+			lzs_kernel_specialize(j == 0);
+
+			lzs_peak_t peak;
+			double     t0 = now_ns();
+			int        i;
+			for(i = 0; i < iters; ++i)
+			{
+				lzs_kernel_peak(bgra, 4*w, w, w, scratch, &peak);
+			}
+			dt[j][0] = (now_ns() - t0)/((double) iters);
+
+			t0 = now_ns();
+			for(i = 0; i < iters; ++i)
+			{
+				lzs_kernel_peakgray(gray, w, w, w, scratch, &peak);
+			}
+			dt[j][1] = (now_ns() - t0)/((double) iters);
+		}
+		lzs_kernel_specialize(1);
+
+		printf("bench fixed %s %ix%i: peak %.0lf ns (generic %.0lf ns), "
+		       "gray %.0lf ns (generic %.0lf ns)\n",
+		       lzs_kernel_name(b), w, w, dt[0][0], dt[1][0],
+		       dt[0][1], dt[1][1]);
+	}
+
+	free(bgra);
+	free(gray);
+	lzs_kernel_free(scratch);
+}
+
+// ball of radius r on a noisy background
+static void fill_ball(unsigned char* bgra, int w, int h,
+                      int cx, int cy, int r)
+{
+	int x;
+	int y;
+	for(y = 0; y < h; ++y)
+	{
+		for(x = 0; x < w; ++x)
+		{
+			unsigned char* p  = &bgra[4*(y*w + x)];
+			int            dx = x - cx;
+			int            dy = y - cy;
+			int            v  = (dx*dx + dy*dy < r*r) ? 220 : 60 + rand()%16;
+			p[0] = (unsigned char) v;
+			p[1] = (unsigned char) v;
+			p[2] = (unsigned char) v;
+			p[3] = 255;
+		}
+	}
+}
+
+// the pyramid peak must lie on the edge of the ball
+// returns the number of misses
+static int check_pyramid(int size, int levels, int iters)
+{
+	int             stride  = 4*size;
+	unsigned char*  bgra    = (unsigned char*) malloc(stride*size);
+	unsigned char*  gray    = (unsigned char*) malloc(size*size);
+	lzs_pyramid_t*  pyramid = lzs_pyramid_new(size, size, levels);
+	if((bgra == NULL) || (gray == NULL) || (pyramid == NULL))
+	{
+		LOGE("malloc failed");
+		free(bgra);
+		free(gray);
+		lzs_pyramid_delete(&pyramid);
+		return 1;
+	}
+
+	int nerr = 0;
+	int i;
+	int b;
+	int g;
+	for(i = 0; i < iters; ++i)
+	{
+		int r  = 12 + rand()%20;
+		int cx = r + 2 + rand()%(size - 2*r - 4);
+		int cy = r + 2 + rand()%(size - 2*r - 4);
+		fill_ball(bgra, size, size, cx, cy, r);
+		lzs_kernel_gray(bgra, stride, size, size, gray, size);
+
+		// g selects the BGRA or luma crop
+		for(b = 0; b < LZS_KERNEL_COUNT; ++b)
+		{
+			if(lzs_kernel_supported(b) == 0)
+			{
+				continue;
+			}
+			lzs_kernel_select(b);
+
+			for(g = 0; g < 2; ++g)
+			{
+				lzs_peak_t peak;
+				if(g)
+				{
+					lzs_pyramid_peakgray(pyramid, gray, size, size, size, &peak);
+				}
+				else
+				{
+					lzs_pyramid_peak(pyramid, bgra, stride, size, size, &peak);
+				}
+				int dx = peak.x - cx;
+				int dy = peak.y - cy;
+				int d2 = dx*dx + dy*dy;
+				if((d2 < (r - 2)*(r - 2)) || (d2 > (r + 2)*(r + 2)))
+				{
+					LOGE("%s pyramid %s %i levels=%i: peak=%u,%i,%i, ball=%i,%i,%i",
+					     lzs_kernel_name(b), g ? "luma" : "bgra", size, levels,
+					     peak.mag, peak.x, peak.y, cx, cy, r);
+					++nerr;
+				}
+			}
+		}
+	}
+
+	free(bgra);
+	free(gray);
+	lzs_pyramid_delete(&pyramid);
+	return nerr;
+}
+
+static void bench_pyramid(int size, int levels, int iters)
+{
+	int             stride  = 4*size;
+	unsigned char*  bgra    = (unsigned char*) malloc(stride*size);
+	lzs_pyramid_t*  pyramid = lzs_pyramid_new(size, size, levels);
+	if((bgra == NULL) || (pyramid == NULL))
+	{
+		LOGE("malloc failed");
+		free(bgra);
+		lzs_pyramid_delete(&pyramid);
+		return;
+	}
+	fill_ball(bgra, size, size, size/3, size/2, 24);
+
+	int b;
+	for(b = 0; b < LZS_KERNEL_COUNT; ++b)
+	{
+		if(lzs_kernel_supported(b) == 0)
+		{
+			continue;
+		}
+		lzs_kernel_select(b);
+
+		lzs_peak_t peak;
+		double     t0 = now_ns();
+		int        i;
+		for(i = 0; i < iters; ++i)
+		{
+			lzs_pyramid_peak(pyramid, bgra, stride, size, size, &peak);
+		}
+		double dt = (now_ns() - t0)/((double) iters);
+		printf("bench %s pyramid %ix%i levels=%i: %.0lf ns\n",
+		       lzs_kernel_name(b), size, size, levels, dt);
+	}
+
+	free(bgra);
+	lzs_pyramid_delete(&pyramid);
+}
+
+// the best reacquisition candidate must match the reference
+// over the whole frame
+// returns the number of mismatches
+static int check_reacquire(int w, int h, int nthreads, int iters)
+{
+	unsigned char*   bgra      = (unsigned char*) malloc(4*w*h);
+	lzs_reacquire_t* reacquire = lzs_reacquire_new(w, nthreads);
+	if((bgra == NULL) || (reacquire == NULL))
+	{
+		LOGE("malloc failed");
+		free(bgra);
+		lzs_reacquire_delete(&reacquire);
+		return 1;
+	}
+
+	int nerr = 0;
+	int i;
+	for(i = 0; i < iters; ++i)
+	{
+		fill_ball(bgra, w, h, rand()%w, rand()%h, 12 + rand()%20);
+
+		lzs_peak_t ref;
+		lzs_peak_t candidates[4];
+		int        count;
+		count = lzs_reacquire_search(reacquire, bgra, 4*w, w, h, 64.0f,
+		                             candidates, 4);
+		if(lzs_kernel_peakref(bgra, 4*w, w, h, &ref) == 0)
+		{
+			++nerr;
+			break;
+		}
+
+		if((count == 0) ||
+		   (candidates[0].x   != ref.x) ||
+		   (candidates[0].y   != ref.y) ||
+		   (candidates[0].mag != ref.mag))
+		{
+			LOGE("reacquire %ix%i threads=%i: count=%i, peak=%u,%i,%i, ref=%u,%i,%i",
+			     w, h, reacquire->nthreads, count,
+			     candidates[0].mag, candidates[0].x, candidates[0].y,
+			     ref.mag, ref.x, ref.y);
+			++nerr;
+		}
+	}
+
+	free(bgra);
+	lzs_reacquire_delete(&reacquire);
+	return nerr;
+}
+
+static void bench_reacquire(int w, int h, int nthreads, int iters)
+{
+	unsigned char*   bgra      = (unsigned char*) malloc(4*w*h);
+	lzs_reacquire_t* reacquire = lzs_reacquire_new(w, nthreads);
+	if((bgra == NULL) || (reacquire == NULL))
+	{
+		LOGE("malloc failed");
+		free(bgra);
+		lzs_reacquire_delete(&reacquire);
+		return;
+	}
+	fill_ball(bgra, w, h, w/3, h/2, 24);
+
+	lzs_peak_t candidates[4];
+	double     t0 = now_ns();
+	int        i;
+	for(i = 0; i < iters; ++i)
+	{
+		lzs_reacquire_search(reacquire, bgra, 4*w, w, h, 64.0f,
+		                     candidates, 4);
+	}
+	double dt = (now_ns() - t0)/((double) iters);
+	printf("bench %s reacquire %ix%i threads=%i: %.0lf ns\n",
+	       lzs_kernel_name(lzs_kernel_backend()), w, h,
+	       reacquire->nthreads, dt);
+
+	free(bgra);
+	lzs_reacquire_delete(&reacquire);
+}
+
+// compares the distance from the true center for the peak
+// and circle detectors on random balls
+// returns the number of circles that were not found
+static int bench_circle(int size, int iters)
+{
+	int            stride  = 4*size;
+	unsigned char* bgra    = (unsigned char*) malloc(stride*size);
+	unsigned char* scratch = (unsigned char*) lzs_kernel_malloc(LZS_KERNEL_SCRATCH(size));
+	lzs_circle_t*  circle  = lzs_circle_new(size, size, LZS_CIRCLE_RMIN,
+	                                        LZS_CIRCLE_RMAX);
+	if((bgra == NULL) || (scratch == NULL) || (circle == NULL))
+	{
+		LOGE("malloc failed");
+		free(bgra);
+		lzs_kernel_free(scratch);
+		lzs_circle_delete(&circle);
+		return 1;
+	}
+
+	double peak_sum  = 0.0;
+	double peak_max  = 0.0;
+	double peak_dt   = 0.0;
+	double circ_sum  = 0.0;
+	double circ_max  = 0.0;
+	double circ_dt   = 0.0;
+	double circ_conf = 0.0;
+	int    nerr      = 0;
+	int    i;
+	for(i = 0; i < iters; ++i)
+	{
+		int r  = 12 + rand()%20;
+		int cx = r + 2 + rand()%(size - 2*r - 4);
+		int cy = r + 2 + rand()%(size - 2*r - 4);
+		fill_ball(bgra, size, size, cx, cy, r);
+
+		lzs_peak_t peak;
+		double     t0 = now_ns();
+		lzs_kernel_peak(bgra, stride, size, size, scratch, &peak);
+		double     t1 = now_ns();
+		peak_dt += t1 - t0;
+
+		double dx = (double) (peak.x - cx);
+		double dy = (double) (peak.y - cy);
+		double d  = sqrt(dx*dx + dy*dy);
+		peak_sum += d;
+		peak_max  = (d > peak_max) ? d : peak_max;
+
+		lzs_center_t center;
+		t0 = now_ns();
+		if(lzs_circle_detect(circle, bgra, stride, size, size, &center) == 0)
+		{
+			LOGE("circle %ix%i: no center for ball=%i,%i,%i",
+			     size, size, cx, cy, r);
+			++nerr;
+			continue;
+		}
+		t1 = now_ns();
+		circ_dt   += t1 - t0;
+		circ_conf += center.confidence;
+
+		dx = (double) center.x - cx;
+		dy = (double) center.y - cy;
+		d  = sqrt(dx*dx + dy*dy);
+		circ_sum += d;
+		circ_max  = (d > circ_max) ? d : circ_max;
+	}
+
+	printf("bench %s peak %ix%i: error avg=%.2lf px, max=%.2lf px, %.0lf ns\n",
+	       lzs_kernel_name(lzs_kernel_backend()), size, size,
+	       peak_sum/iters, peak_max, peak_dt/iters);
+	printf("bench %s circle %ix%i: error avg=%.2lf px, max=%.2lf px, confidence=%.2lf, %.0lf ns\n",
+	       lzs_kernel_name(lzs_kernel_backend()), size, size,
+	       circ_sum/iters, circ_max, circ_conf/iters, circ_dt/iters);
+
+	free(bgra);
+	lzs_kernel_free(scratch);
+	lzs_circle_delete(&circle);
+	return nerr;
+}
+
+// per-pixel trig of the original ground projection
+static void camera_ref(float heading, float slope, float height,
+                       float x, float y, float* X, float* Y)
+{
+	float ph  = heading*M_PI/180.0f;
+	float ps  = slope*M_PI/180.0f;
+	float aph = ph + LZS_CAMERA_FOVX*M_PI/180.0f*(x - 400.0f)/400.0f;
+	float aps = ps - LZS_CAMERA_FOVY*M_PI/180.0f*(y - 240.0f)/240.0f;
+	float hyp = height*tanf(aps);
+	*X = hyp*sinf(aph);
+	*Y = hyp*cosf(aph);
+}
+
+static int check_camera(int n, int iters)
+{
+	lzs_camera_t* camera = lzs_camera_new(800, 480, 400.0f, 240.0f,
+	                                      LZS_CAMERA_FOVX, LZS_CAMERA_FOVY);
+	float*        buf    = (float*) malloc(6*n*sizeof(float));
+	if((camera == NULL) || (buf == NULL))
+	{
+		LOGE("malloc failed");
+		lzs_camera_delete(&camera);
+		free(buf);
+		return 1;
+	}
+
+	float* x  = buf;
+	float* y  = x + n;
+	float* X  = y + n;
+	float* Y  = X + n;
+	float* x2 = Y + n;
+	float* y2 = x2 + n;
+
+	// the slope keeps the screen below the horizon and
+	// changes by more than the tolerance each iteration
+	double ground_max = 0.0;
+	double screen_max = 0.0;
+	double ref_dt     = 0.0;
+	double ground_dt  = 0.0;
+	double screen_dt  = 0.0;
+	int    nerr       = 0;
+	int    it;
+	int    i;
+	for(it = 0; it < iters; ++it)
+	{
+		float heading = (float) (rand()%3600)/10.0f;
+		float slope   = 30.0f + 30.0f*((float) it)/((float) iters);
+		float height  = 3.0f + (float) (rand()%40)/10.0f;
+		for(i = 0; i < n; ++i)
+		{
+			x[i] = (float) (rand()%8000)/10.0f;
+			y[i] = (float) (rand()%4800)/10.0f;
+		}
+
+		double t0 = now_ns();
+		lzs_camera_pose(camera, heading, slope, height);
+		lzs_camera_ground(camera, n, x, y, X, Y);
+		double t1 = now_ns();
+		lzs_camera_screen(camera, n, X, Y, x2, y2);
+		double t2 = now_ns();
+		ground_dt += t1 - t0;
+		screen_dt += t2 - t1;
+
+		for(i = 0; i < n; ++i)
+		{
+			float rX;
+			float rY;
+			camera_ref(heading, slope, height, x[i], y[i], &rX, &rY);
+
+			// relative to the distance from the phone
+			double dX  = (double) (X[i] - rX);
+			double dY  = (double) (Y[i] - rY);
+			double d   = sqrt(dX*dX + dY*dY)/sqrt(rX*rX + rY*rY);
+			double dx  = (double) (x2[i] - x[i]);
+			double dy  = (double) (y2[i] - y[i]);
+			double dxy = sqrt(dx*dx + dy*dy);
+			ground_max = (d   > ground_max) ? d   : ground_max;
+			screen_max = (dxy > screen_max) ? dxy : screen_max;
+		}
+
+		t0 = now_ns();
+		for(i = 0; i < n; ++i)
+		{
+			camera_ref(heading, slope, height, x[i], y[i], &X[i], &Y[i]);
+		}
+		ref_dt += now_ns() - t0;
+	}
+
+	if((ground_max > 1.0e-4) || (screen_max > 0.01))
+	{
+		LOGE("camera: ground error=%lf, screen error=%lf px",
+		     ground_max, screen_max);
+		++nerr;
+	}
+
+	double count = (double) (n*iters);
+	printf("bench camera %i points: ground=%.1lf ns (ref %.1lf ns), screen=%.1lf ns, error ground=%.2le, screen=%.2le px\n",
+	       n, ground_dt/count, ref_dt/count, screen_dt/count,
+	       ground_max, screen_max);
+
+	lzs_camera_delete(&camera);
+	free(buf);
+	return nerr;
+}
+
+// the particles must converge on a ball near the reset
+// position where the crop is BGRA at the center of the
+// screen and returns the number of misses
+static int check_particles(int count, int size, int iters)
+{
+	int              stride    = 4*size;
+	unsigned char*   bgra      = (unsigned char*) malloc(stride*size);
+	lzs_camera_t*    camera    = lzs_camera_new(800, 480, 400.0f, 240.0f,
+	                                            LZS_CAMERA_FOVX, LZS_CAMERA_FOVY);
+	lzs_particles_t* particles = lzs_particles_new(count, size, size);
+	if((bgra == NULL) || (camera == NULL) || (particles == NULL))
+	{
+		LOGE("malloc failed");
+		free(bgra);
+		lzs_camera_delete(&camera);
+		lzs_particles_delete(&particles);
+		return 1;
+	}
+
+	// bottom-up rows map to the screen as in the tracker
+	float n  = (float) (1 << LZS_PARTICLES_LEVEL);
+	float ax = 1.0f/n;
+	float bx = (0.5f*size - 400.0f)/n;
+	float ay = -1.0f/n;
+	float by = (0.5f*size + 240.0f)/n;
+	lzs_camera_pose(camera, 0.0f, 45.0f, 4.5f);
+
+	double predict_dt  = 0.0;
+	double edges_dt    = 0.0;
+	double weigh_dt    = 0.0;
+	double resample_dt = 0.0;
+	double err_sum     = 0.0;
+	double err_max     = 0.0;
+	int    steps       = 0;
+	int    nerr        = 0;
+	int    it;
+	int    i;
+	for(it = 0; it < iters; ++it)
+	{
+		int r  = (int) LZS_PARTICLES_RADIUS;
+		int cx = 2*r + rand()%(size - 4*r);
+		int cy = 2*r + rand()%(size - 4*r);
+		fill_ball(bgra, size, size, cx, cy, r);
+
+		// reset about a third of the ball from the center
+		float x = 400.0f + (float) (cx - size/2);
+		float y = 240.0f - (float) (cy - size/2);
+		float sx = x + (float) (rand()%21 - 10);
+		float sy = y + (float) (rand()%21 - 10);
+		float X;
+		float Y;
+		lzs_camera_ground(camera, 1, &sx, &sy, &X, &Y);
+		lzs_particles_reset(particles, X, Y);
+		particles->energy_avg = 0.0f;
+
+		int accept = 1;
+		for(i = 0; i < 8; ++i)
+		{
+			double t0 = now_ns();
+			lzs_particles_predict(particles, 1.0f/30.0f, 0.0f, 0.0f);
+			double t1 = now_ns();
+			lzs_particles_edges(particles, bgra, stride, size, size);
+			double t2 = now_ns();
+			accept &= lzs_particles_weigh(particles, camera, ax, bx, ay, by);
+			double t3 = now_ns();
+			lzs_particles_resample(particles);
+			double t4 = now_ns();
+			predict_dt  += t1 - t0;
+			edges_dt    += t2 - t1;
+			weigh_dt    += t3 - t2;
+			resample_dt += t4 - t3;
+			++steps;
+		}
+
+		double dx = (double) (particles->est_x - x);
+		double dy = (double) (particles->est_y - y);
+		double d  = sqrt(dx*dx + dy*dy);
+		err_sum += d;
+		err_max  = (d > err_max) ? d : err_max;
+		if((accept == 0) || (d > 4.0))
+		{
+			LOGE("particles %i: error=%lf px, accept=%i for ball=%i,%i,%i",
+			     count, d, accept, cx, cy, r);
+			++nerr;
+		}
+	}
+
+	printf("bench %s particles %i in %ix%i: error avg=%.2lf px, max=%.2lf px, "
+	       "predict=%.0lf ns, edges=%.0lf ns, weigh=%.0lf ns, resample=%.0lf ns\n",
+	       lzs_kernel_name(lzs_kernel_backend()), count, size, size,
+	       err_sum/iters, err_max, predict_dt/steps, edges_dt/steps,
+	       weigh_dt/steps, resample_dt/steps);
+
+	free(bgra);
+	lzs_camera_delete(&camera);
+	lzs_particles_delete(&particles);
+	return nerr;
+}
+
+// gray frame with a ball under each window
+static void fill_set(unsigned char* gray, int w, int h,
+                     lzs_trackerset_t* set)
+{
+	int x;
+	int y;
+	int i;
+	for(y = 0; y < h; ++y)
+	{
+		for(x = 0; x < w; ++x)
+		{
+			gray[y*w + x] = (unsigned char) (60 + rand()%16);
+		}
+	}
+
+	float sx = set->config.screen_w/((float) w);
+	float sy = set->config.screen_h/((float) h);
+	for(i = 0; i < set->count; ++i)
+	{
+		int cx = (int) (set->trackers[i]->roi_x/sx) + rand()%9 - 4;
+		int cy = (int) (set->trackers[i]->roi_y/sy) + rand()%9 - 4;
+		int r  = 12 + rand()%12;
+		for(y = cy - r; y <= cy + r; ++y)
+		{
+			for(x = cx - r; x <= cx + r; ++x)
+			{
+				int dx = x - cx;
+				int dy = y - cy;
+				if((x >= 0) && (x < w) && (y >= 0) && (y < h) &&
+				   (dx*dx + dy*dy < r*r))
+				{
+					gray[y*w + x] = 220;
+				}
+			}
+		}
+	}
+}
+
+// the peak of each window must match a reference search of
+// the pixels that are closer to its center than to any
+// other window that contains them
+// returns the number of mismatches
+static int check_trackerset(int n, int nthreads, int iters)
+{
+	int               w    = 640;
+	int               h    = 480;
+	unsigned char*    gray = (unsigned char*) malloc(w*h);
+	lzs_config_t      config;
+	lzs_config_defaults(&config);
+	config.search_radius = (int) LZS_RADIUS_MAX;
+	config.search_levels = 0;
+	lzs_trackerset_t* set  = lzs_trackerset_new(&config, w, nthreads);
+	if((gray == NULL) || (set == NULL))
+	{
+		LOGE("malloc failed");
+		free(gray);
+		lzs_trackerset_delete(&set);
+		return 1;
+	}
+
+	int i;
+	for(i = 0; i < n; ++i)
+	{
+		lzs_trackerset_add(set, 400.0f, 240.0f);
+	}
+
+	int nerr     = 0;
+	int clusters = 0;
+	int it;
+	for(it = 0; it < iters; ++it)
+	{
+		// random windows which often overlap where the search
+		// drops the prediction so the separate windows take
+		// the strongest peak
+		for(i = 0; i < n; ++i)
+		{
+			lzs_tracker_t* tracker = set->trackers[i];
+			lzs_trackerset_searchsphero(set, i, 400.0f, 240.0f);
+			tracker->roi_radius = 16 + rand()%200;
+			tracker->roi_x      = (float) (rand()%800);
+			tracker->roi_y      = (float) (rand()%480);
+			lzs_tracker_limitposition(&config, (float) tracker->roi_radius,
+			                          &tracker->roi_x, &tracker->roi_y);
+		}
+		fill_set(gray, w, h, set);
+		lzs_trackerset_luma(set, gray, w, h, w, 0.0);
+		clusters += set->nclusters;
+
+		for(i = 0; i < n; ++i)
+		{
+			lzs_peak_t ref;
+			ref.x   = 0;
+			ref.y   = 0;
+			ref.mag = 0;
+
+			int x;
+			int y;
+			int j;
+			for(y = set->win_y0[i] + 1; y < set->win_y1[i] - 1; ++y)
+			{
+				for(x = set->win_x0[i] + 1; x < set->win_x1[i] - 1; ++x)
+				{
+					float dx    = (float) x - 0.5f*((float) (set->win_x0[i] + set->win_x1[i]));
+					float dy    = (float) y - 0.5f*((float) (set->win_y0[i] + set->win_y1[i]));
+					float best  = dx*dx + dy*dy;
+					int   owner = i;
+					for(j = 0; j < n; ++j)
+					{
+						if((j == i) ||
+						   (x <= set->win_x0[j]) || (x >= set->win_x1[j] - 1) ||
+						   (y <= set->win_y0[j]) || (y >= set->win_y1[j] - 1))
+						{
+							continue;
+						}
+						dx = (float) x - 0.5f*((float) (set->win_x0[j] + set->win_x1[j]));
+						dy = (float) y - 0.5f*((float) (set->win_y0[j] + set->win_y1[j]));
+						float d = dx*dx + dy*dy;
+						if((d < best) || ((d == best) && (j < owner)))
+						{
+							owner = j;
+							best  = d;
+						}
+					}
+					if(owner != i)
+					{
+						continue;
+					}
+
+					const unsigned char* a  = &gray[(y - 1)*w];
+					const unsigned char* b  = &gray[y*w];
+					const unsigned char* c  = &gray[(y + 1)*w];
+					int          gx  = (a[x + 1] + 2*b[x + 1] + c[x + 1]) -
+					                   (a[x - 1] + 2*b[x - 1] + c[x - 1]);
+					int          gy  = (c[x - 1] + 2*c[x] + c[x + 1]) -
+					                   (a[x - 1] + 2*a[x] + a[x + 1]);
+					unsigned int mag = (unsigned int) (gx*gx + gy*gy);
+					if(mag > ref.mag)
+					{
+						ref.x   = x;
+						ref.y   = y;
+						ref.mag = mag;
+					}
+				}
+			}
+
+			if((set->peak_x[i] != ref.x) || (set->peak_y[i] != ref.y) ||
+			   (set->peak_mag[i] != ref.mag))
+			{
+				LOGE("trackerset n=%i threads=%i ball=%i: peak=%u,%i,%i, ref=%u,%i,%i",
+				     n, set->nthreads, i, set->peak_mag[i], set->peak_x[i],
+				     set->peak_y[i], ref.mag, ref.x, ref.y);
+				++nerr;
+			}
+		}
+	}
+	printf("check trackerset n=%i threads=%i: %.1lf clusters/frame\n",
+	       n, set->nthreads, ((double) clusters)/((double) iters));
+
+	free(gray);
+	lzs_trackerset_delete(&set);
+	return nerr;
+}
+
+// compares the set with a separate tracker per ball where
+// the balls are on a grid with overlapping windows
+static void bench_trackerset(int n, int nthreads, int iters)
+{
+	int               w    = 640;
+	int               h    = 480;
+	unsigned char*    gray = (unsigned char*) malloc(w*h);
+	lzs_config_t      config;
+	lzs_config_defaults(&config);
+	config.search_radius = (int) LZS_RADIUS_MAX;
+	config.search_levels = 0;
+	lzs_trackerset_t* set  = lzs_trackerset_new(&config, w, nthreads);
+	lzs_tracker_t*    ref[LZS_TRACKERSET_MAX];
+	int               i;
+	for(i = 0; i < n; ++i)
+	{
+		ref[i] = lzs_tracker_new(&config);
+		if(ref[i])
+		{
+			lzs_tracker_window(ref[i], config.search_radius, config.search_levels);
+			lzs_tracker_background(ref[i], 0);
+		}
+	}
+
+	int cols = 1;
+	while(cols*cols < n)
+	{
+		++cols;
+	}
+	int rows = (n + cols - 1)/cols;
+
+	float roi_x[LZS_TRACKERSET_MAX];
+	float roi_y[LZS_TRACKERSET_MAX];
+	for(i = 0; i < n; ++i)
+	{
+		roi_x[i] = config.screen_w*(0.5f + (float) (i%cols))/((float) cols);
+		roi_y[i] = config.screen_h*(0.5f + (float) (i/cols))/((float) rows);
+		if((ref[i] == NULL) || (set == NULL) ||
+		   (lzs_trackerset_add(set, roi_x[i], roi_y[i]) < 0))
+		{
+			LOGE("malloc failed");
+			goto fail_new;
+		}
+	}
+	if(gray == NULL)
+	{
+		LOGE("malloc failed");
+		goto fail_new;
+	}
+	fill_set(gray, w, h, set);
+
+	// the radius of a converged track
+	int    radius = (int) config.radius_ball + 32;
+	double dt_set = 0.0;
+	double dt_ref = 0.0;
+	int    it;
+	for(it = 0; it < iters; ++it)
+	{
+		for(i = 0; i < n; ++i)
+		{
+			lzs_tracker_t* tracker = set->trackers[i];
+			tracker->roi_x      = roi_x[i];
+			tracker->roi_y      = roi_y[i];
+			tracker->roi_radius = radius;
+			lzs_tracker_limitposition(&config, (float) radius,
+			                          &tracker->roi_x, &tracker->roi_y);
+		}
+
+		// the separate trackers search the same windows
+		double t0 = now_ns();
+		lzs_trackerset_luma(set, gray, w, h, w, 0.0);
+		double t1 = now_ns();
+		for(i = 0; i < n; ++i)
+		{
+			lzs_tracker_detect(ref[i], &set->crops[i]);
+			lzs_tracker_steer(ref[i]);
+		}
+		double t2 = now_ns();
+		dt_set += t1 - t0;
+		dt_ref += t2 - t1;
+	}
+
+	double count = (double) (n*iters);
+	printf("bench %s trackerset n=%i threads=%i: clusters=%i, %.0lf ns/ball (separate %.0lf ns/ball)\n",
+	       lzs_kernel_name(lzs_kernel_backend()), n, set->nthreads,
+	       set->nclusters, dt_set/count, dt_ref/count);
+
+	fail_new:
+		for(i = 0; i < n; ++i)
+		{
+			lzs_tracker_delete(&ref[i]);
+		}
+		free(gray);
+		lzs_trackerset_delete(&set);
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+int main(int argc, char** argv)
+{
+	// odd sizes exercise the scalar tails of the backends
+	const int sizes[][2] =
+	{
+		{   3,   3 },
+		{   9,   4 },
+		{  17,  11 },
+		{  19,  19 },
+		{  24,  17 },
+		{  32,  32 },
+		{  33,  33 },
+		{  40,  23 },
+		{  48,  48 },
+		{  61,  47 },
+		{  64,  64 },
+		{  96,  40 },
+		{ 128, 128 },
+		{ 192, 192 },
+		{ 200, 150 },
+		{ 256, 256 },
+	};
+	int nsizes = sizeof(sizes)/sizeof(sizes[0]);
+
+	srand(1);
+
+	int b;
+	for(b = 0; b < LZS_KERNEL_COUNT; ++b)
+	{
+		printf("backend %s: %s\n", lzs_kernel_name(b),
+		       lzs_kernel_supported(b) ? "supported" : "unsupported");
+	}
+
+	int nerr = 0;
+	int i;
+	int p;
+	for(i = 0; i < nsizes; ++i)
+	{
+		for(p = 0; p < PATTERN_COUNT; ++p)
+		{
+			nerr += check(sizes[i][0], sizes[i][1], 0, p, 8);
+			nerr += check(sizes[i][0], sizes[i][1], 3, p, 8);
+		}
+	}
+	for(i = 1; i <= LZS_PYRAMID_LEVELS; ++i)
+	{
+		nerr += check_pyramid(448, i, 16);
+	}
+	for(i = 1; i <= LZS_REACQUIRE_THREADS; ++i)
+	{
+		nerr += check_reacquire(800, 480, i, 4);
+		nerr += check_reacquire(61, 37, i, 4);
+	}
+	for(i = 0; i < nsizes; ++i)
+	{
+		nerr += check_fixed(sizes[i][0], sizes[i][1], 8);
+	}
+	printf("check: %i errors\n", nerr);
+
+	bench(128, 128, 2000);
+	bench(256, 256, 500);
+	bench(448, 448, 200);
+	bench_fixed(19, 20000);
+	bench_fixed(32, 20000);
+	bench_fixed(48, 10000);
+	bench_fixed(64, 4000);
+	bench_fixed(96, 2000);
+	bench_fixed(128, 2000);
+	bench_fixed(192, 1000);
+	bench_fixed(256, 500);
+	bench_pyramid(448, 1, 500);
+	bench_pyramid(448, 2, 1000);
+	bench_pyramid(448, 3, 1000);
+
+	lzs_kernel_select(LZS_KERNEL_BEST);
+	for(i = 1; i <= LZS_REACQUIRE_THREADS; ++i)
+	{
+		bench_reacquire(800, 480, i, 100);
+	}
+
+	nerr += bench_circle(128, 200);
+	nerr += bench_circle(LZS_CIRCLE_WINDOW, 200);
+	nerr += check_camera(1024, 64);
+	nerr += check_particles(LZS_PARTICLES_COUNT / 4, 192, 32);
+	nerr += check_particles(LZS_PARTICLES_COUNT, 192, 32);
+	nerr += check_particles(LZS_PARTICLES_MAX, 192, 32);
+
+	for(i = 1; i <= LZS_TRACKERSET_THREADS; i *= 2)
+	{
+		nerr += check_trackerset(1, i, 16);
+		nerr += check_trackerset(6, i, 64);
+		nerr += check_trackerset(LZS_TRACKERSET_MAX, i, 16);
+	}
+	lzs_kernel_select(LZS_KERNEL_BEST);
+	for(i = 1; i <= LZS_TRACKERSET_MAX; i *= 2)
+	{
+		bench_trackerset(i, 1, 200);
+	}
+	bench_trackerset(LZS_TRACKERSET_MAX, LZS_TRACKERSET_THREADS, 200);
+
+	lzs_kernel_select(LZS_KERNEL_BEST);
+	return (nerr == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
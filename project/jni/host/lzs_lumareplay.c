@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lzs_pipeline.h"
+#include "a3d/a3d_time.h"
+
+#define LOG_TAG "lzs_lumareplay"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return 1.0e9*((double) ts.tv_sec) + (double) ts.tv_nsec;
+}
+
+static void usage(const char* argv0)
+{
+	LOGE("usage: %s [-q] [-c] [-k] [-l levels] [-s x y] [-a x y] [-r session] width height file", argv0);
+	LOGE("-c selects the circle detector");
+	LOGE("-k selects the LED color detector which requires NV21");
+	LOGE("-l sets the pyramid levels (default 3)");
+	LOGE("-s searches for the ball at x, y in screen coordinates");
+	LOGE("-a adds a ball at x, y to the tracker set (repeatable)");
+	LOGE("-r records the crops and results for lzs_replay");
+	LOGE("file contains raw NV21 or YUV420 preview frames");
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+int main(int argc, char** argv)
+{
+	// the frames search the whole window at the default size
+	lzs_config_t config;
+	lzs_config_defaults(&config);
+	config.search_radius = (int) LZS_RADIUS_MAX;
+
+	int         quiet  = 0;
+	int         levels = 3;
+	int         detect = LZS_DETECTOR_PEAK;
+	int         search = 0;
+	float       sx     = 0.5f*config.screen_w;
+	float       sy     = 0.5f*config.screen_h;
+	int         width  = 0;
+	int         height = 0;
+	const char* fname  = NULL;
+	const char* record = NULL;
+	int         args   = 0;
+	int         nadds  = 0;
+	float       ax[LZS_PIPELINE_BALLS];
+	float       ay[LZS_PIPELINE_BALLS];
+	int i;
+	for(i = 1; i < argc; ++i)
+	{
+		if(strcmp(argv[i], "-q") == 0)
+		{
+			quiet = 1;
+		}
+		else if(strcmp(argv[i], "-c") == 0)
+		{
+			detect = LZS_DETECTOR_CIRCLE;
+		}
+		else if(strcmp(argv[i], "-k") == 0)
+		{
+			detect = LZS_DETECTOR_COLOR;
+		}
+		else if((strcmp(argv[i], "-l") == 0) && (i + 1 < argc))
+		{
+			levels = atoi(argv[++i]);
+		}
+		else if((strcmp(argv[i], "-s") == 0) && (i + 2 < argc))
+		{
+			search = 1;
+			sx     = (float) atof(argv[++i]);
+			sy     = (float) atof(argv[++i]);
+		}
+		else if((strcmp(argv[i], "-a") == 0) && (i + 2 < argc) &&
+		        (nadds < LZS_PIPELINE_BALLS))
+		{
+			ax[nadds] = (float) atof(argv[++i]);
+			ay[nadds] = (float) atof(argv[++i]);
+			++nadds;
+		}
+		else if((strcmp(argv[i], "-r") == 0) && (i + 1 < argc))
+		{
+			record = argv[++i];
+		}
+		else if(args == 0)
+		{
+			width = atoi(argv[i]);
+			++args;
+		}
+		else if(args == 1)
+		{
+			height = atoi(argv[i]);
+			++args;
+		}
+		else
+		{
+			fname = argv[i];
+			++args;
+		}
+	}
+	if((fname == NULL) || (width < 3) || (height < 3) ||
+	   (width  > LZS_PIPELINE_LUMA_W) ||
+	   (height > LZS_PIPELINE_LUMA_H))
+	{
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	FILE* f = fopen(fname, "r");
+	if(f == NULL)
+	{
+		LOGE("fopen %s failed", fname);
+		return EXIT_FAILURE;
+	}
+
+	// both formats begin with the full size Y plane which is
+	// all that the edge detectors read
+	int            size  = width*height + 2*((width + 1)/2)*((height + 1)/2);
+	unsigned char* frame = (unsigned char*) malloc(size);
+	if(frame == NULL)
+	{
+		LOGE("malloc failed");
+		fclose(f);
+		return EXIT_FAILURE;
+	}
+	unsigned char* chroma = (detect == LZS_DETECTOR_COLOR) ? &frame[width*height] : NULL;
+
+	config.search_levels = levels;
+	lzs_pipeline_t* pipeline = lzs_pipeline_new(&config, detect);
+	if(pipeline == NULL)
+	{
+		free(frame);
+		fclose(f);
+		return EXIT_FAILURE;
+	}
+
+	lzs_recorder_t* recorder = NULL;
+	if(record)
+	{
+		recorder = lzs_recorder_new(record, LZS_RECORDER_CAPACITY);
+		if(recorder == NULL)
+		{
+			lzs_pipeline_delete(&pipeline);
+			free(frame);
+			fclose(f);
+			return EXIT_FAILURE;
+		}
+		lzs_pipeline_record(pipeline, recorder);
+	}
+
+	if(search)
+	{
+		lzs_pipeline_searchsphero(pipeline, sx, sy);
+	}
+	for(i = 0; i < nadds; ++i)
+	{
+		lzs_pipeline_addsphero(pipeline, ax[i], ay[i]);
+	}
+
+	// the frames are assumed to be 30 Hz after the search
+	double       t0    = a3d_utime();
+	double       dtmin = 0.0;
+	double       dtmax = 0.0;
+	double       dtsum = 0.0;
+	int          n     = 0;
+	lzs_result_t result;
+	while(fread(frame, size, 1, f) == 1)
+	{
+		double t  = t0 + A3D_USEC*((double) (n + 1))/30.0;
+		double t1 = now_ns();
+		lzs_pipeline_luma(pipeline, frame, chroma, width, height, width, t);
+		lzs_pipeline_flush(pipeline);
+		double dt = now_ns() - t1;
+
+		if((n == 0) || (dt < dtmin))
+		{
+			dtmin = dt;
+		}
+		if((n == 0) || (dt > dtmax))
+		{
+			dtmax = dt;
+		}
+		dtsum += dt;
+
+		if(quiet == 0)
+		{
+			lzs_pipeline_result(pipeline, &result);
+			printf("frame=%i, dt=%.0lf ns, x=%0.1f, y=%0.1f, peak=%u, roi=%0.1f,%0.1f,%i, lost=%i, reacquired=%u\n",
+			       n, dt, result.sphero_x, result.sphero_y, result.peak.mag,
+			       result.roi_x, result.roi_y, result.roi_radius,
+			       result.lost, result.reacquired);
+
+			lzs_balls_t balls;
+			lzs_pipeline_balls(pipeline, &balls);
+			for(i = 0; i < balls.count; ++i)
+			{
+				lzs_ball_t* ball = &balls.ball[i];
+				printf("  ball=%i, x=%0.1f, y=%0.1f, roi=%0.1f,%0.1f,%i, lost=%i\n",
+				       i + 1, ball->sphero_x, ball->sphero_y,
+				       ball->roi_x, ball->roi_y, ball->roi_radius, ball->lost);
+			}
+		}
+		++n;
+	}
+
+	if(n > 0)
+	{
+		double avg = dtsum/((double) n);
+		printf("frames=%i, min=%.0lf ns, avg=%.0lf ns, max=%.0lf ns, throughput=%.1lf fps\n",
+		       n, dtmin, avg, dtmax, 1.0e9/avg);
+	}
+
+	lzs_pipeline_delete(&pipeline);
+	lzs_recorder_delete(&recorder);
+	free(frame);
+	fclose(f);
+	return (n > 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,529 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "lzs_pipeline.h"
+#include "lzs_session.h"
+#include "texgz/texgz_tex.h"
+#include "a3d/a3d_time.h"
+
+#define LOG_TAG "lzs_replay"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+// frames.txt was written by the renderer before the session
+// recorder replaced DEBUG_BUFFERS and each line contains
+// fname sphero_x sphero_y sphero_heading sphero_heading_offset
+//       phone_heading phone_slope phone_height
+typedef struct
+{
+	texgz_tex_t* tex;
+	float        sphero_x;
+	float        sphero_y;
+	float        sphero_heading;
+	float        sphero_heading_offset;
+	float        phone_heading;
+	float        phone_slope;
+	float        phone_height;
+} lzs_replayframe_t;
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return 1.0e9*((double) ts.tv_sec) + (double) ts.tv_nsec;
+}
+
+static lzs_replayframe_t* load_frames(const char* dir, int* _count)
+{
+	char fname[512];
+	snprintf(fname, 512, "%s/frames.txt", dir);
+	FILE* f = fopen(fname, "r");
+	if(f == NULL)
+	{
+		LOGE("fopen %s failed", fname);
+		return NULL;
+	}
+
+	int                count  = 0;
+	int                size   = 0;
+	lzs_replayframe_t* frames = NULL;
+	char               name[256];
+	lzs_replayframe_t  frame;
+	while(fscanf(f, "%255s %f %f %f %f %f %f %f", name,
+	             &frame.sphero_x, &frame.sphero_y,
+	             &frame.sphero_heading, &frame.sphero_heading_offset,
+	             &frame.phone_heading, &frame.phone_slope,
+	             &frame.phone_height) == 8)
+	{
+		snprintf(fname, 512, "%s/%s", dir, name);
+		frame.tex = texgz_tex_import(fname);
+		if(frame.tex == NULL)
+		{
+			LOGE("texgz_tex_import %s failed", fname);
+			continue;
+		}
+
+		if(count == size)
+		{
+			size = (size == 0) ? 256 : 2*size;
+			lzs_replayframe_t* tmp = (lzs_replayframe_t*) realloc(frames, size*sizeof(lzs_replayframe_t));
+			if(tmp == NULL)
+			{
+				LOGE("realloc failed");
+				texgz_tex_delete(&frame.tex);
+				break;
+			}
+			frames = tmp;
+		}
+		frames[count++] = frame;
+	}
+	fclose(f);
+
+	*_count = count;
+	return frames;
+}
+
+static void delete_frames(lzs_replayframe_t** _frames, int count)
+{
+	lzs_replayframe_t* frames = *_frames;
+	if(frames)
+	{
+		int i;
+		for(i = 0; i < count; ++i)
+		{
+			texgz_tex_delete(&frames[i].tex);
+		}
+		free(frames);
+		*_frames = NULL;
+	}
+}
+
+// returns the number of backends which differ from the reference
+static int verify_frame(const lzs_crop_t* crop, unsigned char* scratch, int frame)
+{
+	lzs_peak_t ref;
+	if(lzs_kernel_peakref(crop->pixels, crop->stride,
+	                      crop->w, crop->h, &ref) == 0)
+	{
+		return 1;
+	}
+
+	int nerr    = 0;
+	int current = lzs_kernel_backend();
+	int b;
+	for(b = 0; b < LZS_KERNEL_COUNT; ++b)
+	{
+		if(lzs_kernel_supported(b) == 0)
+		{
+			continue;
+		}
+		lzs_kernel_select(b);
+
+		lzs_peak_t peak;
+		lzs_kernel_peak(crop->pixels, crop->stride, crop->w, crop->h,
+		                scratch, &peak);
+		if((ref.x   != peak.x) ||
+		   (ref.y   != peak.y) ||
+		   (ref.mag != peak.mag))
+		{
+			LOGE("verify frame=%i, backend=%s: peak=%u,%i,%i, ref=%u,%i,%i",
+			     frame, lzs_kernel_name(b), peak.mag, peak.x, peak.y,
+			     ref.mag, ref.x, ref.y);
+			++nerr;
+		}
+	}
+	lzs_kernel_select(current);
+
+	return nerr;
+}
+
+typedef struct
+{
+	double dtmin;
+	double dtmax;
+	double dtsum;
+	int    n;
+} lzs_replaystats_t;
+
+static void stats_update(lzs_replaystats_t* stats, double dt)
+{
+	if((stats->n == 0) || (dt < stats->dtmin))
+	{
+		stats->dtmin = dt;
+	}
+	if((stats->n == 0) || (dt > stats->dtmax))
+	{
+		stats->dtmax = dt;
+	}
+	stats->dtsum += dt;
+	++stats->n;
+}
+
+// replays a session recorded by lzs_recorder in record order
+// and compares the tracker with the recorded results where
+// full frames are searched as in lzs_pipeline_reacquire
+static int replay_session(lzs_tracker_t* tracker, const char* fname,
+                          int quiet, lzs_replaystats_t* stats)
+{
+	lzs_session_t* session = lzs_session_new(fname);
+	if(session == NULL)
+	{
+		return 0;
+	}
+
+	lzs_reacquire_t* reacquire = lzs_reacquire_new(LZS_PIPELINE_LUMA_W, 0);
+	if(reacquire == NULL)
+	{
+		lzs_session_delete(&session);
+		return 0;
+	}
+
+	int    crops   = 0;
+	int    results = 0;
+	int    sensors = 0;
+	int    differ  = 0;
+	float  errmax  = 0.0f;
+	int    i;
+	for(i = 0; i < session->count; ++i)
+	{
+		const lzs_recordheader_t* rh      = lzs_session_record(session, i);
+		const void*               payload = lzs_session_payload(rh);
+		if(rh->type == LZS_RECORD_SEARCH)
+		{
+			const float* xy = (const float*) payload;
+			lzs_tracker_searchsphero(tracker, xy[0], xy[1]);
+		}
+		else if(rh->type == LZS_RECORD_CROP)
+		{
+			const lzs_recordcrop_t* rc  = (const lzs_recordcrop_t*) payload;
+			int                     bpp = (rc->format == LZS_CROP_LUMA) ? 1 : 4;
+			lzs_crop_t crop =
+			{
+				.t       = rh->t,
+				.x       = rc->x,
+				.y       = rc->y,
+				.w       = rc->w,
+				.h       = rc->h,
+				.stride  = bpp*rc->w,
+				.format  = rc->format,
+				.scale_x = rc->scale_x,
+				.scale_y = rc->scale_y,
+				.pixels  = (unsigned char*) (rc + 1),
+			};
+			tracker->sphero_heading        = rc->sphero_heading;
+			tracker->sphero_heading_offset = rc->sphero_heading_offset;
+			tracker->phone_heading         = rc->phone_heading;
+			tracker->phone_slope           = rc->phone_slope;
+			tracker->phone_height          = rc->phone_height;
+
+			double t0 = now_ns();
+			if(rc->full)
+			{
+				lzs_peak_t candidates[4];
+				int        count;
+				int        blob = lzs_tracker_hascolor(tracker, &crop);
+				if(blob)
+				{
+					count = lzs_tracker_blob(tracker, &crop, &candidates[0]);
+				}
+				else if(crop.format == LZS_CROP_LUMA)
+				{
+					count = lzs_reacquire_searchgray(reacquire, crop.pixels, crop.stride,
+					                                 crop.w, crop.h, tracker->config.radius_ball/crop.scale_x,
+					                                 candidates, 4);
+				}
+				else
+				{
+					count = lzs_reacquire_search(reacquire, crop.pixels, crop.stride,
+					                             crop.w, crop.h, tracker->config.radius_ball,
+					                             candidates, 4);
+				}
+				if(tracker->lost && (count > 0) &&
+				   (blob || lzs_tracker_accept(tracker, &candidates[0])))
+				{
+					lzs_tracker_reacquire(tracker, &crop, &candidates[0]);
+				}
+			}
+			else
+			{
+				lzs_tracker_detect(tracker, &crop);
+			}
+			lzs_tracker_steer(tracker);
+			stats_update(stats, now_ns() - t0);
+			++crops;
+		}
+		else if((rh->type == LZS_RECORD_RESULT) &&
+		        (rh->size >= sizeof(lzs_result_t)))
+		{
+			const lzs_result_t* r  = (const lzs_result_t*) payload;
+			float               dx = tracker->sphero_x - r->sphero_x;
+			float               dy = tracker->sphero_y - r->sphero_y;
+			float               d  = sqrtf(dx*dx + dy*dy);
+			if(d > 0.01f)
+			{
+				++differ;
+			}
+			errmax = (d > errmax) ? d : errmax;
+			++results;
+
+			if(quiet == 0)
+			{
+				printf("t=%.0lf, x=%0.1f, y=%0.1f, recorded=%0.1f,%0.1f, lost=%i\n",
+				       rh->t, tracker->sphero_x, tracker->sphero_y,
+				       r->sphero_x, r->sphero_y, tracker->lost);
+			}
+		}
+		else if(rh->type == LZS_RECORD_SENSOR)
+		{
+			++sensors;
+		}
+	}
+
+	printf("session: records=%i, crops=%i, results=%i, sensors=%i, differ=%i, max=%0.2f px\n",
+	       session->count, crops, results, sensors, differ, errmax);
+
+	lzs_reacquire_delete(&reacquire);
+	lzs_session_delete(&session);
+	return 1;
+}
+
+static void usage(const char* argv0)
+{
+	LOGE("usage: %s [-q] [-v] [-c] [-k] [-l levels] [-r repeat] dir|session", argv0);
+	LOGE("-v verifies each kernel backend against the reference");
+	LOGE("-c selects the circle detector");
+	LOGE("-k selects the LED color detector for BGRA crops");
+	LOGE("-l enables the pyramid search with levels");
+	LOGE("dir contains frames.txt and the exported color-*.texgz crops");
+	LOGE("session is recorded by lzs_recorder (see RECORD_SESSION)");
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+int main(int argc, char** argv)
+{
+	int         quiet  = 0;
+	int         verify = 0;
+	int         repeat = 1;
+	int         levels = 0;
+	int         detect = LZS_DETECTOR_PEAK;
+	const char* dir    = NULL;
+	int i;
+	for(i = 1; i < argc; ++i)
+	{
+		if(strcmp(argv[i], "-q") == 0)
+		{
+			quiet = 1;
+		}
+		else if(strcmp(argv[i], "-v") == 0)
+		{
+			verify = 1;
+		}
+		else if(strcmp(argv[i], "-c") == 0)
+		{
+			detect = LZS_DETECTOR_CIRCLE;
+		}
+		else if(strcmp(argv[i], "-k") == 0)
+		{
+			detect = LZS_DETECTOR_COLOR;
+		}
+		else if((strcmp(argv[i], "-r") == 0) && (i + 1 < argc))
+		{
+			repeat = atoi(argv[++i]);
+		}
+		else if((strcmp(argv[i], "-l") == 0) && (i + 1 < argc))
+		{
+			levels = atoi(argv[++i]);
+		}
+		else
+		{
+			dir = argv[i];
+		}
+	}
+	if((dir == NULL) || (repeat < 1))
+	{
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	// the recordings use the default config
+	lzs_config_t config;
+	lzs_config_defaults(&config);
+
+	// sessions are replayed once in record order
+	struct stat st;
+	if((stat(dir, &st) == 0) && S_ISREG(st.st_mode))
+	{
+		lzs_tracker_t* tracker = lzs_tracker_new(&config);
+		if(tracker == NULL)
+		{
+			return EXIT_FAILURE;
+		}
+
+		lzs_replaystats_t stats;
+		memset(&stats, 0, sizeof(lzs_replaystats_t));
+		if((lzs_tracker_window(tracker, (int) LZS_RADIUS_MAX, levels) == 0) ||
+		   (lzs_tracker_detector(tracker, detect) == 0) ||
+		   (replay_session(tracker, dir, quiet, &stats) == 0))
+		{
+			lzs_tracker_delete(&tracker);
+			return EXIT_FAILURE;
+		}
+
+		if(stats.n > 0)
+		{
+			double avg = stats.dtsum/((double) stats.n);
+			printf("frames=%i, min=%.0lf ns, avg=%.0lf ns, max=%.0lf ns, throughput=%.1lf fps\n",
+			       stats.n, stats.dtmin, avg, stats.dtmax, 1.0e9/avg);
+		}
+		lzs_tracker_delete(&tracker);
+		return EXIT_SUCCESS;
+	}
+
+	int                count  = 0;
+	lzs_replayframe_t* frames = load_frames(dir, &count);
+	if((frames == NULL) || (count == 0))
+	{
+		LOGE("no frames in %s", dir);
+		delete_frames(&frames, count);
+		return EXIT_FAILURE;
+	}
+
+	lzs_tracker_t* tracker = lzs_tracker_new(&config);
+	if(tracker == NULL)
+	{
+		delete_frames(&frames, count);
+		return EXIT_FAILURE;
+	}
+
+	// the search window holds the largest recorded crop
+	int size = 0;
+	for(i = 0; i < count; ++i)
+	{
+		if(frames[i].tex->width > size)
+		{
+			size = frames[i].tex->width;
+		}
+	}
+	if((lzs_tracker_window(tracker, size/2, levels) == 0) ||
+	   (lzs_tracker_detector(tracker, detect) == 0))
+	{
+		lzs_tracker_delete(&tracker);
+		delete_frames(&frames, count);
+		return EXIT_FAILURE;
+	}
+	size = 2*tracker->radius;
+
+	lzs_replaystats_t stats;
+	memset(&stats, 0, sizeof(lzs_replaystats_t));
+	int nerr = 0;
+	int r;
+	for(r = 0; r < repeat; ++r)
+	{
+		for(i = 0; i < count; ++i)
+		{
+			lzs_replayframe_t* frame = &frames[i];
+			texgz_tex_t*       tex   = frame->tex;
+			if((tex->width  > LZS_CROP_MAX) ||
+			   (tex->height > LZS_CROP_MAX) ||
+			   (tex->format != TEXGZ_BGRA)    ||
+			   (tex->type   != TEXGZ_UNSIGNED_BYTE))
+			{
+				LOGE("invalid crop %i: %ix%i", i, tex->width, tex->height);
+				continue;
+			}
+
+			// restore the state at the time of the capture
+			// where the crops are assumed to be 30 Hz
+			int w = (tex->width  < size) ? tex->width  : size;
+			int h = (tex->height < size) ? tex->height : size;
+			lzs_crop_t crop =
+			{
+				.t       = A3D_USEC*((double) (r*count + i + 1))/30.0,
+				.x       = frame->sphero_x,
+				.y       = frame->sphero_y,
+				.w       = w,
+				.h       = h,
+				.stride  = 4*tex->stride,
+				.format  = LZS_CROP_BGRA,
+				.scale_x = 1.0f,
+				.scale_y = 1.0f,
+				.pixels  = tex->pixels,
+			};
+			tracker->sphero_heading        = frame->sphero_heading;
+			tracker->sphero_heading_offset = frame->sphero_heading_offset;
+			tracker->phone_heading         = frame->phone_heading;
+			tracker->phone_slope           = frame->phone_slope;
+			tracker->phone_height          = frame->phone_height;
+
+			double t0 = now_ns();
+			lzs_tracker_detect(tracker, &crop);
+			lzs_tracker_steer(tracker);
+			double dt = now_ns() - t0;
+			stats_update(&stats, dt);
+
+			if(verify && (r == 0))
+			{
+				nerr += verify_frame(&crop, tracker->scratch, i);
+			}
+
+			if((quiet == 0) && (r == 0))
+			{
+				printf("frame=%i, dt=%.0lf ns, x=%0.1f, y=%0.1f, X=%0.2f, Y=%0.2f, peak=%u, goal=%i, spd=%0.2f, roi=%0.1f,%0.1f,%i, lost=%i\n",
+				       i, dt, tracker->sphero_x, tracker->sphero_y,
+				       tracker->sphero_X, tracker->sphero_Y, tracker->peak.mag,
+				       lzs_tracker_spheroheading(tracker),
+				       lzs_tracker_spherospeed(tracker),
+				       tracker->roi_x, tracker->roi_y, tracker->roi_radius,
+				       tracker->lost);
+			}
+		}
+	}
+
+	if(stats.n > 0)
+	{
+		double avg = stats.dtsum/((double) stats.n);
+		printf("frames=%i, min=%.0lf ns, avg=%.0lf ns, max=%.0lf ns, throughput=%.1lf fps\n",
+		       stats.n, stats.dtmin, avg, stats.dtmax, 1.0e9/avg);
+	}
+
+	if(verify)
+	{
+		printf("verify: %i errors\n", nerr);
+	}
+
+	lzs_tracker_delete(&tracker);
+	delete_frames(&frames, count);
+	return (nerr == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_scene.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include "lzs_camera.h"
+
+#define LOG_TAG "lzs_scene"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+#define LZS_SCENE_HZ 30.0f
+
+// the floor texture is wide enough for the largest pan and
+// tall enough for the largest change in slope
+#define LZS_SCENE_PAD  256
+#define LZS_SCENE_PADY 64
+
+static unsigned int lzs_scene_rand(unsigned int* seed)
+{
+	// xorshift32
+	unsigned int x = *seed;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*seed = x;
+	return x;
+}
+
+// approximately gaussian with unit variance
+static float lzs_scene_gauss(unsigned int* seed)
+{
+	// the sum of four uniforms has a variance of 1/3
+	float s = 0.0f;
+	int   i;
+	for(i = 0; i < 4; ++i)
+	{
+		s += (float) (lzs_scene_rand(seed) & 0xFFFF)/65535.0f;
+	}
+	return (s - 2.0f)*1.7320508f;
+}
+
+static unsigned char lzs_scene_clamp(float v)
+{
+	if(v < 0.0f)
+	{
+		return 0;
+	}
+	else if(v > 255.0f)
+	{
+		return 255;
+	}
+	return (unsigned char) (v + 0.5f);
+}
+
+// box blur of a w x h plane in place
+static void lzs_scene_blur(unsigned char* luma, unsigned char* tmp,
+                           int w, int h, int r)
+{
+	int n = 2*r + 1;
+	int x;
+	int y;
+	for(y = 0; y < h; ++y)
+	{
+		unsigned char* row = &luma[y*w];
+		int            sum = 0;
+		for(x = -r; x <= r; ++x)
+		{
+			sum += row[(x < 0) ? 0 : ((x >= w) ? w - 1 : x)];
+		}
+		for(x = 0; x < w; ++x)
+		{
+			tmp[y*w + x] = (unsigned char) (sum/n);
+			int x0 = x - r;
+			int x1 = x + r + 1;
+			sum += row[(x1 >= w) ? w - 1 : x1] - row[(x0 < 0) ? 0 : x0];
+		}
+	}
+	for(x = 0; x < w; ++x)
+	{
+		int sum = 0;
+		for(y = -r; y <= r; ++y)
+		{
+			sum += tmp[((y < 0) ? 0 : ((y >= h) ? h - 1 : y))*w + x];
+		}
+		for(y = 0; y < h; ++y)
+		{
+			luma[y*w + x] = (unsigned char) (sum/n);
+			int y0 = y - r;
+			int y1 = y + r + 1;
+			sum += tmp[((y1 >= h) ? h - 1 : y1)*w + x] - tmp[((y0 < 0) ? 0 : y0)*w + x];
+		}
+	}
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+lzs_scenegen_t* lzs_scenegen_new(const lzs_scene_t* scene, int w, int h)
+{
+	assert(scene);
+	LOGD("debug name=%s, w=%i, h=%i", scene->name, w, h);
+
+	lzs_scenegen_t* self = (lzs_scenegen_t*) malloc(sizeof(lzs_scenegen_t));
+	if(self == NULL)
+	{
+		LOGE("malloc failed");
+		return NULL;
+	}
+
+	self->scene = *scene;
+	self->w     = w;
+	self->h     = h;
+	self->tw    = w + 2*LZS_SCENE_PAD;
+	self->th    = h + 2*LZS_SCENE_PADY;
+	self->seed  = 0x2545F491;
+
+	// the chroma noise does not disturb the luma noise
+	self->seed_chroma = 0x6C078965;
+
+	self->texture = (unsigned char*) malloc(self->tw*self->th);
+	self->light   = (float*) malloc(w*h*sizeof(float));
+	self->tmp     = (unsigned char*) malloc(self->tw*self->th);
+	if((self->texture == NULL) || (self->light == NULL) ||
+	   (self->tmp == NULL))
+	{
+		LOGE("malloc failed");
+		free(self->texture);
+		free(self->light);
+		free(self->tmp);
+		free(self);
+		return NULL;
+	}
+
+	// the floor is a smoothed random tile pattern
+	unsigned int seed = 0x9E3779B9;
+	int x;
+	int y;
+	for(y = 0; y < self->th; ++y)
+	{
+		for(x = 0; x < self->tw; ++x)
+		{
+			int tile = ((x/24) + (y/24)) & 1;
+			int v    = scene->floor + (tile ? scene->contrast : -scene->contrast)/2 +
+			           (int) (lzs_scene_rand(&seed)%(scene->contrast + 1)) - scene->contrast/2;
+			if(scene->seam && ((x%LZS_SCENE_TILE < LZS_SCENE_GROUT) ||
+			                   (y%LZS_SCENE_TILE < LZS_SCENE_GROUT)))
+			{
+				v = scene->seam;
+			}
+			self->texture[y*self->tw + x] = lzs_scene_clamp((float) v);
+		}
+	}
+	lzs_scene_blur(self->texture, self->tmp, self->tw, self->th, 1);
+
+	// gradient from left to right and vignette
+	for(y = 0; y < h; ++y)
+	{
+		for(x = 0; x < w; ++x)
+		{
+			float u  = ((float) x)/((float) w);
+			float dx = 2.0f*u - 1.0f;
+			float dy = 2.0f*((float) y)/((float) h) - 1.0f;
+			float g  = 1.0f - scene->light*(0.5f*u + 0.25f*(dx*dx + dy*dy));
+			self->light[y*w + x] = g;
+		}
+	}
+
+	return self;
+}
+
+void lzs_scenegen_delete(lzs_scenegen_t** _self)
+{
+	assert(_self);
+
+	lzs_scenegen_t* self = *_self;
+	if(self)
+	{
+		LOGD("debug");
+		free(self->texture);
+		free(self->light);
+		free(self->tmp);
+		free(self);
+		*_self = NULL;
+	}
+}
+
+void lzs_scenegen_truth(lzs_scenegen_t* self, int frame, lzs_truth_t* truth)
+{
+	assert(self);
+	assert(truth);
+	LOGD("debug frame=%i", frame);
+
+	const lzs_scene_t* scene = &self->scene;
+	float t  = ((float) frame)/LZS_SCENE_HZ;
+	float cx = 0.5f*((float) self->w);
+	float cy = 0.5f*((float) self->h);
+	float ax = 0.5f*((float) self->w) - 2.0f*scene->radius;
+	float ay = 0.5f*((float) self->h) - 2.0f*scene->radius;
+	float x  = cx;
+	float y  = cy;
+	if(scene->path == LZS_SCENE_LINE)
+	{
+		// bounce between the left and right sides
+		float d = fmodf(scene->speed*t, 4.0f*ax);
+		x = cx - ax + ((d < 2.0f*ax) ? d : 4.0f*ax - d);
+		y = cy + 0.25f*ay;
+	}
+	else if(scene->path == LZS_SCENE_CIRCLE)
+	{
+		float r = 0.8f*ay;
+		float a = scene->speed*t/r;
+		x = cx + r*cosf(a);
+		y = cy + r*sinf(a);
+	}
+	else if(scene->path == LZS_SCENE_EIGHT)
+	{
+		// the speed is approximate
+		float a = scene->speed*t/(0.75f*ax);
+		x = cx + 0.8f*ax*sinf(a);
+		y = cy + 0.8f*ay*sinf(a)*cosf(a);
+	}
+
+	float pt = 2.0f*((float) M_PI)*t;
+	truth->x       = x;
+	truth->y       = y;
+	truth->visible = (frame < scene->hide0) || (frame >= scene->hide1);
+	truth->heading = scene->pan*sinf(0.1f*pt);
+	truth->slope   = scene->slope + 2.0f*sinf(0.07f*pt);
+	truth->height  = scene->height;
+}
+
+void lzs_scenegen_render(lzs_scenegen_t* self, int frame,
+                         unsigned char* luma, unsigned char* chroma,
+                         lzs_truth_t* truth)
+{
+	assert(self);
+	assert(luma);
+	assert(truth);
+	LOGD("debug frame=%i", frame);
+
+	const lzs_scene_t* scene = &self->scene;
+	lzs_scenegen_truth(self, frame, truth);
+
+	// the floor moves with the heading and slope at the
+	// pixels per degree of the tracker camera model
+	int w    = self->w;
+	int h    = self->h;
+	int off  = LZS_SCENE_PAD + (int) (truth->heading*0.5f*((float) w)/LZS_CAMERA_FOVX);
+	int offy = LZS_SCENE_PADY - (int) ((truth->slope - scene->slope)*0.5f*((float) h)/LZS_CAMERA_FOVY);
+	off  = (off  < 0) ? 0 : ((off  > 2*LZS_SCENE_PAD)  ? 2*LZS_SCENE_PAD  : off);
+	offy = (offy < 0) ? 0 : ((offy > 2*LZS_SCENE_PADY) ? 2*LZS_SCENE_PADY : offy);
+
+	// the ball is shaded toward its rim and its edge is
+	// antialiased by the coverage of each pixel
+	float r  = scene->radius;
+	float bx = truth->x;
+	float by = truth->y;
+	int x;
+	int y;
+	for(y = 0; y < h; ++y)
+	{
+		const unsigned char* src = &self->texture[(y + offy)*self->tw + off];
+		const float*         g   = &self->light[y*w];
+		unsigned char*       dst = &luma[y*w];
+		float                dy  = ((float) y) + 0.5f - by;
+		for(x = 0; x < w; ++x)
+		{
+			float v  = (float) src[x];
+			float dx = ((float) x) + 0.5f - bx;
+			float d  = sqrtf(dx*dx + dy*dy);
+			if(truth->visible && (d < r + 1.0f))
+			{
+				float cover = r + 0.5f - d;
+				cover = (cover < 0.0f) ? 0.0f : ((cover > 1.0f) ? 1.0f : cover);
+				float shade = (float) scene->ball*(1.0f - 0.15f*d*d/(r*r));
+				v = cover*shade + (1.0f - cover)*v;
+			}
+			v = g[x]*v;
+			if(scene->noise > 0.0f)
+			{
+				v += scene->noise*lzs_scene_gauss(&self->seed);
+			}
+			dst[x] = lzs_scene_clamp(v);
+		}
+	}
+
+	if(scene->blur > 0)
+	{
+		lzs_scene_blur(luma, self->tmp, w, h, scene->blur);
+	}
+
+	// the VU plane has one pair per 2x2 block where the LED
+	// covers the block over a blurred edge and the chroma is
+	// scaled with the light like the luma
+	if(chroma == NULL)
+	{
+		return;
+	}
+	for(y = 0; y < h/2; ++y)
+	{
+		const float*   g   = &self->light[2*y*w];
+		unsigned char* dst = &chroma[y*w];
+		float          dy  = 2.0f*((float) y) + 1.0f - by;
+		for(x = 0; x < w/2; ++x)
+		{
+			float u  = (float) (LZS_SCENE_FLOOR_U - 128);
+			float v  = (float) (LZS_SCENE_FLOOR_V - 128);
+			float dx = 2.0f*((float) x) + 1.0f - bx;
+			float d  = sqrtf(dx*dx + dy*dy);
+			if(truth->visible && (d < r + 1.0f))
+			{
+				float cover = 0.5f*(r + 1.0f - d);
+				cover = (cover > 1.0f) ? 1.0f : cover;
+				u = cover*((float) (LZS_SCENE_LED_U - 128)) + (1.0f - cover)*u;
+				v = cover*((float) (LZS_SCENE_LED_V - 128)) + (1.0f - cover)*v;
+			}
+			u = g[2*x]*u;
+			v = g[2*x]*v;
+			if(scene->noise > 0.0f)
+			{
+				u += 0.5f*scene->noise*lzs_scene_gauss(&self->seed_chroma);
+				v += 0.5f*scene->noise*lzs_scene_gauss(&self->seed_chroma);
+			}
+			dst[2*x]     = lzs_scene_clamp(128.0f + v);
+			dst[2*x + 1] = lzs_scene_clamp(128.0f + u);
+		}
+	}
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef lzs_scene_H
+#define lzs_scene_H
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+// synthetic camera preview of a ball on a textured floor
+//
+// frames are generated with a private random number
+// generator so a scene renders the same pixels on every
+// machine and the results are comparable across commits
+#define LZS_SCENE_STATIC 0
+#define LZS_SCENE_LINE   1
+#define LZS_SCENE_CIRCLE 2
+#define LZS_SCENE_EIGHT  3
+
+// tile size and grout width in preview pixels
+#define LZS_SCENE_TILE  48
+#define LZS_SCENE_GROUT 3
+
+// NV21 chroma of the floor and of the blue sphero LED
+#define LZS_SCENE_FLOOR_U 120
+#define LZS_SCENE_FLOOR_V 136
+#define LZS_SCENE_LED_U   220
+#define LZS_SCENE_LED_V   96
+
+typedef struct
+{
+	const char* name;
+
+	// path of the ball center in preview pixels where speed
+	// is pixels per second
+	int   path;
+	float speed;
+	float radius;
+
+	// luma of the ball and the floor where contrast is the
+	// amplitude of the floor texture, seam is the luma of the
+	// grout between LZS_SCENE_TILE tiles (0 for none) and
+	// light darkens the frame from left to right and toward
+	// the corners
+	int   ball;
+	int   floor;
+	int   contrast;
+	int   seam;
+	float light;
+
+	// gaussian noise sigma and box blur radius
+	float noise;
+	int   blur;
+
+	// the ball is hidden in [hide0, hide1)
+	int   hide0;
+	int   hide1;
+
+	// phone track where the heading pans by pan degrees
+	// and the floor texture moves with the heading and slope
+	float pan;
+	float slope;
+	float height;
+} lzs_scene_t;
+
+typedef struct
+{
+	// ball center in preview pixels
+	float x;
+	float y;
+	int   visible;
+
+	// phone orientation in degrees and height in feet
+	float heading;
+	float slope;
+	float height;
+} lzs_truth_t;
+
+typedef struct
+{
+	lzs_scene_t    scene;
+	int            w;
+	int            h;
+	int            tw;
+	int            th;
+	unsigned char* texture;
+	float*         light;
+	unsigned char* tmp;
+	unsigned int   seed;
+	unsigned int   seed_chroma;
+} lzs_scenegen_t;
+
+lzs_scenegen_t* lzs_scenegen_new(const lzs_scene_t* scene, int w, int h);
+void            lzs_scenegen_delete(lzs_scenegen_t** _self);
+void            lzs_scenegen_truth(lzs_scenegen_t* self, int frame, lzs_truth_t* truth);
+void            lzs_scenegen_render(lzs_scenegen_t* self, int frame,
+                                    unsigned char* luma, unsigned char* chroma,
+                                    lzs_truth_t* truth);
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lzs_timing.h"
+
+#define LOG_TAG "lzs_timingdump"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+static void print_timing(const lzs_timing_t* timing)
+{
+	printf("%-12s %10s %10s %10s %10s %10s\n",
+	       "stage", "count", "p50 us", "p95 us", "p99 us", "max us");
+
+	int i;
+	for(i = 0; i < LZS_TIMING_COUNT; ++i)
+	{
+		lzs_timingstats_t st;
+		lzs_timing_stats(timing, i, &st);
+		printf("%-12s %10u %10.1f %10.1f %10.1f %10.1f\n",
+		       lzs_timing_name(i), st.count, st.p50/1000.0,
+		       st.p95/1000.0, st.p99/1000.0, st.max/1000.0);
+	}
+}
+
+// measures the cost of a mark which reads the clock and
+// updates a histogram
+static void bench_timing(int iters)
+{
+	lzs_timing_t timing;
+	lzs_timing_reset(&timing);
+
+	unsigned int t0 = lzs_timing_now();
+	unsigned int t  = t0;
+	int i;
+	for(i = 0; i < iters; ++i)
+	{
+		t = lzs_timing_mark(&timing, LZS_TIMING_DETECT, t);
+	}
+	unsigned int dt = lzs_timing_now() - t0;
+
+	printf("bench mark: %.1f ns\n", ((double) dt)/((double) iters));
+	print_timing(&timing);
+}
+
+static void usage(const char* argv0)
+{
+	LOGE("usage: %s [-b] [timing.bin]", argv0);
+	LOGE("-b measures the overhead of recording a stage");
+	LOGE("timing.bin is exported by the renderer (see pull-data.sh)");
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+int main(int argc, char** argv)
+{
+	int         bench = 0;
+	const char* fname = NULL;
+	int i;
+	for(i = 1; i < argc; ++i)
+	{
+		if(strcmp(argv[i], "-b") == 0)
+		{
+			bench = 1;
+		}
+		else
+		{
+			fname = argv[i];
+		}
+	}
+	if((bench == 0) && (fname == NULL))
+	{
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if(bench)
+	{
+		bench_timing(1000000);
+	}
+
+	if(fname)
+	{
+		lzs_timing_t timing;
+		if(lzs_timing_import(&timing, fname) == 0)
+		{
+			return EXIT_FAILURE;
+		}
+		print_timing(&timing);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_background.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#define LOG_TAG "LaserShark"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+// returns the ground cell of X, Y or -1 when the point is
+// beyond the horizon or out of range and key is nonzero
+static int lzs_background_cell(float X, float Y, unsigned int* key)
+{
+	assert(key);
+
+	if((fabsf(X) >= LZS_BACKGROUND_RANGE) || (fabsf(Y) >= LZS_BACKGROUND_RANGE) ||
+	   (X != X) || (Y != Y))
+	{
+		return -1;
+	}
+
+	int gx = (int) floorf(X/LZS_BACKGROUND_FEET);
+	int gy = (int) floorf(Y/LZS_BACKGROUND_FEET);
+	*key = (((unsigned int) (gx + 0x8000)) << 16) | ((unsigned int) (gy + 0x8000));
+	return (gy & (LZS_BACKGROUND_GRID - 1))*LZS_BACKGROUND_GRID +
+	       (gx & (LZS_BACKGROUND_GRID - 1));
+}
+
+// ranks the strongest cells of the last search (or only
+// the foreground cells) by magnitude and returns the count
+static int lzs_background_rank(const lzs_background_t* self,
+                               lzs_peak_t* peaks, int count,
+                               int foreground)
+{
+	assert(self);
+	assert(peaks);
+
+	int ranked = 0;
+	int i;
+	for(i = 0; i < self->count; ++i)
+	{
+		unsigned int mag = self->peaks[i].mag;
+		if((mag == 0) ||
+		   ((ranked == count) && (mag <= peaks[count - 1].mag)))
+		{
+			continue;
+		}
+
+		if(foreground)
+		{
+			unsigned int key;
+			int          k = lzs_background_cell(self->X[i], self->Y[i], &key);
+			if((k >= 0) && (self->key[k] == key) &&
+			   ((float) mag <= LZS_BACKGROUND_K*self->mag[k]))
+			{
+				continue;
+			}
+		}
+
+		// insert the cell in order of magnitude
+		int j = (ranked < count) ? ranked++ : count - 1;
+		while((j > 0) && (peaks[j - 1].mag < mag))
+		{
+			peaks[j] = peaks[j - 1];
+			--j;
+		}
+		peaks[j] = self->peaks[i];
+	}
+	return ranked;
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+lzs_background_t* lzs_background_new(int w, int h)
+{
+	LOGD("debug w=%i, h=%i", w, h);
+
+	if((w < 3) || (h < 3))
+	{
+		LOGE("invalid w=%i, h=%i", w, h);
+		return NULL;
+	}
+
+	lzs_background_t* self = (lzs_background_t*) malloc(sizeof(lzs_background_t));
+	if(self == NULL)
+	{
+		LOGE("malloc failed");
+		return NULL;
+	}
+
+	// the cells span LZS_BACKGROUND_CELL crop pixels at each
+	// pyramid level so the full resolution has the most
+	self->cells = ((w + LZS_BACKGROUND_CELL - 1)/LZS_BACKGROUND_CELL)*
+	              ((h + LZS_BACKGROUND_CELL - 1)/LZS_BACKGROUND_CELL);
+
+	self->peaks = (lzs_peak_t*) malloc(self->cells*sizeof(lzs_peak_t));
+	if(self->peaks == NULL)
+	{
+		LOGE("malloc failed");
+		goto fail_peaks;
+	}
+
+	// one buffer holds the cell centers
+	self->x = (float*) malloc(4*self->cells*sizeof(float));
+	if(self->x == NULL)
+	{
+		LOGE("malloc failed");
+		goto fail_centers;
+	}
+	self->y = self->x + self->cells;
+	self->X = self->y + self->cells;
+	self->Y = self->X + self->cells;
+
+	self->scratch = (unsigned char*) lzs_kernel_malloc(LZS_KERNEL_SCRATCH(w));
+	if(self->scratch == NULL)
+	{
+		goto fail_scratch;
+	}
+
+	lzs_background_reset(self);
+
+	// success
+	return self;
+
+	// failure
+	fail_scratch:
+		free(self->x);
+	fail_centers:
+		free(self->peaks);
+	fail_peaks:
+		free(self);
+	return NULL;
+}
+
+void lzs_background_delete(lzs_background_t** _self)
+{
+	assert(_self);
+
+	lzs_background_t* self = *_self;
+	if(self)
+	{
+		LOGD("debug");
+		lzs_kernel_free(self->scratch);
+		free(self->x);
+		free(self->peaks);
+		free(self);
+		*_self = NULL;
+	}
+}
+
+void lzs_background_reset(lzs_background_t* self)
+{
+	assert(self);
+	LOGD("debug");
+
+	self->count = 0;
+	memset(self->key, 0, sizeof(self->key));
+}
+
+int lzs_background_peaksgray(lzs_background_t* self, lzs_camera_t* camera,
+                             const unsigned char* gray, int stride,
+                             int w, int h, int level,
+                             float x, float y, float scale_x, float scale_y,
+                             lzs_peak_t* peaks, int count)
+{
+	assert(self);
+	assert(camera);
+	assert(gray);
+	assert(peaks);
+	LOGD("debug stride=%i, w=%i, h=%i, level=%i, count=%i", stride, w, h, level, count);
+
+	self->count = 0;
+
+	// cells cover the pixels [1, w - 1) x [1, h - 1) which
+	// have an edge response
+	int cell = LZS_BACKGROUND_CELL >> level;
+	cell = (cell < 2) ? 2 : cell;
+	int cw = (w - 2 + cell - 1)/cell;
+	int ch = (h - 2 + cell - 1)/cell;
+	if((w < 3) || (h < 3) || (cw*ch > self->cells) || (count <= 0))
+	{
+		LOGE("invalid w=%i, h=%i, level=%i, count=%i", w, h, level, count);
+		return 0;
+	}
+
+	// peak of each cell
+	int n = cw*ch;
+	int i;
+	int j;
+	memset(self->peaks, 0, n*sizeof(lzs_peak_t));
+	for(j = 1; j < h - 1; ++j)
+	{
+		const unsigned char* row   = &gray[j*stride];
+		lzs_peak_t*          cells = &self->peaks[((j - 1)/cell)*cw];
+		for(i = 0; i < cw; ++i)
+		{
+			int x0 = 1 + i*cell;
+			int x1 = (x0 + cell > w - 1) ? w - 1 : x0 + cell;
+			lzs_kernel_peakgrayrow(row, stride, x0, x1, j,
+			                       self->scratch, &cells[i]);
+		}
+	}
+
+	// project the cell centers to the ground
+	float ox = x - scale_x*0.5f*((float) w);
+	float oy = y - scale_y*0.5f*((float) h);
+	for(j = 0; j < ch; ++j)
+	{
+		for(i = 0; i < cw; ++i)
+		{
+			self->x[j*cw + i] = ox + scale_x*(1.0f + ((float) cell)*(((float) i) + 0.5f));
+			self->y[j*cw + i] = oy + scale_y*(1.0f + ((float) cell)*(((float) j) + 0.5f));
+		}
+	}
+	lzs_camera_ground(camera, n, self->x, self->y, self->X, self->Y);
+	self->count = n;
+
+	// rank the strongest foreground cells or the strongest
+	// cells when no cell stands out so the candidates are no
+	// worse than without the model
+	int ranked = lzs_background_rank(self, peaks, count, 1);
+	if(ranked == 0)
+	{
+		ranked = lzs_background_rank(self, peaks, count, 0);
+	}
+	return ranked;
+}
+
+void lzs_background_update(lzs_background_t* self, float x, float y, float r)
+{
+	assert(self);
+	LOGD("debug x=%f, y=%f, r=%f", x, y, r);
+
+	// learn the cells of the last search away from the ball
+	int i;
+	for(i = 0; i < self->count; ++i)
+	{
+		float dx = self->x[i] - x;
+		float dy = self->y[i] - y;
+		if(dx*dx + dy*dy < r*r)
+		{
+			continue;
+		}
+
+		unsigned int key;
+		int          k   = lzs_background_cell(self->X[i], self->Y[i], &key);
+		float        mag = (float) self->peaks[i].mag;
+		if(k < 0)
+		{
+			continue;
+		}
+		else if(self->key[k] == key)
+		{
+			self->mag[k] += LZS_BACKGROUND_RATE*(mag - self->mag[k]);
+		}
+		else
+		{
+			self->key[k] = key;
+			self->mag[k] = mag;
+		}
+	}
+	self->count = 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef lzs_background_H
+#define lzs_background_H
+
+#include "lzs_kernel.h"
+#include "lzs_camera.h"
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+// running average of the floor edge magnitude on the ground
+// so that seams and tile edges may be suppressed in the peak
+// search even as the phone pans
+//
+// the gray crop is divided into cells of LZS_BACKGROUND_CELL
+// crop pixels and the peak of each cell is compared with the
+// average of the ground cell under its center where a cell is
+// foreground when its peak exceeds LZS_BACKGROUND_K times the
+// average (both are squared magnitudes) and the candidates are
+// the peaks of the strongest foreground cells (or of the
+// strongest cells when no cell is foreground) ranked by
+// magnitude in the same order as lzs_kernel_peaksgray
+//
+// the ground is divided into cells of LZS_BACKGROUND_FEET and
+// wrapped on a grid of LZS_BACKGROUND_GRID cells per side so
+// the memory covers the search window with a margin and a
+// ground cell is relearned when the window returns to it
+//
+// the cells of the last search are learned once the ball is
+// found so that the cells near the ball are not learned
+#define LZS_BACKGROUND_CELL  16
+#define LZS_BACKGROUND_FEET  0.125f
+#define LZS_BACKGROUND_GRID  64
+#define LZS_BACKGROUND_RATE  0.125f
+#define LZS_BACKGROUND_K     2.0f
+#define LZS_BACKGROUND_RANGE 32.0f   // ft
+
+typedef struct
+{
+	// cells of the largest crop and of the last search
+	int            cells;
+	int            count;
+	lzs_peak_t*    peaks;
+	float*         x;
+	float*         y;
+	float*         X;
+	float*         Y;
+	unsigned char* scratch;
+
+	// ground cells where key is 0 until the cell is learned
+	unsigned int key[LZS_BACKGROUND_GRID*LZS_BACKGROUND_GRID];
+	float        mag[LZS_BACKGROUND_GRID*LZS_BACKGROUND_GRID];
+} lzs_background_t;
+
+lzs_background_t* lzs_background_new(int w, int h);
+void              lzs_background_delete(lzs_background_t** _self);
+void              lzs_background_reset(lzs_background_t* self);
+int               lzs_background_peaksgray(lzs_background_t* self, lzs_camera_t* camera,
+                                           const unsigned char* gray, int stride,
+                                           int w, int h, int level,
+                                           float x, float y, float scale_x, float scale_y,
+                                           lzs_peak_t* peaks, int count);
+void              lzs_background_update(lzs_background_t* self, float x, float y, float r);
+
+#endif
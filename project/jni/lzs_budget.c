@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_budget.h"
+#include <assert.h>
+
+#define LOG_TAG "LaserShark"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+static void lzs_budgetstage_reset(lzs_budgetstage_t* self)
+{
+	assert(self);
+
+	self->level  = 0;
+	self->over   = 0;
+	self->under  = 0;
+	self->frames = 0;
+	self->misses = 0;
+}
+
+// steps the level of a stage where levels is the number of
+// levels of the stage and limit is the budget of a frame
+// at the current level
+static void lzs_budgetstage_update(lzs_budgetstage_t* self,
+                                   const char* name, int levels,
+                                   unsigned int cost,
+                                   float budget, float limit)
+{
+	assert(self);
+	assert(name);
+
+	int level = self->level;
+	++self->frames;
+
+	if((float) cost > limit)
+	{
+		++self->misses;
+		++self->over;
+		self->under = 0;
+		if((self->over >= LZS_BUDGET_DEGRADE) && (level < levels - 1))
+		{
+			LOGI("%s level=%i, cost=%u, budget=%f", name, level + 1, cost, budget);
+			self->level = level + 1;
+			self->over  = 0;
+		}
+		return;
+	}
+
+	// the headroom is measured against the budget of every
+	// frame so the last level is only left when the frames
+	// would fit without it
+	self->over = 0;
+	if((float) cost <= LZS_BUDGET_HEADROOM*budget)
+	{
+		++self->under;
+		if((self->under >= LZS_BUDGET_RESTORE) && (level > 0))
+		{
+			LOGI("%s level=%i, cost=%u, budget=%f", name, level - 1, cost, budget);
+			self->level = level - 1;
+			self->under = 0;
+		}
+	}
+	else
+	{
+		self->under = 0;
+	}
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+void lzs_budget_reset(lzs_budget_t* self, unsigned int budget)
+{
+	assert(self);
+	LOGD("debug budget=%u", budget);
+
+	self->budget  = budget;
+	self->parity  = 0;
+	self->skipped = 0;
+	lzs_budgetstage_reset(&self->vision);
+	lzs_budgetstage_reset(&self->render);
+}
+
+void lzs_budget_render(lzs_budget_t* self, unsigned int ns)
+{
+	assert(self);
+	LOGD("debug ns=%u", ns);
+
+	// only the HUD text reduces the cost of a draw
+	float budget = (float) self->budget;
+	lzs_budgetstage_update(&self->render, "render", LZS_BUDGET_NOTEXT + 1,
+	                       ns, budget, budget);
+}
+
+int lzs_budget_skip(lzs_budget_t* self)
+{
+	assert(self);
+	LOGD("debug");
+
+	if(self->vision.level < LZS_BUDGET_SKIP)
+	{
+		self->parity = 0;
+		return 0;
+	}
+
+	self->parity ^= 1;
+	if(self->parity)
+	{
+		++self->skipped;
+		return 1;
+	}
+	return 0;
+}
+
+void lzs_budget_update(lzs_budget_t* self, unsigned int ns)
+{
+	assert(self);
+	LOGD("debug ns=%u", ns);
+
+	// a frame at the last level has the time of two
+	float budget = (float) self->budget;
+	float limit  = (self->vision.level >= LZS_BUDGET_SKIP) ? 2.0f*budget : budget;
+	lzs_budgetstage_update(&self->vision, "vision", LZS_BUDGET_LEVELS,
+	                       ns, budget, limit);
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef lzs_budget_H
+#define lzs_budget_H
+
+#include "lzs_tracker.h"
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+// frame time scheduler which trades vision quality for the
+// frame rate when the device throttles
+//
+// the worker reports the cost of each crop it processes and
+// the render thread reports the cost of each draw where
+// each cost only drives the levels that reduce it since
+// the stages run in parallel and a stage misses when its
+// cost exceeds the budget
+//
+// a stage steps down after LZS_BUDGET_DEGRADE misses in a
+// row and steps back up after LZS_BUDGET_RESTORE frames in
+// a row within LZS_BUDGET_HEADROOM of the budget so the
+// level does not oscillate at the edge of the budget
+//
+// each vision level keeps the degradations of the levels
+// above it
+// LZS_BUDGET_ROI  limits the window to LZS_BUDGET_RADIUS
+//                 of the radius of the ball
+// LZS_BUDGET_HALF processes the camera crop at half size
+// LZS_BUDGET_SKIP processes every other frame where the
+//                 budget of a processed frame is doubled
+//
+// the render level LZS_BUDGET_NOTEXT stops updating the HUD
+// text each frame
+#define LZS_BUDGET_FULL   0
+#define LZS_BUDGET_ROI    1
+#define LZS_BUDGET_HALF   2
+#define LZS_BUDGET_SKIP   3
+#define LZS_BUDGET_LEVELS 4
+
+#define LZS_BUDGET_TEXT   0
+#define LZS_BUDGET_NOTEXT 1
+
+#define LZS_BUDGET_NS       16000000   // 16 ms
+#define LZS_BUDGET_DEGRADE  3
+#define LZS_BUDGET_RESTORE  30
+#define LZS_BUDGET_HEADROOM 0.5f
+#define LZS_BUDGET_RADIUS(radius_ball) ((int) (1.5f*(radius_ball)))
+
+// level of a stage and the frames it evaluated and missed
+typedef struct
+{
+	volatile int          level;
+	int                   over;
+	int                   under;
+	volatile unsigned int frames;
+	volatile unsigned int misses;
+} lzs_budgetstage_t;
+
+typedef struct
+{
+	volatile unsigned int budget;
+
+	// vision (and parity) is only written by the worker and
+	// the thread that holds the producer of the pipeline and
+	// render is only written by the render thread
+	lzs_budgetstage_t vision;
+	lzs_budgetstage_t render;
+	int               parity;
+
+	// frames skipped by the vision level
+	volatile unsigned int skipped;
+} lzs_budget_t;
+
+void lzs_budget_reset(lzs_budget_t* self, unsigned int budget);
+void lzs_budget_render(lzs_budget_t* self, unsigned int ns);
+int  lzs_budget_skip(lzs_budget_t* self);
+void lzs_budget_update(lzs_budget_t* self, unsigned int ns);
+
+#endif
@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_camera.h"
+#include "lzs_kernel.h"
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+
+#define LOG_TAG "LaserShark"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+static void lzs_camera_rebuild(lzs_camera_t* self)
+{
+	assert(self);
+	LOGD("debug slope=%f, height=%f", self->slope, self->height);
+
+	float ps = self->slope*M_PI/180.0f;
+	int   i;
+	for(i = 0; i <= self->h; ++i)
+	{
+		float aps = ps - self->fovy*(((float) i) - self->cy)/self->cy;
+		self->row_hyp[i] = self->height*tanf(aps);
+	}
+
+	self->table_slope  = self->slope;
+	self->table_height = self->height;
+	self->dirty        = 0;
+}
+
+// wraps a to [-range/2, range/2)
+static float lzs_camera_wrap(float a, float range)
+{
+	return a - range*floorf(a/range + 0.5f);
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+lzs_camera_t* lzs_camera_new(int w, int h, float cx, float cy, float fovx, float fovy)
+{
+	LOGD("debug w=%i, h=%i, cx=%f, cy=%f, fovx=%f, fovy=%f", w, h, cx, cy, fovx, fovy);
+
+	if((w < 2) || (h < 2) || (cx <= 0.0f) || (cy <= 0.0f) ||
+	   (fovx <= 0.0f) || (fovy <= 0.0f))
+	{
+		LOGE("invalid w=%i, h=%i, cx=%f, cy=%f, fovx=%f, fovy=%f", w, h, cx, cy, fovx, fovy);
+		return NULL;
+	}
+
+	lzs_camera_t* self = (lzs_camera_t*) malloc(sizeof(lzs_camera_t));
+	if(self == NULL)
+	{
+		LOGE("malloc failed");
+		return NULL;
+	}
+
+	self->w    = w;
+	self->h    = h;
+	self->cx   = cx;
+	self->cy   = cy;
+	self->fovx = fovx*M_PI/180.0f;
+	self->fovy = fovy*M_PI/180.0f;
+
+	// one buffer holds the tables
+	int n = 2*(w + 1) + (h + 1);
+	self->col_sin = (float*) lzs_kernel_malloc(n*sizeof(float));
+	if(self->col_sin == NULL)
+	{
+		goto fail_tables;
+	}
+	self->col_cos = self->col_sin + (w + 1);
+	self->row_hyp = self->col_cos + (w + 1);
+
+	// the column table does not depend on the pose
+	int i;
+	for(i = 0; i <= w; ++i)
+	{
+		float a = self->fovx*(((float) i) - cx)/cx;
+		self->col_sin[i] = sinf(a);
+		self->col_cos[i] = cosf(a);
+	}
+
+	self->heading     = 0.0f;
+	self->sin_heading = 0.0f;
+	self->cos_heading = 1.0f;
+	self->slope       = 0.0f;
+	self->height      = 1.0f;
+	lzs_camera_rebuild(self);
+
+	// success
+	return self;
+
+	// failure
+	fail_tables:
+		free(self);
+	return NULL;
+}
+
+void lzs_camera_delete(lzs_camera_t** _self)
+{
+	assert(_self);
+
+	lzs_camera_t* self = *_self;
+	if(self)
+	{
+		LOGD("debug");
+		lzs_kernel_free(self->col_sin);
+		free(self);
+		*_self = NULL;
+	}
+}
+
+void lzs_camera_pose(lzs_camera_t* self, float heading, float slope, float height)
+{
+	assert(self);
+	LOGD("debug heading=%f, slope=%f, height=%f", heading, slope, height);
+
+	if(heading != self->heading)
+	{
+		float ph = heading*M_PI/180.0f;
+		self->heading     = heading;
+		self->sin_heading = sinf(ph);
+		self->cos_heading = cosf(ph);
+	}
+
+	self->slope  = slope;
+	self->height = height;
+	if((fabsf(slope  - self->table_slope)  > LZS_CAMERA_DSLOPE) ||
+	   (fabsf(height - self->table_height) > LZS_CAMERA_DHEIGHT))
+	{
+		self->dirty = 1;
+	}
+}
+
+void lzs_camera_ground(lzs_camera_t* self, int n, const float* x, const float* y,
+                       float* X, float* Y)
+{
+	assert(self);
+	assert(x);
+	assert(y);
+	assert(X);
+	assert(Y);
+	LOGD("debug n=%i", n);
+
+	if(self->dirty)
+	{
+		lzs_camera_rebuild(self);
+	}
+
+	// interpolate the tables and extrapolate the edges for
+	// pixels which are off screen
+	const float* col_sin = self->col_sin;
+	const float* col_cos = self->col_cos;
+	const float* row_hyp = self->row_hyp;
+	float        sh      = self->sin_heading;
+	float        ch      = self->cos_heading;
+	int          wmax    = self->w - 1;
+	int          hmax    = self->h - 1;
+	int i;
+	for(i = 0; i < n; ++i)
+	{
+		float fx = floorf(x[i]);
+		float fy = floorf(y[i]);
+		int   c  = (int) fx;
+		int   r  = (int) fy;
+		c  = (c < 0) ? 0 : ((c > wmax) ? wmax : c);
+		r  = (r < 0) ? 0 : ((r > hmax) ? hmax : r);
+		float u = x[i] - (float) c;
+		float v = y[i] - (float) r;
+
+		float sa  = col_sin[c] + u*(col_sin[c + 1] - col_sin[c]);
+		float ca  = col_cos[c] + u*(col_cos[c + 1] - col_cos[c]);
+		float hyp = row_hyp[r] + v*(row_hyp[r + 1] - row_hyp[r]);
+
+		// rotate by the heading
+		X[i] = hyp*(sh*ca + ch*sa);
+		Y[i] = hyp*(ch*ca - sh*sa);
+	}
+}
+
+void lzs_camera_screen(lzs_camera_t* self, int n, const float* X, const float* Y,
+                       float* x, float* y)
+{
+	assert(self);
+	assert(X);
+	assert(Y);
+	assert(x);
+	assert(y);
+	LOGD("debug n=%i", n);
+
+	// ground points are assumed to be below the horizon
+	float ph = self->heading*M_PI/180.0f;
+	float ps = self->slope*M_PI/180.0f;
+	int i;
+	for(i = 0; i < n; ++i)
+	{
+		float hyp = sqrtf(X[i]*X[i] + Y[i]*Y[i]);
+		float aph = lzs_camera_wrap(atan2f(X[i], Y[i]) - ph, 2.0f*M_PI);
+		float aps = lzs_camera_wrap(atanf(hyp/self->height) - ps, M_PI);
+		x[i] = self->cx + self->cx*aph/self->fovx;
+		y[i] = self->cy - self->cy*aps/self->fovy;
+	}
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef lzs_camera_H
+#define lzs_camera_H
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+// maps screen pixels to the ground plane and back
+//
+// the view angle is linear in pixels where fovx and fovy are
+// the angles (degrees) from the center to the left and top
+// edges and a pixel maps to the ground at
+// hyp = height*tan(slope - fovy*(y - cy)/cy)
+// X   = hyp*sin(heading + fovx*(x - cx)/cx)
+// Y   = hyp*cos(heading + fovx*(x - cx)/cx)
+//
+// the per-column sin/cos table is rotated by the heading and
+// the per-row table is rebuilt lazily when the slope or
+// height changes by more than the tolerance
+#define LZS_CAMERA_FOVX    27.7f
+#define LZS_CAMERA_FOVY    19.0f
+#define LZS_CAMERA_DSLOPE  0.05f   // degrees
+#define LZS_CAMERA_DHEIGHT 0.01f   // ft
+
+typedef struct
+{
+	// intrinsics
+	int   w;
+	int   h;
+	float cx;
+	float cy;
+	float fovx;   // radians
+	float fovy;   // radians
+
+	// pose
+	float heading;
+	float slope;
+	float height;
+	float sin_heading;
+	float cos_heading;
+
+	// row_hyp is valid for table_slope and table_height
+	int    dirty;
+	float  table_slope;
+	float  table_height;
+	float* col_sin;   // w + 1
+	float* col_cos;   // w + 1
+	float* row_hyp;   // h + 1
+} lzs_camera_t;
+
+lzs_camera_t* lzs_camera_new(int w, int h, float cx, float cy, float fovx, float fovy);
+void          lzs_camera_delete(lzs_camera_t** _self);
+void          lzs_camera_pose(lzs_camera_t* self, float heading, float slope, float height);
+void          lzs_camera_ground(lzs_camera_t* self, int n, const float* x, const float* y,
+                                float* X, float* Y);
+void          lzs_camera_screen(lzs_camera_t* self, int n, const float* X, const float* Y,
+                                float* x, float* y);
+
+#endif
@@ -0,0 +1,323 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_circle.h"
+#include "lzs_kernel.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#define LOG_TAG "LaserShark"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+// computes the gradients and returns the largest magnitude
+static unsigned int lzs_circle_gradient(lzs_circle_t* self,
+                                        const unsigned char* gray, int stride,
+                                        int w, int h)
+{
+	assert(self);
+	assert(gray);
+	LOGD("debug stride=%i, w=%i, h=%i", stride, w, h);
+
+	unsigned int max = 0;
+	int x;
+	int y;
+	for(y = 1; y < h - 1; ++y)
+	{
+		const unsigned char* a  = &gray[(y - 1)*stride];
+		const unsigned char* b  = &gray[y*stride];
+		const unsigned char* c  = &gray[(y + 1)*stride];
+		short*               sx = &self->sx[y*w];
+		short*               sy = &self->sy[y*w];
+		unsigned int*        m  = &self->mag[y*w];
+		for(x = 1; x < w - 1; ++x)
+		{
+			int gx = ((int) a[x + 1] + 2*((int) b[x + 1]) + (int) c[x + 1]) -
+			         ((int) a[x - 1] + 2*((int) b[x - 1]) + (int) c[x - 1]);
+			int gy = ((int) c[x - 1] + 2*((int) c[x]) + (int) c[x + 1]) -
+			         ((int) a[x - 1] + 2*((int) a[x]) + (int) a[x + 1]);
+			sx[x] = (short) gx;
+			sy[x] = (short) gy;
+			m[x]  = (unsigned int) (gx*gx + gy*gy);
+			if(m[x] > max)
+			{
+				max = m[x];
+			}
+		}
+	}
+	return max;
+}
+
+// returns the number of edge pixels that voted
+static int lzs_circle_vote(lzs_circle_t* self, int w, int h, unsigned int threshold)
+{
+	assert(self);
+	LOGD("debug w=%i, h=%i, threshold=%u", w, h, threshold);
+
+	unsigned int* acc   = self->acc;
+	int           nedge = 0;
+	int x;
+	int y;
+	int r;
+	for(y = 1; y < h - 1; ++y)
+	{
+		for(x = 1; x < w - 1; ++x)
+		{
+			int i = y*w + x;
+			if(self->mag[i] < threshold)
+			{
+				continue;
+			}
+			++nedge;
+
+			// unit gradient in 8.8 fixed point
+			float g  = 256.0f/sqrtf((float) self->mag[i]);
+			int   ux = (int) ((float) self->sx[i]*g);
+			int   uy = (int) ((float) self->sy[i]*g);
+			for(r = self->rmin; r <= self->rmax; r += LZS_CIRCLE_RSTEP)
+			{
+				int cx = x + ((r*ux + 128) >> 8);
+				int cy = y + ((r*uy + 128) >> 8);
+				if((cx < 0) || (cx >= w) || (cy < 0) || (cy >= h))
+				{
+					break;
+				}
+				++acc[cy*w + cx];
+			}
+		}
+	}
+	return nedge;
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+lzs_circle_t* lzs_circle_new(int maxw, int maxh, int rmin, int rmax)
+{
+	LOGD("debug maxw=%i, maxh=%i, rmin=%i, rmax=%i", maxw, maxh, rmin, rmax);
+
+	if((rmin < 1) || (rmax < rmin))
+	{
+		LOGE("invalid rmin=%i, rmax=%i", rmin, rmax);
+		return NULL;
+	}
+
+	lzs_circle_t* self = (lzs_circle_t*) malloc(sizeof(lzs_circle_t));
+	if(self == NULL)
+	{
+		LOGE("malloc failed");
+		return NULL;
+	}
+
+	self->maxw = maxw;
+	self->maxh = maxh;
+	self->rmin = rmin;
+	self->rmax = rmax;
+
+	int n = maxw*maxh;
+	self->gray = (unsigned char*) lzs_kernel_malloc(n);
+	if(self->gray == NULL)
+	{
+		goto fail_gray;
+	}
+
+	self->sx = (short*) lzs_kernel_malloc(n*sizeof(short));
+	if(self->sx == NULL)
+	{
+		goto fail_sx;
+	}
+
+	self->sy = (short*) lzs_kernel_malloc(n*sizeof(short));
+	if(self->sy == NULL)
+	{
+		goto fail_sy;
+	}
+
+	self->mag = (unsigned int*) lzs_kernel_malloc(n*sizeof(unsigned int));
+	if(self->mag == NULL)
+	{
+		goto fail_mag;
+	}
+
+	self->acc = (unsigned int*) lzs_kernel_malloc(n*sizeof(unsigned int));
+	if(self->acc == NULL)
+	{
+		goto fail_acc;
+	}
+
+	// success
+	return self;
+
+	// failure
+	fail_acc:
+		lzs_kernel_free(self->mag);
+	fail_mag:
+		lzs_kernel_free(self->sy);
+	fail_sy:
+		lzs_kernel_free(self->sx);
+	fail_sx:
+		lzs_kernel_free(self->gray);
+	fail_gray:
+		free(self);
+	return NULL;
+}
+
+void lzs_circle_delete(lzs_circle_t** _self)
+{
+	assert(_self);
+
+	lzs_circle_t* self = *_self;
+	if(self)
+	{
+		LOGD("debug");
+		lzs_kernel_free(self->acc);
+		lzs_kernel_free(self->mag);
+		lzs_kernel_free(self->sy);
+		lzs_kernel_free(self->sx);
+		lzs_kernel_free(self->gray);
+		free(self);
+		*_self = NULL;
+	}
+}
+
+int lzs_circle_detect(lzs_circle_t* self,
+                      const unsigned char* bgra, int stride,
+                      int w, int h, lzs_center_t* center)
+{
+	assert(self);
+	assert(bgra);
+	assert(center);
+	LOGD("debug stride=%i, w=%i, h=%i", stride, w, h);
+
+	if((w > self->maxw) || (h > self->maxh))
+	{
+		LOGE("invalid w=%i, h=%i", w, h);
+		return 0;
+	}
+
+	lzs_kernel_gray(bgra, stride, w, h, self->gray, w);
+	return lzs_circle_detectgray(self, self->gray, w, w, h, center);
+}
+
+int lzs_circle_detectgray(lzs_circle_t* self,
+                          const unsigned char* gray, int stride,
+                          int w, int h, lzs_center_t* center)
+{
+	assert(self);
+	assert(gray);
+	assert(center);
+	LOGD("debug stride=%i, w=%i, h=%i", stride, w, h);
+
+	center->x          = 0.0f;
+	center->y          = 0.0f;
+	center->votes      = 0;
+	center->confidence = 0.0f;
+
+	if((w > self->maxw) || (h > self->maxh) || (w < 3) || (h < 3))
+	{
+		LOGE("invalid w=%i, h=%i", w, h);
+		return 0;
+	}
+
+	// the border has no gradient
+	int n = w*h;
+	memset(self->mag, 0, n*sizeof(unsigned int));
+	memset(self->acc, 0, n*sizeof(unsigned int));
+	unsigned int max = lzs_circle_gradient(self, gray, stride, w, h);
+	if(max == 0)
+	{
+		return 0;
+	}
+
+	// edges are at least a quarter of the strongest edge
+	int nedge = lzs_circle_vote(self, w, h, max/16);
+	if(nedge == 0)
+	{
+		return 0;
+	}
+
+	// find the best 3x3 block from the horizontal sums which
+	// reuse the magnitude buffer
+	unsigned int* acc  = self->acc;
+	unsigned int* hsum = self->mag;
+	unsigned int  best = 0;
+	int           bx   = 0;
+	int           by   = 0;
+	int x;
+	int y;
+	for(y = 0; y < h; ++y)
+	{
+		const unsigned int* a = &acc[y*w];
+		unsigned int*       s = &hsum[y*w];
+		for(x = 1; x < w - 1; ++x)
+		{
+			s[x] = a[x - 1] + a[x] + a[x + 1];
+		}
+	}
+	for(y = 1; y < h - 1; ++y)
+	{
+		const unsigned int* a = &hsum[(y - 1)*w];
+		const unsigned int* b = &hsum[y*w];
+		const unsigned int* c = &hsum[(y + 1)*w];
+		for(x = 1; x < w - 1; ++x)
+		{
+			unsigned int sum = a[x] + b[x] + c[x];
+			if(sum > best)
+			{
+				best = sum;
+				bx   = x;
+				by   = y;
+			}
+		}
+	}
+	if(best == 0)
+	{
+		return 0;
+	}
+
+	// centroid of the block
+	float sumx = 0.0f;
+	float sumy = 0.0f;
+	int   i;
+	int   j;
+	for(j = -1; j <= 1; ++j)
+	{
+		for(i = -1; i <= 1; ++i)
+		{
+			float v = (float) acc[(by + j)*w + bx + i];
+			sumx += v*((float) (bx + i));
+			sumy += v*((float) (by + j));
+		}
+	}
+	center->x          = sumx/((float) best);
+	center->y          = sumy/((float) best);
+	center->votes      = best;
+	center->confidence = ((float) best)/((float) nedge);
+	return 1;
+}
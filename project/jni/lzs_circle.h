@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef lzs_circle_H
+#define lzs_circle_H
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+// circle center detector using gradient direction voting
+//
+// each strong edge pixel votes for the centers that lie
+// r pixels along its gradient for r in [rmin, rmax] where
+// the gradient points into the ball since the sphero is
+// brighter than the floor
+//
+// votes are stored in integer accumulators and the center
+// is the centroid of the best 3x3 block
+#define LZS_CIRCLE_RMIN   8
+#define LZS_CIRCLE_RMAX   40
+#define LZS_CIRCLE_RSTEP  2
+#define LZS_CIRCLE_WINDOW (4*LZS_CIRCLE_RMAX + 4)
+
+typedef struct
+{
+	// sub-pixel center in crop coordinates
+	float x;
+	float y;
+
+	// votes in the best 3x3 block and the fraction of edge
+	// pixels that voted for it
+	unsigned int votes;
+	float        confidence;
+} lzs_center_t;
+
+typedef struct
+{
+	int maxw;
+	int maxh;
+	int rmin;
+	int rmax;
+
+	unsigned char* gray;
+	short*         sx;
+	short*         sy;
+	unsigned int*  mag;
+	unsigned int*  acc;
+} lzs_circle_t;
+
+lzs_circle_t* lzs_circle_new(int maxw, int maxh, int rmin, int rmax);
+void          lzs_circle_delete(lzs_circle_t** _self);
+int           lzs_circle_detect(lzs_circle_t* self,
+                                const unsigned char* bgra, int stride,
+                                int w, int h, lzs_center_t* center);
+int           lzs_circle_detectgray(lzs_circle_t* self,
+                                    const unsigned char* gray, int stride,
+                                    int w, int h, lzs_center_t* center);
+
+#endif
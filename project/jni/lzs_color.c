@@ -0,0 +1,396 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_color.h"
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+
+#define LOG_TAG "LaserShark"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+static float lzs_color_clamp(float v)
+{
+	return (v < 0.0f) ? 0.0f : ((v > 255.0f) ? 255.0f : v);
+}
+
+// returns 1 if the color is within tolerance of the hue
+static unsigned char lzs_color_classify(float r, float g, float b,
+                                        float hue, float tolerance)
+{
+	float max = (r > g) ? r : g;
+	float min = (r < g) ? r : g;
+	max = (b > max) ? b : max;
+	min = (b < min) ? b : min;
+	if((max < 255.0f*LZS_COLOR_VAL) ||
+	   (max - min < LZS_COLOR_SAT*max))
+	{
+		return 0;
+	}
+
+	float d = max - min;
+	float h;
+	if(max == r)
+	{
+		h = 60.0f*(g - b)/d;
+	}
+	else if(max == g)
+	{
+		h = 60.0f*(b - r)/d + 120.0f;
+	}
+	else
+	{
+		h = 60.0f*(r - g)/d + 240.0f;
+	}
+
+	float dh = fabsf(fmodf(h - hue + 720.0f, 360.0f));
+	dh = (dh > 180.0f) ? 360.0f - dh : dh;
+	return dh <= tolerance;
+}
+
+// returns the number of pixels and fills in the blob
+static int lzs_color_blob(unsigned int m00, unsigned int m10,
+                          unsigned int m01, int scale, lzs_blob_t* blob)
+{
+	assert(blob);
+
+	blob->area = scale*scale*((int) m00);
+	if(m00 == 0)
+	{
+		blob->x = 0.0f;
+		blob->y = 0.0f;
+		return 0;
+	}
+
+	// the centroid is moved to the center of the block
+	float s = (float) scale;
+	blob->x = s*((float) m10)/((float) m00) + 0.5f*(s - 1.0f);
+	blob->y = s*((float) m01)/((float) m00) + 0.5f*(s - 1.0f);
+	return blob->area >= LZS_COLOR_AREA;
+}
+
+// class of a BGRA pixel
+static inline unsigned int lzs_color_rgb(const unsigned char* lut,
+                                         const unsigned char* p)
+{
+	int shift = 8 - LZS_COLOR_BITS;
+	return lut[((p[2] >> shift) << (2*LZS_COLOR_BITS)) |
+	           ((p[1] >> shift) << LZS_COLOR_BITS)     |
+	           (p[0] >> shift)];
+}
+
+// class of a 2x2 block of the NV21 planes which shares one
+// VU pair and is classified with the luma of its first pixel
+static inline unsigned int lzs_color_yuv(const unsigned char* lut,
+                                         const unsigned char* l,
+                                         const unsigned char* vu)
+{
+	int shift = 8 - LZS_COLOR_BITS;
+	return lut[((l[0]  >> shift) << (2*LZS_COLOR_BITS)) |
+	           ((vu[1] >> shift) << LZS_COLOR_BITS)     |
+	           (vu[0] >> shift)];
+}
+
+// the bounds are grown by the sample step so the moments
+// cover each pixel next to a sample in the class
+static int lzs_color_grow(int w, int h, int* x0, int* y0, int* x1, int* y1)
+{
+	assert(x0);
+	assert(y0);
+	assert(x1);
+	assert(y1);
+
+	if(*x1 < *x0)
+	{
+		return 0;
+	}
+
+	*x0 = (*x0 < LZS_COLOR_STEP) ? 0 : *x0 - LZS_COLOR_STEP;
+	*y0 = (*y0 < LZS_COLOR_STEP) ? 0 : *y0 - LZS_COLOR_STEP;
+	*x1 = (*x1 + LZS_COLOR_STEP + 1 > w) ? w : *x1 + LZS_COLOR_STEP + 1;
+	*y1 = (*y1 + LZS_COLOR_STEP + 1 > h) ? h : *y1 + LZS_COLOR_STEP + 1;
+	return 1;
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+lzs_color_t* lzs_color_new(float hue, float tolerance)
+{
+	LOGD("debug hue=%f, tolerance=%f", hue, tolerance);
+
+	lzs_color_t* self = (lzs_color_t*) malloc(sizeof(lzs_color_t));
+	if(self == NULL)
+	{
+		LOGE("malloc failed");
+		return NULL;
+	}
+
+	lzs_color_target(self, hue, tolerance);
+	return self;
+}
+
+void lzs_color_delete(lzs_color_t** _self)
+{
+	assert(_self);
+
+	lzs_color_t* self = *_self;
+	if(self)
+	{
+		LOGD("debug");
+		free(self);
+		*_self = NULL;
+	}
+}
+
+void lzs_color_target(lzs_color_t* self, float hue, float tolerance)
+{
+	assert(self);
+	LOGD("debug hue=%f, tolerance=%f", hue, tolerance);
+
+	self->hue       = hue;
+	self->tolerance = tolerance;
+
+	// each entry is classified at the center of its bin and
+	// the NV21 planes are full range BT.601
+	int step = 1 << (8 - LZS_COLOR_BITS);
+	int n    = 1 << LZS_COLOR_BITS;
+	int i;
+	int j;
+	int k;
+	for(i = 0; i < n; ++i)
+	{
+		for(j = 0; j < n; ++j)
+		{
+			for(k = 0; k < n; ++k)
+			{
+				int   idx = (i << (2*LZS_COLOR_BITS)) | (j << LZS_COLOR_BITS) | k;
+				float a   = (float) (i*step + step/2);
+				float b   = (float) (j*step + step/2);
+				float c   = (float) (k*step + step/2);
+				self->rgb[idx] = lzs_color_classify(a, b, c, hue, tolerance);
+
+				float u = b - 128.0f;
+				float v = c - 128.0f;
+				float r = lzs_color_clamp(a + 1.402f*v);
+				float g = lzs_color_clamp(a - 0.344136f*u - 0.714136f*v);
+				float z = lzs_color_clamp(a + 1.772f*u);
+				self->yuv[idx] = lzs_color_classify(r, g, z, hue, tolerance);
+			}
+		}
+	}
+}
+
+int lzs_color_detect(const lzs_color_t* self,
+                     const unsigned char* bgra, int stride,
+                     int w, int h, lzs_blob_t* blob)
+{
+	assert(self);
+	assert(bgra);
+	assert(blob);
+	LOGD("debug stride=%i, w=%i, h=%i", stride, w, h);
+
+	// bound the samples in the class
+	const unsigned char* lut = self->rgb;
+	int x0 = w;
+	int y0 = h;
+	int x1 = -1;
+	int y1 = -1;
+	int x;
+	int y;
+	for(y = 0; y < h; y += LZS_COLOR_STEP)
+	{
+		const unsigned char* p = &bgra[y*stride];
+		for(x = 0; x < w; x += LZS_COLOR_STEP)
+		{
+			if(lzs_color_rgb(lut, &p[4*x]))
+			{
+				x0 = (x < x0) ? x : x0;
+				x1 = (x > x1) ? x : x1;
+				y0 = (y < y0) ? y : y0;
+				y1 = y;
+			}
+		}
+	}
+	if(lzs_color_grow(w, h, &x0, &y0, &x1, &y1) == 0)
+	{
+		return lzs_color_blob(0, 0, 0, 1, blob);
+	}
+
+	// the moments of a 1280x720 frame fit in 32 bits
+	unsigned int m00 = 0;
+	unsigned int m10 = 0;
+	unsigned int m01 = 0;
+	for(y = y0; y < y1; ++y)
+	{
+		const unsigned char* p  = &bgra[y*stride + 4*x0];
+		unsigned int         n  = 0;
+		unsigned int         sx = 0;
+		for(x = x0; x < x1; ++x)
+		{
+			unsigned int c = lzs_color_rgb(lut, p);
+			n  += c;
+			sx += c*x;
+			p  += 4;
+		}
+		m00 += n;
+		m10 += sx;
+		m01 += n*y;
+	}
+
+	return lzs_color_blob(m00, m10, m01, 1, blob);
+}
+
+int lzs_color_detectnv21(const lzs_color_t* self,
+                         const unsigned char* luma,
+                         const unsigned char* chroma, int stride,
+                         int w, int h, lzs_blob_t* blob)
+{
+	assert(self);
+	assert(luma);
+	assert(chroma);
+	assert(blob);
+	LOGD("debug stride=%i, w=%i, h=%i", stride, w, h);
+
+	// the blocks are sampled in the same way as the pixels
+	// of a BGRA crop
+	const unsigned char* lut = self->yuv;
+	int bw = w/2;
+	int bh = h/2;
+	int x0 = bw;
+	int y0 = bh;
+	int x1 = -1;
+	int y1 = -1;
+	int x;
+	int y;
+	for(y = 0; y < bh; y += LZS_COLOR_STEP)
+	{
+		const unsigned char* l  = &luma[2*y*stride];
+		const unsigned char* vu = &chroma[y*stride];
+		for(x = 0; x < bw; x += LZS_COLOR_STEP)
+		{
+			if(lzs_color_yuv(lut, &l[2*x], &vu[2*x]))
+			{
+				x0 = (x < x0) ? x : x0;
+				x1 = (x > x1) ? x : x1;
+				y0 = (y < y0) ? y : y0;
+				y1 = y;
+			}
+		}
+	}
+	if(lzs_color_grow(bw, bh, &x0, &y0, &x1, &y1) == 0)
+	{
+		return lzs_color_blob(0, 0, 0, 2, blob);
+	}
+
+	unsigned int m00 = 0;
+	unsigned int m10 = 0;
+	unsigned int m01 = 0;
+	for(y = y0; y < y1; ++y)
+	{
+		const unsigned char* l  = &luma[2*y*stride + 2*x0];
+		const unsigned char* vu = &chroma[y*stride + 2*x0];
+		unsigned int         n  = 0;
+		unsigned int         sx = 0;
+		for(x = x0; x < x1; ++x)
+		{
+			unsigned int c = lzs_color_yuv(lut, l, vu);
+			n  += c;
+			sx += c*x;
+			l  += 2;
+			vu += 2;
+		}
+		m00 += n;
+		m10 += sx;
+		m01 += n*y;
+	}
+
+	return lzs_color_blob(m00, m10, m01, 2, blob);
+}
+
+void lzs_color_mask(const lzs_color_t* self,
+                    const unsigned char* bgra, int stride,
+                    int w, int h, int level,
+                    unsigned char* mask, int mstride)
+{
+	assert(self);
+	assert(bgra);
+	assert(mask);
+	LOGD("debug stride=%i, w=%i, h=%i, level=%i", stride, w, h, level);
+
+	// the pixel at the center of each block is classified
+	const unsigned char* lut = self->rgb;
+	int c  = (1 << level)/2;
+	int mw = w >> level;
+	int mh = h >> level;
+	int x;
+	int y;
+	for(y = 0; y < mh; ++y)
+	{
+		const unsigned char* p = &bgra[((y << level) + c)*stride + 4*c];
+		unsigned char*       m = &mask[y*mstride];
+		for(x = 0; x < mw; ++x)
+		{
+			m[x] = (unsigned char) lzs_color_rgb(lut, &p[4*(x << level)]);
+		}
+	}
+}
+
+void lzs_color_masknv21(const lzs_color_t* self,
+                        const unsigned char* luma,
+                        const unsigned char* chroma, int stride,
+                        int w, int h, int level,
+                        unsigned char* mask, int mstride)
+{
+	assert(self);
+	assert(luma);
+	assert(chroma);
+	assert(mask);
+	LOGD("debug stride=%i, w=%i, h=%i, level=%i", stride, w, h, level);
+
+	// the 2x2 block of the NV21 planes at the center of each
+	// block is classified
+	const unsigned char* lut = self->yuv;
+	int c  = ((1 << level)/2)/2;
+	int mw = w >> level;
+	int mh = h >> level;
+	int x;
+	int y;
+	for(y = 0; y < mh; ++y)
+	{
+		int                  by = (y << level)/2 + c;
+		const unsigned char* l  = &luma[2*by*stride + 2*c];
+		const unsigned char* vu = &chroma[by*stride + 2*c];
+		unsigned char*       m  = &mask[y*mstride];
+		for(x = 0; x < mw; ++x)
+		{
+			int i = 2*((x << level)/2);
+			m[x] = (unsigned char) lzs_color_yuv(lut, &l[i], &vu[i]);
+		}
+	}
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef lzs_color_H
+#define lzs_color_H
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+// LED color detector
+//
+// each pixel is classified through a table indexed by the
+// top LZS_COLOR_BITS of each channel and the blob is the
+// centroid of the pixels in the class which is accumulated
+// with integer moments in one pass over the bounds of a
+// sparse pass
+//
+// the tables are built from a target hue and tolerance in
+// degrees where the pixel must also be saturated and bright
+// to reject the floor and the specular highlights
+#define LZS_COLOR_BITS  5
+#define LZS_COLOR_SIZE  (1 << (3*LZS_COLOR_BITS))
+#define LZS_COLOR_SAT   0.35f
+#define LZS_COLOR_VAL   0.25f
+
+// the sphero LED is blue (see LaserShark.java)
+#define LZS_COLOR_HUE       240.0f
+#define LZS_COLOR_TOLERANCE 30.0f
+
+// blobs with fewer crop pixels are rejected
+#define LZS_COLOR_AREA 32
+
+// the moments are only accumulated near the samples in the
+// class on every LZS_COLOR_STEP row and column
+#define LZS_COLOR_STEP 4
+
+typedef struct
+{
+	// centroid in crop coordinates and area in crop pixels
+	float x;
+	float y;
+	int   area;
+} lzs_blob_t;
+
+typedef struct
+{
+	float hue;
+	float tolerance;
+
+	// tables indexed by (r, g, b) for BGRA pixels and by
+	// (y, u, v) for the NV21 planes
+	unsigned char rgb[LZS_COLOR_SIZE];
+	unsigned char yuv[LZS_COLOR_SIZE];
+} lzs_color_t;
+
+lzs_color_t* lzs_color_new(float hue, float tolerance);
+void         lzs_color_delete(lzs_color_t** _self);
+void         lzs_color_target(lzs_color_t* self, float hue, float tolerance);
+int          lzs_color_detect(const lzs_color_t* self,
+                              const unsigned char* bgra, int stride,
+                              int w, int h, lzs_blob_t* blob);
+int          lzs_color_detectnv21(const lzs_color_t* self,
+                                  const unsigned char* luma,
+                                  const unsigned char* chroma, int stride,
+                                  int w, int h, lzs_blob_t* blob);
+
+// lzs_color_mask classifies the pixel at the center of each
+// 2^level block of the crop (or the 2x2 block of the NV21
+// planes that holds it) into a (w >> level) x (h >> level)
+// mask of 0 or 1
+void         lzs_color_mask(const lzs_color_t* self,
+                            const unsigned char* bgra, int stride,
+                            int w, int h, int level,
+                            unsigned char* mask, int mstride);
+void         lzs_color_masknv21(const lzs_color_t* self,
+                                const unsigned char* luma,
+                                const unsigned char* chroma, int stride,
+                                int w, int h, int level,
+                                unsigned char* mask, int mstride);
+
+#endif
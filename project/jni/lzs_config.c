@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_config.h"
+#include "lzs_pyramid.h"
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#define LOG_TAG "LaserShark"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+static int lzs_config_valid(const lzs_config_t* config)
+{
+	assert(config);
+	LOGD("debug");
+
+	if((config->radius_ball < LZS_CONFIG_RADIUS_MIN) ||
+	   (config->radius_ball > LZS_CONFIG_RADIUS_MAX))
+	{
+		LOGE("invalid radius_ball=%f", config->radius_ball);
+		return 0;
+	}
+
+	if((config->speed_min < 0.0f) ||
+	   (config->speed_max > 1.0f) ||
+	   (config->speed_min > config->speed_max))
+	{
+		LOGE("invalid speed_min=%f, speed_max=%f",
+		     config->speed_min, config->speed_max);
+		return 0;
+	}
+
+	if((config->screen_w < LZS_CONFIG_SCREEN_MIN) ||
+	   (config->screen_w > LZS_CONFIG_SCREEN_MAX) ||
+	   (config->screen_h < LZS_CONFIG_SCREEN_MIN) ||
+	   (config->screen_h > LZS_CONFIG_SCREEN_MAX))
+	{
+		LOGE("invalid screen_w=%f, screen_h=%f",
+		     config->screen_w, config->screen_h);
+		return 0;
+	}
+
+	// the search window is centered on screen pixels
+	float size = (float) (2*config->search_radius + 2);
+	if((config->search_radius < (int) config->radius_ball) ||
+	   (config->search_radius > LZS_CONFIG_SEARCH_MAX) ||
+	   (size > config->screen_w) || (size > config->screen_h) ||
+	   (config->search_levels < 0) ||
+	   (config->search_levels > LZS_PYRAMID_LEVELS))
+	{
+		LOGE("invalid search_radius=%i, search_levels=%i",
+		     config->search_radius, config->search_levels);
+		return 0;
+	}
+
+	if((config->background != 0) && (config->background != 1))
+	{
+		LOGE("invalid background=%i", config->background);
+		return 0;
+	}
+
+	return 1;
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+void lzs_config_defaults(lzs_config_t* self)
+{
+	assert(self);
+	LOGD("debug");
+
+	self->radius_ball   = LZS_CONFIG_RADIUS_BALL;
+	self->speed_min     = LZS_CONFIG_SPEED_MIN;
+	self->speed_max     = LZS_CONFIG_SPEED_MAX;
+	self->screen_w      = LZS_CONFIG_SCREEN_W;
+	self->screen_h      = LZS_CONFIG_SCREEN_H;
+	self->search_radius = LZS_CONFIG_SEARCH_RADIUS;
+	self->search_levels = LZS_CONFIG_SEARCH_LEVELS;
+	self->background    = LZS_CONFIG_BACKGROUND;
+}
+
+int lzs_config_load(lzs_config_t* self, const char* fname)
+{
+	assert(self);
+	assert(fname);
+	LOGD("debug fname=%s", fname);
+
+	FILE* f = fopen(fname, "r");
+	if(f == NULL)
+	{
+		LOGI("fopen %s failed", fname);
+		return 0;
+	}
+
+	// the values are validated together so a bad file does
+	// not leave a partial config
+	lzs_config_t config = *self;
+	char         line[256];
+	int          n = 0;
+	while(fgets(line, sizeof(line), f))
+	{
+		++n;
+
+		char* comment = strchr(line, '#');
+		if(comment)
+		{
+			*comment = '\0';
+		}
+
+		char  name[64];
+		float value;
+		int   count = sscanf(line, "%63s %f", name, &value);
+		if(count <= 0)
+		{
+			continue;
+		}
+		else if(count != 2)
+		{
+			LOGE("%s:%i: invalid line", fname, n);
+			goto fail_parse;
+		}
+
+		if(strcmp(name, "radius_ball") == 0)
+		{
+			config.radius_ball = value;
+		}
+		else if(strcmp(name, "speed_min") == 0)
+		{
+			config.speed_min = value;
+		}
+		else if(strcmp(name, "speed_max") == 0)
+		{
+			config.speed_max = value;
+		}
+		else if(strcmp(name, "screen_w") == 0)
+		{
+			config.screen_w = value;
+		}
+		else if(strcmp(name, "screen_h") == 0)
+		{
+			config.screen_h = value;
+		}
+		else if(strcmp(name, "search_radius") == 0)
+		{
+			config.search_radius = (int) value;
+		}
+		else if(strcmp(name, "search_levels") == 0)
+		{
+			config.search_levels = (int) value;
+		}
+		else if(strcmp(name, "background") == 0)
+		{
+			config.background = (int) value;
+		}
+		else
+		{
+			LOGE("%s:%i: unknown name=%s", fname, n, name);
+			goto fail_parse;
+		}
+	}
+
+	if(lzs_config_valid(&config) == 0)
+	{
+		goto fail_parse;
+	}
+
+	fclose(f);
+	*self = config;
+	LOGI("radius_ball=%f, speed_min=%f, speed_max=%f, screen_w=%f, screen_h=%f, search_radius=%i, search_levels=%i, background=%i",
+	     self->radius_ball, self->speed_min, self->speed_max,
+	     self->screen_w, self->screen_h,
+	     self->search_radius, self->search_levels,
+	     self->background);
+
+	// success
+	return 1;
+
+	// failure
+	fail_parse:
+		fclose(f);
+	return 0;
+}
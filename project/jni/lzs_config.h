@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef lzs_config_H
+#define lzs_config_H
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+// tracker parameters which are loaded at startup from a
+// text file of "name value" lines where # starts a comment
+//
+// radius_ball is the radius of the ball in screen pixels,
+// speed_min and speed_max bound the steering speed,
+// screen_w, screen_h are the size of the virtual screen and
+// search_radius, search_levels are the largest search
+// window and its pyramid levels (see lzs_tracker_window)
+// and background enables the floor background model
+//
+// the pipeline and tracker keep a copy of the config which
+// is not changed once they are created
+#define LZS_CONFIG_RADIUS_BALL   64.0f
+#define LZS_CONFIG_SPEED_MIN     0.4f
+#define LZS_CONFIG_SPEED_MAX     0.7f
+#define LZS_CONFIG_SCREEN_W      800.0f
+#define LZS_CONFIG_SCREEN_H      480.0f
+#define LZS_CONFIG_SEARCH_RADIUS 224
+#define LZS_CONFIG_SEARCH_LEVELS 3
+#define LZS_CONFIG_BACKGROUND    0
+
+// the ball must leave room for the search window within
+// LZS_CONFIG_SEARCH_MAX and the screen must hold the
+// search window
+#define LZS_CONFIG_RADIUS_MIN 8.0f
+#define LZS_CONFIG_RADIUS_MAX 118.0f
+#define LZS_CONFIG_SCREEN_MIN 474.0f
+#define LZS_CONFIG_SCREEN_MAX 2048.0f
+#define LZS_CONFIG_SEARCH_MAX 236
+
+typedef struct
+{
+	float radius_ball;
+	float speed_min;
+	float speed_max;
+	float screen_w;
+	float screen_h;
+	int   search_radius;
+	int   search_levels;
+	int   background;
+} lzs_config_t;
+
+void lzs_config_defaults(lzs_config_t* self);
+
+// returns 0 and keeps the current config when the file is
+// missing, has an unknown name or any value is invalid
+int lzs_config_load(lzs_config_t* self, const char* fname);
+
+#endif
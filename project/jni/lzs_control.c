@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_control.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <assert.h>
+#include "a3d/a3d_time.h"
+
+#define LOG_TAG "LaserShark"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+static void lzs_control_publish(lzs_control_t* self, const lzs_command_t* command)
+{
+	assert(self);
+	assert(command);
+	LOGD("debug id=%u", command->id);
+
+	__sync_fetch_and_add(&self->seq, 1);
+	self->command = *command;
+	__sync_synchronize();
+	__sync_fetch_and_add(&self->seq, 1);
+}
+
+static void* lzs_control_thread(void* arg)
+{
+	assert(arg);
+	LOGD("debug");
+
+	lzs_control_t* self   = (lzs_control_t*) arg;
+	double         period = A3D_USEC/((double) self->hz);
+	double         next   = a3d_utime();
+	while(self->running)
+	{
+		unsigned int t0 = lzs_timing_now();
+		lzs_control_step(self, a3d_utime());
+		lzs_timing_mark(&self->pipeline->timing, LZS_TIMING_CONTROL, t0);
+
+		// sleep until the next tick or skip the ticks which
+		// were missed
+		next += period;
+		double t = a3d_utime();
+		if(next > t)
+		{
+			usleep((useconds_t) (next - t));
+		}
+		else
+		{
+			next = t;
+		}
+	}
+
+	return NULL;
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+lzs_control_t* lzs_control_new(lzs_pipeline_t* pipeline, int hz)
+{
+	assert(pipeline);
+	LOGD("debug hz=%i", hz);
+
+	if(hz <= 0)
+	{
+		LOGE("invalid hz=%i", hz);
+		return NULL;
+	}
+
+	lzs_control_t* self = (lzs_control_t*) malloc(sizeof(lzs_control_t));
+	if(self == NULL)
+	{
+		LOGE("malloc failed");
+		return NULL;
+	}
+	memset(self, 0, sizeof(lzs_control_t));
+
+	self->pipeline = pipeline;
+	self->hz       = hz;
+	self->running  = 1;
+	if(pthread_create(&self->thread, NULL, lzs_control_thread, (void*) self) != 0)
+	{
+		LOGE("pthread_create failed");
+		goto fail_thread;
+	}
+
+	// success
+	return self;
+
+	// failure
+	fail_thread:
+		free(self);
+	return NULL;
+}
+
+void lzs_control_delete(lzs_control_t** _self)
+{
+	assert(_self);
+
+	lzs_control_t* self = *_self;
+	if(self)
+	{
+		LOGD("debug");
+
+		self->running = 0;
+		__sync_synchronize();
+		pthread_join(self->thread, NULL);
+		free(self);
+		*_self = NULL;
+	}
+}
+
+int lzs_control_compute(const lzs_config_t* config,
+                        const lzs_result_t* result, const lzs_command_t* last,
+                        float horizon, double t, lzs_command_t* command)
+{
+	assert(config);
+	assert(result);
+	assert(last);
+	assert(command);
+	LOGD("debug horizon=%f", horizon);
+
+	// predict where the ball will be when the command
+	// arrives since it follows the current command with a
+	// first order lag as in the ground motion model
+	float w  = (last->heading + result->sphero_heading_offset)*M_PI/180.0f;
+	float uX = LZS_MOTION_FTPS*last->speed*sinf(w);
+	float uY = LZS_MOTION_FTPS*last->speed*cosf(w);
+	float k  = LZS_MOTION_TAU*(1.0f - expf(-horizon/LZS_MOTION_TAU));
+	float X  = result->sphero_X + uX*horizon + (result->sphero_vX - uX)*k;
+	float Y  = result->sphero_Y + uY*horizon + (result->sphero_vY - uY)*k;
+
+	float dx = result->phone_X - X;
+	float dy = result->phone_Y - Y;
+	float heading;
+	float speed;
+	lzs_tracker_command(config, dx, dy, result->sphero_heading,
+	                    result->sphero_heading_offset,
+	                    &heading, &speed);
+	heading = lzs_tracker_fixangle(heading);
+
+	// slow down when arriving to avoid overshooting the
+	// target and stop while the ball is lost
+	float d = sqrtf(dx*dx + dy*dy);
+	if(result->lost || (d < LZS_CONTROL_STOP))
+	{
+		speed = 0.0f;
+	}
+	else if(d < LZS_CONTROL_ARRIVE)
+	{
+		speed *= d/LZS_CONTROL_ARRIVE;
+	}
+
+	// the heading does not matter while stopped
+	float dh = fabsf(lzs_tracker_fixangle(heading - last->heading + 180.0f) - 180.0f);
+	if((last->id > 0) &&
+	   (((speed == 0.0f) && (last->speed == 0.0f)) ||
+	    ((dh < LZS_CONTROL_DHEADING) &&
+	     (fabsf(speed - last->speed) < LZS_CONTROL_DSPEED))))
+	{
+		return 0;
+	}
+
+	command->id        = last->id + 1;
+	command->heading   = heading;
+	command->speed     = speed;
+	command->t_capture = result->t_capture;
+	command->t_publish = t;
+	command->horizon   = horizon;
+	return 1;
+}
+
+void lzs_control_step(lzs_control_t* self, double t)
+{
+	assert(self);
+	LOGD("debug t=%lf", t);
+
+	lzs_result_t result;
+	lzs_pipeline_result(self->pipeline, &result);
+
+	// the command arrives after the tracker output has aged
+	// by the time it takes to be taken and sent
+	float horizon = (float) ((t - result.t_capture)/A3D_USEC) +
+	                self->take_delay + LZS_CONTROL_LINK;
+	if(horizon < 0.0f)
+	{
+		horizon = 0.0f;
+	}
+	else if(horizon > LZS_CONTROL_HORIZON)
+	{
+		horizon = LZS_CONTROL_HORIZON;
+	}
+
+	// only the control thread writes the mailbox and the
+	// config of the tracker is not changed after it is
+	// created
+	lzs_command_t command;
+	if(lzs_control_compute(&self->pipeline->tracker->config, &result,
+	                       &self->command, horizon, t, &command))
+	{
+		lzs_control_publish(self, &command);
+	}
+}
+
+int lzs_control_take(lzs_control_t* self, lzs_command_t* command)
+{
+	assert(self);
+	assert(command);
+	LOGD("debug");
+
+	lzs_command_t c;
+	unsigned int  seq0;
+	unsigned int  seq1;
+	do
+	{
+		seq0 = self->seq;
+		__sync_synchronize();
+		c = self->command;
+		__sync_synchronize();
+		seq1 = self->seq;
+	} while((seq0 != seq1) || (seq0 & 1));
+
+	if(c.id == self->taken)
+	{
+		return 0;
+	}
+	self->taken = c.id;
+
+	// the delay until a command is taken depends on how
+	// often Java polls the mailbox
+	float delay = (float) ((a3d_utime() - c.t_publish)/A3D_USEC);
+	self->take_delay += 0.1f*(delay - self->take_delay);
+
+	*command = c;
+	return 1;
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef lzs_control_H
+#define lzs_control_H
+
+#include <pthread.h>
+#include "lzs_pipeline.h"
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+// the control thread runs at a fixed rate and steers toward
+// where the ball will be when the roll command reaches it
+//
+// the prediction horizon is the age of the tracker output
+// plus the measured delay until Java takes the command plus
+// LZS_CONTROL_LINK for the Bluetooth link to the ball
+#define LZS_CONTROL_HZ      50
+#define LZS_CONTROL_LINK    0.06f   // s
+#define LZS_CONTROL_HORIZON 0.5f    // s
+#define LZS_CONTROL_ARRIVE  1.0f    // ft
+#define LZS_CONTROL_STOP    0.25f   // ft
+
+// a new command is only published when the heading or speed
+// changes by these amounts so the link is not flooded with
+// duplicate commands
+#define LZS_CONTROL_DHEADING 2.0f
+#define LZS_CONTROL_DSPEED   0.02f
+
+typedef struct
+{
+	// incremented for each command
+	unsigned int id;
+
+	// RollCommand heading (degrees) and speed
+	float heading;
+	float speed;
+
+	// capture time of the tracker output and the time the
+	// command was published in usec
+	double t_capture;
+	double t_publish;
+
+	// prediction horizon in seconds
+	float horizon;
+} lzs_command_t;
+
+typedef struct
+{
+	lzs_pipeline_t* pipeline;
+	int             hz;
+
+	// control thread
+	pthread_t    thread;
+	volatile int running;
+
+	// mailbox is protected by a sequence lock where seq is
+	// odd while the control thread is writing
+	volatile unsigned int seq;
+	lzs_command_t         command;
+
+	// written by the thread which takes the commands
+	unsigned int   taken;
+	volatile float take_delay;
+} lzs_control_t;
+
+lzs_control_t* lzs_control_new(lzs_pipeline_t* pipeline, int hz);
+void           lzs_control_delete(lzs_control_t** _self);
+void           lzs_control_step(lzs_control_t* self, double t);
+int            lzs_control_compute(const lzs_config_t* config,
+                                   const lzs_result_t* result, const lzs_command_t* last,
+                                   float horizon, double t, lzs_command_t* command);
+int            lzs_control_take(lzs_control_t* self, lzs_command_t* command);
+
+#endif
@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_fusion.h"
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#define LOG_TAG "LaserShark"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+static void lzs_fusion_normalize(float* q)
+{
+	assert(q);
+
+	float n = sqrtf(q[0]*q[0] + q[1]*q[1] + q[2]*q[2] + q[3]*q[3]);
+	if(n > 0.0f)
+	{
+		q[0] /= n;
+		q[1] /= n;
+		q[2] /= n;
+		q[3] /= n;
+	}
+}
+
+static void lzs_fusion_matrix(const float* q, float* R)
+{
+	assert(q);
+	assert(R);
+
+	float w = q[0];
+	float x = q[1];
+	float y = q[2];
+	float z = q[3];
+	R[0] = 1.0f - 2.0f*(y*y + z*z);
+	R[1] = 2.0f*(x*y - w*z);
+	R[2] = 2.0f*(x*z + w*y);
+	R[3] = 2.0f*(x*y + w*z);
+	R[4] = 1.0f - 2.0f*(x*x + z*z);
+	R[5] = 2.0f*(y*z - w*x);
+	R[6] = 2.0f*(x*z - w*y);
+	R[7] = 2.0f*(y*z + w*x);
+	R[8] = 1.0f - 2.0f*(x*x + y*y);
+}
+
+static void lzs_fusion_quaternion(const float* R, float* q)
+{
+	assert(R);
+	assert(q);
+
+	// use the largest diagonal term for precision
+	float tr = R[0] + R[4] + R[8];
+	float s;
+	if(tr > 0.0f)
+	{
+		s    = 2.0f*sqrtf(tr + 1.0f);
+		q[0] = 0.25f*s;
+		q[1] = (R[7] - R[5])/s;
+		q[2] = (R[2] - R[6])/s;
+		q[3] = (R[3] - R[1])/s;
+	}
+	else if((R[0] > R[4]) && (R[0] > R[8]))
+	{
+		s    = 2.0f*sqrtf(1.0f + R[0] - R[4] - R[8]);
+		q[0] = (R[7] - R[5])/s;
+		q[1] = 0.25f*s;
+		q[2] = (R[1] + R[3])/s;
+		q[3] = (R[2] + R[6])/s;
+	}
+	else if(R[4] > R[8])
+	{
+		s    = 2.0f*sqrtf(1.0f + R[4] - R[0] - R[8]);
+		q[0] = (R[2] - R[6])/s;
+		q[1] = (R[1] + R[3])/s;
+		q[2] = 0.25f*s;
+		q[3] = (R[5] + R[7])/s;
+	}
+	else
+	{
+		s    = 2.0f*sqrtf(1.0f + R[8] - R[0] - R[4]);
+		q[0] = (R[3] - R[1])/s;
+		q[1] = (R[2] + R[6])/s;
+		q[2] = (R[5] + R[7])/s;
+		q[3] = 0.25f*s;
+	}
+	lzs_fusion_normalize(q);
+}
+
+static void lzs_fusion_publish(lzs_fusion_t* self)
+{
+	assert(self);
+
+	float R[9];
+	lzs_fusion_matrix(self->q, R);
+
+	lzs_orientation_t* o = &self->orientation;
+	__sync_fetch_and_add(&self->seq, 1);
+	__sync_synchronize();
+	o->valid = 1;
+	o->q[0]  = self->q[0];
+	o->q[1]  = self->q[1];
+	o->q[2]  = self->q[2];
+	o->q[3]  = self->q[3];
+	lzs_fusion_angles(R, &o->heading, &o->pitch, &o->roll);
+	__sync_synchronize();
+	__sync_fetch_and_add(&self->seq, 1);
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+void lzs_fusion_reset(lzs_fusion_t* self)
+{
+	assert(self);
+	LOGD("debug");
+
+	memset(self, 0, sizeof(lzs_fusion_t));
+	self->q[0] = 1.0f;
+}
+
+void lzs_fusion_gyro(lzs_fusion_t* self, float gx, float gy, float gz, float dt)
+{
+	assert(self);
+	LOGD("debug gx=%f, gy=%f, gz=%f, dt=%f", gx, gy, gz, dt);
+
+	// the absolute orientation initializes the filter
+	float R[9];
+	float qam[4];
+	int   am = self->has_a && self->has_m &&
+	           lzs_fusion_rotation(self->a, self->m, R);
+	if(am)
+	{
+		lzs_fusion_quaternion(R, qam);
+	}
+
+	float* q = self->q;
+	if((self->init == 0) || (dt <= 0.0f) || (dt > LZS_FUSION_DTMAX))
+	{
+		if(am == 0)
+		{
+			return;
+		}
+		memcpy(q, qam, sizeof(qam));
+		self->init = 1;
+		lzs_fusion_publish(self);
+		return;
+	}
+
+	// integrate the body rate q' = q*(0, w)/2 exactly for a
+	// constant rate over dt
+	float wn = sqrtf(gx*gx + gy*gy + gz*gz);
+	if(wn > 0.0f)
+	{
+		float h  = 0.5f*wn*dt;
+		float s  = sinf(h)/wn;
+		float pw = cosf(h);
+		float px = gx*s;
+		float py = gy*s;
+		float pz = gz*s;
+		float w  = q[0];
+		float x  = q[1];
+		float y  = q[2];
+		float z  = q[3];
+		q[0] = w*pw - x*px - y*py - z*pz;
+		q[1] = w*px + x*pw + y*pz - z*py;
+		q[2] = w*py - x*pz + y*pw + z*px;
+		q[3] = w*pz + x*py - y*px + z*pw;
+	}
+
+	// blend toward the absolute orientation along the short
+	// path which is close to a slerp for small steps
+	if(am)
+	{
+		float k   = dt/(LZS_FUSION_TAU + dt);
+		float dot = q[0]*qam[0] + q[1]*qam[1] + q[2]*qam[2] + q[3]*qam[3];
+		float sgn = (dot < 0.0f) ? -1.0f : 1.0f;
+		int i;
+		for(i = 0; i < 4; ++i)
+		{
+			q[i] = (1.0f - k)*q[i] + k*sgn*qam[i];
+		}
+	}
+	lzs_fusion_normalize(q);
+	lzs_fusion_publish(self);
+}
+
+void lzs_fusion_accel(lzs_fusion_t* self, float ax, float ay, float az)
+{
+	assert(self);
+	LOGD("debug ax=%f, ay=%f, az=%f", ax, ay, az);
+
+	self->a[0]  = ax;
+	self->a[1]  = ay;
+	self->a[2]  = az;
+	self->has_a = 1;
+}
+
+void lzs_fusion_mag(lzs_fusion_t* self, float mx, float my, float mz)
+{
+	assert(self);
+	LOGD("debug mx=%f, my=%f, mz=%f", mx, my, mz);
+
+	self->m[0]  = mx;
+	self->m[1]  = my;
+	self->m[2]  = mz;
+	self->has_m = 1;
+}
+
+void lzs_fusion_orientation(lzs_fusion_t* self, lzs_orientation_t* orientation)
+{
+	assert(self);
+	assert(orientation);
+	LOGD("debug");
+
+	unsigned int seq0;
+	unsigned int seq1;
+	do
+	{
+		seq0 = self->seq;
+		__sync_synchronize();
+		*orientation = self->orientation;
+		__sync_synchronize();
+		seq1 = self->seq;
+	} while((seq0 != seq1) || (seq0 & 1));
+}
+
+int lzs_fusion_rotation(const float* a, const float* m, float* R)
+{
+	assert(a);
+	assert(m);
+	assert(R);
+
+	// H points East and M points North
+	float hx = m[1]*a[2] - m[2]*a[1];
+	float hy = m[2]*a[0] - m[0]*a[2];
+	float hz = m[0]*a[1] - m[1]*a[0];
+	float nh = sqrtf(hx*hx + hy*hy + hz*hz);
+	float na = sqrtf(a[0]*a[0] + a[1]*a[1] + a[2]*a[2]);
+	if((nh < 0.1f) || (na == 0.0f))
+	{
+		// free fall or close to the magnetic pole
+		return 0;
+	}
+	hx /= nh;
+	hy /= nh;
+	hz /= nh;
+
+	float ax = a[0]/na;
+	float ay = a[1]/na;
+	float az = a[2]/na;
+	R[0] = hx;
+	R[1] = hy;
+	R[2] = hz;
+	R[3] = ay*hz - az*hy;
+	R[4] = az*hx - ax*hz;
+	R[5] = ax*hy - ay*hx;
+	R[6] = ax;
+	R[7] = ay;
+	R[8] = az;
+	return 1;
+}
+
+void lzs_fusion_angles(const float* R, float* heading, float* pitch, float* roll)
+{
+	assert(R);
+	assert(heading);
+	assert(pitch);
+	assert(roll);
+
+	float s = -R[7];
+	s = (s > 1.0f) ? 1.0f : s;
+	s = (s < -1.0f) ? -1.0f : s;
+	*heading = atan2f(R[1], R[4])*180.0f/M_PI;
+	*pitch   = asinf(s)*180.0f/M_PI;
+	*roll    = atan2f(-R[6], R[8])*180.0f/M_PI;
+}
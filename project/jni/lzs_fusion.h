@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef lzs_fusion_H
+#define lzs_fusion_H
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+// complementary filter for the phone orientation
+//
+// the gyro is integrated at full rate and the quaternion is
+// pulled toward the accelerometer/magnetometer orientation
+// with a time constant of LZS_FUSION_TAU so that the fast
+// motion comes from the gyro while the drift is removed by
+// the much noisier absolute sensors
+//
+// the quaternion rotates device to world coordinates which
+// are East, North, Up as in SensorManager.getRotationMatrix
+#define LZS_FUSION_TAU   1.0f   // s
+#define LZS_FUSION_DTMAX 0.5f   // s
+
+// angles in degrees as in SensorManager.getOrientation
+typedef struct
+{
+	int   valid;
+	float q[4];   // w, x, y, z
+	float heading;
+	float pitch;
+	float roll;
+} lzs_orientation_t;
+
+// one thread feeds the samples and readers take a
+// copy with lzs_fusion_orientation
+typedef struct
+{
+	// latest absolute samples
+	float a[3];
+	float m[3];
+	int   has_a;
+	int   has_m;
+
+	// filter state
+	int   init;
+	float q[4];
+
+	// orientation is protected by a sequence lock where seq
+	// is odd while the orientation is being written
+	volatile unsigned int seq;
+	lzs_orientation_t     orientation;
+} lzs_fusion_t;
+
+void lzs_fusion_reset(lzs_fusion_t* self);
+void lzs_fusion_gyro(lzs_fusion_t* self, float gx, float gy, float gz, float dt);
+void lzs_fusion_accel(lzs_fusion_t* self, float ax, float ay, float az);
+void lzs_fusion_mag(lzs_fusion_t* self, float mx, float my, float mz);
+void lzs_fusion_orientation(lzs_fusion_t* self, lzs_orientation_t* orientation);
+
+// same as SensorManager.getRotationMatrix and getOrientation
+// where R is row-major
+int  lzs_fusion_rotation(const float* a, const float* m, float* R);
+void lzs_fusion_angles(const float* R, float* heading, float* pitch, float* roll);
+
+#endif
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_gate.h"
+#include <assert.h>
+
+#define LOG_TAG "LaserShark"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+void lzs_gate_reset(lzs_gate_t* self)
+{
+	assert(self);
+	LOGD("debug");
+
+	// the counters are kept
+	self->valid = 0;
+	self->hold  = 0;
+	self->skips = 0;
+}
+
+int lzs_gate_skip(lzs_gate_t* self, const unsigned char* pixels, int stride,
+                  int x0, int y0, int w, int h, float gyro)
+{
+	assert(self);
+	assert(pixels);
+	LOGD("debug x0=%i, y0=%i, w=%i, h=%i, gyro=%f", x0, y0, w, h, gyro);
+
+	++self->frames;
+	if((w > LZS_CROP_MAX) || (h > LZS_CROP_MAX))
+	{
+		lzs_gate_reset(self);
+		return 0;
+	}
+
+	// grid samples inside the crop
+	int gx0 = (x0 + LZS_GATE_STEP - 1)/LZS_GATE_STEP;
+	int gy0 = (y0 + LZS_GATE_STEP - 1)/LZS_GATE_STEP;
+	int gw  = (x0 + w - 1)/LZS_GATE_STEP - gx0 + 1;
+	int gh  = (y0 + h - 1)/LZS_GATE_STEP - gy0 + 1;
+
+	// overlap with the reference in grid coordinates
+	int ox0 = (gx0 > self->gx0) ? gx0 : self->gx0;
+	int oy0 = (gy0 > self->gy0) ? gy0 : self->gy0;
+	int ox1 = (gx0 + gw < self->gx0 + self->gw) ? gx0 + gw : self->gx0 + self->gw;
+	int oy1 = (gy0 + gh < self->gy0 + self->gh) ? gy0 + gh : self->gy0 + self->gh;
+	int ow  = (ox1 > ox0) ? ox1 - ox0 : 0;
+	int oh  = (oy1 > oy0) ? oy1 - oy0 : 0;
+
+	int moved = (self->valid == 0) || (gyro > LZS_GATE_GYRO) || (stride != self->stride) ||
+	            ((float) (ow*oh) < LZS_GATE_OVERLAP*((float) (gw*gh)));
+
+	// the samples are taken either way so that the reference
+	// is current when the crop is processed
+	const unsigned char* ref     = self->samples[self->ref];
+	unsigned char*       cur     = self->samples[self->ref ^ 1];
+	int                  changed = 0;
+	int                  i;
+	int                  j;
+	for(j = 0; j < gh; ++j)
+	{
+		int                  gy  = gy0 + j;
+		const unsigned char* row = &pixels[(LZS_GATE_STEP*gy - y0)*stride +
+		                                   LZS_GATE_STEP*gx0 - x0];
+		unsigned char*       c   = &cur[j*gw];
+		for(i = 0; i < gw; ++i)
+		{
+			c[i] = row[LZS_GATE_STEP*i];
+		}
+
+		if(moved || (gy < oy0) || (gy >= oy1))
+		{
+			continue;
+		}
+
+		const unsigned char* r = &ref[(gy - self->gy0)*self->gw + ox0 - self->gx0];
+		c = &cur[j*gw + ox0 - gx0];
+		for(i = 0; i < ow; ++i)
+		{
+			int d = c[i] - r[i];
+			changed += (d > LZS_GATE_PIXEL) || (d < -LZS_GATE_PIXEL);
+		}
+	}
+
+	if(changed > LZS_GATE_CHANGED)
+	{
+		moved = 1;
+	}
+
+	// keep processing for a few crops after motion so that a
+	// ball which is coming to rest is measured where it stops
+	if(moved)
+	{
+		self->hold = LZS_GATE_HOLD;
+	}
+	else if(self->hold > 0)
+	{
+		--self->hold;
+		moved = 1;
+	}
+
+	if((moved == 0) && (self->skips < LZS_GATE_REFRESH))
+	{
+		++self->skips;
+		++self->skipped;
+		return 1;
+	}
+
+	self->valid  = 1;
+	self->gx0    = gx0;
+	self->gy0    = gy0;
+	self->gw     = gw;
+	self->gh     = gh;
+	self->stride = stride;
+	self->skips  = 0;
+	self->ref   ^= 1;
+	return 0;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef lzs_gate_H
+#define lzs_gate_H
+
+#include "lzs_tracker.h"
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+// change detector which lets the tracker reuse its result
+// while the ball and the phone are still
+//
+// the plane is sampled on a grid of LZS_GATE_STEP pixels and
+// the samples in the crop are compared with the crop that was
+// last processed so that slow changes add up until they are
+// noticed and a window which moved by a few pixels is still
+// compared where it overlaps
+//
+// the crop is processed when more than LZS_GATE_CHANGED
+// samples changed by over LZS_GATE_PIXEL which is about the
+// rim of a ball that moved by a pixel or two, less than
+// LZS_GATE_OVERLAP of the window overlaps the reference, the
+// phone rotated faster than LZS_GATE_GYRO or LZS_GATE_REFRESH
+// crops were skipped in a row which keeps the motion model
+// and the lost track detection alive
+#define LZS_GATE_STEP     4
+#define LZS_GATE_PIXEL    16
+#define LZS_GATE_CHANGED  8
+#define LZS_GATE_OVERLAP  0.75f
+#define LZS_GATE_GYRO     0.05f   // rad/s
+#define LZS_GATE_HOLD     2
+#define LZS_GATE_REFRESH  15
+#define LZS_GATE_SAMPLES  (LZS_CROP_MAX/LZS_GATE_STEP + 1)
+
+typedef struct
+{
+	// grid samples of the reference crop in the plane
+	int valid;
+	int gx0;
+	int gy0;
+	int gw;
+	int gh;
+	int stride;
+
+	// crops processed after motion and crops skipped since
+	// the reference
+	int hold;
+	int skips;
+
+	// crops seen and skipped which are only written by the
+	// worker
+	volatile unsigned int frames;
+	volatile unsigned int skipped;
+
+	// samples of the reference crop and the current crop
+	int           ref;
+	unsigned char samples[2][LZS_GATE_SAMPLES*LZS_GATE_SAMPLES];
+} lzs_gate_t;
+
+void lzs_gate_reset(lzs_gate_t* self);
+int  lzs_gate_skip(lzs_gate_t* self, const unsigned char* pixels, int stride,
+                   int x0, int y0, int w, int h, float gyro);
+
+#endif
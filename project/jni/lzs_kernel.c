@@ -0,0 +1,809 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_kernel.h"
+#include "lzs_kernel_row.h"
+#include <stdlib.h>
+#include <assert.h>
+#ifdef ANDROID
+	#include <malloc.h>
+	#if defined(LZS_KERNEL_HAVE_NEON) && !defined(__aarch64__)
+		#include <cpu-features.h>
+	#endif
+#endif
+
+#define LOG_TAG "LaserShark"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+typedef struct
+{
+	const char*               name;
+	lzs_kernel_grayrow_fn     grayrow;
+	lzs_kernel_sobelrow_fn    sobelrow;
+	const lzs_kernel_fixed_t* fixed;
+} lzs_kernel_backend_t;
+
+static const lzs_kernel_backend_t LZS_KERNEL_BACKENDS[LZS_KERNEL_COUNT] =
+{
+	{ "scalar", lzs_kernel_grayrow_c, lzs_kernel_sobelrow_c, NULL },
+	#if defined(__x86_64__) || defined(__i386__)
+		{ "sse2", lzs_kernel_grayrow_sse2, lzs_kernel_sobelrow_sse2, lzs_kernel_fixed_sse2 },
+		{ "avx2", lzs_kernel_grayrow_avx2, lzs_kernel_sobelrow_avx2, lzs_kernel_fixed_avx2 },
+	#else
+		{ "sse2", NULL, NULL, NULL },
+		{ "avx2", NULL, NULL, NULL },
+	#endif
+	#if defined(__aarch64__) || defined(LZS_KERNEL_HAVE_NEON)
+		{ "neon", lzs_kernel_grayrow_neon, lzs_kernel_sobelrow_neon, lzs_kernel_fixed_neon },
+	#else
+		{ "neon", NULL, NULL, NULL },
+	#endif
+};
+
+static int lzs_kernel_current = LZS_KERNEL_SCALAR;
+static int lzs_kernel_fixed   = 1;
+
+// returns the fixed width rows of the current backend for
+// a crop of width w or NULL for the generic rows
+static const lzs_kernel_fixed_t* lzs_kernel_findfixed(int w)
+{
+	const lzs_kernel_fixed_t* fixed = LZS_KERNEL_BACKENDS[lzs_kernel_current].fixed;
+	if((lzs_kernel_fixed == 0) || (fixed == NULL))
+	{
+		return NULL;
+	}
+
+	// the table ends at the first unused entry
+	int i;
+	for(i = 0; (i < LZS_KERNEL_WIDTHS) && (fixed[i].w > 0); ++i)
+	{
+		if(fixed[i].w == w)
+		{
+			return &fixed[i];
+		}
+	}
+	return NULL;
+}
+
+// selects the rows for a crop of width w where grayrow is
+// called for [0, w) and sobelrow for [1, w - 1)
+static lzs_kernel_grayrow_fn lzs_kernel_grayrowfn(int w)
+{
+	const lzs_kernel_fixed_t* fixed = lzs_kernel_findfixed(w);
+	if(fixed)
+	{
+		return fixed->grayrow;
+	}
+	return LZS_KERNEL_BACKENDS[lzs_kernel_current].grayrow;
+}
+
+static lzs_kernel_sobelrow_fn lzs_kernel_sobelrowfn(int w)
+{
+	const lzs_kernel_fixed_t* fixed = lzs_kernel_findfixed(w);
+	if(fixed)
+	{
+		return fixed->sobelrow;
+	}
+	return LZS_KERNEL_BACKENDS[lzs_kernel_current].sobelrow;
+}
+
+// returns 1 if a ranks before b where the candidates are
+// ranked by magnitude and then by row-major position so
+// that ties keep the first peak
+static inline int lzs_kernel_before(const lzs_peak_t* a, const lzs_peak_t* b)
+{
+	if(a->mag != b->mag)
+	{
+		return a->mag > b->mag;
+	}
+	return (a->y < b->y) || ((a->y == b->y) && (a->x < b->x));
+}
+
+// restores the heap below i where the root of peaks[0, n)
+// is the candidate which ranks last
+static void lzs_kernel_siftdown(lzs_peak_t* peaks, int i, int n)
+{
+	while(1)
+	{
+		int l = 2*i + 1;
+		int r = l + 1;
+		int j = i;
+		if((l < n) && lzs_kernel_before(&peaks[j], &peaks[l]))
+		{
+			j = l;
+		}
+		if((r < n) && lzs_kernel_before(&peaks[j], &peaks[r]))
+		{
+			j = r;
+		}
+		if(j == i)
+		{
+			return;
+		}
+
+		lzs_peak_t t = peaks[i];
+		peaks[i] = peaks[j];
+		peaks[j] = t;
+		i = j;
+	}
+}
+
+// adds the candidate to the heap of at most max candidates
+static void lzs_kernel_push(lzs_peak_t* peaks, int* _count, int max,
+                            int x, int y, unsigned int mag)
+{
+	lzs_peak_t p     = { .x = x, .y = y, .mag = mag };
+	int        count = *_count;
+	if(count < max)
+	{
+		// sift up while the parent ranks before the candidate
+		int i = count;
+		while(i > 0)
+		{
+			int parent = (i - 1)/2;
+			if(lzs_kernel_before(&p, &peaks[parent]))
+			{
+				break;
+			}
+			peaks[i] = peaks[parent];
+			i        = parent;
+		}
+		peaks[i] = p;
+		*_count  = count + 1;
+	}
+	else if(lzs_kernel_before(&p, &peaks[0]))
+	{
+		peaks[0] = p;
+		lzs_kernel_siftdown(peaks, 0, count);
+	}
+}
+
+// pushes the 3x3 local maxima of the magnitudes b of row y
+// where a and c are the rows above and below and the pixels
+// before in row-major order must be smaller so a plateau
+// keeps its first pixel
+//
+// the row is skipped when its maximum bmax (found by the
+// backend and no more than the threshold at the time) cannot
+// enter the heap
+static void lzs_kernel_nmsrow(const unsigned int* a, const unsigned int* b,
+                              const unsigned int* c, unsigned int bmax,
+                              int x0, int x1, int y,
+                              lzs_peak_t* peaks, int* count, int max)
+{
+	// the scan is row-major so a candidate that does not
+	// beat the last of a full heap is rejected early
+	unsigned int th = (*count == max) ? peaks[0].mag : 0;
+	if(bmax <= th)
+	{
+		return;
+	}
+
+	int x;
+	for(x = x0; x < x1; ++x)
+	{
+		unsigned int m = b[x];
+		if(m <= th)
+		{
+			continue;
+		}
+
+		if((m > b[x - 1]) && (m >= b[x + 1]) &&
+		   (m > a[x - 1]) && (m > a[x]) && (m > a[x + 1]) &&
+		   (m >= c[x - 1]) && (m >= c[x]) && (m >= c[x + 1]))
+		{
+			lzs_kernel_push(peaks, count, max, x, y, m);
+			th = (*count == max) ? peaks[0].mag : 0;
+		}
+	}
+}
+
+// sorts the heap from first to last
+static void lzs_kernel_rank(lzs_peak_t* peaks, int count)
+{
+	int n;
+	for(n = count - 1; n > 0; --n)
+	{
+		lzs_peak_t t = peaks[0];
+		peaks[0] = peaks[n];
+		peaks[n] = t;
+		lzs_kernel_siftdown(peaks, 0, n);
+	}
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+int lzs_kernel_select(int backend)
+{
+	LOGD("debug backend=%i", backend);
+
+	if(backend == LZS_KERNEL_BEST)
+	{
+		int i;
+		for(i = LZS_KERNEL_COUNT - 1; i > LZS_KERNEL_SCALAR; --i)
+		{
+			if(lzs_kernel_supported(i))
+			{
+				break;
+			}
+		}
+		backend = i;
+	}
+	else if(lzs_kernel_supported(backend) == 0)
+	{
+		LOGE("unsupported backend=%i", backend);
+		return 0;
+	}
+
+	LOGD("kernel backend=%s", lzs_kernel_name(backend));
+	lzs_kernel_current = backend;
+	return 1;
+}
+
+int lzs_kernel_backend(void)
+{
+	LOGD("debug");
+	return lzs_kernel_current;
+}
+
+int lzs_kernel_supported(int backend)
+{
+	LOGD("debug backend=%i", backend);
+
+	if((backend < 0) || (backend >= LZS_KERNEL_COUNT) ||
+	   (LZS_KERNEL_BACKENDS[backend].grayrow == NULL))
+	{
+		return 0;
+	}
+
+	#if defined(__x86_64__) || defined(__i386__)
+		if(backend == LZS_KERNEL_SSE2)
+		{
+			#if defined(__x86_64__)
+				return 1;
+			#else
+				return __builtin_cpu_supports("sse2");
+			#endif
+		}
+		else if(backend == LZS_KERNEL_AVX2)
+		{
+			return __builtin_cpu_supports("avx2");
+		}
+	#endif
+
+	#if defined(LZS_KERNEL_HAVE_NEON) && !defined(__aarch64__) && defined(ANDROID)
+		if(backend == LZS_KERNEL_NEON)
+		{
+			return (android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM) &&
+			       (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON);
+		}
+	#endif
+
+	return 1;
+}
+
+const char* lzs_kernel_name(int backend)
+{
+	LOGD("debug backend=%i", backend);
+
+	if((backend < 0) || (backend >= LZS_KERNEL_COUNT))
+	{
+		return "invalid";
+	}
+	return LZS_KERNEL_BACKENDS[backend].name;
+}
+
+void lzs_kernel_specialize(int enable)
+{
+	LOGD("debug enable=%i", enable);
+
+	lzs_kernel_fixed = enable;
+}
+
+int lzs_kernel_specialized(int w)
+{
+	LOGD("debug w=%i", w);
+
+	return lzs_kernel_findfixed(w) ? 1 : 0;
+}
+
+int lzs_kernel_fixedwidth(int w, int wmax)
+{
+	LOGD("debug w=%i, wmax=%i", w, wmax);
+
+	const lzs_kernel_fixed_t* fixed = LZS_KERNEL_BACKENDS[lzs_kernel_current].fixed;
+	if((lzs_kernel_fixed == 0) || (fixed == NULL) || (w <= 0))
+	{
+		return w;
+	}
+
+	// the crop may grow by an eighth to reach a fixed width
+	int best = w;
+	int i;
+	for(i = 0; (i < LZS_KERNEL_WIDTHS) && (fixed[i].w > 0); ++i)
+	{
+		int fw = fixed[i].w;
+		if((fw >= w) && (fw <= wmax) && (fw <= w + w/8) &&
+		   ((best == w) || (fw < best)))
+		{
+			best = fw;
+		}
+	}
+	return best;
+}
+
+void* lzs_kernel_malloc(int size)
+{
+	LOGD("debug size=%i", size);
+
+	void* ptr = NULL;
+	#ifdef ANDROID
+		ptr = memalign(LZS_KERNEL_ALIGN, size);
+	#else
+		if(posix_memalign(&ptr, LZS_KERNEL_ALIGN, size) != 0)
+		{
+			ptr = NULL;
+		}
+	#endif
+
+	if(ptr == NULL)
+	{
+		LOGE("memalign failed");
+	}
+	return ptr;
+}
+
+void lzs_kernel_free(void* ptr)
+{
+	LOGD("debug");
+	free(ptr);
+}
+
+void lzs_kernel_grayrow_c(const unsigned char* bgra, int x0, int x1,
+                          unsigned char* gray)
+{
+	lzs_kernel_grayrow_inline(bgra, x0, x1, gray);
+}
+
+void lzs_kernel_sobelrow_c(const unsigned char* a, const unsigned char* b,
+                           const unsigned char* c, int x0, int x1, int y,
+                           unsigned int* mags, lzs_peak_t* peak)
+{
+	lzs_kernel_sobelrow_inline(a, b, c, x0, x1, y, mags, peak);
+}
+
+void lzs_kernel_peak(const unsigned char* bgra, int stride,
+                     int w, int h, unsigned char* scratch,
+                     lzs_peak_t* peak)
+{
+	assert(bgra);
+	assert(scratch);
+	assert(peak);
+	LOGD("debug stride=%i, w=%i, h=%i", stride, w, h);
+
+	lzs_kernel_grayrow_fn  grayrow  = lzs_kernel_grayrowfn(w);
+	lzs_kernel_sobelrow_fn sobelrow = lzs_kernel_sobelrowfn(w);
+
+	peak->x   = 0;
+	peak->y   = 0;
+	peak->mag = 0;
+
+	// rolling buffer of three gray rows followed by the
+	// row of magnitudes
+	int            pitch   = LZS_KERNEL_PITCH(w);
+	unsigned int*  mags    = (unsigned int*) (scratch + 3*pitch);
+	unsigned char* rows[3] =
+	{
+		scratch,
+		scratch + pitch,
+		scratch + 2*pitch,
+	};
+
+	int y;
+	for(y = 0; y < h; ++y)
+	{
+		grayrow(&bgra[y*stride], 0, w, rows[y%3]);
+		if(y >= 2)
+		{
+			sobelrow(rows[(y - 2)%3], rows[(y - 1)%3], rows[y%3],
+			         1, w - 1, y - 1, mags, peak);
+		}
+	}
+}
+
+void lzs_kernel_peakgray(const unsigned char* gray, int stride,
+                         int w, int h, unsigned char* scratch,
+                         lzs_peak_t* peak)
+{
+	assert(gray);
+	assert(scratch);
+	assert(peak);
+	LOGD("debug stride=%i, w=%i, h=%i", stride, w, h);
+
+	lzs_kernel_sobelrow_fn sobelrow = lzs_kernel_sobelrowfn(w);
+
+	peak->x   = 0;
+	peak->y   = 0;
+	peak->mag = 0;
+
+	// the rows are read in place
+	int           pitch = LZS_KERNEL_PITCH(w);
+	unsigned int* mags  = (unsigned int*) (scratch + 3*pitch);
+
+	int y;
+	for(y = 1; y < h - 1; ++y)
+	{
+		sobelrow(&gray[(y - 1)*stride], &gray[y*stride],
+		         &gray[(y + 1)*stride], 1, w - 1, y,
+		         mags, peak);
+	}
+}
+
+void lzs_kernel_magsgray(const unsigned char* gray, int stride,
+                         int w, int h, unsigned int* mags, int mstride)
+{
+	assert(gray);
+	assert(mags);
+	LOGD("debug stride=%i, w=%i, h=%i, mstride=%i", stride, w, h, mstride);
+
+	lzs_kernel_sobelrow_fn sobelrow = lzs_kernel_sobelrowfn(w);
+
+	// the peak is never updated so the backends do not
+	// search the rows for it
+	lzs_peak_t peak = { .x = 0, .y = 0, .mag = 0xFFFFFFFF };
+
+	int x;
+	int y;
+	for(y = 0; y < h; ++y)
+	{
+		unsigned int* m = &mags[y*mstride];
+		if((y == 0) || (y == h - 1) || (w < 3))
+		{
+			for(x = 0; x < w; ++x)
+			{
+				m[x] = 0;
+			}
+			continue;
+		}
+
+		sobelrow(&gray[(y - 1)*stride], &gray[y*stride],
+		         &gray[(y + 1)*stride], 1, w - 1, y,
+		         m, &peak);
+		m[0]     = 0;
+		m[w - 1] = 0;
+	}
+}
+
+void lzs_kernel_peakgrayrow(const unsigned char* gray, int stride,
+                            int x0, int x1, int y,
+                            unsigned char* scratch, lzs_peak_t* peak)
+{
+	assert(gray);
+	assert(scratch);
+	assert(peak);
+	LOGD("debug stride=%i, x0=%i, x1=%i, y=%i", stride, x0, x1, y);
+
+	const lzs_kernel_backend_t* backend = &LZS_KERNEL_BACKENDS[lzs_kernel_current];
+
+	// mags is indexed by x
+	unsigned int* mags = (unsigned int*) (scratch + 3*LZS_KERNEL_PITCH(x1));
+	backend->sobelrow(gray - stride, gray, gray + stride,
+	                  x0, x1, y, mags, peak);
+}
+
+int lzs_kernel_peaks(const unsigned char* bgra, int stride,
+                     int w, int h, unsigned char* scratch,
+                     lzs_peak_t* peaks, int max)
+{
+	assert(bgra);
+	assert(scratch);
+	assert(peaks);
+	LOGD("debug stride=%i, w=%i, h=%i, max=%i", stride, w, h, max);
+
+	lzs_kernel_grayrow_fn  grayrow  = lzs_kernel_grayrowfn(w);
+	lzs_kernel_sobelrow_fn sobelrow = lzs_kernel_sobelrowfn(w);
+
+	if((max <= 0) || (w < 3) || (h < 3))
+	{
+		return 0;
+	}
+
+	// rolling buffers of three gray rows and three rows of
+	// magnitudes followed by a row of zeros for the border
+	int            pitch   = LZS_KERNEL_PITCH(w);
+	unsigned int*  zero    = (unsigned int*) (scratch + 15*pitch);
+	unsigned char* rows[3] =
+	{
+		scratch,
+		scratch + pitch,
+		scratch + 2*pitch,
+	};
+	unsigned int* mags[3] =
+	{
+		(unsigned int*) (scratch + 3*pitch),
+		(unsigned int*) (scratch + 7*pitch),
+		(unsigned int*) (scratch + 11*pitch),
+	};
+	int x;
+	for(x = 0; x < w; ++x)
+	{
+		zero[x] = 0;
+	}
+
+	// the magnitudes of row y - 1 complete the neighborhood
+	// of row y - 2 and the backend also finds the maximum of
+	// each row where it beats the heap so that the rows that
+	// cannot enter the heap are neither scanned for the
+	// position of the maximum nor suppressed
+	unsigned int  maxs[3] = { 0, 0, 0 };
+	int           count   = 0;
+	unsigned int* prev    = zero;
+	int y;
+	for(y = 0; y < h; ++y)
+	{
+		grayrow(&bgra[y*stride], 0, w, rows[y%3]);
+		if(y >= 2)
+		{
+			lzs_peak_t    rowpeak = { .x = 0, .y = 0, .mag = 0 };
+			unsigned int* m       = mags[(y - 1)%3];
+			rowpeak.mag = (count == max) ? peaks[0].mag : 0;
+			sobelrow(rows[(y - 2)%3], rows[(y - 1)%3], rows[y%3],
+			         1, w - 1, y - 1, m, &rowpeak);
+			m[0]            = 0;
+			m[w - 1]        = 0;
+			maxs[(y - 1)%3] = rowpeak.mag;
+			if(y >= 3)
+			{
+				lzs_kernel_nmsrow(prev, mags[(y - 2)%3], m, maxs[(y - 2)%3],
+				                  1, w - 1, y - 2, peaks, &count, max);
+				prev = mags[(y - 2)%3];
+			}
+		}
+	}
+	lzs_kernel_nmsrow(prev, mags[(h - 2)%3], zero, maxs[(h - 2)%3],
+	                  1, w - 1, h - 2, peaks, &count, max);
+
+	lzs_kernel_rank(peaks, count);
+	return count;
+}
+
+int lzs_kernel_peaksgray(const unsigned char* gray, int stride,
+                         int w, int h, unsigned char* scratch,
+                         lzs_peak_t* peaks, int max)
+{
+	assert(gray);
+	assert(scratch);
+	assert(peaks);
+	LOGD("debug stride=%i, w=%i, h=%i, max=%i", stride, w, h, max);
+
+	lzs_kernel_sobelrow_fn sobelrow = lzs_kernel_sobelrowfn(w);
+
+	if((max <= 0) || (w < 3) || (h < 3))
+	{
+		return 0;
+	}
+
+	// the rows are read in place and the magnitudes are the
+	// same as lzs_kernel_peaks
+	int           pitch   = LZS_KERNEL_PITCH(w);
+	unsigned int* zero    = (unsigned int*) (scratch + 15*pitch);
+	unsigned int* mags[3] =
+	{
+		(unsigned int*) (scratch + 3*pitch),
+		(unsigned int*) (scratch + 7*pitch),
+		(unsigned int*) (scratch + 11*pitch),
+	};
+	int x;
+	for(x = 0; x < w; ++x)
+	{
+		zero[x] = 0;
+	}
+
+	unsigned int  maxs[3] = { 0, 0, 0 };
+	int           count   = 0;
+	unsigned int* prev    = zero;
+	int y;
+	for(y = 1; y < h - 1; ++y)
+	{
+		lzs_peak_t    rowpeak = { .x = 0, .y = 0, .mag = 0 };
+		unsigned int* m       = mags[y%3];
+		rowpeak.mag = (count == max) ? peaks[0].mag : 0;
+		sobelrow(&gray[(y - 1)*stride], &gray[y*stride],
+		         &gray[(y + 1)*stride], 1, w - 1, y,
+		         m, &rowpeak);
+		m[0]      = 0;
+		m[w - 1]  = 0;
+		maxs[y%3] = rowpeak.mag;
+		if(y >= 2)
+		{
+			lzs_kernel_nmsrow(prev, mags[(y - 1)%3], m, maxs[(y - 1)%3],
+			                  1, w - 1, y - 1, peaks, &count, max);
+			prev = mags[(y - 1)%3];
+		}
+	}
+	lzs_kernel_nmsrow(prev, mags[(h - 2)%3], zero, maxs[(h - 2)%3],
+	                  1, w - 1, h - 2, peaks, &count, max);
+
+	lzs_kernel_rank(peaks, count);
+	return count;
+}
+
+void lzs_kernel_gray(const unsigned char* bgra, int stride,
+                     int w, int h, unsigned char* gray, int gstride)
+{
+	assert(bgra);
+	assert(gray);
+	LOGD("debug stride=%i, w=%i, h=%i", stride, w, h);
+
+	lzs_kernel_grayrow_fn grayrow = lzs_kernel_grayrowfn(w);
+
+	int y;
+	for(y = 0; y < h; ++y)
+	{
+		grayrow(&bgra[y*stride], 0, w, &gray[y*gstride]);
+	}
+}
+
+void lzs_kernel_downsample(const unsigned char* bgra, int stride,
+                           int w, int h, int level,
+                           unsigned char* gray, int gstride)
+{
+	assert(bgra);
+	assert(gray);
+	assert(level >= 1);
+	LOGD("debug stride=%i, w=%i, h=%i, level=%i", stride, w, h, level);
+
+	// sample the 2x2 box at the center of each block so that
+	// only two of every 2^level rows are read
+	int n    = 1 << level;
+	int half = n >> 1;
+	int gw   = w >> level;
+	int gh   = h >> level;
+	int x;
+	int y;
+	for(y = 0; y < gh; ++y)
+	{
+		const unsigned char* row0 = &bgra[(y*n + half - 1)*stride + 4*(half - 1)];
+		const unsigned char* row1 = row0 + stride;
+		unsigned char*       dst  = &gray[y*gstride];
+		for(x = 0; x < gw; ++x)
+		{
+			const unsigned char* p0 = &row0[4*n*x];
+			const unsigned char* p1 = &row1[4*n*x];
+			unsigned int b = p0[0] + p0[4] + p1[0] + p1[4];
+			unsigned int g = p0[1] + p0[5] + p1[1] + p1[5];
+			unsigned int r = p0[2] + p0[6] + p1[2] + p1[6];
+			dst[x] = (unsigned char) ((77*r + 150*g + 29*b + 512) >> 10);
+		}
+	}
+}
+
+void lzs_kernel_downsamplegray(const unsigned char* src, int stride,
+                               int w, int h, int level,
+                               unsigned char* gray, int gstride)
+{
+	assert(src);
+	assert(gray);
+	assert(level >= 1);
+	LOGD("debug stride=%i, w=%i, h=%i, level=%i", stride, w, h, level);
+
+	// same sampling as lzs_kernel_downsample
+	int n    = 1 << level;
+	int half = n >> 1;
+	int gw   = w >> level;
+	int gh   = h >> level;
+	int x;
+	int y;
+	for(y = 0; y < gh; ++y)
+	{
+		const unsigned char* row0 = &src[(y*n + half - 1)*stride + half - 1];
+		const unsigned char* row1 = row0 + stride;
+		unsigned char*       dst  = &gray[y*gstride];
+		for(x = 0; x < gw; ++x)
+		{
+			const unsigned char* p0 = &row0[n*x];
+			const unsigned char* p1 = &row1[n*x];
+			dst[x] = (unsigned char) ((p0[0] + p0[1] + p1[0] + p1[1] + 2) >> 2);
+		}
+	}
+}
+
+int lzs_kernel_peakref(const unsigned char* bgra, int stride,
+                       int w, int h, lzs_peak_t* peak)
+{
+	assert(bgra);
+	assert(peak);
+	LOGD("debug stride=%i, w=%i, h=%i", stride, w, h);
+
+	peak->x   = 0;
+	peak->y   = 0;
+	peak->mag = 0;
+
+	unsigned char* gray = (unsigned char*) malloc(w*h*sizeof(unsigned char));
+	short*         sx   = (short*) calloc(w*h, sizeof(short));
+	short*         sy   = (short*) calloc(w*h, sizeof(short));
+	if((gray == NULL) || (sx == NULL) || (sy == NULL))
+	{
+		LOGE("malloc failed");
+		free(gray);
+		free(sx);
+		free(sy);
+		return 0;
+	}
+
+	// gray
+	int x;
+	int y;
+	for(y = 0; y < h; ++y)
+	{
+		for(x = 0; x < w; ++x)
+		{
+			const unsigned char* p = &bgra[y*stride + 4*x];
+			unsigned int b = p[0];
+			unsigned int g = p[1];
+			unsigned int r = p[2];
+			gray[y*w + x] = (unsigned char) ((77*r + 150*g + 29*b + 128) >> 8);
+		}
+	}
+
+	// sobel
+	#define GRAY(i, j) ((int) gray[(j)*w + (i)])
+	for(y = 1; y < h - 1; ++y)
+	{
+		for(x = 1; x < w - 1; ++x)
+		{
+			sx[y*w + x] = (short) ((GRAY(x + 1, y - 1) + 2*GRAY(x + 1, y) + GRAY(x + 1, y + 1)) -
+			                       (GRAY(x - 1, y - 1) + 2*GRAY(x - 1, y) + GRAY(x - 1, y + 1)));
+			sy[y*w + x] = (short) ((GRAY(x - 1, y + 1) + 2*GRAY(x, y + 1) + GRAY(x + 1, y + 1)) -
+			                       (GRAY(x - 1, y - 1) + 2*GRAY(x, y - 1) + GRAY(x + 1, y - 1)));
+		}
+	}
+	#undef GRAY
+
+	// magnitude and argmax
+	for(y = 0; y < h; ++y)
+	{
+		for(x = 0; x < w; ++x)
+		{
+			int          idx = y*w + x;
+			unsigned int mag = (unsigned int) (sx[idx]*sx[idx] + sy[idx]*sy[idx]);
+			if(mag > peak->mag)
+			{
+				peak->x   = x;
+				peak->y   = y;
+				peak->mag = mag;
+			}
+		}
+	}
+
+	free(gray);
+	free(sx);
+	free(sy);
+	return 1;
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef lzs_kernel_H
+#define lzs_kernel_H
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+// integer gray -> sobel 3x3 -> magnitude squared -> argmax
+//
+// gray = (77*r + 150*g + 29*b + 128) >> 8
+// mag  = sx*sx + sy*sy
+//
+// the one pixel border has no edge response and ties are
+// resolved by the first peak in row-major order
+typedef struct
+{
+	int          x;
+	int          y;
+	unsigned int mag;
+} lzs_peak_t;
+
+// backends are selected at runtime and the scalar backend
+// is always supported
+#define LZS_KERNEL_BEST   -1
+#define LZS_KERNEL_SCALAR 0
+#define LZS_KERNEL_SSE2   1
+#define LZS_KERNEL_AVX2   2
+#define LZS_KERNEL_NEON   3
+#define LZS_KERNEL_COUNT  4
+
+// the fused kernel reads the BGRA crop once and keeps three
+// gray rows and up to four rows of magnitudes in scratch
+// which must hold LZS_KERNEL_SCRATCH(w) bytes allocated
+// with lzs_kernel_malloc
+#define LZS_KERNEL_ALIGN      64
+#define LZS_KERNEL_PITCH(w)   (((w) + LZS_KERNEL_ALIGN - 1) & ~(LZS_KERNEL_ALIGN - 1))
+#define LZS_KERNEL_SCRATCH(w) (19*LZS_KERNEL_PITCH(w))
+
+// the vector backends also have rows specialized for the
+// crop widths of the common search windows where the row
+// loops are unrolled completely and the crops of any other
+// width use the generic rows
+//
+// the fixed widths are the refine window of the pyramid
+// (LZS_PYRAMID_WINDOW), the coarse rows of the default
+// three level search (24 to 48) and the full resolution
+// windows of 64 to 256 pixels
+//
+// lzs_kernel_specialize(0) disables the fixed width rows
+// for comparison, lzs_kernel_specialized returns 1 when
+// the current backend has rows for the width w and
+// lzs_kernel_fixedwidth returns the fixed width in
+// [w, wmax] which a crop of width w may be widened to or
+// w when there is none
+#define LZS_KERNEL_WIDTHS 10
+
+int         lzs_kernel_select(int backend);
+int         lzs_kernel_backend(void);
+int         lzs_kernel_supported(int backend);
+const char* lzs_kernel_name(int backend);
+void        lzs_kernel_specialize(int enable);
+int         lzs_kernel_specialized(int w);
+int         lzs_kernel_fixedwidth(int w, int wmax);
+void*       lzs_kernel_malloc(int size);
+void        lzs_kernel_free(void* ptr);
+
+void lzs_kernel_peak(const unsigned char* bgra, int stride,
+                     int w, int h, unsigned char* scratch,
+                     lzs_peak_t* peak);
+
+// lzs_kernel_peakgray is the same kernel for a gray image
+// and uses the same scratch
+void lzs_kernel_peakgray(const unsigned char* gray, int stride,
+                         int w, int h, unsigned char* scratch,
+                         lzs_peak_t* peak);
+
+// lzs_kernel_peaks returns up to max candidates which are
+// the local maxima of a 3x3 neighborhood ranked by magnitude
+// and then by row-major order so that peaks[0] matches
+// lzs_kernel_peak
+//
+// the candidates are suppressed during the same pass and
+// are kept in a min-heap over peaks so the cost is close to
+// lzs_kernel_peak
+int lzs_kernel_peaks(const unsigned char* bgra, int stride,
+                     int w, int h, unsigned char* scratch,
+                     lzs_peak_t* peaks, int max);
+int lzs_kernel_peaksgray(const unsigned char* gray, int stride,
+                         int w, int h, unsigned char* scratch,
+                         lzs_peak_t* peaks, int max);
+
+// lzs_kernel_magsgray writes the magnitude of each pixel of
+// the gray image to mags where the border is zero
+void lzs_kernel_magsgray(const unsigned char* gray, int stride,
+                         int w, int h, unsigned int* mags, int mstride);
+
+// lzs_kernel_peakgrayrow updates peak with the pixels
+// [x0, x1) of the gray row y where the rows above and below
+// are read and scratch holds LZS_KERNEL_SCRATCH(x1) so that
+// windows may be scanned a row interval at a time
+void lzs_kernel_peakgrayrow(const unsigned char* gray, int stride,
+                            int x0, int x1, int y,
+                            unsigned char* scratch, lzs_peak_t* peak);
+
+// converts the BGRA crop to gray with the same weights
+void lzs_kernel_gray(const unsigned char* bgra, int stride,
+                     int w, int h, unsigned char* gray, int gstride);
+
+// downsamples the BGRA crop to gray by 2^level (level >= 1)
+// where w and h are the size of the source
+//
+// each gray pixel is the gray of the 2x2 box at the center
+// of its block which is a full box filter at level 1
+void lzs_kernel_downsample(const unsigned char* bgra, int stride,
+                           int w, int h, int level,
+                           unsigned char* gray, int gstride);
+
+// lzs_kernel_downsamplegray is the same downsample for a
+// gray image such as the luminance plane of the camera
+void lzs_kernel_downsamplegray(const unsigned char* src, int stride,
+                               int w, int h, int level,
+                               unsigned char* gray, int gstride);
+
+// the reference computes each stage over the whole crop and
+// must match lzs_kernel_peak bit-for-bit
+int  lzs_kernel_peakref(const unsigned char* bgra, int stride,
+                        int w, int h, lzs_peak_t* peak);
+
+#endif
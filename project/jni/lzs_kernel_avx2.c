@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_kernel_row.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+__attribute__((target("avx2")))
+static inline void lzs_kernel_graystep_avx2(const unsigned char* bgra, int x,
+                                            unsigned char* gray)
+{
+	// see lzs_kernel_graystep_sse2
+	const __m256i mask  = _mm256_set1_epi32(0xFF);
+	const __m256i wb    = _mm256_set1_epi32(29);
+	const __m256i wg    = _mm256_set1_epi32(150);
+	const __m256i wr    = _mm256_set1_epi32(77);
+	const __m256i round = _mm256_set1_epi32(128);
+
+	// the packs interleave the 128-bit lanes
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	__m256i v[4];
+	int i;
+	for(i = 0; i < 4; ++i)
+	{
+		__m256i p = _mm256_loadu_si256((const __m256i*) &bgra[4*(x + 8*i)]);
+		__m256i b = _mm256_and_si256(p, mask);
+		__m256i g = _mm256_and_si256(_mm256_srli_epi32(p, 8), mask);
+		__m256i r = _mm256_and_si256(_mm256_srli_epi32(p, 16), mask);
+		__m256i s = _mm256_add_epi16(_mm256_mullo_epi16(b, wb),
+		                             _mm256_mullo_epi16(g, wg));
+		s    = _mm256_add_epi16(s, _mm256_mullo_epi16(r, wr));
+		s    = _mm256_add_epi16(s, round);
+		v[i] = _mm256_srli_epi32(s, 8);
+	}
+	__m256i lo = _mm256_packs_epi32(v[0], v[1]);
+	__m256i hi = _mm256_packs_epi32(v[2], v[3]);
+	__m256i g8 = _mm256_packus_epi16(lo, hi);
+	_mm256_storeu_si256((__m256i*) &gray[x],
+	                    _mm256_permutevar8x32_epi32(g8, order));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i lzs_kernel_sobelstep_avx2(const unsigned char* a,
+                                                const unsigned char* b,
+                                                const unsigned char* c,
+                                                int x, unsigned int* mags,
+                                                __m256i vmax)
+{
+	#define LOAD16(p) _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*) (p)))
+
+	// see lzs_kernel_sobelstep_sse2
+	__m256i a0 = LOAD16(&a[x - 1]);
+	__m256i a1 = LOAD16(&a[x]);
+	__m256i a2 = LOAD16(&a[x + 1]);
+	__m256i b0 = LOAD16(&b[x - 1]);
+	__m256i b2 = LOAD16(&b[x + 1]);
+	__m256i c0 = LOAD16(&c[x - 1]);
+	__m256i c1 = LOAD16(&c[x]);
+	__m256i c2 = LOAD16(&c[x + 1]);
+
+	#undef LOAD16
+
+	__m256i sx = _mm256_sub_epi16(_mm256_add_epi16(_mm256_add_epi16(a2, c2), _mm256_slli_epi16(b2, 1)),
+	                              _mm256_add_epi16(_mm256_add_epi16(a0, c0), _mm256_slli_epi16(b0, 1)));
+	__m256i sy = _mm256_sub_epi16(_mm256_add_epi16(_mm256_add_epi16(c0, c2), _mm256_slli_epi16(c1, 1)),
+	                              _mm256_add_epi16(_mm256_add_epi16(a0, a2), _mm256_slli_epi16(a1, 1)));
+
+	// the unpacks operate within the 128-bit lanes so lo
+	// holds pixels 0-3, 8-11 and hi holds 4-7, 12-15
+	__m256i lo = _mm256_unpacklo_epi16(sx, sy);
+	__m256i hi = _mm256_unpackhi_epi16(sx, sy);
+	lo = _mm256_madd_epi16(lo, lo);
+	hi = _mm256_madd_epi16(hi, hi);
+	__m256i m0 = _mm256_permute2x128_si256(lo, hi, 0x20);
+	__m256i m1 = _mm256_permute2x128_si256(lo, hi, 0x31);
+	_mm256_storeu_si256((__m256i*) &mags[x],     m0);
+	_mm256_storeu_si256((__m256i*) &mags[x + 8], m1);
+
+	return _mm256_max_epu32(vmax, _mm256_max_epu32(m0, m1));
+}
+
+__attribute__((target("avx2")))
+static inline unsigned int lzs_kernel_sobelmax_avx2(__m256i vmax)
+{
+	// reduce the lanes
+	unsigned int lanes[8];
+	unsigned int max = 0;
+	int          i;
+	_mm256_storeu_si256((__m256i*) lanes, vmax);
+	for(i = 0; i < 8; ++i)
+	{
+		if(lanes[i] > max)
+		{
+			max = lanes[i];
+		}
+	}
+	return max;
+}
+
+LZS_KERNEL_FIXED(avx2, __attribute__((target("avx2"))), __m256i,
+                 _mm256_setzero_si256(), 32, 16)
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+__attribute__((target("avx2")))
+void lzs_kernel_grayrow_avx2(const unsigned char* bgra, int x0, int x1,
+                             unsigned char* gray)
+{
+	int x = x0;
+	for(; x + 32 <= x1; x += 32)
+	{
+		lzs_kernel_graystep_avx2(bgra, x, gray);
+	}
+
+	lzs_kernel_grayrow_c(bgra, x, x1, gray);
+}
+
+__attribute__((target("avx2")))
+void lzs_kernel_sobelrow_avx2(const unsigned char* a, const unsigned char* b,
+                              const unsigned char* c, int x0, int x1, int y,
+                              unsigned int* mags, lzs_peak_t* peak)
+{
+	__m256i vmax = _mm256_setzero_si256();
+
+	int x = x0;
+	for(; x + 16 <= x1; x += 16)
+	{
+		vmax = lzs_kernel_sobelstep_avx2(a, b, c, x, mags, vmax);
+	}
+	lzs_kernel_findpeak(mags, x0, x, y, lzs_kernel_sobelmax_avx2(vmax), peak);
+
+	lzs_kernel_sobelrow_c(a, b, c, x, x1, y, mags, peak);
+}
+
+#endif
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_kernel_row.h"
+
+#if defined(__aarch64__) || defined(LZS_KERNEL_HAVE_NEON)
+
+#include <arm_neon.h>
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+static inline void lzs_kernel_graystep_neon(const unsigned char* bgra, int x,
+                                            unsigned char* gray)
+{
+	const uint8x8_t wb = vdup_n_u8(29);
+	const uint8x8_t wg = vdup_n_u8(150);
+	const uint8x8_t wr = vdup_n_u8(77);
+
+	// deinterleave into b, g, r, a and vrshrn performs
+	// the (s + 128) >> 8 rounding
+	uint8x8x4_t p = vld4_u8(&bgra[4*x]);
+	uint16x8_t  s = vmull_u8(p.val[0], wb);
+	s = vmlal_u8(s, p.val[1], wg);
+	s = vmlal_u8(s, p.val[2], wr);
+	vst1_u8(&gray[x], vrshrn_n_u16(s, 8));
+}
+
+static inline uint32x4_t lzs_kernel_sobelstep_neon(const unsigned char* a,
+                                                   const unsigned char* b,
+                                                   const unsigned char* c,
+                                                   int x, unsigned int* mags,
+                                                   uint32x4_t vmax)
+{
+	#define LOAD8(p) vreinterpretq_s16_u16(vmovl_u8(vld1_u8(p)))
+
+	// see lzs_kernel_sobelstep_sse2
+	int16x8_t a0 = LOAD8(&a[x - 1]);
+	int16x8_t a1 = LOAD8(&a[x]);
+	int16x8_t a2 = LOAD8(&a[x + 1]);
+	int16x8_t b0 = LOAD8(&b[x - 1]);
+	int16x8_t b2 = LOAD8(&b[x + 1]);
+	int16x8_t c0 = LOAD8(&c[x - 1]);
+	int16x8_t c1 = LOAD8(&c[x]);
+	int16x8_t c2 = LOAD8(&c[x + 1]);
+
+	#undef LOAD8
+
+	int16x8_t sx = vsubq_s16(vaddq_s16(vaddq_s16(a2, c2), vshlq_n_s16(b2, 1)),
+	                         vaddq_s16(vaddq_s16(a0, c0), vshlq_n_s16(b0, 1)));
+	int16x8_t sy = vsubq_s16(vaddq_s16(vaddq_s16(c0, c2), vshlq_n_s16(c1, 1)),
+	                         vaddq_s16(vaddq_s16(a0, a2), vshlq_n_s16(a1, 1)));
+
+	int32x4_t  m0 = vmull_s16(vget_low_s16(sx), vget_low_s16(sx));
+	int32x4_t  m1 = vmull_s16(vget_high_s16(sx), vget_high_s16(sx));
+	m0 = vmlal_s16(m0, vget_low_s16(sy), vget_low_s16(sy));
+	m1 = vmlal_s16(m1, vget_high_s16(sy), vget_high_s16(sy));
+	uint32x4_t u0 = vreinterpretq_u32_s32(m0);
+	uint32x4_t u1 = vreinterpretq_u32_s32(m1);
+	vst1q_u32(&mags[x],     u0);
+	vst1q_u32(&mags[x + 4], u1);
+
+	return vmaxq_u32(vmax, vmaxq_u32(u0, u1));
+}
+
+static inline unsigned int lzs_kernel_sobelmax_neon(uint32x4_t vmax)
+{
+	// reduce the lanes
+	uint32x2_t vmax2 = vpmax_u32(vget_low_u32(vmax), vget_high_u32(vmax));
+	vmax2 = vpmax_u32(vmax2, vmax2);
+	return vget_lane_u32(vmax2, 0);
+}
+
+LZS_KERNEL_FIXED(neon, , uint32x4_t, vdupq_n_u32(0), 8, 8)
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+void lzs_kernel_grayrow_neon(const unsigned char* bgra, int x0, int x1,
+                             unsigned char* gray)
+{
+	int x = x0;
+	for(; x + 8 <= x1; x += 8)
+	{
+		lzs_kernel_graystep_neon(bgra, x, gray);
+	}
+
+	lzs_kernel_grayrow_c(bgra, x, x1, gray);
+}
+
+void lzs_kernel_sobelrow_neon(const unsigned char* a, const unsigned char* b,
+                              const unsigned char* c, int x0, int x1, int y,
+                              unsigned int* mags, lzs_peak_t* peak)
+{
+	uint32x4_t vmax = vdupq_n_u32(0);
+
+	int x = x0;
+	for(; x + 8 <= x1; x += 8)
+	{
+		vmax = lzs_kernel_sobelstep_neon(a, b, c, x, mags, vmax);
+	}
+	lzs_kernel_findpeak(mags, x0, x, y, lzs_kernel_sobelmax_neon(vmax), peak);
+
+	lzs_kernel_sobelrow_c(a, b, c, x, x1, y, mags, peak);
+}
+
+#endif
@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef lzs_kernel_row_H
+#define lzs_kernel_row_H
+
+#include "lzs_kernel.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+// row functions implemented by each kernel backend
+//
+// grayrow converts the pixels [x0, x1)
+//
+// sobelrow computes the magnitude for the pixels [x0, x1)
+// of the center row b and updates peak when a larger
+// magnitude is found where 1 <= x0 and x1 <= w - 1
+//
+// mags has room for a row of magnitudes which the vector
+// backends use to locate the first row-major peak
+typedef void (*lzs_kernel_grayrow_fn)(const unsigned char* bgra,
+                                      int x0, int x1,
+                                      unsigned char* gray);
+typedef void (*lzs_kernel_sobelrow_fn)(const unsigned char* a,
+                                       const unsigned char* b,
+                                       const unsigned char* c,
+                                       int x0, int x1, int y,
+                                       unsigned int* mags,
+                                       lzs_peak_t* peak);
+
+// the fixed width rows of a backend where the crop width
+// w is a compile-time constant so grayrow ignores x0 and x1
+// which must be 0 and w and sobelrow ignores x0 and x1
+// which must be 1 and w - 1
+//
+// the widths are sorted and a table ends at the first
+// unused entry which has w = 0
+typedef struct
+{
+	int                    w;
+	lzs_kernel_grayrow_fn  grayrow;
+	lzs_kernel_sobelrow_fn sobelrow;
+} lzs_kernel_fixed_t;
+
+void lzs_kernel_grayrow_c(const unsigned char* bgra, int x0, int x1,
+                          unsigned char* gray);
+void lzs_kernel_sobelrow_c(const unsigned char* a, const unsigned char* b,
+                           const unsigned char* c, int x0, int x1, int y,
+                           unsigned int* mags, lzs_peak_t* peak);
+
+#if defined(__x86_64__) || defined(__i386__)
+void lzs_kernel_grayrow_sse2(const unsigned char* bgra, int x0, int x1,
+                             unsigned char* gray);
+void lzs_kernel_sobelrow_sse2(const unsigned char* a, const unsigned char* b,
+                              const unsigned char* c, int x0, int x1, int y,
+                              unsigned int* mags, lzs_peak_t* peak);
+void lzs_kernel_grayrow_avx2(const unsigned char* bgra, int x0, int x1,
+                             unsigned char* gray);
+void lzs_kernel_sobelrow_avx2(const unsigned char* a, const unsigned char* b,
+                              const unsigned char* c, int x0, int x1, int y,
+                              unsigned int* mags, lzs_peak_t* peak);
+
+extern const lzs_kernel_fixed_t lzs_kernel_fixed_sse2[LZS_KERNEL_WIDTHS];
+extern const lzs_kernel_fixed_t lzs_kernel_fixed_avx2[LZS_KERNEL_WIDTHS];
+#endif
+
+#if defined(__aarch64__) || defined(LZS_KERNEL_HAVE_NEON)
+void lzs_kernel_grayrow_neon(const unsigned char* bgra, int x0, int x1,
+                             unsigned char* gray);
+void lzs_kernel_sobelrow_neon(const unsigned char* a, const unsigned char* b,
+                              const unsigned char* c, int x0, int x1, int y,
+                              unsigned int* mags, lzs_peak_t* peak);
+
+extern const lzs_kernel_fixed_t lzs_kernel_fixed_neon[LZS_KERNEL_WIDTHS];
+#endif
+
+// helper for the vector backends which finds the first
+// magnitude in [x0, x1) that equals max
+static inline void lzs_kernel_findpeak(const unsigned int* mags,
+                                       int x0, int x1, int y,
+                                       unsigned int max,
+                                       lzs_peak_t* peak)
+{
+	if(max > peak->mag)
+	{
+		int x;
+		for(x = x0; x < x1; ++x)
+		{
+			if(mags[x] == max)
+			{
+				peak->x   = x;
+				peak->y   = y;
+				peak->mag = max;
+				return;
+			}
+		}
+	}
+}
+
+// the scalar rows are inlined so that the tails of the
+// fixed width rows are also unrolled
+static inline void lzs_kernel_grayrow_inline(const unsigned char* bgra,
+                                             int x0, int x1,
+                                             unsigned char* gray)
+{
+	int x;
+	for(x = x0; x < x1; ++x)
+	{
+		unsigned int b = bgra[4*x];
+		unsigned int g = bgra[4*x + 1];
+		unsigned int r = bgra[4*x + 2];
+		gray[x] = (unsigned char) ((77*r + 150*g + 29*b + 128) >> 8);
+	}
+}
+
+static inline void lzs_kernel_sobelrow_inline(const unsigned char* a,
+                                              const unsigned char* b,
+                                              const unsigned char* c,
+                                              int x0, int x1, int y,
+                                              unsigned int* mags,
+                                              lzs_peak_t* peak)
+{
+	// keep the peak in registers since it may alias the rows
+	int          peak_x   = -1;
+	unsigned int peak_mag = peak->mag;
+
+	int x;
+	for(x = x0; x < x1; ++x)
+	{
+		int sx = ((int) a[x + 1] + 2*((int) b[x + 1]) + (int) c[x + 1]) -
+		         ((int) a[x - 1] + 2*((int) b[x - 1]) + (int) c[x - 1]);
+		int sy = ((int) c[x - 1] + 2*((int) c[x]) + (int) c[x + 1]) -
+		         ((int) a[x - 1] + 2*((int) a[x]) + (int) a[x + 1]);
+		unsigned int mag = (unsigned int) (sx*sx + sy*sy);
+		mags[x] = mag;
+		if(mag > peak_mag)
+		{
+			peak_x   = x;
+			peak_mag = mag;
+		}
+	}
+
+	if(peak_x >= 0)
+	{
+		peak->x   = peak_x;
+		peak->y   = y;
+		peak->mag = peak_mag;
+	}
+}
+
+// LZS_KERNEL_FIXEDROW instantiates the fixed rows of width
+// W for a vector backend from its step functions and
+// LZS_KERNEL_FIXEDENTRY adds them to lzs_kernel_fixed_name
+//
+// lzs_kernel_graystep_name converts the ng pixels at x and
+// lzs_kernel_sobelstep_name computes the ns magnitudes at x
+// and returns the lanes of the running maximum which
+// lzs_kernel_sobelmax_name reduces
+//
+// the row bounds are constant so the loops are unrolled
+// completely and the loads use constant offsets
+#define LZS_KERNEL_FIXEDROW(name, attr, vec, zero, ng, ns, W)               \
+	attr static void lzs_kernel_grayrow_##name##_##W(const unsigned char* bgra, \
+	                                                 int x0, int x1,            \
+	                                                 unsigned char* gray)       \
+	{                                                                           \
+		int x;                                                                  \
+		_Pragma("GCC unroll 32")                                                \
+		for(x = 0; x + (ng) <= (W); x += (ng))                                  \
+		{                                                                       \
+			lzs_kernel_graystep_##name(bgra, x, gray);                          \
+		}                                                                       \
+		lzs_kernel_grayrow_inline(bgra, x, (W), gray);                          \
+	}                                                                           \
+	attr static void lzs_kernel_sobelrow_##name##_##W(const unsigned char* a,   \
+	                                                  const unsigned char* b,   \
+	                                                  const unsigned char* c,   \
+	                                                  int x0, int x1, int y,    \
+	                                                  unsigned int* mags,       \
+	                                                  lzs_peak_t* peak)         \
+	{                                                                           \
+		vec vmax = (zero);                                                      \
+		int x;                                                                  \
+		_Pragma("GCC unroll 32")                                                \
+		for(x = 1; x + (ns) <= (W) - 1; x += (ns))                              \
+		{                                                                       \
+			vmax = lzs_kernel_sobelstep_##name(a, b, c, x, mags, vmax);         \
+		}                                                                       \
+		lzs_kernel_findpeak(mags, 1, x, y,                                      \
+		                    lzs_kernel_sobelmax_##name(vmax), peak);            \
+		lzs_kernel_sobelrow_inline(a, b, c, x, (W) - 1, y, mags, peak);         \
+	}
+
+#define LZS_KERNEL_FIXEDENTRY(name, W)                                      \
+	{ (W), lzs_kernel_grayrow_##name##_##W, lzs_kernel_sobelrow_##name##_##W }
+
+// LZS_KERNEL_FIXED instantiates the rows and the table of
+// every width listed in lzs_kernel.h for a backend
+#define LZS_KERNEL_FIXED(name, attr, vec, zero, ng, ns)                         \
+	LZS_KERNEL_FIXEDROW(name, attr, vec, zero, ng, ns, 19)                      \
+	LZS_KERNEL_FIXEDROW(name, attr, vec, zero, ng, ns, 24)                      \
+	LZS_KERNEL_FIXEDROW(name, attr, vec, zero, ng, ns, 32)                      \
+	LZS_KERNEL_FIXEDROW(name, attr, vec, zero, ng, ns, 40)                      \
+	LZS_KERNEL_FIXEDROW(name, attr, vec, zero, ng, ns, 48)                      \
+	LZS_KERNEL_FIXEDROW(name, attr, vec, zero, ng, ns, 64)                      \
+	LZS_KERNEL_FIXEDROW(name, attr, vec, zero, ng, ns, 96)                      \
+	LZS_KERNEL_FIXEDROW(name, attr, vec, zero, ng, ns, 128)                     \
+	LZS_KERNEL_FIXEDROW(name, attr, vec, zero, ng, ns, 192)                     \
+	LZS_KERNEL_FIXEDROW(name, attr, vec, zero, ng, ns, 256)                     \
+	const lzs_kernel_fixed_t lzs_kernel_fixed_##name[LZS_KERNEL_WIDTHS] =       \
+	{                                                                           \
+		LZS_KERNEL_FIXEDENTRY(name, 19),                                        \
+		LZS_KERNEL_FIXEDENTRY(name, 24),                                        \
+		LZS_KERNEL_FIXEDENTRY(name, 32),                                        \
+		LZS_KERNEL_FIXEDENTRY(name, 40),                                        \
+		LZS_KERNEL_FIXEDENTRY(name, 48),                                        \
+		LZS_KERNEL_FIXEDENTRY(name, 64),                                        \
+		LZS_KERNEL_FIXEDENTRY(name, 96),                                        \
+		LZS_KERNEL_FIXEDENTRY(name, 128),                                       \
+		LZS_KERNEL_FIXEDENTRY(name, 192),                                       \
+		LZS_KERNEL_FIXEDENTRY(name, 256),                                       \
+	};
+
+#endif
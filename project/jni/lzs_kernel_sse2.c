@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_kernel_row.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <emmintrin.h>
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+__attribute__((target("sse2")))
+static inline void lzs_kernel_graystep_sse2(const unsigned char* bgra, int x,
+                                            unsigned char* gray)
+{
+	// each 32-bit lane holds one pixel and the 16-bit products
+	// cannot overflow since 77*255 + 150*255 + 29*255 + 128
+	// fits in 16 bits
+	const __m128i mask  = _mm_set1_epi32(0xFF);
+	const __m128i wb    = _mm_set1_epi32(29);
+	const __m128i wg    = _mm_set1_epi32(150);
+	const __m128i wr    = _mm_set1_epi32(77);
+	const __m128i round = _mm_set1_epi32(128);
+
+	__m128i v[4];
+	int i;
+	for(i = 0; i < 4; ++i)
+	{
+		__m128i p = _mm_loadu_si128((const __m128i*) &bgra[4*(x + 4*i)]);
+		__m128i b = _mm_and_si128(p, mask);
+		__m128i g = _mm_and_si128(_mm_srli_epi32(p, 8), mask);
+		__m128i r = _mm_and_si128(_mm_srli_epi32(p, 16), mask);
+		__m128i s = _mm_add_epi16(_mm_mullo_epi16(b, wb),
+		                          _mm_mullo_epi16(g, wg));
+		s    = _mm_add_epi16(s, _mm_mullo_epi16(r, wr));
+		s    = _mm_add_epi16(s, round);
+		v[i] = _mm_srli_epi32(s, 8);
+	}
+	__m128i lo = _mm_packs_epi32(v[0], v[1]);
+	__m128i hi = _mm_packs_epi32(v[2], v[3]);
+	_mm_storeu_si128((__m128i*) &gray[x], _mm_packus_epi16(lo, hi));
+}
+
+__attribute__((target("sse2")))
+static inline __m128i lzs_kernel_sobelstep_sse2(const unsigned char* a,
+                                                const unsigned char* b,
+                                                const unsigned char* c,
+                                                int x, unsigned int* mags,
+                                                __m128i vmax)
+{
+	#define LOAD8(p) _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*) (p)), zero)
+
+	// the loads for x + 8 may read up to x1 inclusive which
+	// is at most w - 1
+	const __m128i zero = _mm_setzero_si128();
+
+	__m128i a0 = LOAD8(&a[x - 1]);
+	__m128i a1 = LOAD8(&a[x]);
+	__m128i a2 = LOAD8(&a[x + 1]);
+	__m128i b0 = LOAD8(&b[x - 1]);
+	__m128i b2 = LOAD8(&b[x + 1]);
+	__m128i c0 = LOAD8(&c[x - 1]);
+	__m128i c1 = LOAD8(&c[x]);
+	__m128i c2 = LOAD8(&c[x + 1]);
+
+	#undef LOAD8
+
+	// |sx|, |sy| <= 1020
+	__m128i sx = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(a2, c2), _mm_slli_epi16(b2, 1)),
+	                           _mm_add_epi16(_mm_add_epi16(a0, c0), _mm_slli_epi16(b0, 1)));
+	__m128i sy = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(c0, c2), _mm_slli_epi16(c1, 1)),
+	                           _mm_add_epi16(_mm_add_epi16(a0, a2), _mm_slli_epi16(a1, 1)));
+
+	// sx*sx + sy*sy <= 2080800 which fits in the signed
+	// 32-bit lanes of madd
+	__m128i lo = _mm_unpacklo_epi16(sx, sy);
+	__m128i hi = _mm_unpackhi_epi16(sx, sy);
+	__m128i m0 = _mm_madd_epi16(lo, lo);
+	__m128i m1 = _mm_madd_epi16(hi, hi);
+	_mm_storeu_si128((__m128i*) &mags[x],     m0);
+	_mm_storeu_si128((__m128i*) &mags[x + 4], m1);
+
+	__m128i gt = _mm_cmpgt_epi32(m0, vmax);
+	vmax = _mm_or_si128(_mm_and_si128(gt, m0), _mm_andnot_si128(gt, vmax));
+	gt   = _mm_cmpgt_epi32(m1, vmax);
+	return _mm_or_si128(_mm_and_si128(gt, m1), _mm_andnot_si128(gt, vmax));
+}
+
+__attribute__((target("sse2")))
+static inline unsigned int lzs_kernel_sobelmax_sse2(__m128i vmax)
+{
+	// reduce the lanes
+	unsigned int lanes[4];
+	unsigned int max = 0;
+	int          i;
+	_mm_storeu_si128((__m128i*) lanes, vmax);
+	for(i = 0; i < 4; ++i)
+	{
+		if(lanes[i] > max)
+		{
+			max = lanes[i];
+		}
+	}
+	return max;
+}
+
+LZS_KERNEL_FIXED(sse2, __attribute__((target("sse2"))), __m128i,
+                 _mm_setzero_si128(), 16, 8)
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+__attribute__((target("sse2")))
+void lzs_kernel_grayrow_sse2(const unsigned char* bgra, int x0, int x1,
+                             unsigned char* gray)
+{
+	int x = x0;
+	for(; x + 16 <= x1; x += 16)
+	{
+		lzs_kernel_graystep_sse2(bgra, x, gray);
+	}
+
+	lzs_kernel_grayrow_c(bgra, x, x1, gray);
+}
+
+__attribute__((target("sse2")))
+void lzs_kernel_sobelrow_sse2(const unsigned char* a, const unsigned char* b,
+                              const unsigned char* c, int x0, int x1, int y,
+                              unsigned int* mags, lzs_peak_t* peak)
+{
+	__m128i vmax = _mm_setzero_si128();
+
+	int x = x0;
+	for(; x + 8 <= x1; x += 8)
+	{
+		vmax = lzs_kernel_sobelstep_sse2(a, b, c, x, mags, vmax);
+	}
+	lzs_kernel_findpeak(mags, x0, x, y, lzs_kernel_sobelmax_sse2(vmax), peak);
+
+	lzs_kernel_sobelrow_c(a, b, c, x, x1, y, mags, peak);
+}
+
+#endif
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_motion.h"
+#include <assert.h>
+#include <math.h>
+#include "a3d/a3d_time.h"
+
+#define LOG_TAG "LaserShark"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+static void lzs_kalman_init(lzs_kalman_t* self, float p, float r)
+{
+	assert(self);
+
+	// the velocity is unknown until the second measurement
+	self->p   = p;
+	self->v   = 0.0f;
+	self->P00 = r;
+	self->P01 = 0.0f;
+	self->P11 = 1.0e6f;
+}
+
+static void lzs_kalman_predict(lzs_kalman_t* self, float dt, float q)
+{
+	assert(self);
+
+	// white noise acceleration
+	float dt2 = dt*dt;
+	self->p   += self->v*dt;
+	self->P00 += dt*(2.0f*self->P01 + dt*self->P11) + 0.25f*q*dt2*dt2;
+	self->P01 += dt*self->P11 + 0.5f*q*dt2*dt;
+	self->P11 += q*dt2;
+}
+
+static void lzs_kalman_update(lzs_kalman_t* self, float z, float r)
+{
+	assert(self);
+
+	float s   = self->P00 + r;
+	float k0  = self->P00/s;
+	float k1  = self->P01/s;
+	float e   = z - self->p;
+	float P01 = self->P01;
+	self->p   += k0*e;
+	self->v   += k1*e;
+	self->P11 -= k1*P01;
+	self->P01 -= k0*P01;
+	self->P00 -= k0*self->P00;
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+void lzs_motion_reset(lzs_motion_t* self)
+{
+	assert(self);
+	LOGD("debug");
+
+	self->init = 0;
+	self->t    = 0.0;
+}
+
+void lzs_motion_update(lzs_motion_t* self, double t,
+                       float x, float y, float X, float Y,
+                       float speed, float uX, float uY)
+{
+	assert(self);
+	LOGD("debug t=%lf, x=%f, y=%f, X=%f, Y=%f", t, x, y, X, Y);
+
+	float dt = (float) ((t - self->t)/A3D_USEC);
+	if((self->init == 0) || (dt <= 0.0f) || (dt > 1.0f))
+	{
+		// restart after a search or a long gap
+		lzs_kalman_init(&self->x, x, LZS_MOTION_RSCREEN);
+		lzs_kalman_init(&self->y, y, LZS_MOTION_RSCREEN);
+		lzs_kalman_init(&self->X, X, LZS_MOTION_RGROUND);
+		lzs_kalman_init(&self->Y, Y, LZS_MOTION_RGROUND);
+		self->init = 1;
+		self->t    = t;
+		return;
+	}
+
+	float q = LZS_MOTION_QSCREEN*(1.0f + 4.0f*speed);
+	lzs_kalman_predict(&self->x, dt, q);
+	lzs_kalman_predict(&self->y, dt, q);
+	lzs_kalman_update(&self->x, x, LZS_MOTION_RSCREEN);
+	lzs_kalman_update(&self->y, y, LZS_MOTION_RSCREEN);
+
+	// the ball accelerates toward the commanded velocity
+	float k = dt/(LZS_MOTION_TAU + dt);
+	lzs_kalman_predict(&self->X, dt, LZS_MOTION_QGROUND);
+	lzs_kalman_predict(&self->Y, dt, LZS_MOTION_QGROUND);
+	self->X.v += k*(uX - self->X.v);
+	self->Y.v += k*(uY - self->Y.v);
+	lzs_kalman_update(&self->X, X, LZS_MOTION_RGROUND);
+	lzs_kalman_update(&self->Y, Y, LZS_MOTION_RGROUND);
+
+	self->t = t;
+}
+
+int lzs_motion_predict(lzs_motion_t* self, double t, float speed,
+                       float* x, float* y, float* sigma)
+{
+	assert(self);
+	assert(x);
+	assert(y);
+	assert(sigma);
+	LOGD("debug t=%lf", t);
+
+	if(self->init == 0)
+	{
+		return 0;
+	}
+
+	float dt = (float) ((t - self->t)/A3D_USEC);
+	if(dt < 0.0f)
+	{
+		dt = 0.0f;
+	}
+
+	lzs_kalman_t kx = self->x;
+	lzs_kalman_t ky = self->y;
+	float        q  = LZS_MOTION_QSCREEN*(1.0f + 4.0f*speed);
+	lzs_kalman_predict(&kx, dt, q);
+	lzs_kalman_predict(&ky, dt, q);
+	*x     = kx.p;
+	*y     = ky.p;
+	*sigma = sqrtf((kx.P00 > ky.P00) ? kx.P00 : ky.P00);
+	return 1;
+}
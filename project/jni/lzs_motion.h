@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef lzs_motion_H
+#define lzs_motion_H
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+// constant velocity Kalman filter for each axis of the ball
+// in screen (pixels) and ground (feet) coordinates
+//
+// the screen filter predicts the next search window and its
+// process noise grows with the commanded speed while the
+// ground filter uses the commanded velocity as its control
+// input since the ball follows the command with a lag of
+// about LZS_MOTION_TAU seconds
+#define LZS_MOTION_QSCREEN 2.0e5f   // (px/s^2)^2
+#define LZS_MOTION_RSCREEN 256.0f   // px^2
+#define LZS_MOTION_QGROUND 16.0f    // (ft/s^2)^2
+#define LZS_MOTION_RGROUND 0.25f    // ft^2
+#define LZS_MOTION_FTPS    6.0f     // ft/s at full speed
+#define LZS_MOTION_TAU     0.5f     // s
+
+typedef struct
+{
+	float p;
+	float v;
+
+	// covariance of p, v
+	float P00;
+	float P01;
+	float P11;
+} lzs_kalman_t;
+
+typedef struct
+{
+	// state is valid after the first measurement at t usec
+	int    init;
+	double t;
+
+	lzs_kalman_t x;
+	lzs_kalman_t y;
+	lzs_kalman_t X;
+	lzs_kalman_t Y;
+} lzs_motion_t;
+
+void lzs_motion_reset(lzs_motion_t* self);
+void lzs_motion_update(lzs_motion_t* self, double t,
+                       float x, float y, float X, float Y,
+                       float speed, float uX, float uY);
+int  lzs_motion_predict(lzs_motion_t* self, double t, float speed,
+                        float* x, float* y, float* sigma);
+
+#endif
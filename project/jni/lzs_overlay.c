@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_overlay.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <assert.h>
+#include <math.h>
+
+#define LOG_TAG "LaserShark"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+static void lzs_overlay_vertex(lzs_overlay_t* self, float x, float y)
+{
+	assert(self);
+
+	GLfloat* v = &self->vertices[3*self->count];
+	GLubyte* c = &self->colors[4*self->count];
+	v[0] = x;
+	v[1] = y;
+	v[2] = -1.0f;
+	c[0] = self->color[0];
+	c[1] = self->color[1];
+	c[2] = self->color[2];
+	c[3] = self->color[3];
+	++self->count;
+}
+
+// returns 0 if the segments do not fit
+static int lzs_overlay_reserve(lzs_overlay_t* self, int segments)
+{
+	assert(self);
+
+	if(self->count + 2*segments > LZS_OVERLAY_VERTICES)
+	{
+		++self->dropped;
+		return 0;
+	}
+	return 1;
+}
+
+static GLubyte lzs_overlay_byte(float v)
+{
+	v = (v < 0.0f) ? 0.0f : ((v > 1.0f) ? 1.0f : v);
+	return (GLubyte) (255.0f*v + 0.5f);
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+lzs_overlay_t* lzs_overlay_new(void)
+{
+	LOGD("debug");
+
+	lzs_overlay_t* self = (lzs_overlay_t*) malloc(sizeof(lzs_overlay_t));
+	if(self == NULL)
+	{
+		LOGE("malloc failed");
+		return NULL;
+	}
+
+	self->count   = 0;
+	self->dropped = 0;
+	lzs_overlay_color(self, 1.0f, 1.0f, 1.0f, 1.0f);
+
+	int i;
+	for(i = 0; i <= LZS_OVERLAY_SEGMENTS; ++i)
+	{
+		float a = 2.0f*M_PI*((float) i)/((float) LZS_OVERLAY_SEGMENTS);
+		self->circle_x[i] = cosf(a);
+		self->circle_y[i] = sinf(a);
+	}
+
+	return self;
+}
+
+void lzs_overlay_delete(lzs_overlay_t** _self)
+{
+	assert(_self);
+
+	lzs_overlay_t* self = *_self;
+	if(self)
+	{
+		LOGD("debug");
+		free(self);
+		*_self = NULL;
+	}
+}
+
+void lzs_overlay_begin(lzs_overlay_t* self)
+{
+	assert(self);
+	LOGD("debug");
+
+	self->count = 0;
+}
+
+void lzs_overlay_color(lzs_overlay_t* self, float r, float g, float b, float a)
+{
+	assert(self);
+	LOGD("debug r=%f, g=%f, b=%f, a=%f", r, g, b, a);
+
+	self->color[0] = lzs_overlay_byte(r);
+	self->color[1] = lzs_overlay_byte(g);
+	self->color[2] = lzs_overlay_byte(b);
+	self->color[3] = lzs_overlay_byte(a);
+}
+
+void lzs_overlay_line(lzs_overlay_t* self, float x0, float y0, float x1, float y1)
+{
+	assert(self);
+	LOGD("debug x0=%f, y0=%f, x1=%f, y1=%f", x0, y0, x1, y1);
+
+	if(lzs_overlay_reserve(self, 1))
+	{
+		lzs_overlay_vertex(self, x0, y0);
+		lzs_overlay_vertex(self, x1, y1);
+	}
+}
+
+void lzs_overlay_box(lzs_overlay_t* self, float top, float left, float bottom, float right)
+{
+	assert(self);
+	LOGD("debug top=%f, left=%f, bottom=%f, right=%f", top, left, bottom, right);
+
+	if(lzs_overlay_reserve(self, 4))
+	{
+		lzs_overlay_vertex(self, left,  top);
+		lzs_overlay_vertex(self, left,  bottom);
+		lzs_overlay_vertex(self, left,  bottom);
+		lzs_overlay_vertex(self, right, bottom);
+		lzs_overlay_vertex(self, right, bottom);
+		lzs_overlay_vertex(self, right, top);
+		lzs_overlay_vertex(self, right, top);
+		lzs_overlay_vertex(self, left,  top);
+	}
+}
+
+void lzs_overlay_crosshair(lzs_overlay_t* self, float top, float left, float bottom, float right)
+{
+	assert(self);
+	LOGD("debug top=%f, left=%f, bottom=%f, right=%f", top, left, bottom, right);
+
+	float cx = left + (right - left)/2.0f;
+	float cy = top + (bottom - top)/2.0f;
+	if(lzs_overlay_reserve(self, 2))
+	{
+		lzs_overlay_vertex(self, cx,    top);
+		lzs_overlay_vertex(self, cx,    bottom);
+		lzs_overlay_vertex(self, left,  cy);
+		lzs_overlay_vertex(self, right, cy);
+	}
+}
+
+void lzs_overlay_marker(lzs_overlay_t* self, float x, float y, float r)
+{
+	assert(self);
+	LOGD("debug x=%f, y=%f, r=%f", x, y, r);
+
+	if(lzs_overlay_reserve(self, LZS_OVERLAY_SEGMENTS))
+	{
+		int i;
+		for(i = 0; i < LZS_OVERLAY_SEGMENTS; ++i)
+		{
+			lzs_overlay_vertex(self, x + r*self->circle_x[i],
+			                   y + r*self->circle_y[i]);
+			lzs_overlay_vertex(self, x + r*self->circle_x[i + 1],
+			                   y + r*self->circle_y[i + 1]);
+		}
+	}
+}
+
+void lzs_overlay_path(lzs_overlay_t* self, int n, const float* x, const float* y)
+{
+	assert(self);
+	assert(x);
+	assert(y);
+	LOGD("debug n=%i", n);
+
+	if((n >= 2) && lzs_overlay_reserve(self, n - 1))
+	{
+		int i;
+		for(i = 1; i < n; ++i)
+		{
+			lzs_overlay_vertex(self, x[i - 1], y[i - 1]);
+			lzs_overlay_vertex(self, x[i],     y[i]);
+		}
+	}
+}
+
+void lzs_overlay_draw(lzs_overlay_t* self)
+{
+	assert(self);
+	LOGD("debug count=%i", self->count);
+
+	if(self->count == 0)
+	{
+		return;
+	}
+
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 0, self->vertices);
+	glColorPointer(4, GL_UNSIGNED_BYTE, 0, self->colors);
+	glDrawArrays(GL_LINES, 0, self->count);
+	glDisableClientState(GL_COLOR_ARRAY);
+	glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+}
+
+lzs_overlaytext_t* lzs_overlaytext_new(a3d_texfont_t* font, int max_len, int size, int justify,
+                                       float r, float g, float b, float a)
+{
+	assert(font);
+	LOGD("debug max_len=%i, size=%i, justify=%i", max_len, size, justify);
+
+	lzs_overlaytext_t* self = (lzs_overlaytext_t*) malloc(sizeof(lzs_overlaytext_t));
+	if(self == NULL)
+	{
+		LOGE("malloc failed");
+		return NULL;
+	}
+
+	self->string = a3d_texstring_new(font, max_len, size, justify, r, g, b, a);
+	if(self->string == NULL)
+	{
+		free(self);
+		return NULL;
+	}
+	self->text[0] = '\0';
+	self->updates = 0;
+
+	return self;
+}
+
+void lzs_overlaytext_delete(lzs_overlaytext_t** _self)
+{
+	assert(_self);
+
+	lzs_overlaytext_t* self = *_self;
+	if(self)
+	{
+		LOGD("debug");
+		a3d_texstring_delete(&self->string);
+		free(self);
+		*_self = NULL;
+	}
+}
+
+int lzs_overlaytext_printf(lzs_overlaytext_t* self, const char* fmt, ...)
+{
+	assert(self);
+	assert(fmt);
+	LOGD("debug");
+
+	char    text[LZS_OVERLAY_TEXT];
+	va_list argptr;
+	va_start(argptr, fmt);
+	vsnprintf(text, LZS_OVERLAY_TEXT, fmt, argptr);
+	va_end(argptr);
+
+	// the texstring is only laid out when the text changes
+	if(strncmp(text, self->text, LZS_OVERLAY_TEXT) == 0)
+	{
+		return 0;
+	}
+	strncpy(self->text, text, LZS_OVERLAY_TEXT);
+	a3d_texstring_printf(self->string, "%s", self->text);
+	++self->updates;
+	return 1;
+}
+
+void lzs_overlaytext_draw(lzs_overlaytext_t* self, float x, float y, float w, float h)
+{
+	assert(self);
+	LOGD("debug x=%f, y=%f, w=%f, h=%f", x, y, w, h);
+
+	a3d_texstring_draw(self->string, x, y, w, h);
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef lzs_overlay_H
+#define lzs_overlay_H
+
+#include "a3d/a3d_GL.h"
+#include "a3d/a3d_texfont.h"
+#include "a3d/a3d_texstring.h"
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+// retained HUD layer where the boxes, crosshairs, markers
+// and paths of a frame are collected as colored line
+// segments in screen coordinates and drawn with a single
+// glDrawArrays
+//
+// primitives which do not fit in LZS_OVERLAY_VERTICES are
+// dropped and counted
+#define LZS_OVERLAY_VERTICES 2048
+#define LZS_OVERLAY_SEGMENTS 16
+#define LZS_OVERLAY_TEXT     128
+
+typedef struct
+{
+	int          count;
+	unsigned int dropped;
+	GLubyte      color[4];
+
+	// unit circle for the markers
+	float circle_x[LZS_OVERLAY_SEGMENTS + 1];
+	float circle_y[LZS_OVERLAY_SEGMENTS + 1];
+
+	// vertices are xyz to match the camera quad
+	GLfloat vertices[3*LZS_OVERLAY_VERTICES];
+	GLubyte colors[4*LZS_OVERLAY_VERTICES];
+} lzs_overlay_t;
+
+// texstring which is only formatted and laid out again
+// when the text changes at its printed precision
+typedef struct
+{
+	a3d_texstring_t* string;
+	char             text[LZS_OVERLAY_TEXT];
+	unsigned int     updates;
+} lzs_overlaytext_t;
+
+lzs_overlay_t*     lzs_overlay_new(void);
+void               lzs_overlay_delete(lzs_overlay_t** _self);
+void               lzs_overlay_begin(lzs_overlay_t* self);
+void               lzs_overlay_color(lzs_overlay_t* self, float r, float g, float b, float a);
+void               lzs_overlay_line(lzs_overlay_t* self, float x0, float y0, float x1, float y1);
+void               lzs_overlay_box(lzs_overlay_t* self, float top, float left, float bottom, float right);
+void               lzs_overlay_crosshair(lzs_overlay_t* self, float top, float left, float bottom, float right);
+void               lzs_overlay_marker(lzs_overlay_t* self, float x, float y, float r);
+void               lzs_overlay_path(lzs_overlay_t* self, int n, const float* x, const float* y);
+void               lzs_overlay_draw(lzs_overlay_t* self);
+lzs_overlaytext_t* lzs_overlaytext_new(a3d_texfont_t* font, int max_len, int size, int justify,
+                                       float r, float g, float b, float a);
+void               lzs_overlaytext_delete(lzs_overlaytext_t** _self);
+int                lzs_overlaytext_printf(lzs_overlaytext_t* self, const char* fmt, ...);
+void               lzs_overlaytext_draw(lzs_overlaytext_t* self, float x, float y, float w, float h);
+
+#endif
@@ -0,0 +1,546 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_particles.h"
+#include "lzs_motion.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#define LOG_TAG "LaserShark"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+// xorshift32 returns a uniform number in [0, 1)
+static inline float lzs_particles_uniform(unsigned int* seed)
+{
+	unsigned int s = *seed;
+	s ^= s << 13;
+	s ^= s >> 17;
+	s ^= s << 5;
+	*seed = s;
+	return ((float) (s >> 8))*(1.0f/16777216.0f);
+}
+
+// the sum of two uniforms has a triangular distribution
+// which is scaled to unit variance and is close enough to
+// a normal for the process noise
+static inline float lzs_particles_noise(unsigned int* seed)
+{
+	float u1 = lzs_particles_uniform(seed);
+	float u2 = lzs_particles_uniform(seed);
+	return 2.4494897f*(u1 + u2 - 1.0f);
+}
+
+// builds the integral image of src where each row of sum
+// is offset by one and the first row and column are zero
+static void lzs_particles_integral(int mw, int mh,
+                                   const unsigned int* src, int stride,
+                                   int shift, unsigned int* sum)
+{
+	assert(src);
+	assert(sum);
+
+	int sw = mw + 1;
+	int x;
+	int y;
+	memset(sum, 0, sw*sizeof(unsigned int));
+	for(y = 0; y < mh; ++y)
+	{
+		const unsigned int* s    = &src[y*stride];
+		const unsigned int* prev = &sum[y*sw];
+		unsigned int*       row  = &sum[(y + 1)*sw];
+		unsigned int        acc  = 0;
+		row[0] = 0;
+		for(x = 0; x < mw; ++x)
+		{
+			acc       += s[x] >> shift;
+			row[x + 1] = prev[x + 1] + acc;
+		}
+	}
+}
+
+static void lzs_particles_integral8(int mw, int mh,
+                                       const unsigned char* src, int stride,
+                                       unsigned int* sum)
+{
+	assert(src);
+	assert(sum);
+
+	int sw = mw + 1;
+	int x;
+	int y;
+	memset(sum, 0, sw*sizeof(unsigned int));
+	for(y = 0; y < mh; ++y)
+	{
+		const unsigned char* s    = &src[y*stride];
+		const unsigned int*  prev = &sum[y*sw];
+		unsigned int*        row  = &sum[(y + 1)*sw];
+		unsigned int         acc  = 0;
+		row[0] = 0;
+		for(x = 0; x < mw; ++x)
+		{
+			acc       += s[x];
+			row[x + 1] = prev[x + 1] + acc;
+		}
+	}
+}
+
+// rounds v to a cell edge of the map in [0, max]
+static inline int lzs_particles_clamp(float v, float max)
+{
+	return (int) fminf(fmaxf(v + 0.5f, 0.0f), max);
+}
+
+// sum of the box [x0, x1) x [y0, y1)
+static inline unsigned int lzs_particles_box(const unsigned int* sum, int sw,
+                                             int x0, int y0, int x1, int y1)
+{
+	return sum[y1*sw + x1] - sum[y1*sw + x0] - sum[y0*sw + x1] + sum[y0*sw + x0];
+}
+
+// the magnitudes of the downsampled gray crop are squared
+// so they are shifted to keep the sum of the largest map
+// within 32 bits
+static void lzs_particles_map(lzs_particles_t* self, int w, int h)
+{
+	assert(self);
+
+	self->mw    = w >> LZS_PARTICLES_LEVEL;
+	self->mh    = h >> LZS_PARTICLES_LEVEL;
+	self->color = 0;
+	lzs_kernel_magsgray(self->gray, self->mpitch, self->mw, self->mh,
+	                    self->mags, self->mpitch);
+	lzs_particles_integral(self->mw, self->mh, self->mags, self->mpitch,
+	                       8, self->edge_sum);
+	lzs_particles_integral8(self->mw, self->mh, self->gray, self->mpitch,
+	                        self->gray_sum);
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+lzs_particles_t* lzs_particles_new(int count, int w, int h)
+{
+	LOGD("debug count=%i, w=%i, h=%i", count, w, h);
+
+	if((count < 1) || (count > LZS_PARTICLES_MAX) ||
+	   (w < (4 << LZS_PARTICLES_LEVEL)) || (h < (4 << LZS_PARTICLES_LEVEL)))
+	{
+		LOGE("invalid count=%i, w=%i, h=%i", count, w, h);
+		return NULL;
+	}
+
+	lzs_particles_t* self = (lzs_particles_t*) malloc(sizeof(lzs_particles_t));
+	if(self == NULL)
+	{
+		LOGE("malloc failed");
+		return NULL;
+	}
+
+	// one buffer holds the arrays of the particles where
+	// the count is rounded to keep each array aligned
+	int n = (count + 15) & ~15;
+	self->count = count;
+	self->X = (float*) lzs_kernel_malloc(14*n*sizeof(float));
+	if(self->X == NULL)
+	{
+		goto fail_state;
+	}
+	self->Y    = self->X  + n;
+	self->U    = self->Y  + n;
+	self->V    = self->U  + n;
+	self->x    = self->V  + n;
+	self->y    = self->x  + n;
+	self->w    = self->y  + n;
+	self->c    = self->w  + n;
+	self->k    = self->c  + n;
+	self->X2   = self->k  + n;
+	self->Y2   = self->X2 + n;
+	self->U2   = self->Y2 + n;
+	self->V2   = self->U2 + n;
+	self->seed = (unsigned int*) (self->V2 + n);
+
+	// the maps of the largest crop
+	int mw = w >> LZS_PARTICLES_LEVEL;
+	int mh = h >> LZS_PARTICLES_LEVEL;
+	self->mw     = 0;
+	self->mh     = 0;
+	self->mpitch = LZS_KERNEL_PITCH(mw);
+	self->gray   = (unsigned char*) lzs_kernel_malloc(2*self->mpitch*mh);
+	if(self->gray == NULL)
+	{
+		goto fail_gray;
+	}
+	self->mask = self->gray + self->mpitch*mh;
+
+	self->mags = (unsigned int*) lzs_kernel_malloc(self->mpitch*mh*sizeof(unsigned int));
+	if(self->mags == NULL)
+	{
+		goto fail_mags;
+	}
+
+	int sums = (mw + 1)*(mh + 1);
+	self->edge_sum = (unsigned int*) lzs_kernel_malloc(3*sums*sizeof(unsigned int));
+	if(self->edge_sum == NULL)
+	{
+		goto fail_sums;
+	}
+	self->gray_sum  = self->edge_sum + sums;
+	self->color_sum = self->gray_sum + sums;
+	self->color     = 0;
+
+	// the generators must not start at zero
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		self->seed[i] = 2654435761u*((unsigned int) i + 1);
+	}
+
+	self->energy_avg = 0.0f;
+	lzs_particles_reset(self, 0.0f, 0.0f);
+	self->init = 0;
+
+	// success
+	return self;
+
+	// failure
+	fail_sums:
+		lzs_kernel_free(self->mags);
+	fail_mags:
+		lzs_kernel_free(self->gray);
+	fail_gray:
+		lzs_kernel_free(self->X);
+	fail_state:
+		free(self);
+	return NULL;
+}
+
+void lzs_particles_delete(lzs_particles_t** _self)
+{
+	assert(_self);
+
+	lzs_particles_t* self = *_self;
+	if(self)
+	{
+		LOGD("debug");
+		lzs_kernel_free(self->edge_sum);
+		lzs_kernel_free(self->mags);
+		lzs_kernel_free(self->gray);
+		lzs_kernel_free(self->X);
+		free(self);
+		*_self = NULL;
+	}
+}
+
+void lzs_particles_reset(lzs_particles_t* self, float X, float Y)
+{
+	assert(self);
+	LOGD("debug X=%f, Y=%f", X, Y);
+
+	// the ball is assumed to be at rest near X, Y
+	int   n  = self->count;
+	float wn = 1.0f/((float) n);
+	int   i;
+	for(i = 0; i < n; ++i)
+	{
+		self->X[i] = X + LZS_PARTICLES_SPREAD*lzs_particles_noise(&self->seed[i]);
+		self->Y[i] = Y + LZS_PARTICLES_SPREAD*lzs_particles_noise(&self->seed[i]);
+		self->U[i] = 0.0f;
+		self->V[i] = 0.0f;
+		self->w[i] = wn;
+	}
+
+	self->init   = 1;
+	self->est_X  = X;
+	self->est_Y  = Y;
+	self->energy = 0.0f;
+}
+
+void lzs_particles_predict(lzs_particles_t* self, float dt,
+                           float uX, float uY)
+{
+	assert(self);
+	LOGD("debug dt=%f, uX=%f, uY=%f", dt, uX, uY);
+
+	if(dt <= 0.0f)
+	{
+		return;
+	}
+
+	// the velocity relaxes toward the command with the time
+	// constant of the ball and both random walks grow with
+	// the square root of the interval
+	float a  = dt/(LZS_MOTION_TAU + dt);
+	float sq = sqrtf(dt);
+	float qp = LZS_PARTICLES_QPOS*sq;
+	float qv = LZS_PARTICLES_QVEL*sq;
+	int   n  = self->count;
+	int   i;
+	for(i = 0; i < n; ++i)
+	{
+		unsigned int* seed = &self->seed[i];
+		float u = self->U[i] + a*(uX - self->U[i]) + qv*lzs_particles_noise(seed);
+		float v = self->V[i] + a*(uY - self->V[i]) + qv*lzs_particles_noise(seed);
+		self->X[i] += u*dt + qp*lzs_particles_noise(seed);
+		self->Y[i] += v*dt + qp*lzs_particles_noise(seed);
+		self->U[i]  = u;
+		self->V[i]  = v;
+	}
+}
+
+void lzs_particles_edges(lzs_particles_t* self,
+                         const unsigned char* bgra, int stride,
+                         int w, int h)
+{
+	assert(self);
+	assert(bgra);
+	LOGD("debug stride=%i, w=%i, h=%i", stride, w, h);
+
+	lzs_kernel_downsample(bgra, stride, w, h, LZS_PARTICLES_LEVEL,
+	                      self->gray, self->mpitch);
+	lzs_particles_map(self, w, h);
+}
+
+void lzs_particles_edgesgray(lzs_particles_t* self,
+                             const unsigned char* gray, int stride,
+                             int w, int h)
+{
+	assert(self);
+	assert(gray);
+	LOGD("debug stride=%i, w=%i, h=%i", stride, w, h);
+
+	lzs_kernel_downsamplegray(gray, stride, w, h, LZS_PARTICLES_LEVEL,
+	                          self->gray, self->mpitch);
+	lzs_particles_map(self, w, h);
+}
+
+void lzs_particles_colors(lzs_particles_t* self, const lzs_color_t* color,
+                          const unsigned char* bgra, int stride,
+                          int w, int h)
+{
+	assert(self);
+	assert(color);
+	assert(bgra);
+	LOGD("debug stride=%i, w=%i, h=%i", stride, w, h);
+
+	// the edges of the same crop are mapped first
+	lzs_color_mask(color, bgra, stride, w, h, LZS_PARTICLES_LEVEL,
+	               self->mask, self->mpitch);
+	lzs_particles_integral8(self->mw, self->mh, self->mask, self->mpitch,
+	                        self->color_sum);
+	self->color = 1;
+}
+
+void lzs_particles_colorsnv21(lzs_particles_t* self, const lzs_color_t* color,
+                              const unsigned char* luma,
+                              const unsigned char* chroma, int stride,
+                              int w, int h)
+{
+	assert(self);
+	assert(color);
+	assert(luma);
+	assert(chroma);
+	LOGD("debug stride=%i, w=%i, h=%i", stride, w, h);
+
+	lzs_color_masknv21(color, luma, chroma, stride, w, h, LZS_PARTICLES_LEVEL,
+	                   self->mask, self->mpitch);
+	lzs_particles_integral8(self->mw, self->mh, self->mask, self->mpitch,
+	                        self->color_sum);
+	self->color = 1;
+}
+
+int lzs_particles_weigh(lzs_particles_t* self, lzs_camera_t* camera,
+                        float ax, float bx, float ay, float by)
+{
+	assert(self);
+	assert(camera);
+	LOGD("debug ax=%f, bx=%f, ay=%f, by=%f", ax, bx, ay, by);
+
+	int   n  = self->count;
+	int   sw = self->mw + 1;
+	float mw = (float) self->mw;
+	float mh = (float) self->mh;
+	float rx = LZS_PARTICLES_RADIUS*fabsf(ax);
+	float ry = LZS_PARTICLES_RADIUS*fabsf(ay);
+	int   i;
+
+	lzs_camera_screen(camera, n, self->X, self->Y, self->x, self->y);
+
+	// the boxes of each particle are clamped to the map
+	// where a particle beyond the horizon has empty boxes
+	// since fmaxf ignores the NaN
+	float emax = 0.0f;
+	float kmax = 0.0f;
+	float cmax = 0.0f;
+	for(i = 0; i < n; ++i)
+	{
+		float cx = ax*self->x[i] + bx;
+		float cy = ay*self->y[i] + by;
+
+		// the rim lies in the box of the radius
+		int x0 = lzs_particles_clamp(cx - rx, mw);
+		int x1 = lzs_particles_clamp(cx + rx, mw);
+		int y0 = lzs_particles_clamp(cy - ry, mh);
+		int y1 = lzs_particles_clamp(cy + ry, mh);
+		float e = (float) lzs_particles_box(self->edge_sum, sw, x0, y0, x1, y1);
+		float c = 0.0f;
+		if(self->color)
+		{
+			c = (float) lzs_particles_box(self->color_sum, sw, x0, y0, x1, y1);
+		}
+
+		// the inner box lies within the ball and the ring
+		// between it and the outer box lies on the floor
+		int ix0 = lzs_particles_clamp(cx - 0.75f*rx, mw);
+		int ix1 = lzs_particles_clamp(cx + 0.75f*rx, mw);
+		int iy0 = lzs_particles_clamp(cy - 0.75f*ry, mh);
+		int iy1 = lzs_particles_clamp(cy + 0.75f*ry, mh);
+		int ox0 = lzs_particles_clamp(cx - 1.5f*rx, mw);
+		int ox1 = lzs_particles_clamp(cx + 1.5f*rx, mw);
+		int oy0 = lzs_particles_clamp(cy - 1.5f*ry, mh);
+		int oy1 = lzs_particles_clamp(cy + 1.5f*ry, mh);
+		float si = (float) lzs_particles_box(self->gray_sum, sw, ix0, iy0, ix1, iy1);
+		float so = (float) lzs_particles_box(self->gray_sum, sw, ox0, oy0, ox1, oy1);
+		float ai = (float) ((ix1 - ix0)*(iy1 - iy0));
+		float ao = (float) ((ox1 - ox0)*(oy1 - oy0));
+		float k  = 0.0f;
+		if((ai > 0.0f) && (ao > ai))
+		{
+			k = fabsf(si/ai - (so - si)/(ao - ai));
+		}
+
+		emax = (e > emax) ? e : emax;
+		kmax = (k > kmax) ? k : kmax;
+		cmax = (c > cmax) ? c : cmax;
+		self->w[i] = e;
+		self->k[i] = k;
+		self->c[i] = c;
+	}
+	self->energy = kmax;
+
+	int accept = (kmax > 0.0f) && (emax > 0.0f) &&
+	             ((self->energy_avg == 0.0f) ||
+	              (kmax >= LZS_PARTICLES_RATIO*self->energy_avg));
+	if(accept)
+	{
+		// the score is the product of the fractions of the
+		// best contrast and edges so that a seam (edges on a
+		// flat floor) or a shadow (contrast without a rim)
+		// scores low and it is raised to the 8th power to
+		// concentrate the weights where the LED counts as
+		// much as the ball when the crop has color
+		float se  = 1.0f/emax;
+		float sk  = 1.0f/kmax;
+		float sc  = (cmax > 0.0f) ? 1.0f/cmax : 0.0f;
+		float sum = 0.0f;
+		for(i = 0; i < n; ++i)
+		{
+			float s = (self->k[i]*sk)*(self->w[i]*se);
+			if(cmax > 0.0f)
+			{
+				s = 0.5f*(s + self->c[i]*sc);
+			}
+			s *= s;
+			s *= s;
+			s *= s;
+			self->w[i] = s;
+			sum += s;
+		}
+
+		self->energy_avg = (self->energy_avg == 0.0f) ? kmax :
+		                   0.9f*self->energy_avg + 0.1f*kmax;
+
+		float wn = 1.0f/sum;
+		for(i = 0; i < n; ++i)
+		{
+			self->w[i] *= wn;
+		}
+	}
+	else
+	{
+		float wn = 1.0f/((float) n);
+		for(i = 0; i < n; ++i)
+		{
+			self->w[i] = wn;
+		}
+	}
+
+	// the estimate is the weighted mean on the ground which
+	// is projected since a particle may be beyond the horizon
+	float X = 0.0f;
+	float Y = 0.0f;
+	for(i = 0; i < n; ++i)
+	{
+		X += self->w[i]*self->X[i];
+		Y += self->w[i]*self->Y[i];
+	}
+	self->est_X = X;
+	self->est_Y = Y;
+	lzs_camera_screen(camera, 1, &self->est_X, &self->est_Y,
+	                  &self->est_x, &self->est_y);
+	return accept;
+}
+
+void lzs_particles_resample(lzs_particles_t* self)
+{
+	assert(self);
+	LOGD("debug");
+
+	// systematic resampling takes the particles under a comb
+	// of count teeth with one random offset where the offset
+	// is drawn from the generator of the first particle
+	int   n    = self->count;
+	float step = 1.0f/((float) n);
+	float u    = step*lzs_particles_uniform(&self->seed[0]);
+	float c    = self->w[0];
+	int   j    = 0;
+	int   i;
+	for(i = 0; i < n; ++i)
+	{
+		while((u > c) && (j < n - 1))
+		{
+			++j;
+			c += self->w[j];
+		}
+		self->X2[i] = self->X[j];
+		self->Y2[i] = self->Y[j];
+		self->U2[i] = self->U[j];
+		self->V2[i] = self->V[j];
+		u += step;
+	}
+
+	memcpy(self->X, self->X2, n*sizeof(float));
+	memcpy(self->Y, self->Y2, n*sizeof(float));
+	memcpy(self->U, self->U2, n*sizeof(float));
+	memcpy(self->V, self->V2, n*sizeof(float));
+	for(i = 0; i < n; ++i)
+	{
+		self->w[i] = step;
+	}
+}
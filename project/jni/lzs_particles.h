@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef lzs_particles_H
+#define lzs_particles_H
+
+#include "lzs_kernel.h"
+#include "lzs_camera.h"
+#include "lzs_color.h"
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+// particle filter over the ground position and velocity of
+// the ball which keeps several hypotheses alive when the
+// edges of the floor or a passing object compete with the
+// ball
+//
+// each particle follows the commanded velocity with the lag
+// of the ground motion model (see lzs_motion.h) plus noise
+// and is weighed by the edge energy in a box of
+// LZS_PARTICLES_RADIUS screen pixels around its projection
+// times the contrast of the gray levels inside the ball with
+// the ring around it (plus the LED pixels when the crop has
+// color) where the box sums are read from integral images of
+// the crop downsampled by 2^LZS_PARTICLES_LEVEL so a particle
+// costs a projection and a dozen loads
+//
+// the state is kept as arrays so the loops over particles
+// have no dependencies and vectorize and each particle has
+// its own random number generator so that a range of
+// particles may be handed to another thread
+//
+// the measurement is rejected when the best contrast is
+// less than LZS_PARTICLES_RATIO of the average and the cloud is
+// not resampled until the ball returns
+#define LZS_PARTICLES_COUNT  500
+#define LZS_PARTICLES_MAX    2048
+#define LZS_PARTICLES_LEVEL  2
+#define LZS_PARTICLES_RADIUS 32.0f   // px
+#define LZS_PARTICLES_SPREAD 0.25f   // ft
+#define LZS_PARTICLES_QPOS   0.25f   // ft/sqrt(s)
+#define LZS_PARTICLES_QVEL   4.0f    // ft/s/sqrt(s)
+#define LZS_PARTICLES_RATIO  0.25f
+#define LZS_PARTICLES_FRAMES 15
+
+typedef struct
+{
+	int count;
+
+	// state in feet and ft/s
+	float*        X;
+	float*        Y;
+	float*        U;
+	float*        V;
+	unsigned int* seed;
+
+	// screen projection, normalized weights and the LED
+	// pixels in the box of each particle
+	float* x;
+	float* y;
+	float* w;
+	float* c;
+	float* k;
+
+	// resampled state
+	float* X2;
+	float* Y2;
+	float* U2;
+	float* V2;
+
+	// maps of the last crop which are (mw + 1) x (mh + 1)
+	// integral images where color is 0 when the crop has no
+	// color
+	int            mw;
+	int            mh;
+	int            mpitch;
+	unsigned char* gray;
+	unsigned int*  mags;
+	unsigned char* mask;
+	unsigned int*  edge_sum;
+	unsigned int*  gray_sum;
+	unsigned int*  color_sum;
+	int            color;
+
+	// weighted mean of the last weigh which is valid after
+	// reset where init is 0 until then
+	int   init;
+	float est_x;
+	float est_y;
+	float est_X;
+	float est_Y;
+
+	// best contrast of the last weigh in gray levels and its
+	// average over the accepted measurements
+	float energy;
+	float energy_avg;
+} lzs_particles_t;
+
+lzs_particles_t* lzs_particles_new(int count, int w, int h);
+void             lzs_particles_delete(lzs_particles_t** _self);
+void             lzs_particles_reset(lzs_particles_t* self, float X, float Y);
+void             lzs_particles_predict(lzs_particles_t* self, float dt,
+                                       float uX, float uY);
+void             lzs_particles_edges(lzs_particles_t* self,
+                                     const unsigned char* bgra, int stride,
+                                     int w, int h);
+void             lzs_particles_edgesgray(lzs_particles_t* self,
+                                         const unsigned char* gray, int stride,
+                                         int w, int h);
+void             lzs_particles_colors(lzs_particles_t* self, const lzs_color_t* color,
+                                      const unsigned char* bgra, int stride,
+                                      int w, int h);
+void             lzs_particles_colorsnv21(lzs_particles_t* self, const lzs_color_t* color,
+                                          const unsigned char* luma,
+                                          const unsigned char* chroma, int stride,
+                                          int w, int h);
+
+// lzs_particles_weigh projects the particles with the camera
+// and maps screen x, y to the cells of the last maps at
+// ax*x + bx, ay*y + by then returns 0 when the measurement
+// is rejected which leaves uniform weights
+int              lzs_particles_weigh(lzs_particles_t* self, lzs_camera_t* camera,
+                                     float ax, float bx, float ay, float by);
+void             lzs_particles_resample(lzs_particles_t* self);
+
+#endif
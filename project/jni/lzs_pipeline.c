@@ -0,0 +1,1152 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_pipeline.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include "a3d/a3d_time.h"
+
+#define LOG_TAG "LaserShark"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+static void lzs_pipeline_publish(lzs_pipeline_t* self, const lzs_crop_t* crop, int depth)
+{
+	assert(self);
+	assert(crop);
+	LOGD("debug");
+
+	lzs_tracker_t* tracker = self->tracker;
+	lzs_result_t*  result  = &self->result;
+
+	__sync_fetch_and_add(&self->seq, 1);
+	__sync_synchronize();
+	result->sphero_x              = tracker->sphero_x;
+	result->sphero_y              = tracker->sphero_y;
+	result->sphero_X              = tracker->sphero_X;
+	result->sphero_Y              = tracker->sphero_Y;
+	result->sphero_speed          = tracker->sphero_speed;
+	result->sphero_heading        = tracker->sphero_heading;
+	result->sphero_heading_offset = tracker->sphero_heading_offset;
+	result->sphero_goal           = tracker->sphero_goal;
+	result->phone_heading         = tracker->phone_heading;
+	result->phone_slope           = tracker->phone_slope;
+	result->phone_X               = tracker->phone_X;
+	result->phone_Y               = tracker->phone_Y;
+	result->peak                  = tracker->peak;
+	result->sphero_vX             = tracker->motion.init ? tracker->motion.X.v : 0.0f;
+	result->sphero_vY             = tracker->motion.init ? tracker->motion.Y.v : 0.0f;
+	result->lost                  = tracker->lost;
+	result->reacquired            = self->reacquired;
+	result->reacquire_ms          = self->reacquire_ms;
+	result->roi_x                 = tracker->roi_x;
+	result->roi_y                 = tracker->roi_y;
+	result->roi_radius            = tracker->roi_radius;
+	result->t_capture             = crop->t;
+	result->t_done                = a3d_utime();
+	result->depth                 = depth;
+	__sync_synchronize();
+	__sync_fetch_and_add(&self->seq, 1);
+
+	lzs_recorder_t* recorder = self->recorder;
+	if(recorder)
+	{
+		lzs_recorder_result(recorder, result->t_done, result, sizeof(lzs_result_t));
+	}
+
+	if(crop->t > 0.0)
+	{
+		double ns = 1000.0*(result->t_done - crop->t);
+		lzs_timing_record(&self->timing, LZS_TIMING_LATENCY,
+		                  (ns < 4.0e9) ? (unsigned int) ns : 0xFFFFFFFF);
+	}
+}
+
+static void lzs_pipeline_recordcrop(lzs_pipeline_t* self, const lzs_crop_t* crop, int full)
+{
+	assert(self);
+	assert(crop);
+	LOGD("debug full=%i", full);
+
+	lzs_recorder_t* recorder = self->recorder;
+	if(recorder)
+	{
+		lzs_recorder_crop(recorder, crop, self->tracker, full);
+	}
+}
+
+static unsigned int lzs_pipeline_readsearch(lzs_pipeline_t* self, lzs_search_t* search)
+{
+	assert(self);
+	assert(search);
+	LOGD("debug");
+
+	unsigned int seq0;
+	unsigned int seq1;
+	do
+	{
+		seq0 = self->search_seq;
+		__sync_synchronize();
+		*search = self->search;
+		__sync_synchronize();
+		seq1 = self->search_seq;
+	} while((seq0 != seq1) || (seq0 & 1));
+	return seq0;
+}
+
+static void lzs_pipeline_search(lzs_pipeline_t* self, const lzs_search_t* search)
+{
+	assert(self);
+	assert(search);
+	LOGD("debug");
+
+	lzs_recorder_t* recorder = self->recorder;
+	if(recorder)
+	{
+		lzs_recorder_search(recorder, search->t, search->x, search->y);
+	}
+	lzs_tracker_searchsphero(self->tracker, search->x, search->y);
+	lzs_gate_reset(&self->gate);
+}
+
+static void lzs_pipeline_applypose(lzs_pipeline_t* self)
+{
+	assert(self);
+	LOGD("debug");
+
+	lzs_pose_t   pose;
+	unsigned int seq0;
+	unsigned int seq1;
+	do
+	{
+		seq0 = self->pose_seq;
+		__sync_synchronize();
+		pose = self->pose;
+		__sync_synchronize();
+		seq1 = self->pose_seq;
+	} while((seq0 != seq1) || (seq0 & 1));
+
+	// the calibration uses the pose of the same snapshot
+	lzs_tracker_t* tracker  = self->tracker;
+	tracker->phone_heading  = pose.phone_heading;
+	tracker->phone_slope    = pose.phone_slope;
+	tracker->phone_height   = pose.phone_height;
+	tracker->sphero_heading = pose.sphero_heading;
+	if(pose.calibrate != self->calibrated)
+	{
+		lzs_tracker_calibratesphero(tracker, 0.0f, 0.0f, 0.0f, 0.0f);
+		self->calibrated = pose.calibrate;
+	}
+}
+
+static void lzs_pipeline_beginpose(lzs_pipeline_t* self)
+{
+	assert(self);
+	LOGD("debug");
+
+	pthread_mutex_lock(&self->pose_mutex);
+	++self->pose_seq;
+	__sync_synchronize();
+}
+
+static void lzs_pipeline_endpose(lzs_pipeline_t* self)
+{
+	assert(self);
+	LOGD("debug");
+
+	__sync_synchronize();
+	++self->pose_seq;
+	pthread_mutex_unlock(&self->pose_mutex);
+}
+
+static void lzs_pipeline_reacquire(lzs_pipeline_t* self, const lzs_crop_t* crop)
+{
+	assert(self);
+	assert(crop);
+	LOGD("debug");
+
+	lzs_pipeline_recordcrop(self, crop, 1);
+
+	unsigned int   t0      = lzs_timing_now();
+	lzs_tracker_t* tracker = self->tracker;
+	lzs_peak_t     candidates[4];
+	int            count;
+	int            blob    = lzs_tracker_hascolor(tracker, crop);
+	if(blob)
+	{
+		// the LED is found in one pass over the frame
+		count = lzs_tracker_blob(tracker, crop, &candidates[0]);
+	}
+	else if(crop->format == LZS_CROP_LUMA)
+	{
+		count = lzs_reacquire_searchgray(self->reacquire, crop->pixels, crop->stride,
+		                                 crop->w, crop->h,
+		                                 tracker->config.radius_ball/crop->scale_x,
+		                                 candidates, 4);
+	}
+	else
+	{
+		count = lzs_reacquire_search(self->reacquire, crop->pixels, crop->stride,
+		                             crop->w, crop->h, tracker->config.radius_ball,
+		                             candidates, 4);
+	}
+
+	// the track may have recovered while the frame was queued
+	if(tracker->lost && (count > 0) &&
+	   (blob || lzs_tracker_accept(tracker, &candidates[0])))
+	{
+		double t_lost = tracker->t_lost;
+		lzs_tracker_reacquire(tracker, crop, &candidates[0]);
+		self->reacquire_ms = (float) ((a3d_utime() - t_lost)/1000.0);
+		++self->reacquired;
+	}
+	lzs_timing_mark(&self->timing, LZS_TIMING_REACQUIRE, t0);
+}
+
+// the window is limited while the scheduler is degraded
+static void lzs_pipeline_steer(lzs_pipeline_t* self)
+{
+	assert(self);
+	LOGD("debug");
+
+	lzs_tracker_t* tracker = self->tracker;
+	int            limit   = LZS_BUDGET_RADIUS(tracker->config.radius_ball);
+	tracker->roi_limit = tracker->radius;
+	if((self->budget.vision.level >= LZS_BUDGET_ROI) &&
+	   (tracker->radius > limit))
+	{
+		tracker->roi_limit = limit;
+	}
+
+	unsigned int t0 = lzs_timing_now();
+	lzs_tracker_steer(tracker);
+	lzs_timing_mark(&self->timing, LZS_TIMING_STEER, t0);
+}
+
+// halves a LUMA crop at an origin and size that are a
+// multiple of four so that each VU pair of the half crop is
+// the top left pair of its block
+static void lzs_pipeline_half(lzs_pipeline_t* self, lzs_crop_t* crop)
+{
+	assert(self);
+	assert(crop);
+	LOGD("debug w=%i, h=%i", crop->w, crop->h);
+
+	int w = crop->w/2;
+	int h = crop->h/2;
+	lzs_kernel_downsamplegray(crop->pixels, crop->stride, crop->w, crop->h, 1,
+	                          self->half, LZS_PIPELINE_HALF_PITCH);
+	if(crop->chroma)
+	{
+		unsigned char* chroma = &self->half[LZS_PIPELINE_HALF*LZS_PIPELINE_HALF_PITCH];
+		int x;
+		int y;
+		for(y = 0; y < h/2; ++y)
+		{
+			const unsigned char* src = &crop->chroma[2*y*crop->stride];
+			unsigned char*       dst = &chroma[y*LZS_PIPELINE_HALF_PITCH];
+			for(x = 0; x < w/2; ++x)
+			{
+				dst[2*x]     = src[4*x];
+				dst[2*x + 1] = src[4*x + 1];
+			}
+		}
+		crop->chroma = chroma;
+	}
+
+	crop->pixels   = self->half;
+	crop->stride   = LZS_PIPELINE_HALF_PITCH;
+	crop->w        = w;
+	crop->h        = h;
+	crop->scale_x *= 2.0f;
+	crop->scale_y *= 2.0f;
+}
+
+// processes the window of the camera plane in slot where
+// the gate keeps the last result while the scene is still
+static void lzs_pipeline_lumacrop(lzs_pipeline_t* self, lzs_crop_t* crop, int slot)
+{
+	assert(self);
+	assert(crop);
+	LOGD("debug slot=%i", slot);
+
+	// a new preview size restarts the gate
+	lzs_lumaslot_t* luma = &self->luma_slots[slot];
+	if((luma->w != self->luma_w) || (luma->h != self->luma_h))
+	{
+		lzs_gate_reset(&self->gate);
+		self->luma_w = luma->w;
+		self->luma_h = luma->h;
+	}
+
+	// the gate compares the crop with the last one that was
+	// processed
+	if(lzs_gate_skip(&self->gate, crop->pixels, crop->stride,
+	                 luma->x0, luma->y0, crop->w, crop->h, self->gyro))
+	{
+		lzs_pipeline_steer(self);
+		return;
+	}
+
+	unsigned int t0 = lzs_timing_now();
+	if(luma->half)
+	{
+		lzs_pipeline_half(self, crop);
+	}
+	lzs_pipeline_recordcrop(self, crop, 0);
+	unsigned int t1 = lzs_timing_now();
+	lzs_tracker_detect(self->tracker, crop);
+	lzs_timing_mark(&self->timing, LZS_TIMING_DETECT, t1);
+	lzs_pipeline_steer(self);
+	lzs_budget_update(&self->budget, lzs_timing_now() - t0);
+}
+
+// copies the rows [y0, y0 + h) and the columns [x0, x0 + w)
+// of the camera plane and its optional VU plane to dst
+// where the VU rows follow the h rows of pixels
+static void lzs_pipeline_copyluma(const unsigned char* luma,
+                                  const unsigned char* chroma,
+                                  int stride, int x0, int y0, int w, int h,
+                                  unsigned char* dst, int pitch)
+{
+	assert(luma);
+	assert(dst);
+	LOGD("debug stride=%i, x0=%i, y0=%i, w=%i, h=%i, pitch=%i",
+	     stride, x0, y0, w, h, pitch);
+
+	int y;
+	for(y = 0; y < h; ++y)
+	{
+		memcpy(&dst[y*pitch], &luma[(y0 + y)*stride + x0], w);
+	}
+
+	if(chroma)
+	{
+		unsigned char* vu = &dst[h*pitch];
+		for(y = 0; y < (h + 1)/2; ++y)
+		{
+			memcpy(&vu[y*pitch], &chroma[(y0/2 + y)*stride + x0], 2*((w + 1)/2));
+		}
+	}
+}
+
+// adds the requested balls and searches the plane copied
+// with the crop for the balls of the set
+static void lzs_pipeline_plane(lzs_pipeline_t* self, const lzs_crop_t* crop, int slot)
+{
+	assert(self);
+	assert(crop);
+	LOGD("debug slot=%i", slot);
+
+	lzs_trackerset_t* set   = self->set;
+	int               nadds = self->nadds;
+	__sync_synchronize();
+	while(set->count < nadds)
+	{
+		lzs_search_t* add = &self->adds[set->count];
+		if(lzs_trackerset_add(set, add->x, add->y) < 0)
+		{
+			break;
+		}
+	}
+
+	// the balls share the pose of the tracker
+	lzs_tracker_t*  tracker = self->tracker;
+	lzs_lumaslot_t* lslot   = &self->luma_slots[slot];
+	unsigned int    t0      = lzs_timing_now();
+	lzs_trackerset_phonepose(set, tracker->phone_heading,
+	                         tracker->phone_slope, tracker->phone_height);
+	lzs_trackerset_luma(set, self->plane, lslot->w, lslot->h, lslot->w, crop->t);
+	lzs_timing_mark(&self->timing, LZS_TIMING_SET, t0);
+
+	lzs_balls_t* balls = &self->balls;
+	__sync_fetch_and_add(&self->balls_seq, 1);
+	__sync_synchronize();
+	balls->count = set->count;
+	++balls->planes;
+	int i;
+	for(i = 0; i < set->count; ++i)
+	{
+		lzs_tracker_t* t    = set->trackers[i];
+		lzs_ball_t*    ball = &balls->ball[i];
+		ball->sphero_x     = t->sphero_x;
+		ball->sphero_y     = t->sphero_y;
+		ball->sphero_speed = lzs_trackerset_spherospeed(set, i);
+		ball->sphero_goal  = (float) lzs_trackerset_spheroheading(set, i);
+		ball->roi_x        = t->roi_x;
+		ball->roi_y        = t->roi_y;
+		ball->roi_radius   = t->roi_radius;
+		ball->lost         = t->lost;
+	}
+	__sync_synchronize();
+	__sync_fetch_and_add(&self->balls_seq, 1);
+}
+
+static void* lzs_pipeline_thread(void* arg)
+{
+	assert(arg);
+	LOGD("debug");
+
+	lzs_pipeline_t* self = (lzs_pipeline_t*) arg;
+	while(1)
+	{
+		sem_wait(&self->sem);
+		if(self->running == 0)
+		{
+			break;
+		}
+
+		unsigned int tail = self->tail;
+		__sync_synchronize();
+		if(tail == self->head)
+		{
+			continue;
+		}
+
+		// apply the latest pose and a pending search before
+		// the next crop
+		lzs_pipeline_applypose(self);
+		lzs_search_t search;
+		unsigned int search_seq = lzs_pipeline_readsearch(self, &search);
+		if(search_seq != self->searched)
+		{
+			lzs_pipeline_search(self, &search);
+			self->searched_t = search.t;
+			__sync_synchronize();
+			self->searched = search_seq;
+		}
+
+		// crops captured before a search would undo it, a
+		// full frame is searched for the lost ball and the
+		// BGRA crops queued before the camera plane took over
+		// are stale
+		int         slot  = (int) (tail%LZS_PIPELINE_SLOTS);
+		lzs_crop_t* crop  = &self->slots[slot];
+		int         depth = (int) (self->head - tail);
+		int         full  = (crop->pixels == self->frame);
+		int         valid = (crop->t >= self->searched_t) &&
+		                    ((crop->format == LZS_CROP_LUMA) ||
+		                     (self->producer != LZS_PIPELINE_PRODUCER_LUMA));
+		if(full && valid)
+		{
+			lzs_gate_reset(&self->gate);
+			lzs_pipeline_reacquire(self, crop);
+			lzs_pipeline_steer(self);
+		}
+		else if(valid && (crop->format == LZS_CROP_LUMA))
+		{
+			lzs_pipeline_lumacrop(self, crop, slot);
+		}
+		else if(valid)
+		{
+			lzs_pipeline_recordcrop(self, crop, 0);
+			unsigned int t0 = lzs_timing_now();
+			lzs_tracker_detect(self->tracker, crop);
+			lzs_timing_mark(&self->timing, LZS_TIMING_DETECT, t0);
+			lzs_pipeline_steer(self);
+			lzs_budget_update(&self->budget, lzs_timing_now() - t0);
+		}
+		else
+		{
+			lzs_gate_reset(&self->gate);
+			lzs_pipeline_steer(self);
+		}
+		lzs_pipeline_publish(self, crop, depth);
+		if(full)
+		{
+			__sync_synchronize();
+			self->reacquiring = 0;
+		}
+
+		// the plane is released even when the crop is stale
+		if((crop->format == LZS_CROP_LUMA) && self->luma_slots[slot].plane)
+		{
+			if(valid)
+			{
+				lzs_pipeline_plane(self, crop, slot);
+			}
+			self->luma_slots[slot].plane = 0;
+			__sync_synchronize();
+			self->planing = 0;
+		}
+
+		// release the slot
+		__sync_synchronize();
+		self->tail = tail + 1;
+		__sync_fetch_and_add(&self->processed, 1);
+		pthread_mutex_lock(&self->idle_mutex);
+		pthread_cond_broadcast(&self->idle_cond);
+		pthread_mutex_unlock(&self->idle_mutex);
+	}
+
+	return NULL;
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+lzs_pipeline_t* lzs_pipeline_new(const lzs_config_t* config, int detector)
+{
+	assert(config);
+	LOGD("debug detector=%i", detector);
+
+	lzs_pipeline_t* self = (lzs_pipeline_t*) malloc(sizeof(lzs_pipeline_t));
+	if(self == NULL)
+	{
+		LOGE("malloc failed");
+		return NULL;
+	}
+	memset(self, 0, sizeof(lzs_pipeline_t));
+
+	self->tracker = lzs_tracker_new(config);
+	if(self->tracker == NULL)
+	{
+		goto fail_tracker;
+	}
+
+	if((lzs_tracker_window(self->tracker, config->search_radius,
+	                       config->search_levels) == 0) ||
+	   (lzs_tracker_detector(self->tracker, detector) == 0))
+	{
+		goto fail_window;
+	}
+
+	// the slots hold the largest BGRA window which also has
+	// room for a LUMA window and its VU rows at the pitch
+	// of the kernel
+	int size = 2*self->tracker->radius;
+	int i;
+	for(i = 0; i < LZS_PIPELINE_SLOTS; ++i)
+	{
+		lzs_crop_t* crop = &self->slots[i];
+		crop->w         = size;
+		crop->h         = size;
+		crop->stride    = 4*size;
+		crop->format    = LZS_CROP_BGRA;
+		crop->scale_x   = 1.0f;
+		crop->scale_y   = 1.0f;
+		self->pixels[i] = (unsigned char*) lzs_kernel_malloc(crop->stride*crop->h);
+		if(self->pixels[i] == NULL)
+		{
+			goto fail_pixels;
+		}
+		crop->pixels = self->pixels[i];
+	}
+
+	// the frame holds the BGRA screen or the camera plane
+	int frame_size = 4*((int) config->screen_w)*((int) config->screen_h);
+	if(frame_size < LZS_PIPELINE_LUMA_SIZE)
+	{
+		frame_size = LZS_PIPELINE_LUMA_SIZE;
+	}
+	self->frame = (unsigned char*) lzs_kernel_malloc(frame_size);
+	if(self->frame == NULL)
+	{
+		goto fail_frame;
+	}
+
+	self->half = (unsigned char*) lzs_kernel_malloc(LZS_PIPELINE_HALF_PITCH*
+	                                                (LZS_PIPELINE_HALF + LZS_PIPELINE_HALF/2));
+	if(self->half == NULL)
+	{
+		goto fail_half;
+	}
+	lzs_budget_reset(&self->budget, LZS_BUDGET_NS);
+
+	// use every core where the full frame is the camera plane
+	// or the BGRA screen
+	int maxw = LZS_PIPELINE_LUMA_W;
+	if(maxw < (int) config->screen_w)
+	{
+		maxw = (int) config->screen_w;
+	}
+	self->reacquire = lzs_reacquire_new(maxw, 0);
+	if(self->reacquire == NULL)
+	{
+		goto fail_reacquire;
+	}
+
+	self->set = lzs_trackerset_new(config, LZS_PIPELINE_LUMA_W, 0);
+	if(self->set == NULL)
+	{
+		goto fail_set;
+	}
+
+	self->plane = (unsigned char*) lzs_kernel_malloc(LZS_PIPELINE_LUMA_W*
+	                                                 LZS_PIPELINE_LUMA_H);
+	if(self->plane == NULL)
+	{
+		goto fail_plane;
+	}
+
+	// publish the initial state
+	lzs_tracker_steer(self->tracker);
+	lzs_pipeline_publish(self, &self->slots[0], 0);
+
+	// the pose starts from the tracker
+	lzs_tracker_t* tracker    = self->tracker;
+	self->pose.phone_heading  = tracker->phone_heading;
+	self->pose.phone_slope    = tracker->phone_slope;
+	self->pose.phone_height   = tracker->phone_height;
+	self->pose.sphero_heading = tracker->sphero_heading;
+
+	if(sem_init(&self->sem, 0, 0) != 0)
+	{
+		LOGE("sem_init failed");
+		goto fail_sem;
+	}
+
+	if(pthread_mutex_init(&self->pose_mutex, NULL) != 0)
+	{
+		LOGE("pthread_mutex_init failed");
+		goto fail_pose;
+	}
+
+	if(pthread_mutex_init(&self->idle_mutex, NULL) != 0)
+	{
+		LOGE("pthread_mutex_init failed");
+		goto fail_mutex;
+	}
+
+	if(pthread_cond_init(&self->idle_cond, NULL) != 0)
+	{
+		LOGE("pthread_cond_init failed");
+		goto fail_cond;
+	}
+
+	self->running = 1;
+	if(pthread_create(&self->thread, NULL, lzs_pipeline_thread, (void*) self) != 0)
+	{
+		LOGE("pthread_create failed");
+		goto fail_thread;
+	}
+
+	// success
+	return self;
+
+	// failure
+	fail_thread:
+		pthread_cond_destroy(&self->idle_cond);
+	fail_cond:
+		pthread_mutex_destroy(&self->idle_mutex);
+	fail_mutex:
+		pthread_mutex_destroy(&self->pose_mutex);
+	fail_pose:
+		sem_destroy(&self->sem);
+	fail_sem:
+		lzs_kernel_free(self->plane);
+	fail_plane:
+		lzs_trackerset_delete(&self->set);
+	fail_set:
+		lzs_reacquire_delete(&self->reacquire);
+	fail_reacquire:
+		lzs_kernel_free(self->half);
+	fail_half:
+		lzs_kernel_free(self->frame);
+	fail_frame:
+	fail_pixels:
+		for(i = 0; i < LZS_PIPELINE_SLOTS; ++i)
+		{
+			lzs_kernel_free(self->pixels[i]);
+		}
+	fail_window:
+		lzs_tracker_delete(&self->tracker);
+	fail_tracker:
+		free(self);
+	return NULL;
+}
+
+void lzs_pipeline_delete(lzs_pipeline_t** _self)
+{
+	assert(_self);
+
+	lzs_pipeline_t* self = *_self;
+	if(self)
+	{
+		LOGD("debug");
+
+		self->running = 0;
+		__sync_synchronize();
+		sem_post(&self->sem);
+		pthread_join(self->thread, NULL);
+		pthread_cond_destroy(&self->idle_cond);
+		pthread_mutex_destroy(&self->idle_mutex);
+		pthread_mutex_destroy(&self->pose_mutex);
+		sem_destroy(&self->sem);
+		lzs_kernel_free(self->plane);
+		lzs_trackerset_delete(&self->set);
+		lzs_reacquire_delete(&self->reacquire);
+		lzs_kernel_free(self->half);
+		lzs_kernel_free(self->frame);
+
+		int i;
+		for(i = 0; i < LZS_PIPELINE_SLOTS; ++i)
+		{
+			lzs_kernel_free(self->pixels[i]);
+		}
+		lzs_tracker_delete(&self->tracker);
+		free(self);
+		*_self = NULL;
+	}
+}
+
+lzs_crop_t* lzs_pipeline_capture(lzs_pipeline_t* self, const lzs_result_t* result, double t)
+{
+	assert(self);
+	assert(result);
+	LOGD("debug t=%lf", t);
+
+	// claim the ring until lzs_pipeline_submit unless the
+	// camera plane has replaced glReadPixels
+	if(__sync_bool_compare_and_swap(&self->producer,
+	                                LZS_PIPELINE_PRODUCER_NONE,
+	                                LZS_PIPELINE_PRODUCER_GL) == 0)
+	{
+		return NULL;
+	}
+
+	__sync_fetch_and_add(&self->captured, 1);
+
+	// drop the frame when the worker falls behind
+	unsigned int head = self->head;
+	__sync_synchronize();
+	if(head - self->tail >= LZS_PIPELINE_DEPTH)
+	{
+		__sync_fetch_and_add(&self->dropped, 1);
+		goto fail_capture;
+	}
+
+	// the scheduler skips every other crop of the window
+	lzs_search_t search;
+	int pending = (lzs_pipeline_readsearch(self, &search) != self->searched);
+	int full    = result->lost && (pending == 0) && (self->reacquiring == 0);
+	if((full == 0) && (pending == 0) && lzs_budget_skip(&self->budget))
+	{
+		goto fail_capture;
+	}
+
+	const lzs_config_t* config = &self->tracker->config;
+	lzs_crop_t*         crop   = &self->slots[head%LZS_PIPELINE_SLOTS];
+	crop->t       = t;
+	crop->format  = LZS_CROP_BGRA;
+	crop->scale_x = 1.0f;
+	crop->scale_y = 1.0f;
+	crop->pixels  = self->pixels[head%LZS_PIPELINE_SLOTS];
+	crop->chroma  = NULL;
+	if(full)
+	{
+		// glReadPixels rows start at SCREEN_H - y - 1 - h/2
+		self->reacquiring = 1;
+		crop->pixels      = self->frame;
+		crop->x           = 0.5f*config->screen_w;
+		crop->y           = 0.5f*config->screen_h - 1.0f;
+		crop->w           = (int) config->screen_w;
+		crop->h           = (int) config->screen_h;
+	}
+	else if(pending)
+	{
+		crop->x = search.x;
+		crop->y = search.y;
+		crop->w = 2*self->tracker->radius;
+		crop->h = 2*self->tracker->radius;
+	}
+	else
+	{
+		crop->x = result->roi_x;
+		crop->y = result->roi_y;
+		crop->w = 2*result->roi_radius;
+		crop->h = 2*result->roi_radius;
+	}
+
+	// glReadPixels packs the rows
+	crop->stride = 4*crop->w;
+
+	// success
+	return crop;
+
+	// failure
+	fail_capture:
+		__sync_synchronize();
+		self->producer = LZS_PIPELINE_PRODUCER_NONE;
+	return NULL;
+}
+
+void lzs_pipeline_submit(lzs_pipeline_t* self)
+{
+	assert(self);
+	LOGD("debug");
+
+	// publish the slot after the pixels are written and
+	// release the ring claimed by lzs_pipeline_capture
+	__sync_synchronize();
+	self->head = self->head + 1;
+	__sync_bool_compare_and_swap(&self->producer,
+	                             LZS_PIPELINE_PRODUCER_GL,
+	                             LZS_PIPELINE_PRODUCER_NONE);
+	sem_post(&self->sem);
+}
+
+void lzs_pipeline_luma(lzs_pipeline_t* self, const unsigned char* luma,
+                       const unsigned char* chroma,
+                       int w, int h, int stride, double t)
+{
+	assert(self);
+	assert(luma);
+	LOGD("debug w=%i, h=%i, stride=%i, t=%lf", w, h, stride, t);
+
+	if((w > LZS_PIPELINE_LUMA_W) || (h > LZS_PIPELINE_LUMA_H) ||
+	   (w < 3) || (h < 3))
+	{
+		LOGE("invalid w=%i, h=%i", w, h);
+		return;
+	}
+
+	// the camera plane replaces glReadPixels for good once
+	// the render thread has released the ring
+	if((self->producer != LZS_PIPELINE_PRODUCER_LUMA) &&
+	   (__sync_bool_compare_and_swap(&self->producer,
+	                                 LZS_PIPELINE_PRODUCER_NONE,
+	                                 LZS_PIPELINE_PRODUCER_LUMA) == 0))
+	{
+		__sync_fetch_and_add(&self->dropped, 1);
+		return;
+	}
+	__sync_fetch_and_add(&self->captured, 1);
+
+	// drop the frame when the worker falls behind
+	unsigned int head = self->head;
+	__sync_synchronize();
+	if(head - self->tail >= LZS_PIPELINE_DEPTH)
+	{
+		__sync_fetch_and_add(&self->dropped, 1);
+		return;
+	}
+
+	// the scheduler skips every other crop of the window
+	lzs_result_t result;
+	lzs_pipeline_result(self, &result);
+	lzs_search_t search;
+	int pending = (lzs_pipeline_readsearch(self, &search) != self->searched);
+	int full    = result.lost && (pending == 0) && (self->reacquiring == 0);
+	if((full == 0) && (pending == 0) && lzs_budget_skip(&self->budget))
+	{
+		return;
+	}
+
+	// the preview is stretched to fill the screen
+	const lzs_config_t* config = &self->tracker->config;
+	int                 slot   = (int) (head%LZS_PIPELINE_SLOTS);
+	lzs_crop_t*         crop   = &self->slots[slot];
+	lzs_lumaslot_t*     lslot  = &self->luma_slots[slot];
+	crop->t       = t;
+	crop->format  = LZS_CROP_LUMA;
+	crop->scale_x = config->screen_w/((float) w);
+	crop->scale_y = config->screen_h/((float) h);
+	lslot->w      = w;
+	lslot->h      = h;
+	lslot->half   = 0;
+	lslot->plane  = 0;
+
+	int x0;
+	int y0;
+	int cw;
+	int ch;
+	if(full)
+	{
+		// search the whole plane for the lost ball
+		self->reacquiring = 1;
+		x0            = 0;
+		y0            = 0;
+		cw            = w;
+		ch            = h;
+		crop->x       = 0.5f*config->screen_w;
+		crop->y       = 0.5f*config->screen_h;
+		crop->stride  = w;
+		crop->pixels  = self->frame;
+	}
+	else
+	{
+		float roi_x      = result.roi_x;
+		float roi_y      = result.roi_y;
+		int   roi_radius = result.roi_radius;
+		if(pending)
+		{
+			roi_x      = search.x;
+			roi_y      = search.y;
+			roi_radius = self->tracker->radius;
+		}
+
+		// map the roi to the preview and limit the crop to the
+		// plane and the search window where the radius is
+		// fixed after lzs_pipeline_new
+		int size = 2*self->tracker->radius;
+		int wmax = (size > w) ? w : size;
+		cw = (int) (2.0f*((float) roi_radius)/crop->scale_x) & ~1;
+		ch = (int) (2.0f*((float) roi_radius)/crop->scale_y) & ~1;
+		cw = (cw > wmax) ? wmax : cw;
+		ch = (ch > size) ? size : ch;
+		ch = (ch > h) ? h : ch;
+
+		// the half crop is aligned to its 2x2 blocks of VU
+		// and the full crop is widened so the rows of the
+		// search level have a fixed width in the kernel
+		int half   = (self->budget.vision.level >= LZS_BUDGET_HALF);
+		int align  = half ? 3 : 1;
+		int levels = self->tracker->levels;
+		if(half)
+		{
+			cw &= ~3;
+			ch &= ~3;
+		}
+		else
+		{
+			int fw = lzs_kernel_fixedwidth(cw >> levels, wmax >> levels);
+			cw = (fw == (cw >> levels)) ? cw : (fw << levels);
+		}
+
+		x0 = (int) (roi_x/crop->scale_x) - cw/2;
+		y0 = (int) (roi_y/crop->scale_y) - ch/2;
+		x0 = (x0 < 0) ? 0 : x0;
+		y0 = (y0 < 0) ? 0 : y0;
+		x0 = (x0 + cw > w) ? w - cw : x0;
+		y0 = (y0 + ch > h) ? h - ch : y0;
+
+		// the VU pairs are shared by 2x2 blocks
+		if(chroma || half)
+		{
+			x0 &= ~align;
+			y0 &= ~align;
+		}
+
+		// the slots have a constant pitch so the gate may
+		// compare the crops
+		crop->x      = crop->scale_x*((float) (x0 + cw/2));
+		crop->y      = crop->scale_y*((float) (y0 + ch/2));
+		crop->stride = LZS_KERNEL_PITCH(size);
+		crop->pixels = self->pixels[slot];
+		lslot->half  = half;
+	}
+	crop->w   = cw;
+	crop->h   = ch;
+	lslot->x0 = x0;
+	lslot->y0 = y0;
+
+	// the caller may reuse the plane once it returns
+	lzs_pipeline_copyluma(luma, chroma, stride, x0, y0, cw, ch,
+	                      crop->pixels, crop->stride);
+	crop->chroma = chroma ? &crop->pixels[ch*crop->stride] : NULL;
+
+	// the set searches the whole Y plane for its balls and
+	// skips the frames which arrive while it is busy
+	if(self->nadds && (self->planing == 0))
+	{
+		self->planing = 1;
+		lzs_pipeline_copyluma(luma, NULL, stride, 0, 0, w, h,
+		                      self->plane, w);
+		lslot->plane = 1;
+	}
+	lzs_pipeline_submit(self);
+}
+
+void lzs_pipeline_flush(lzs_pipeline_t* self)
+{
+	assert(self);
+	LOGD("debug");
+
+	pthread_mutex_lock(&self->idle_mutex);
+	while(self->tail != self->head)
+	{
+		pthread_cond_wait(&self->idle_cond, &self->idle_mutex);
+	}
+	pthread_mutex_unlock(&self->idle_mutex);
+	__sync_synchronize();
+}
+
+void lzs_pipeline_gyro(lzs_pipeline_t* self, float x, float y, float z)
+{
+	assert(self);
+	LOGD("debug x=%f, y=%f, z=%f", x, y, z);
+
+	// the worker only needs the latest rate
+	self->gyro = sqrtf(x*x + y*y + z*z);
+}
+
+void lzs_pipeline_budget(lzs_pipeline_t* self, unsigned int ns)
+{
+	assert(self);
+	LOGD("debug ns=%u", ns);
+
+	// the worker reads the budget with the next frame
+	self->budget.budget = ns;
+}
+
+void lzs_pipeline_result(lzs_pipeline_t* self, lzs_result_t* result)
+{
+	assert(self);
+	assert(result);
+	LOGD("debug");
+
+	unsigned int seq0;
+	unsigned int seq1;
+	do
+	{
+		seq0 = self->seq;
+		__sync_synchronize();
+		*result = self->result;
+		__sync_synchronize();
+		seq1 = self->seq;
+	} while((seq0 != seq1) || (seq0 & 1));
+}
+
+void lzs_pipeline_balls(lzs_pipeline_t* self, lzs_balls_t* balls)
+{
+	assert(self);
+	assert(balls);
+	LOGD("debug");
+
+	unsigned int seq0;
+	unsigned int seq1;
+	do
+	{
+		seq0 = self->balls_seq;
+		__sync_synchronize();
+		*balls = self->balls;
+		__sync_synchronize();
+		seq1 = self->balls_seq;
+	} while((seq0 != seq1) || (seq0 & 1));
+}
+
+int lzs_pipeline_depth(lzs_pipeline_t* self)
+{
+	assert(self);
+	LOGD("debug");
+
+	unsigned int head = self->head;
+	__sync_synchronize();
+	return (int) (head - self->tail);
+}
+
+void lzs_pipeline_searchsphero(lzs_pipeline_t* self, float x, float y)
+{
+	assert(self);
+	LOGD("debug x=%f, y=%f", x, y);
+
+	// the worker applies the search before the next crop
+	// the radius is fixed after lzs_pipeline_new
+	lzs_tracker_t* tracker = self->tracker;
+	lzs_tracker_limitposition(&tracker->config, (float) tracker->radius, &x, &y);
+	++self->search_seq;
+	__sync_synchronize();
+	self->search.x = x;
+	self->search.y = y;
+	self->search.t = a3d_utime();
+	__sync_synchronize();
+	++self->search_seq;
+}
+
+int lzs_pipeline_addsphero(lzs_pipeline_t* self, float x, float y)
+{
+	assert(self);
+	LOGD("debug x=%f, y=%f", x, y);
+
+	// the UI thread is the only writer and the worker adds
+	// the ball before the next plane
+	int n = self->nadds;
+	if(n >= LZS_PIPELINE_BALLS)
+	{
+		LOGE("invalid nadds=%i", n);
+		return -1;
+	}
+
+	self->adds[n].x = x;
+	self->adds[n].y = y;
+	self->adds[n].t = a3d_utime();
+	__sync_synchronize();
+	self->nadds = n + 1;
+
+	// the ball of the tracker is number zero
+	return n + 1;
+}
+
+void lzs_pipeline_calibratesphero(lzs_pipeline_t* self)
+{
+	assert(self);
+	LOGD("debug");
+
+	// the worker calibrates with the pose of the next crop
+	lzs_pipeline_beginpose(self);
+	++self->pose.calibrate;
+	lzs_pipeline_endpose(self);
+}
+
+void lzs_pipeline_spheroorientation(lzs_pipeline_t* self, float pitch, float roll, float yaw)
+{
+	assert(self);
+	LOGD("debug pitch=%f, roll=%f, yaw=%f", pitch, roll, yaw);
+
+	// see lzs_tracker_spheroorientation
+	lzs_pipeline_beginpose(self);
+	self->pose.sphero_heading = -yaw;
+	lzs_pipeline_endpose(self);
+}
+
+void lzs_pipeline_phoneorientation(lzs_pipeline_t* self, float pitch, float roll, float yaw)
+{
+	assert(self);
+	LOGD("debug pitch=%f, roll=%f, yaw=%f", pitch, roll, yaw);
+
+	// see lzs_tracker_phoneorientation
+	lzs_pipeline_beginpose(self);
+	self->pose.phone_heading = yaw;
+	self->pose.phone_slope   = 360.0f - roll;
+	lzs_pipeline_endpose(self);
+}
+
+void lzs_pipeline_phonepose(lzs_pipeline_t* self, float heading, float slope, float height)
+{
+	assert(self);
+	LOGD("debug heading=%f, slope=%f, height=%f", heading, slope, height);
+
+	lzs_pipeline_beginpose(self);
+	self->pose.phone_heading = heading;
+	self->pose.phone_slope   = slope;
+	self->pose.phone_height  = height;
+	lzs_pipeline_endpose(self);
+}
+
+void lzs_pipeline_record(lzs_pipeline_t* self, lzs_recorder_t* recorder)
+{
+	assert(self);
+	LOGD("debug");
+
+	// the recorder must outlive the pipeline or be detached
+	// while the worker is idle
+	__sync_synchronize();
+	self->recorder = recorder;
+}
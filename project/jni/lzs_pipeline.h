@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef lzs_pipeline_H
+#define lzs_pipeline_H
+
+#include <pthread.h>
+#include <semaphore.h>
+#include "lzs_tracker.h"
+#include "lzs_trackerset.h"
+#include "lzs_reacquire.h"
+#include "lzs_timing.h"
+#include "lzs_recorder.h"
+#include "lzs_gate.h"
+#include "lzs_budget.h"
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+// at most LZS_PIPELINE_DEPTH crops may be queued so that
+// frames are dropped rather than queued when the worker
+// falls behind and the slot being written is never queued
+// so the ring only needs LZS_PIPELINE_DEPTH slots
+#define LZS_PIPELINE_SLOTS 2
+#define LZS_PIPELINE_DEPTH 2
+
+// the ring has one producer at a time where the render
+// thread claims the ring from lzs_pipeline_capture until
+// lzs_pipeline_submit and the camera plane claims it for
+// good with its first lzs_pipeline_luma
+#define LZS_PIPELINE_PRODUCER_NONE 0
+#define LZS_PIPELINE_PRODUCER_GL   1
+#define LZS_PIPELINE_PRODUCER_LUMA 2
+
+// largest camera preview accepted by lzs_pipeline_luma
+#define LZS_PIPELINE_LUMA_W 1280
+#define LZS_PIPELINE_LUMA_H 720
+#define LZS_PIPELINE_LUMA_SIZE (LZS_PIPELINE_LUMA_W*LZS_PIPELINE_LUMA_H + \
+                                LZS_PIPELINE_LUMA_W*LZS_PIPELINE_LUMA_H/2)
+
+// the balls added with lzs_pipeline_addsphero are tracked
+// by a tracker set on a copy of the Y plane of the camera
+// preview (see lzs_trackerset.h) and are numbered from one
+// after the ball of the tracker
+#define LZS_PIPELINE_BALLS LZS_TRACKERSET_MAX
+
+// the camera crop is halved into a buffer of the largest
+// window with room for its VU plane
+#define LZS_PIPELINE_HALF       (LZS_CROP_MAX/2)
+#define LZS_PIPELINE_HALF_PITCH LZS_KERNEL_PITCH(LZS_PIPELINE_HALF)
+
+// tracker output published by the worker
+typedef struct
+{
+	// see lzs_tracker_t
+	float sphero_x;
+	float sphero_y;
+	float sphero_X;
+	float sphero_Y;
+	float sphero_speed;
+	float sphero_heading;
+	float sphero_heading_offset;
+	float sphero_goal;
+	float phone_heading;
+	float phone_slope;
+	float phone_X;
+	float phone_Y;
+	lzs_peak_t peak;
+
+	// ground velocity (ft/s) of the motion model which is
+	// zero until the model is initialized
+	float sphero_vX;
+	float sphero_vY;
+
+	// search window for the next crop
+	float roi_x;
+	float roi_y;
+	int   roi_radius;
+
+	// the next crop is the full frame while lost and
+	// reacquire_ms is the latency of the last reacquisition
+	int          lost;
+	unsigned int reacquired;
+	float        reacquire_ms;
+
+	// capture and completion times of the crop in usec
+	double t_capture;
+	double t_done;
+
+	// queue depth when the crop was dequeued
+	int depth;
+} lzs_result_t;
+
+// output of a ball of the tracker set published by the
+// worker after each plane
+typedef struct
+{
+	float sphero_x;
+	float sphero_y;
+	float sphero_speed;
+	float sphero_goal;
+	float roi_x;
+	float roi_y;
+	int   roi_radius;
+	int   lost;
+} lzs_ball_t;
+
+typedef struct
+{
+	// count of balls and planes processed by the set
+	int          count;
+	unsigned int planes;
+	lzs_ball_t   ball[LZS_PIPELINE_BALLS];
+} lzs_balls_t;
+
+// phone and sphero pose in the units of lzs_tracker_t which
+// the render and UI threads write and the worker applies to
+// the tracker before each crop where calibrate counts the
+// lzs_pipeline_calibratesphero requests
+typedef struct
+{
+	float        phone_heading;
+	float        phone_slope;
+	float        phone_height;
+	float        sphero_heading;
+	unsigned int calibrate;
+} lzs_pose_t;
+
+// lzs_pipeline_searchsphero request in screen coordinates
+// where t is the time of the request in usec
+typedef struct
+{
+	float  x;
+	float  y;
+	double t;
+} lzs_search_t;
+
+// the LUMA crop of a slot was copied from the origin x0, y0
+// of a camera plane of w x h pixels and aligned for
+// lzs_pipeline_half when half is set
+typedef struct
+{
+	int x0;
+	int y0;
+	int w;
+	int h;
+	int half;
+	int plane;
+} lzs_lumaslot_t;
+
+typedef struct
+{
+	lzs_tracker_t* tracker;
+
+	// worker thread
+	pthread_t thread;
+	sem_t     sem;
+	int       running;
+
+	// single-producer/single-consumer ring where head (and
+	// the budget) are only written by the thread that holds
+	// producer and tail is only written by the worker
+	lzs_crop_t            slots[LZS_PIPELINE_SLOTS];
+	unsigned char*        pixels[LZS_PIPELINE_SLOTS];
+	volatile unsigned int head;
+	volatile unsigned int tail;
+	volatile int          producer;
+
+	// lzs_pipeline_flush waits on idle for the worker to
+	// release the queued slots
+	pthread_mutex_t idle_mutex;
+	pthread_cond_t  idle_cond;
+
+	// at most one full frame is queued for reacquisition
+	lzs_reacquire_t* reacquire;
+	unsigned char*   frame;
+	volatile int     reacquiring;
+	unsigned int     reacquired;
+	float            reacquire_ms;
+
+	// lzs_pipeline_luma copies the window of the camera
+	// preview into the ring (or the whole plane into frame
+	// while the ball is lost) and the render thread stops
+	// capturing once it holds the producer where the
+	// optional VU plane is copied for the color detector
+	//
+	// luma_w, luma_h are the plane of the last crop that was
+	// compared by the gate
+	lzs_lumaslot_t luma_slots[LZS_PIPELINE_SLOTS];
+	int            luma_w;
+	int            luma_h;
+
+	// the detector is skipped while the crop and the gyro
+	// rate (rad/s) show no motion
+	lzs_gate_t     gate;
+	volatile float gyro;
+
+	// the Y plane is copied to plane with the crop of a slot
+	// (and luma_slots[slot].plane is set) when the set has
+	// balls and the last plane was processed where adds are
+	// the lzs_pipeline_addsphero requests in screen
+	// coordinates which the UI thread publishes by nadds
+	lzs_trackerset_t*     set;
+	unsigned char*        plane;
+	volatile int          planing;
+	lzs_search_t          adds[LZS_PIPELINE_BALLS];
+	volatile int          nadds;
+
+	// balls is protected by a sequence lock where balls_seq
+	// is odd while the worker is writing
+	volatile unsigned int balls_seq;
+	lzs_balls_t           balls;
+
+	// the frame time scheduler lowers the level when the
+	// frames miss the budget (see lzs_budget.h)
+	lzs_budget_t   budget;
+	unsigned char* half;
+
+	// pose is protected by a sequence lock where pose_seq is
+	// odd while a writer holds pose_mutex and calibrated is
+	// the last calibrate request applied by the worker
+	pthread_mutex_t       pose_mutex;
+	volatile unsigned int pose_seq;
+	lzs_pose_t            pose;
+	unsigned int          calibrated;
+
+	// search is protected by a sequence lock where the UI
+	// thread is the only writer and search_seq is odd while
+	// it writes and advances by two per request so that a
+	// request is pending until the worker sets searched to
+	// its sequence and searched_t is the time of the last
+	// request applied by the worker
+	volatile unsigned int search_seq;
+	lzs_search_t          search;
+	volatile unsigned int searched;
+	double                searched_t;
+
+	// result is protected by a sequence lock where seq is
+	// odd while the worker is writing
+	volatile unsigned int seq;
+	lzs_result_t          result;
+
+	// optional session recorder for the crops seen by the
+	// worker and the published results
+	lzs_recorder_t* volatile recorder;
+
+	// metrics where the timing is shared with the render
+	// and control threads which record their own stages
+	lzs_timing_t          timing;
+	volatile unsigned int captured;
+	volatile unsigned int dropped;
+	volatile unsigned int processed;
+} lzs_pipeline_t;
+
+lzs_pipeline_t* lzs_pipeline_new(const lzs_config_t* config, int detector);
+void            lzs_pipeline_delete(lzs_pipeline_t** _self);
+lzs_crop_t*     lzs_pipeline_capture(lzs_pipeline_t* self, const lzs_result_t* result, double t);
+void            lzs_pipeline_submit(lzs_pipeline_t* self);
+void            lzs_pipeline_luma(lzs_pipeline_t* self, const unsigned char* luma,
+                                  const unsigned char* chroma,
+                                  int w, int h, int stride, double t);
+void            lzs_pipeline_flush(lzs_pipeline_t* self);
+void            lzs_pipeline_gyro(lzs_pipeline_t* self, float x, float y, float z);
+void            lzs_pipeline_budget(lzs_pipeline_t* self, unsigned int ns);
+void            lzs_pipeline_result(lzs_pipeline_t* self, lzs_result_t* result);
+void            lzs_pipeline_balls(lzs_pipeline_t* self, lzs_balls_t* balls);
+int             lzs_pipeline_depth(lzs_pipeline_t* self);
+void            lzs_pipeline_searchsphero(lzs_pipeline_t* self, float x, float y);
+int             lzs_pipeline_addsphero(lzs_pipeline_t* self, float x, float y);
+void            lzs_pipeline_calibratesphero(lzs_pipeline_t* self);
+void            lzs_pipeline_spheroorientation(lzs_pipeline_t* self, float pitch, float roll, float yaw);
+void            lzs_pipeline_phoneorientation(lzs_pipeline_t* self, float pitch, float roll, float yaw);
+void            lzs_pipeline_phonepose(lzs_pipeline_t* self, float heading, float slope, float height);
+void            lzs_pipeline_record(lzs_pipeline_t* self, lzs_recorder_t* recorder);
+
+#endif
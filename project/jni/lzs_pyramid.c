@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_pyramid.h"
+#include <stdlib.h>
+#include <assert.h>
+
+#define LOG_TAG "LaserShark"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+// computes the window [x0, x1) x [y0, y1) within refine
+// pixels of cx, cy plus the one pixel border that has no
+// edge response
+static void lzs_pyramid_window(int cx, int cy, int w, int h,
+                               int* x0, int* y0, int* x1, int* y1)
+{
+	assert(x0);
+	assert(y0);
+	assert(x1);
+	assert(y1);
+
+	int r = LZS_PYRAMID_REFINE + 1;
+	*x0 = (cx - r < 0) ? 0 : cx - r;
+	*y0 = (cy - r < 0) ? 0 : cy - r;
+	*x1 = (cx + r + 1 > w) ? w : cx + r + 1;
+	*y1 = (cy + r + 1 > h) ? h : cy + r + 1;
+}
+
+// the crop is BGRA when bpp is 4 and gray when bpp is 1
+static int lzs_pyramid_build(lzs_pyramid_t* self,
+                             const unsigned char* pixels, int stride,
+                             int bpp, int w, int h)
+{
+	assert(self);
+	assert(pixels);
+	LOGD("debug stride=%i, bpp=%i, w=%i, h=%i", stride, bpp, w, h);
+
+	if((w > self->w) || (h > self->h))
+	{
+		LOGE("invalid w=%i, h=%i", w, h);
+		return 0;
+	}
+
+	if(bpp == 4)
+	{
+		lzs_kernel_downsample(pixels, stride, w, h, self->levels,
+		                      self->coarse, self->pitch);
+	}
+	else
+	{
+		lzs_kernel_downsamplegray(pixels, stride, w, h, self->levels,
+		                          self->coarse, self->pitch);
+	}
+	return 1;
+}
+
+// refines the coarse peak p through the finer levels
+static void lzs_pyramid_refinelevels(lzs_pyramid_t* self,
+                                     const unsigned char* pixels, int stride,
+                                     int bpp, int w, int h, lzs_peak_t p,
+                                     lzs_peak_t* peak)
+{
+	assert(self);
+	assert(pixels);
+	assert(peak);
+	LOGD("debug stride=%i, bpp=%i, w=%i, h=%i", stride, bpp, w, h);
+
+	peak->x   = 0;
+	peak->y   = 0;
+	peak->mag = 0;
+
+	if(p.mag == 0)
+	{
+		return;
+	}
+
+	// refine the finer levels
+	int        levels = self->levels;
+	int        pitch  = LZS_KERNEL_PITCH(LZS_PYRAMID_WINDOW);
+	int        x0;
+	int        y0;
+	int        x1;
+	int        y1;
+	lzs_peak_t q;
+	int        l;
+	for(l = levels - 1; l >= 1; --l)
+	{
+		lzs_pyramid_window(2*p.x, 2*p.y, w >> l, h >> l,
+		                   &x0, &y0, &x1, &y1);
+		const unsigned char* src = &pixels[(y0 << l)*stride + bpp*(x0 << l)];
+		if(bpp == 4)
+		{
+			lzs_kernel_downsample(src, stride, (x1 - x0) << l,
+			                      (y1 - y0) << l, l, self->window, pitch);
+		}
+		else
+		{
+			lzs_kernel_downsamplegray(src, stride, (x1 - x0) << l,
+			                          (y1 - y0) << l, l, self->window, pitch);
+		}
+		lzs_kernel_peakgray(self->window, pitch, x1 - x0, y1 - y0,
+		                    self->scratch, &q);
+		p.x   = (q.mag > 0) ? x0 + q.x : 2*p.x;
+		p.y   = (q.mag > 0) ? y0 + q.y : 2*p.y;
+		p.mag = q.mag;
+	}
+
+	lzs_pyramid_window(2*p.x, 2*p.y, w, h, &x0, &y0, &x1, &y1);
+	if(bpp == 4)
+	{
+		lzs_kernel_peak(&pixels[y0*stride + 4*x0], stride,
+		                x1 - x0, y1 - y0, self->scratch, &q);
+	}
+	else
+	{
+		lzs_kernel_peakgray(&pixels[y0*stride + x0], stride,
+		                    x1 - x0, y1 - y0, self->scratch, &q);
+	}
+	if(q.mag > 0)
+	{
+		peak->x   = x0 + q.x;
+		peak->y   = y0 + q.y;
+		peak->mag = q.mag;
+	}
+	else
+	{
+		peak->x   = 2*p.x;
+		peak->y   = 2*p.y;
+		peak->mag = 0;
+	}
+}
+
+static void lzs_pyramid_search(lzs_pyramid_t* self,
+                               const unsigned char* pixels, int stride,
+                               int bpp, int w, int h, lzs_peak_t* peak)
+{
+	assert(self);
+	assert(pixels);
+	assert(peak);
+	LOGD("debug stride=%i, bpp=%i, w=%i, h=%i", stride, bpp, w, h);
+
+	peak->x   = 0;
+	peak->y   = 0;
+	peak->mag = 0;
+
+	// search the coarse level
+	lzs_peak_t p;
+	if(lzs_pyramid_build(self, pixels, stride, bpp, w, h) == 0)
+	{
+		return;
+	}
+	lzs_kernel_peakgray(self->coarse, self->pitch,
+	                    w >> self->levels, h >> self->levels,
+	                    self->scratch, &p);
+	lzs_pyramid_refinelevels(self, pixels, stride, bpp, w, h, p, peak);
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+lzs_pyramid_t* lzs_pyramid_new(int w, int h, int levels)
+{
+	LOGD("debug w=%i, h=%i, levels=%i", w, h, levels);
+
+	if((levels < 1) || (levels > LZS_PYRAMID_LEVELS))
+	{
+		LOGE("invalid levels=%i", levels);
+		return NULL;
+	}
+
+	lzs_pyramid_t* self = (lzs_pyramid_t*) malloc(sizeof(lzs_pyramid_t));
+	if(self == NULL)
+	{
+		LOGE("malloc failed");
+		return NULL;
+	}
+
+	self->w      = w;
+	self->h      = h;
+	self->levels = levels;
+	self->pitch  = LZS_KERNEL_PITCH(w >> levels);
+
+	self->coarse = (unsigned char*) lzs_kernel_malloc(self->pitch*(h >> levels));
+	if(self->coarse == NULL)
+	{
+		goto fail_coarse;
+	}
+
+	self->window = (unsigned char*) lzs_kernel_malloc(LZS_KERNEL_PITCH(LZS_PYRAMID_WINDOW)*
+	                                                  LZS_PYRAMID_WINDOW);
+	if(self->window == NULL)
+	{
+		goto fail_window;
+	}
+
+	// the scratch is shared by the coarse level and the
+	// refine windows
+	int sw = w >> levels;
+	if(sw < LZS_PYRAMID_WINDOW)
+	{
+		sw = LZS_PYRAMID_WINDOW;
+	}
+	self->scratch = (unsigned char*) lzs_kernel_malloc(LZS_KERNEL_SCRATCH(sw));
+	if(self->scratch == NULL)
+	{
+		goto fail_scratch;
+	}
+
+	// success
+	return self;
+
+	// failure
+	fail_scratch:
+		lzs_kernel_free(self->window);
+	fail_window:
+		lzs_kernel_free(self->coarse);
+	fail_coarse:
+		free(self);
+	return NULL;
+}
+
+void lzs_pyramid_delete(lzs_pyramid_t** _self)
+{
+	assert(_self);
+
+	lzs_pyramid_t* self = *_self;
+	if(self)
+	{
+		LOGD("debug");
+		lzs_kernel_free(self->scratch);
+		lzs_kernel_free(self->window);
+		lzs_kernel_free(self->coarse);
+		free(self);
+		*_self = NULL;
+	}
+}
+
+void lzs_pyramid_peak(lzs_pyramid_t* self,
+                      const unsigned char* bgra, int stride,
+                      int w, int h, lzs_peak_t* peak)
+{
+	assert(self);
+	assert(bgra);
+	assert(peak);
+	LOGD("debug stride=%i, w=%i, h=%i", stride, w, h);
+
+	lzs_pyramid_search(self, bgra, stride, 4, w, h, peak);
+}
+
+void lzs_pyramid_peakgray(lzs_pyramid_t* self,
+                          const unsigned char* gray, int stride,
+                          int w, int h, lzs_peak_t* peak)
+{
+	assert(self);
+	assert(gray);
+	assert(peak);
+	LOGD("debug stride=%i, w=%i, h=%i", stride, w, h);
+
+	lzs_pyramid_search(self, gray, stride, 1, w, h, peak);
+}
+
+int lzs_pyramid_coarsegray(lzs_pyramid_t* self,
+                           const unsigned char* gray, int stride,
+                           int w, int h)
+{
+	assert(self);
+	assert(gray);
+	LOGD("debug stride=%i, w=%i, h=%i", stride, w, h);
+
+	return lzs_pyramid_build(self, gray, stride, 1, w, h);
+}
+
+void lzs_pyramid_refinegray(lzs_pyramid_t* self,
+                            const unsigned char* gray, int stride,
+                            int w, int h, const lzs_peak_t* coarse,
+                            lzs_peak_t* peak)
+{
+	assert(self);
+	assert(gray);
+	assert(coarse);
+	assert(peak);
+	LOGD("debug stride=%i, w=%i, h=%i", stride, w, h);
+
+	lzs_pyramid_refinelevels(self, gray, stride, 1, w, h, *coarse, peak);
+}
+
+int lzs_pyramid_coarse(lzs_pyramid_t* self,
+                       const unsigned char* bgra, int stride,
+                       int w, int h)
+{
+	assert(self);
+	assert(bgra);
+	LOGD("debug stride=%i, w=%i, h=%i", stride, w, h);
+
+	return lzs_pyramid_build(self, bgra, stride, 4, w, h);
+}
+
+void lzs_pyramid_refine(lzs_pyramid_t* self,
+                        const unsigned char* bgra, int stride,
+                        int w, int h, const lzs_peak_t* coarse,
+                        lzs_peak_t* peak)
+{
+	assert(self);
+	assert(bgra);
+	assert(coarse);
+	assert(peak);
+	LOGD("debug stride=%i, w=%i, h=%i", stride, w, h);
+
+	lzs_pyramid_refinelevels(self, bgra, stride, 4, w, h, *coarse, peak);
+}
+
+int lzs_pyramid_candidates(lzs_pyramid_t* self, int w, int h,
+                           lzs_peak_t* peaks, int max)
+{
+	assert(self);
+	assert(peaks);
+	LOGD("debug w=%i, h=%i, max=%i", w, h, max);
+
+	return lzs_kernel_peaksgray(self->coarse, self->pitch,
+	                            w >> self->levels, h >> self->levels,
+	                            self->scratch, peaks, max);
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef lzs_pyramid_H
+#define lzs_pyramid_H
+
+#include "lzs_kernel.h"
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+// coarse-to-fine peak search
+//
+// the peak is found over the whole crop downsampled by
+// 2^levels and then each finer level (ending with the BGRA
+// crop) is only built and searched within LZS_PYRAMID_REFINE
+// pixels of the upsampled peak so the cost is mostly the
+// coarse level
+#define LZS_PYRAMID_LEVELS 3
+#define LZS_PYRAMID_REFINE 8
+#define LZS_PYRAMID_WINDOW (2*LZS_PYRAMID_REFINE + 3)
+
+typedef struct
+{
+	// maximum size of the crop
+	int w;
+	int h;
+	int levels;
+
+	// coarse level and refine window
+	int            pitch;
+	unsigned char* coarse;
+	unsigned char* window;
+	unsigned char* scratch;
+} lzs_pyramid_t;
+
+lzs_pyramid_t* lzs_pyramid_new(int w, int h, int levels);
+void           lzs_pyramid_delete(lzs_pyramid_t** _self);
+void           lzs_pyramid_peak(lzs_pyramid_t* self,
+                                const unsigned char* bgra, int stride,
+                                int w, int h, lzs_peak_t* peak);
+void           lzs_pyramid_peakgray(lzs_pyramid_t* self,
+                                    const unsigned char* gray, int stride,
+                                    int w, int h, lzs_peak_t* peak);
+
+// lzs_pyramid_peakgray split at the coarse level so that the
+// coarse search may be replaced where coarsegray leaves the
+// (w >> levels) x (h >> levels) level in coarse and returns
+// 0 if the crop is too large
+int            lzs_pyramid_coarsegray(lzs_pyramid_t* self,
+                                      const unsigned char* gray, int stride,
+                                      int w, int h);
+void           lzs_pyramid_refinegray(lzs_pyramid_t* self,
+                                      const unsigned char* gray, int stride,
+                                      int w, int h, const lzs_peak_t* coarse,
+                                      lzs_peak_t* peak);
+
+// the same split for a BGRA crop
+int            lzs_pyramid_coarse(lzs_pyramid_t* self,
+                                  const unsigned char* bgra, int stride,
+                                  int w, int h);
+void           lzs_pyramid_refine(lzs_pyramid_t* self,
+                                  const unsigned char* bgra, int stride,
+                                  int w, int h, const lzs_peak_t* coarse,
+                                  lzs_peak_t* peak);
+
+// lzs_pyramid_candidates ranks up to max local maxima of the
+// coarse level left by coarse or coarsegray (see
+// lzs_kernel_peaks) where w and h are the size of the crop
+int            lzs_pyramid_candidates(lzs_pyramid_t* self, int w, int h,
+                                      lzs_peak_t* peaks, int max);
+
+#endif
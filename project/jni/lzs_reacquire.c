@@ -0,0 +1,362 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_reacquire.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+
+#define LOG_TAG "LaserShark"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+static void lzs_reacquire_strip(lzs_reacquire_t* self, int id, int strip)
+{
+	assert(self);
+	LOGD("debug id=%i, strip=%i", id, strip);
+
+	// include the neighboring rows so that every row of the
+	// strip has an edge response
+	int h  = self->h;
+	int y0 = strip*h/LZS_REACQUIRE_STRIPS;
+	int y1 = (strip + 1)*h/LZS_REACQUIRE_STRIPS;
+	int r0 = (y0 > 0) ? y0 - 1 : 0;
+	int r1 = (y1 < h) ? y1 + 1 : h;
+
+	lzs_peak_t* peak = &self->peaks[strip];
+	if(r1 - r0 < 3)
+	{
+		peak->x   = 0;
+		peak->y   = 0;
+		peak->mag = 0;
+		return;
+	}
+
+	const unsigned char* src     = &self->pixels[r0*self->stride];
+	unsigned char*       scratch = self->workers[id].scratch;
+	if(self->bpp == 4)
+	{
+		lzs_kernel_peak(src, self->stride, self->w, r1 - r0, scratch, peak);
+	}
+	else
+	{
+		lzs_kernel_peakgray(src, self->stride, self->w, r1 - r0, scratch, peak);
+	}
+	peak->y += r0;
+}
+
+static void lzs_reacquire_run(lzs_reacquire_t* self, int id)
+{
+	assert(self);
+	LOGD("debug id=%i", id);
+
+	// drain our own range and then steal from the others
+	int n = self->nthreads;
+	int k;
+	for(k = 0; k < n; ++k)
+	{
+		lzs_reacquireworker_t* victim = &self->workers[(id + k)%n];
+		while(1)
+		{
+			int strip = __sync_fetch_and_add(&victim->next, 1);
+			if(strip >= victim->end)
+			{
+				break;
+			}
+			lzs_reacquire_strip(self, id, strip);
+		}
+	}
+}
+
+static void* lzs_reacquire_thread(void* arg)
+{
+	assert(arg);
+	LOGD("debug");
+
+	lzs_reacquire_t* self = (lzs_reacquire_t*) arg;
+	while(1)
+	{
+		sem_wait(&self->start);
+		if(self->running == 0)
+		{
+			break;
+		}
+
+		// any helper may take any id for this search
+		int id = __sync_add_and_fetch(&self->ids, 1);
+		lzs_reacquire_run(self, id);
+		sem_post(&self->done);
+	}
+	return NULL;
+}
+
+// the frame is BGRA when bpp is 4 and gray when bpp is 1
+static int lzs_reacquire_find(lzs_reacquire_t* self,
+                              const unsigned char* pixels, int stride,
+                              int bpp, int w, int h, float radius,
+                              lzs_peak_t* candidates, int max)
+{
+	assert(self);
+	assert(pixels);
+	assert(candidates);
+	LOGD("debug stride=%i, bpp=%i, w=%i, h=%i", stride, bpp, w, h);
+
+	if(w > self->maxw)
+	{
+		LOGE("invalid w=%i", w);
+		return 0;
+	}
+
+	self->pixels = pixels;
+	self->stride = stride;
+	self->bpp    = bpp;
+	self->w      = w;
+	self->h      = h;
+	self->ids    = 0;
+
+	// deal out contiguous ranges of strips
+	int n = self->nthreads;
+	int i;
+	for(i = 0; i < n; ++i)
+	{
+		self->workers[i].next = i*LZS_REACQUIRE_STRIPS/n;
+		self->workers[i].end  = (i + 1)*LZS_REACQUIRE_STRIPS/n;
+	}
+	__sync_synchronize();
+
+	for(i = 1; i < n; ++i)
+	{
+		sem_post(&self->start);
+	}
+	lzs_reacquire_run(self, 0);
+	for(i = 1; i < n; ++i)
+	{
+		sem_wait(&self->done);
+	}
+	__sync_synchronize();
+
+	// sort the strip peaks strongest first where equal peaks
+	// keep the row-major order
+	lzs_peak_t sorted[LZS_REACQUIRE_STRIPS];
+	int        nsorted = 0;
+	int        j;
+	for(i = 0; i < LZS_REACQUIRE_STRIPS; ++i)
+	{
+		lzs_peak_t p = self->peaks[i];
+		if(p.mag == 0)
+		{
+			continue;
+		}
+
+		j = nsorted++;
+		while((j > 0) && (sorted[j - 1].mag < p.mag))
+		{
+			sorted[j] = sorted[j - 1];
+			--j;
+		}
+		sorted[j] = p;
+	}
+
+	// a peak within radius of a stronger candidate is the
+	// same ball split across strips
+	int count = 0;
+	for(i = 0; (i < nsorted) && (count < max); ++i)
+	{
+		lzs_peak_t* p = &sorted[i];
+		for(j = 0; j < count; ++j)
+		{
+			float dx = (float) (p->x - candidates[j].x);
+			float dy = (float) (p->y - candidates[j].y);
+			if(dx*dx + dy*dy < radius*radius)
+			{
+				break;
+			}
+		}
+		if(j == count)
+		{
+			candidates[count++] = *p;
+		}
+	}
+
+	return count;
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+lzs_reacquire_t* lzs_reacquire_new(int maxw, int nthreads)
+{
+	LOGD("debug maxw=%i, nthreads=%i", maxw, nthreads);
+
+	// use every core by default
+	if(nthreads <= 0)
+	{
+		nthreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	if(nthreads < 1)
+	{
+		nthreads = 1;
+	}
+	else if(nthreads > LZS_REACQUIRE_THREADS)
+	{
+		nthreads = LZS_REACQUIRE_THREADS;
+	}
+
+	lzs_reacquire_t* self = (lzs_reacquire_t*) malloc(sizeof(lzs_reacquire_t));
+	if(self == NULL)
+	{
+		LOGE("malloc failed");
+		return NULL;
+	}
+	memset(self, 0, sizeof(lzs_reacquire_t));
+	self->nthreads = nthreads;
+	self->maxw     = maxw;
+
+	int i;
+	for(i = 0; i < nthreads; ++i)
+	{
+		self->workers[i].scratch = (unsigned char*) lzs_kernel_malloc(LZS_KERNEL_SCRATCH(maxw));
+		if(self->workers[i].scratch == NULL)
+		{
+			goto fail_scratch;
+		}
+	}
+
+	if(sem_init(&self->start, 0, 0) != 0)
+	{
+		LOGE("sem_init failed");
+		goto fail_start;
+	}
+
+	if(sem_init(&self->done, 0, 0) != 0)
+	{
+		LOGE("sem_init failed");
+		goto fail_done;
+	}
+
+	// worker 0 is the caller
+	self->running = 1;
+	int started;
+	for(started = 1; started < nthreads; ++started)
+	{
+		if(pthread_create(&self->workers[started].thread, NULL,
+		                  lzs_reacquire_thread, (void*) self) != 0)
+		{
+			LOGE("pthread_create failed");
+			goto fail_thread;
+		}
+	}
+
+	// success
+	return self;
+
+	// failure
+	fail_thread:
+		self->running = 0;
+		__sync_synchronize();
+		for(i = 1; i < started; ++i)
+		{
+			sem_post(&self->start);
+		}
+		for(i = 1; i < started; ++i)
+		{
+			pthread_join(self->workers[i].thread, NULL);
+		}
+		sem_destroy(&self->done);
+	fail_done:
+		sem_destroy(&self->start);
+	fail_start:
+	fail_scratch:
+		for(i = 0; i < nthreads; ++i)
+		{
+			lzs_kernel_free(self->workers[i].scratch);
+		}
+		free(self);
+	return NULL;
+}
+
+void lzs_reacquire_delete(lzs_reacquire_t** _self)
+{
+	assert(_self);
+
+	lzs_reacquire_t* self = *_self;
+	if(self)
+	{
+		LOGD("debug");
+
+		self->running = 0;
+		__sync_synchronize();
+
+		int i;
+		for(i = 1; i < self->nthreads; ++i)
+		{
+			sem_post(&self->start);
+		}
+		for(i = 1; i < self->nthreads; ++i)
+		{
+			pthread_join(self->workers[i].thread, NULL);
+		}
+		sem_destroy(&self->done);
+		sem_destroy(&self->start);
+
+		for(i = 0; i < self->nthreads; ++i)
+		{
+			lzs_kernel_free(self->workers[i].scratch);
+		}
+		free(self);
+		*_self = NULL;
+	}
+}
+
+int lzs_reacquire_search(lzs_reacquire_t* self,
+                         const unsigned char* bgra, int stride,
+                         int w, int h, float radius,
+                         lzs_peak_t* candidates, int max)
+{
+	assert(self);
+	assert(bgra);
+	assert(candidates);
+	LOGD("debug stride=%i, w=%i, h=%i", stride, w, h);
+
+	return lzs_reacquire_find(self, bgra, stride, 4, w, h,
+	                          radius, candidates, max);
+}
+
+int lzs_reacquire_searchgray(lzs_reacquire_t* self,
+                             const unsigned char* gray, int stride,
+                             int w, int h, float radius,
+                             lzs_peak_t* candidates, int max)
+{
+	assert(self);
+	assert(gray);
+	assert(candidates);
+	LOGD("debug stride=%i, w=%i, h=%i", stride, w, h);
+
+	return lzs_reacquire_find(self, gray, stride, 1, w, h,
+	                          radius, candidates, max);
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef lzs_reacquire_H
+#define lzs_reacquire_H
+
+#include <pthread.h>
+#include <semaphore.h>
+#include "lzs_kernel.h"
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+// full frame search used to find the ball after the track
+// is lost
+//
+// the frame is split into horizontal strips which are dealt
+// out to the threads in contiguous ranges and a thread that
+// finishes its range steals strips from the others so a
+// slow core does not delay the result
+#define LZS_REACQUIRE_THREADS 4
+#define LZS_REACQUIRE_STRIPS  16
+
+typedef struct
+{
+	// strips [next, end) where next is shared with thieves
+	volatile int next;
+	int          end;
+
+	pthread_t      thread;
+	unsigned char* scratch;
+} lzs_reacquireworker_t;
+
+typedef struct
+{
+	// worker 0 is the caller
+	int                   nthreads;
+	lzs_reacquireworker_t workers[LZS_REACQUIRE_THREADS];
+	sem_t                 start;
+	sem_t                 done;
+	volatile int          running;
+	volatile int          ids;
+	int                   maxw;
+
+	// current search where bpp is 4 for BGRA or 1 for gray
+	const unsigned char* pixels;
+	int                  stride;
+	int                  bpp;
+	int                  w;
+	int                  h;
+	lzs_peak_t           peaks[LZS_REACQUIRE_STRIPS];
+} lzs_reacquire_t;
+
+lzs_reacquire_t* lzs_reacquire_new(int maxw, int nthreads);
+void             lzs_reacquire_delete(lzs_reacquire_t** _self);
+int              lzs_reacquire_search(lzs_reacquire_t* self,
+                                      const unsigned char* bgra, int stride,
+                                      int w, int h, float radius,
+                                      lzs_peak_t* candidates, int max);
+int              lzs_reacquire_searchgray(lzs_reacquire_t* self,
+                                          const unsigned char* gray, int stride,
+                                          int w, int h, float radius,
+                                          lzs_peak_t* candidates, int max);
+
+#endif
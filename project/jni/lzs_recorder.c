@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_recorder.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "a3d/a3d_time.h"
+
+#define LOG_TAG "LaserShark"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+// copies n bytes to the ring at the free running offset pos
+static void lzs_recorder_copy(lzs_recorder_t* self, unsigned int pos,
+                              const void* src, unsigned int n)
+{
+	assert(self);
+	assert(src);
+
+	unsigned int i     = pos & (self->capacity - 1);
+	unsigned int first = self->capacity - i;
+	if(first >= n)
+	{
+		memcpy(&self->buffer[i], src, n);
+	}
+	else
+	{
+		memcpy(&self->buffer[i], src, first);
+		memcpy(self->buffer, ((const unsigned char*) src) + first, n - first);
+	}
+}
+
+// reserves size bytes for a record and returns the offset of
+// the payload or 0 with the mutex released if the ring is
+// full
+static int lzs_recorder_begin(lzs_recorder_t* self, int type, double t,
+                              unsigned int size, unsigned int* pos)
+{
+	assert(self);
+	assert(pos);
+
+	lzs_recordheader_t header =
+	{
+		.type = (unsigned int) type,
+		.size = (size + 7) & ~7,
+		.t    = t,
+	};
+
+	pthread_mutex_lock(&self->mutex);
+	unsigned int used = self->head - self->tail;
+	if(used + sizeof(header) + header.size > self->capacity)
+	{
+		++self->dropped;
+		pthread_mutex_unlock(&self->mutex);
+		return 0;
+	}
+
+	lzs_recorder_copy(self, self->head, &header, sizeof(header));
+	*pos = self->head + sizeof(header);
+	return 1;
+}
+
+static void lzs_recorder_end(lzs_recorder_t* self, unsigned int size)
+{
+	assert(self);
+
+	// clear the padding
+	const unsigned char zero[8] = { 0 };
+	unsigned int        pad     = ((size + 7) & ~7) - size;
+	unsigned int        pos     = self->head + sizeof(lzs_recordheader_t) + size;
+	if(pad)
+	{
+		lzs_recorder_copy(self, pos, zero, pad);
+	}
+
+	self->head += sizeof(lzs_recordheader_t) + size + pad;
+	++self->records;
+	pthread_cond_signal(&self->cond);
+	pthread_mutex_unlock(&self->mutex);
+}
+
+static void* lzs_recorder_thread(void* arg)
+{
+	assert(arg);
+	LOGD("debug");
+
+	lzs_recorder_t* self = (lzs_recorder_t*) arg;
+	pthread_mutex_lock(&self->mutex);
+	while(1)
+	{
+		unsigned int tail = self->tail;
+		unsigned int head = self->head;
+		if(tail == head)
+		{
+			if(self->running == 0)
+			{
+				break;
+			}
+			pthread_cond_wait(&self->cond, &self->mutex);
+			continue;
+		}
+
+		// write outside of the lock since producers only
+		// append after head
+		pthread_mutex_unlock(&self->mutex);
+		unsigned int i     = tail & (self->capacity - 1);
+		unsigned int n     = head - tail;
+		unsigned int first = self->capacity - i;
+		if(first > n)
+		{
+			first = n;
+		}
+		if((fwrite(&self->buffer[i], first, 1, self->f) != 1) ||
+		   ((n > first) &&
+		    (fwrite(self->buffer, n - first, 1, self->f) != 1)))
+		{
+			LOGE("fwrite failed");
+		}
+		pthread_mutex_lock(&self->mutex);
+		self->tail = head;
+	}
+	pthread_mutex_unlock(&self->mutex);
+
+	return NULL;
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+lzs_recorder_t* lzs_recorder_new(const char* fname, int capacity)
+{
+	assert(fname);
+	LOGD("debug fname=%s, capacity=%i", fname, capacity);
+
+	// the capacity must be a power of two
+	if((capacity < 1024) || (capacity & (capacity - 1)))
+	{
+		LOGE("invalid capacity=%i", capacity);
+		return NULL;
+	}
+
+	lzs_recorder_t* self = (lzs_recorder_t*) malloc(sizeof(lzs_recorder_t));
+	if(self == NULL)
+	{
+		LOGE("malloc failed");
+		return NULL;
+	}
+
+	self->capacity = (unsigned int) capacity;
+	self->head     = 0;
+	self->tail     = 0;
+	self->records  = 0;
+	self->dropped  = 0;
+
+	self->buffer = (unsigned char*) malloc(capacity);
+	if(self->buffer == NULL)
+	{
+		LOGE("malloc failed");
+		goto fail_buffer;
+	}
+
+	self->f = fopen(fname, "w");
+	if(self->f == NULL)
+	{
+		LOGE("fopen %s failed", fname);
+		goto fail_fopen;
+	}
+
+	lzs_recordfile_t header =
+	{
+		.magic       = LZS_RECORD_MAGIC,
+		.version     = LZS_RECORD_VERSION,
+		.header_size = sizeof(lzs_recordheader_t),
+		.reserved    = 0,
+	};
+	if(fwrite(&header, sizeof(header), 1, self->f) != 1)
+	{
+		LOGE("fwrite %s failed", fname);
+		goto fail_header;
+	}
+
+	if(pthread_mutex_init(&self->mutex, NULL) != 0)
+	{
+		LOGE("pthread_mutex_init failed");
+		goto fail_mutex;
+	}
+
+	if(pthread_cond_init(&self->cond, NULL) != 0)
+	{
+		LOGE("pthread_cond_init failed");
+		goto fail_cond;
+	}
+
+	self->running = 1;
+	if(pthread_create(&self->thread, NULL, lzs_recorder_thread, (void*) self) != 0)
+	{
+		LOGE("pthread_create failed");
+		goto fail_thread;
+	}
+
+	// success
+	return self;
+
+	// failure
+	fail_thread:
+		pthread_cond_destroy(&self->cond);
+	fail_cond:
+		pthread_mutex_destroy(&self->mutex);
+	fail_mutex:
+	fail_header:
+		fclose(self->f);
+	fail_fopen:
+		free(self->buffer);
+	fail_buffer:
+		free(self);
+	return NULL;
+}
+
+void lzs_recorder_delete(lzs_recorder_t** _self)
+{
+	assert(_self);
+
+	lzs_recorder_t* self = *_self;
+	if(self)
+	{
+		LOGD("debug");
+
+		// the writer drains the ring before it exits
+		pthread_mutex_lock(&self->mutex);
+		self->running = 0;
+		pthread_cond_signal(&self->cond);
+		pthread_mutex_unlock(&self->mutex);
+		pthread_join(self->thread, NULL);
+
+		LOGI("records=%u, dropped=%u", self->records, self->dropped);
+		pthread_cond_destroy(&self->cond);
+		pthread_mutex_destroy(&self->mutex);
+		fclose(self->f);
+		free(self->buffer);
+		free(self);
+		*_self = NULL;
+	}
+}
+
+int lzs_recorder_crop(lzs_recorder_t* self, const lzs_crop_t* crop,
+                      const lzs_tracker_t* tracker, int full)
+{
+	assert(self);
+	assert(crop);
+	assert(tracker);
+	LOGD("debug w=%i, h=%i, full=%i", crop->w, crop->h, full);
+
+	int bpp = (crop->format == LZS_CROP_LUMA) ? 1 : 4;
+	lzs_recordcrop_t rc =
+	{
+		.x                     = crop->x,
+		.y                     = crop->y,
+		.w                     = crop->w,
+		.h                     = crop->h,
+		.format                = crop->format,
+		.full                  = full,
+		.scale_x               = crop->scale_x,
+		.scale_y               = crop->scale_y,
+		.sphero_heading        = tracker->sphero_heading,
+		.sphero_heading_offset = tracker->sphero_heading_offset,
+		.phone_heading         = tracker->phone_heading,
+		.phone_slope           = tracker->phone_slope,
+		.phone_height          = tracker->phone_height,
+	};
+	memset(rc.reserved, 0, sizeof(rc.reserved));
+
+	unsigned int row  = (unsigned int) (bpp*crop->w);
+	unsigned int size = sizeof(rc) + row*((unsigned int) crop->h);
+	unsigned int pos;
+	if(lzs_recorder_begin(self, LZS_RECORD_CROP, crop->t, size, &pos) == 0)
+	{
+		return 0;
+	}
+
+	// the rows are packed
+	lzs_recorder_copy(self, pos, &rc, sizeof(rc));
+	pos += sizeof(rc);
+	int y;
+	for(y = 0; y < crop->h; ++y)
+	{
+		lzs_recorder_copy(self, pos, &crop->pixels[y*crop->stride], row);
+		pos += row;
+	}
+
+	lzs_recorder_end(self, size);
+	return 1;
+}
+
+int lzs_recorder_result(lzs_recorder_t* self, double t,
+                        const void* result, int size)
+{
+	assert(self);
+	assert(result);
+	LOGD("debug t=%lf, size=%i", t, size);
+
+	unsigned int pos;
+	if(lzs_recorder_begin(self, LZS_RECORD_RESULT, t, size, &pos) == 0)
+	{
+		return 0;
+	}
+	lzs_recorder_copy(self, pos, result, size);
+	lzs_recorder_end(self, size);
+	return 1;
+}
+
+int lzs_recorder_sensor(lzs_recorder_t* self, const lzs_sensor_t* sensor)
+{
+	assert(self);
+	assert(sensor);
+	LOGD("debug type=%i", sensor->type);
+
+	unsigned int pos;
+	if(lzs_recorder_begin(self, LZS_RECORD_SENSOR, A3D_USEC*sensor->t,
+	                      sizeof(lzs_sensor_t), &pos) == 0)
+	{
+		return 0;
+	}
+	lzs_recorder_copy(self, pos, sensor, sizeof(lzs_sensor_t));
+	lzs_recorder_end(self, sizeof(lzs_sensor_t));
+	return 1;
+}
+
+int lzs_recorder_search(lzs_recorder_t* self, double t, float x, float y)
+{
+	assert(self);
+	LOGD("debug t=%lf, x=%f, y=%f", t, x, y);
+
+	float        xy[2] = { x, y };
+	unsigned int pos;
+	if(lzs_recorder_begin(self, LZS_RECORD_SEARCH, t, sizeof(xy), &pos) == 0)
+	{
+		return 0;
+	}
+	lzs_recorder_copy(self, pos, xy, sizeof(xy));
+	lzs_recorder_end(self, sizeof(xy));
+	return 1;
+}
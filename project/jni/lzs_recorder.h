@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef lzs_recorder_H
+#define lzs_recorder_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include "lzs_tracker.h"
+#include "lzs_sensors.h"
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+// session recorder for offline replay
+//
+// records are copied into a preallocated ring and appended
+// to the file by a background thread so recording never
+// blocks the tracker and records are dropped when the ring
+// is full
+//
+// the file is a lzs_recordfile_t followed by records where
+// each lzs_recordheader_t is followed by size bytes of
+// payload and size is a multiple of 8 so the file may be
+// mapped and the records read in place (see lzs_session)
+#define LZS_RECORD_MAGIC   0x52535A4C   // "LZSR"
+#define LZS_RECORD_VERSION 1
+
+#define LZS_RECORD_CROP   0   // lzs_recordcrop_t and pixels
+#define LZS_RECORD_RESULT 1   // lzs_result_t
+#define LZS_RECORD_SENSOR 2   // lzs_sensor_t
+#define LZS_RECORD_SEARCH 3   // x, y of lzs_tracker_searchsphero
+
+// default ring size in bytes
+#define LZS_RECORDER_CAPACITY (16*1024*1024)
+
+typedef struct
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int header_size;
+	unsigned int reserved;
+} lzs_recordfile_t;
+
+typedef struct
+{
+	unsigned int type;
+	unsigned int size;
+	double       t;   // usec
+} lzs_recordheader_t;
+
+// the crop and the tracker state when it was detected where
+// full frames are searched for the lost ball and the pixels
+// are h rows of w*bpp bytes
+typedef struct
+{
+	float x;
+	float y;
+	int   w;
+	int   h;
+	int   format;
+	int   full;
+	float scale_x;
+	float scale_y;
+	float sphero_heading;
+	float sphero_heading_offset;
+	float phone_heading;
+	float phone_slope;
+	float phone_height;
+	int   reserved[3];
+} lzs_recordcrop_t;
+
+typedef struct
+{
+	FILE* f;
+
+	// bytes in [tail, head) are waiting to be written where
+	// head and tail are free running
+	unsigned char*  buffer;
+	unsigned int    capacity;
+	unsigned int    head;
+	unsigned int    tail;
+	pthread_mutex_t mutex;
+	pthread_cond_t  cond;
+
+	// writer thread
+	pthread_t thread;
+	int       running;
+
+	// metrics
+	unsigned int records;
+	unsigned int dropped;
+} lzs_recorder_t;
+
+lzs_recorder_t* lzs_recorder_new(const char* fname, int capacity);
+void            lzs_recorder_delete(lzs_recorder_t** _self);
+int             lzs_recorder_crop(lzs_recorder_t* self, const lzs_crop_t* crop,
+                                  const lzs_tracker_t* tracker, int full);
+int             lzs_recorder_result(lzs_recorder_t* self, double t,
+                                    const void* result, int size);
+int             lzs_recorder_sensor(lzs_recorder_t* self, const lzs_sensor_t* sensor);
+int             lzs_recorder_search(lzs_recorder_t* self, double t, float x, float y);
+
+#endif
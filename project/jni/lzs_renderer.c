@@ -36,21 +36,31 @@
 * private                                                  *
 ***********************************************************/
 
-#define SCREEN_W  800.0f
-#define SCREEN_H  480.0f
-#define SCREEN_CX 400.0f
-#define SCREEN_CY 240.0f
+#define RADIUS_CROSS  24.0f
+#define RADIUS_MARKER 8.0f
 
-#define RADIUS_BALL  64.0f
-#define RADIUS_CROSS 24.0f
+// see LZS_DETECTOR_*
+#define DETECTOR LZS_DETECTOR_PEAK
 
-#define SPEED_MIN 0.4f
-#define SPEED_MAX 0.7f
+// rate of the steering commands
+#define CONTROL_HZ LZS_CONTROL_HZ
 
-//#define DEBUG_TIME
-//#define DEBUG_BUFFERS
+// the stage timing is always recorded and may be shown on
+// the HUD while timing.bin is exported every TIMING_EXPORT
+// seconds for pull-data.sh
+#define HUD_TIMING
+#define TIMING_EXPORT 10
+#define TIMING_FNAME  "/sdcard/laser-shark/timing.bin"
 
-static GLfloat BOX[] =
+// records the crops, results and sensors to SESSION_FNAME
+// for lzs_replay
+//#define RECORD_SESSION
+#define SESSION_FNAME "/sdcard/laser-shark/session.lzs"
+
+//#define DEBUG_SENSORS
+
+// unit quad which is scaled to the screen of the config
+static GLfloat VERTEX[] =
 {
 	0.0f, 0.0f, -1.0f,   // 0
 	0.0f, 1.0f, -1.0f,   // 1
@@ -58,14 +68,6 @@ static GLfloat BOX[] =
 	1.0f, 0.0f, -1.0f,   // 3
 };
 
-static GLfloat VERTEX[] =
-{
-	    0.0f,     0.0f, -1.0f,   // 0
-	    0.0f, SCREEN_H, -1.0f,   // 1
-	SCREEN_W, SCREEN_H, -1.0f,   // 2
-	SCREEN_W,     0.0f, -1.0f,   // 3
-};
-
 static GLfloat COORDS[] =
 {
 	0.0f, 0.0f,   // 0
@@ -74,20 +76,25 @@ static GLfloat COORDS[] =
 	1.0f, 0.0f,   // 3
 };
 
-static float fix_angle(float angle)
+#ifdef DEBUG_SENSORS
+static void debug_sensors(char type, float x, float y, float z, float dt)
 {
-	while(angle >= 360.0f)
-	{
-		angle -= 360.0f;
-	}
-	while(angle < 0.0f)
+	LOGD("debug type=%c", type);
+
+	// sensors.txt is replayed with the host lzs_fusionreplay
+	// tool where dt is only used by the gyro
+	static int first = 1;
+	FILE* f = fopen("/sdcard/laser-shark/sensors.txt", first ? "w" : "a");
+	if(f)
 	{
-		angle += 360.0f;
+		fprintf(f, "%c %f %f %f %f\n", type, x, y, z, dt);
+		fclose(f);
 	}
-	return angle;
+	first = 0;
 }
+#endif
 
-static void lzs_renderer_step(lzs_renderer_t* self)
+static void lzs_renderer_step(lzs_renderer_t* self, const lzs_result_t* result)
 {
 	assert(self);
 	LOGD("debug");
@@ -103,10 +110,55 @@ static void lzs_renderer_step(lzs_renderer_t* self)
 		double fps     = (double) self->frames / seconds;
 
 		// LOGI("%i frames in %.2lf seconds = %.2lf FPS", self->frames, seconds, fps);
-		a3d_texstring_printf(self->string_fps, "%i fps", (int) fps);
+		lzs_overlaytext_printf(self->string_fps, "%i fps", (int) fps);
+
+		// pipeline queue depth, frames dropped in the last
+		// second, how stale the displayed result is and the
+		// percentage of crops skipped by the motion gate
+		lzs_pipeline_t* pipeline     = self->pipeline;
+		unsigned int    dropped      = pipeline->dropped;
+		unsigned int    gate_frames  = pipeline->gate.frames;
+		unsigned int    gate_skipped = pipeline->gate.skipped;
+		unsigned int    gate_dframes = gate_frames - self->gate_frames;
+		int             skipped      = (gate_dframes > 0) ?
+		                               (int) (100*(gate_skipped - self->gate_skipped)/gate_dframes) : 0;
+		unsigned int misses = pipeline->budget.vision.misses + pipeline->budget.render.misses;
+		lzs_overlaytext_printf(self->string_pipeline, "depth=%i, dropped=%u, skipped=%i%%, stale=%i ms, reacquired=%u (%i ms), level=%i/%i, misses=%u%s",
+		                     lzs_pipeline_depth(pipeline), dropped - self->dropped, skipped,
+		                     (int) ((t - result->t_capture) / 1000.0),
+		                     result->reacquired, (int) result->reacquire_ms,
+		                     pipeline->budget.vision.level, pipeline->budget.render.level,
+		                     misses - self->budget_misses,
+		                     result->lost ? ", lost" : "");
+
+		// p99 of each stage in ms since the start
+		#ifdef HUD_TIMING
+		{
+			lzs_timingstats_t st[LZS_TIMING_COUNT];
+			int i;
+			for(i = 0; i < LZS_TIMING_COUNT; ++i)
+			{
+				lzs_timing_stats(&pipeline->timing, i, &st[i]);
+			}
+			lzs_overlaytext_printf(self->string_timing, "p99 ms: setup=%0.2f, read=%0.2f, draw=%0.2f, detect=%0.2f, set=%0.2f, steer=%0.3f, latency=%0.1f",
+			                     st[LZS_TIMING_SETUP].p99/1.0e6, st[LZS_TIMING_READPIXELS].p99/1.0e6,
+			                     st[LZS_TIMING_DRAW].p99/1.0e6, st[LZS_TIMING_DETECT].p99/1.0e6,
+			                     st[LZS_TIMING_SET].p99/1.0e6, st[LZS_TIMING_STEER].p99/1.0e6,
+			                     st[LZS_TIMING_LATENCY].p99/1.0e6);
+		}
+		#endif
 
-		self->t0     = t;
-		self->frames = 0;
+		if((++self->seconds % TIMING_EXPORT) == 0)
+		{
+			lzs_timing_export(&pipeline->timing, TIMING_FNAME);
+		}
+
+		self->t0      = t;
+		self->frames  = 0;
+		self->dropped = dropped;
+		self->gate_frames  = gate_frames;
+		self->gate_skipped = gate_skipped;
+		self->budget_misses = misses;
 	}
 }
 
@@ -114,10 +166,11 @@ static void lzs_renderer_step(lzs_renderer_t* self)
 * public                                                   *
 ***********************************************************/
 
-lzs_renderer_t* lzs_renderer_new(const char* font)
+lzs_renderer_t* lzs_renderer_new(const char* font, const char* config)
 {
-	assert(s);
-	LOGD("debug");
+	assert(font);
+	assert(config);
+	LOGD("debug config=%s", config);
 
 	lzs_renderer_t* self = (lzs_renderer_t*) malloc(sizeof(lzs_renderer_t));
 	if(self == NULL)
@@ -126,45 +179,48 @@ lzs_renderer_t* lzs_renderer_new(const char* font)
 		return NULL;
 	}
 
-	self->sphero_x              = 400.0f;
-	self->sphero_y              = 240.0f;
-	self->sphero_X              = 0.0f;
-	self->sphero_Y              = 0.0f;
-	self->sphero_speed          = 0.0f;
-	self->sphero_heading        = 0.0f;
-	self->sphero_heading_offset = 0.0f;
-	self->sphero_goal           = 0.0f;
-	self->phone_heading         = 0.0f;
-	self->phone_slope           = 0.0f;
-	self->phone_height          = 5.0f;
-	self->t0                    = a3d_utime();
-	self->frames                = 0;
-
-	// allocate the buffer(s)
-	GLint bsize         = 2 * ((int) RADIUS_BALL);
-	GLint format        = TEXGZ_BGRA;
-	GLint type          = TEXGZ_UNSIGNED_BYTE;
-	self->buffer_color = texgz_tex_new(bsize, bsize, bsize, bsize, type, format, NULL);
-	if(self->buffer_color == NULL)
-	{
-		goto fail_color;
-	}
-	format = TEXGZ_LUMINANCE;
-	type   = TEXGZ_FLOAT;
-	self->buffer_gray = texgz_tex_new(bsize, bsize, bsize, bsize, type, format, NULL);
-	if(self->buffer_gray == NULL)
+	// the defaults are kept when the config is missing
+	lzs_config_defaults(&self->config);
+	lzs_config_load(&self->config, config);
+
+	self->t0      = a3d_utime();
+	self->frames  = 0;
+	self->dropped = 0;
+	self->seconds = 0;
+	self->gate_frames  = 0;
+	self->gate_skipped = 0;
+	self->budget_misses = 0;
+	self->sensors_overflow = 0;
+	lzs_fusion_reset(&self->fusion);
+
+	int i;
+	for(i = 0; i < LZS_PIPELINE_BALLS; ++i)
 	{
-		goto fail_gray;
+		self->ball_heading[i] = 0.0f;
+		self->ball_speed[i]   = 0.0f;
+		self->ball_taken[i]   = 0;
 	}
-	self->buffer_sx = texgz_tex_new(bsize, bsize, bsize, bsize, type, format, NULL);
-	if(self->buffer_sx == NULL)
+
+	self->pipeline = lzs_pipeline_new(&self->config, DETECTOR);
+	if(self->pipeline == NULL)
 	{
-		goto fail_sx;
+		goto fail_pipeline;
 	}
-	self->buffer_sy = texgz_tex_new(bsize, bsize, bsize, bsize, type, format, NULL);
-	if(self->buffer_sy == NULL)
+
+	// recording is best effort
+	self->recorder = NULL;
+	#ifdef RECORD_SESSION
+		self->recorder = lzs_recorder_new(SESSION_FNAME, LZS_RECORDER_CAPACITY);
+		if(self->recorder)
+		{
+			lzs_pipeline_record(self->pipeline, self->recorder);
+		}
+	#endif
+
+	self->control = lzs_control_new(self->pipeline, CONTROL_HZ);
+	if(self->control == NULL)
 	{
-		goto fail_sy;
+		goto fail_control;
 	}
 
 	// create the font
@@ -175,21 +231,37 @@ lzs_renderer_t* lzs_renderer_new(const char* font)
 	}
 
 	// create the string(s)
-	self->string_sphero = a3d_texstring_new(self->font, 64, 24, A3D_TEXSTRING_TOP_CENTER, 1.0f, 1.0f, 0.235f, 1.0f);
+	self->string_sphero = lzs_overlaytext_new(self->font, 64, 24, A3D_TEXSTRING_TOP_CENTER, 1.0f, 1.0f, 0.235f, 1.0f);
 	if(self->string_sphero == NULL)
 	{
 		goto fail_string_sphero;
 	}
-	self->string_phone = a3d_texstring_new(self->font, 64, 24, A3D_TEXSTRING_TOP_CENTER, 1.0f, 1.0f, 0.235f, 1.0f);
+	self->string_phone = lzs_overlaytext_new(self->font, 80, 24, A3D_TEXSTRING_TOP_CENTER, 1.0f, 1.0f, 0.235f, 1.0f);
 	if(self->string_phone == NULL)
 	{
 		goto fail_string_phone;
 	}
-	self->string_fps = a3d_texstring_new(self->font, 16, 24, A3D_TEXSTRING_BOTTOM_RIGHT, 1.0f, 1.0f, 0.235f, 1.0f);
+	self->string_fps = lzs_overlaytext_new(self->font, 16, 24, A3D_TEXSTRING_BOTTOM_RIGHT, 1.0f, 1.0f, 0.235f, 1.0f);
 	if(self->string_fps == NULL)
 	{
 		goto fail_string_fps;
 	}
+	self->string_pipeline = lzs_overlaytext_new(self->font, 80, 24, A3D_TEXSTRING_BOTTOM_RIGHT, 1.0f, 1.0f, 0.235f, 1.0f);
+	if(self->string_pipeline == NULL)
+	{
+		goto fail_string_pipeline;
+	}
+	self->string_timing = lzs_overlaytext_new(self->font, 96, 24, A3D_TEXSTRING_BOTTOM_RIGHT, 1.0f, 1.0f, 0.235f, 1.0f);
+	if(self->string_timing == NULL)
+	{
+		goto fail_string_timing;
+	}
+
+	self->overlay = lzs_overlay_new();
+	if(self->overlay == NULL)
+	{
+		goto fail_overlay;
+	}
 
 	glGenTextures(1, &self->texid);
 	glEnableClientState(GL_VERTEX_ARRAY);
@@ -200,21 +272,24 @@ lzs_renderer_t* lzs_renderer_new(const char* font)
 	return self;
 
 	// failure
+	fail_overlay:
+		lzs_overlaytext_delete(&self->string_timing);
+	fail_string_timing:
+		lzs_overlaytext_delete(&self->string_pipeline);
+	fail_string_pipeline:
+		lzs_overlaytext_delete(&self->string_fps);
 	fail_string_fps:
-		a3d_texstring_delete(&self->string_phone);
+		lzs_overlaytext_delete(&self->string_phone);
 	fail_string_phone:
-		a3d_texstring_delete(&self->string_sphero);
+		lzs_overlaytext_delete(&self->string_sphero);
 	fail_string_sphero:
 		a3d_texfont_delete(&self->font);
 	fail_font:
-		texgz_tex_delete(&self->buffer_sy);
-	fail_sy:
-		texgz_tex_delete(&self->buffer_sx);
-	fail_sx:
-		texgz_tex_delete(&self->buffer_gray);
-	fail_gray:
-		texgz_tex_delete(&self->buffer_color);
-	fail_color:
+		lzs_control_delete(&self->control);
+	fail_control:
+		lzs_pipeline_delete(&self->pipeline);
+		lzs_recorder_delete(&self->recorder);
+	fail_pipeline:
 		free(self);
 	return NULL;
 }
@@ -227,14 +302,17 @@ void lzs_renderer_delete(lzs_renderer_t** _self)
 	if(self)
 	{
 		LOGD("debug");
-		a3d_texstring_delete(&self->string_fps);
-		a3d_texstring_delete(&self->string_phone);
-		a3d_texstring_delete(&self->string_sphero);
+		lzs_timing_export(&self->pipeline->timing, TIMING_FNAME);
+		lzs_overlay_delete(&self->overlay);
+		lzs_overlaytext_delete(&self->string_timing);
+		lzs_overlaytext_delete(&self->string_pipeline);
+		lzs_overlaytext_delete(&self->string_fps);
+		lzs_overlaytext_delete(&self->string_phone);
+		lzs_overlaytext_delete(&self->string_sphero);
 		a3d_texfont_delete(&self->font);
-		texgz_tex_delete(&self->buffer_sy);
-		texgz_tex_delete(&self->buffer_sx);
-		texgz_tex_delete(&self->buffer_gray);
-		texgz_tex_delete(&self->buffer_color);
+		lzs_control_delete(&self->control);
+		lzs_pipeline_delete(&self->pipeline);
+		lzs_recorder_delete(&self->recorder);
 		glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0);
 		glDeleteTextures(1, &self->texid);
 		free(self);
@@ -250,114 +328,38 @@ void lzs_renderer_resize(lzs_renderer_t* self, int w, int h)
 	glViewport(0, 0, w, h);
 }
 
-void lzs_renderer_drawbox(float top, float left, float bottom, float right, float r, float g, float b, int filled)
-{
-	LOGD("top=%f, left=%f, bottom=%f, right=%f, r=%f, g=%f, b=%f", top, left, bottom, right, r, g, b);
-
-	BOX[0]  = left;
-	BOX[1]  = top;
-	BOX[3]  = left;
-	BOX[4]  = bottom;
-	BOX[6]  = right;
-	BOX[7]  = bottom;
-	BOX[9]  = right;
-	BOX[10] = top;
-
-	glColor4f(r, g, b, 1.0f);
-	glVertexPointer(3, GL_FLOAT, 0, BOX);
-	if(filled)
-	{
-		glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-	}
-	else
-	{
-		glDrawArrays(GL_LINE_LOOP, 0, 4);
-	}
-	glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
-}
-
-void lzs_renderer_crosshair(float top, float left, float bottom, float right, float r, float g, float b)
-{
-	LOGD("top=%f, left=%f, bottom=%f, right=%f, r=%f, g=%f, b=%f", top, left, bottom, right, r, g, b);
-
-	BOX[0]  = left + (right - left) / 2.0f;
-	BOX[1]  = top;
-	BOX[3]  = left + (right - left) / 2.0f;
-	BOX[4]  = bottom;
-	BOX[6]  = left;
-	BOX[7]  = top + (bottom - top) / 2.0f;
-	BOX[9]  = right;
-	BOX[10] = top + (bottom - top) / 2.0f;
-
-	glColor4f(r, g, b, 1.0f);
-	glVertexPointer(3, GL_FLOAT, 0, BOX);
-	glDrawArrays(GL_LINES, 0, 4);
-	glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
-}
-
-void limit_position(float r, float* x, float* y)
-{
-	// limit search region to screen
-	if(*x - r < 0.0f)
-	{
-		*x = r;
-	}
-	if(*x + r >= SCREEN_W)
-	{
-		*x = SCREEN_W - r - 1;
-	}
-	if(*y - r < 0.0f)
-	{
-		*y = r;
-	}
-	if(*y + r >= SCREEN_H)
-	{
-		*y = SCREEN_H - r - 1;
-	}
-}
-
-static void utime_update(const char* name, double* _t0)
-{
-	double t1 = a3d_utime();
-	#ifdef DEBUG_TIME
-	LOGI("%s dt=%lf", name, t1 - *_t0);
-	#endif
-	*_t0 = t1;
-}
-
-static void compute_position(lzs_renderer_t* self, float x, float y, float* X, float* Y)
-{
-	assert(self);
-
-	float h      = self->phone_height;
-	float ph     = self->phone_heading * M_PI / 180.0f;
-	float ps     = self->phone_slope   * M_PI / 180.0f;
-	float scalew = 27.7f * M_PI / 180.0f;
-	float scaleh = 19.0f * M_PI / 180.0f;
-	float aph    = ph + scalew * (x - SCREEN_CX) / SCREEN_CX;
-	float aps    = ps - scaleh * (y - SCREEN_CY) / SCREEN_CY;
-	float aphyp  = h * tanf(aps);     // hypotenuse
-	float apX    = aphyp * sinf(aph);  // X
-	float apY    = aphyp * cosf(aph);  // Y
-	*X           = apX;
-	*Y           = apY;
-
-	LOGD("x=%f, y=%f, apX=%f, apY=%f", x, y, apX, apY);
-}
-
 void lzs_renderer_draw(lzs_renderer_t* self)
 {
 	assert(self);
 	LOGD("debug");
 
-	double t0 = a3d_utime();
+	lzs_timing_t* timing  = &self->pipeline->timing;
+	unsigned int  t0      = lzs_timing_now();
+	unsigned int  t_frame = t0;
 
-	// stretch screen to 800x480
+	// virtual screen
+	float screen_w  = self->config.screen_w;
+	float screen_h  = self->config.screen_h;
+	float screen_cx = 0.5f*screen_w;
+	float screen_cy = 0.5f*screen_h;
+
+	// the fused phone orientation is sampled once per frame
+	lzs_orientation_t orientation;
+	lzs_fusion_orientation(&self->fusion, &orientation);
+	if(orientation.valid)
+	{
+		lzs_pipeline_phoneorientation(self->pipeline, orientation.pitch,
+		                              orientation.roll, orientation.heading);
+	}
+
+	// stretch screen to the virtual screen
 	glMatrixMode(GL_PROJECTION);
 	glLoadIdentity();
-	glOrthof(0.0f, SCREEN_W, SCREEN_H, 0.0f, 0.0f, 2.0f);
+	glOrthof(0.0f, screen_w, screen_h, 0.0f, 0.0f, 2.0f);
 	glMatrixMode(GL_MODELVIEW);
 	glLoadIdentity();
+	glPushMatrix();
+	glScalef(screen_w, screen_h, 1.0f);
 
 	// draw camera
 	glEnable(GL_TEXTURE_EXTERNAL_OES);
@@ -368,9 +370,14 @@ void lzs_renderer_draw(lzs_renderer_t* self)
 	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
 	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 	glDisable(GL_TEXTURE_EXTERNAL_OES);
-	utime_update("setup", &t0);
+	glPopMatrix();
+	t0 = lzs_timing_mark(timing, LZS_TIMING_SETUP, t0);
 
 	// capture buffers
+	// the worker thread processes the crop and the latest
+	// result positions the next crop and the HUD
+	lzs_result_t result;
+	lzs_pipeline_result(self->pipeline, &result);
 	GLint format = TEXGZ_BGRA;
 	GLint type   = GL_UNSIGNED_BYTE;
 	glGetIntegerv(GL_IMPLEMENTATION_COLOR_READ_FORMAT_OES, &format);
@@ -379,61 +386,13 @@ void lzs_renderer_draw(lzs_renderer_t* self)
 	{
 		LOGD("readpixels format=0x%X, type=0x%X", format, type);
 
-		// TODO - check for texgz errors
-
-		// process buffers
-		texgz_tex_t* bc  = self->buffer_color;
-		texgz_tex_t* bg  = self->buffer_gray;
-		texgz_tex_t* bsx = self->buffer_sx;
-		texgz_tex_t* bsy = self->buffer_sy;
-		glReadPixels(self->sphero_x - RADIUS_BALL, (SCREEN_H - self->sphero_y - 1) - RADIUS_BALL,
-		             bc->width, bc->height, bc->format, bc->type, (void*) bc->pixels);
-		#ifdef DEBUG_BUFFERS
-			texgz_tex_export(bc, "/sdcard/laser-shark/color.texgz");
-		#endif
-		utime_update("readpixels", &t0);
-
-		texgz_tex_computegray(bc, bg);
-		utime_update("computegray", &t0);
-
-		texgz_tex_computeedges3x3(bg, bsx, bsy);
-		utime_update("computeedges", &t0);
-
-		// compute peak
+		lzs_crop_t* crop = lzs_pipeline_capture(self->pipeline, &result, a3d_utime());
+		if(crop)
 		{
-			int    x;
-			int    y;
-			int    peak_x  = 0;
-			int    peak_y  = 0;
-			float  peak    = 0.0f;
-			float* gpixels = (float*) bg->pixels;
-			float* xpixels = (float*) bsx->pixels;
-			float* ypixels = (float*) bsy->pixels;
-			for(x = 0; x < bg->width; ++x)
-			{
-				for(y = 0; y < bg->height; ++y)
-				{
-					int idx      = bg->width*y + x;
-					// compute magnitude squared
-					float magsq = xpixels[idx]*xpixels[idx] + ypixels[idx]*ypixels[idx];
-					gpixels[idx] = magsq;
-					if(magsq > peak)
-					{
-						peak_x = x;
-						peak_y = y;
-						peak   = magsq;
-					}
-				}
-			}
-			LOGD("peak=%f, peak_x=%i, peak_y=%i", peak, peak_x, peak_y);
-			utime_update("computepeak", &t0);
-			#ifdef DEBUG_BUFFERS
-				texgz_tex_export(bg, "/sdcard/laser-shark/peak.texgz");
-			#endif
-
-			// move sphero center to match peak
-			self->sphero_x += (float) peak_x - (float) bg->width / 2.0f;
-			self->sphero_y -= (float) peak_y - (float) bg->height / 2.0f;
+			glReadPixels((int) (crop->x - crop->w / 2), (int) ((screen_h - crop->y - 1) - crop->h / 2),
+			             crop->w, crop->h, format, type, (void*) crop->pixels);
+			lzs_pipeline_submit(self->pipeline);
+			t0 = lzs_timing_mark(timing, LZS_TIMING_READPIXELS, t0);
 		}
 	}
 	else
@@ -441,61 +400,88 @@ void lzs_renderer_draw(lzs_renderer_t* self)
 		LOGE("unsupported format=0x%X, type=0x%X", format, type);
 	}
 
-	// compute phone X, Y center
-	compute_position(self, SCREEN_CX, SCREEN_CY, &self->phone_X, &self->phone_Y);
+	// the overlay is collected and drawn in one batch
+	lzs_overlay_t* overlay = self->overlay;
+	lzs_overlay_begin(overlay);
 
-	// compute sphero X, Y
-	compute_position(self, self->sphero_x, self->sphero_y, &self->sphero_X, &self->sphero_Y);
-	utime_update("computeposition", &t0);
-
-	// compute goal
-	float dx           = self->phone_X - self->sphero_X;
-	float dy           = self->phone_Y - self->sphero_Y;
-	float a            = fix_angle(atan2f(dx, dy) * 180.0f / M_PI);
-	self->sphero_goal  = a - self->sphero_heading_offset;
-
-	// compute speed
-	float dotp = cosf((a - self->sphero_heading) * M_PI / 180.0f);
-	if(dotp > 0.0f)
+	// camera cross-hair
 	{
-		// linearly interpolate speed based on the turning angle
-		self->sphero_speed = SPEED_MAX*dotp + SPEED_MIN*(1.0f - dotp);
-	}
-	else
-	{
-		// go slow to turn around
-		self->sphero_speed = SPEED_MIN;
+		float x = screen_cx;
+		float y = screen_cy;
+		float r = RADIUS_CROSS;
+		lzs_tracker_limitposition(&self->config, r, &x, &y);
+		lzs_overlay_color(overlay, 1.0f, 0.0f, 0.0f, 1.0f);
+		lzs_overlay_crosshair(overlay, y - r, x - r, y + r, x + r);
 	}
 
-	// draw camera cross-hair
+	// sphero search box which turns red while lost and the
+	// path from the ball to the predicted search window
 	{
-		float x = SCREEN_CX;
-		float y = SCREEN_CY;
-		float r = RADIUS_CROSS;
-		limit_position(r, &x, &y);
-		lzs_renderer_crosshair(y - r, x - r, y + r, x + r, 1.0f, 0.0f, 0.0f);
+		float r = (float) result.roi_radius;
+		float x = result.roi_x;
+		float y = result.roi_y;
+		if(result.lost)
+		{
+			lzs_overlay_color(overlay, 1.0f, 0.0f, 0.0f, 1.0f);
+			lzs_overlay_box(overlay, y - r, x - r, y + r, x + r);
+		}
+		else
+		{
+			lzs_overlay_color(overlay, 0.0f, 1.0f, 0.0f, 1.0f);
+			lzs_overlay_box(overlay, y - r, x - r, y + r, x + r);
+			lzs_overlay_color(overlay, 1.0f, 1.0f, 0.235f, 1.0f);
+			lzs_overlay_marker(overlay, result.sphero_x, result.sphero_y, RADIUS_MARKER);
+			lzs_overlay_line(overlay, result.sphero_x, result.sphero_y, x, y);
+		}
 	}
 
-	// draw sphero search box
+	// the balls of the set are drawn in cyan
 	{
-		float r = RADIUS_BALL;
-		limit_position(r, &self->sphero_x, &self->sphero_y);
-		float x = self->sphero_x;
-		float y = self->sphero_y;
-		lzs_renderer_drawbox(y - r, x - r, y + r, x + r, 0.0f, 1.0f, 0.0f, 0);
+		lzs_balls_t balls;
+		lzs_pipeline_balls(self->pipeline, &balls);
+
+		int i;
+		for(i = 0; i < balls.count; ++i)
+		{
+			lzs_ball_t* ball = &balls.ball[i];
+			float       r    = (float) ball->roi_radius;
+			float       x    = ball->roi_x;
+			float       y    = ball->roi_y;
+			if(ball->lost)
+			{
+				lzs_overlay_color(overlay, 1.0f, 0.0f, 0.0f, 1.0f);
+				lzs_overlay_box(overlay, y - r, x - r, y + r, x + r);
+			}
+			else
+			{
+				lzs_overlay_color(overlay, 0.0f, 1.0f, 1.0f, 1.0f);
+				lzs_overlay_box(overlay, y - r, x - r, y + r, x + r);
+				lzs_overlay_marker(overlay, ball->sphero_x, ball->sphero_y, RADIUS_MARKER);
+			}
+		}
 	}
+	lzs_overlay_draw(overlay);
 
-	lzs_renderer_step(self);
+	lzs_renderer_step(self, &result);
 
-	// draw string
-	a3d_texstring_printf(self->string_sphero, "sphero: head=%i, x=%0.1f, y=%0.1f, spd=%0.2f, goal=%i", (int) fix_angle(self->sphero_heading + self->sphero_heading_offset), self->sphero_X, self->sphero_Y, self->sphero_speed, (int) fix_angle(self->sphero_goal));
-	a3d_texstring_printf(self->string_phone, "phone: heading=%i, slope=%i, x=%0.1f, y=%0.1f", (int) fix_angle(self->phone_heading), (int) fix_angle(self->phone_slope), self->phone_X, self->phone_Y);
-	a3d_texstring_draw(self->string_sphero, 400.0f, 16.0f, 800, 480);
-	a3d_texstring_draw(self->string_phone,  400.0f, 16.0f + self->string_sphero->size, 800, 480);
-	a3d_texstring_draw(self->string_fps, (float) SCREEN_W - 16.0f, (float) SCREEN_H - 16.0f, SCREEN_W, SCREEN_H);
-	utime_update("draw", &t0);
+	// the strings are only laid out when they change and the
+	// scheduler keeps the last layout when it is degraded
+	if(self->pipeline->budget.render.level < LZS_BUDGET_NOTEXT)
+	{
+		lzs_overlaytext_printf(self->string_sphero, "sphero: head=%i, x=%0.1f, y=%0.1f, spd=%0.2f, goal=%i", (int) lzs_tracker_fixangle(result.sphero_heading + result.sphero_heading_offset), result.sphero_X, result.sphero_Y, result.sphero_speed, (int) lzs_tracker_fixangle(result.sphero_goal));
+		lzs_overlaytext_printf(self->string_phone, "phone: heading=%i, slope=%i, x=%0.1f, y=%0.1f, overflow=%u", (int) lzs_tracker_fixangle(result.phone_heading), (int) lzs_tracker_fixangle(result.phone_slope), result.phone_X, result.phone_Y, self->sensors_overflow);
+	}
+	lzs_overlaytext_draw(self->string_sphero, screen_cx, 16.0f, screen_w, screen_h);
+	lzs_overlaytext_draw(self->string_phone,  screen_cx, 16.0f + self->string_sphero->string->size, screen_w, screen_h);
+	lzs_overlaytext_draw(self->string_fps, screen_w - 16.0f, screen_h - 16.0f, screen_w, screen_h);
+	lzs_overlaytext_draw(self->string_pipeline, screen_w - 16.0f, screen_h - 16.0f - self->string_fps->string->size, screen_w, screen_h);
+	#ifdef HUD_TIMING
+		lzs_overlaytext_draw(self->string_timing, screen_w - 16.0f, screen_h - 16.0f - self->string_fps->string->size - self->string_pipeline->string->size, screen_w, screen_h);
+	#endif
+	t0 = lzs_timing_mark(timing, LZS_TIMING_DRAW, t0);
+	lzs_budget_render(&self->pipeline->budget, t0 - t_frame);
 
-	//texgz_tex_t* screen = texgz_tex_new(SCREEN_W, SCREEN_H, SCREEN_W, SCREEN_H, TEXGZ_UNSIGNED_BYTE, TEXGZ_BGRA, NULL);
+	//texgz_tex_t* screen = texgz_tex_new(screen_w, screen_h, screen_w, screen_h, TEXGZ_UNSIGNED_BYTE, TEXGZ_BGRA, NULL);
 	//glReadPixels(0, 0, screen->width, screen->height, screen->format, screen->type, (void*) screen->pixels);
 	//texgz_tex_export(screen, "/sdcard/laser-shark/screen.texgz");
 	//texgz_tex_delete(&screen);
@@ -503,52 +489,184 @@ void lzs_renderer_draw(lzs_renderer_t* self)
 	A3D_GL_GETERROR();
 }
 
+void lzs_renderer_luma(lzs_renderer_t* self, const unsigned char* luma,
+                       const unsigned char* chroma, int w, int h, int stride)
+{
+	assert(self);
+	assert(luma);
+	LOGD("debug w=%i, h=%i, stride=%i", w, h, stride);
+
+	lzs_pipeline_luma(self->pipeline, luma, chroma, w, h, stride, a3d_utime());
+}
+
 void lzs_renderer_searchsphero(lzs_renderer_t* self, float x, float y)
 {
 	assert(self);
 	LOGD("debug x=%f, y=%f", x, y);
 
-	limit_position(RADIUS_BALL, &x, &y);
-	self->sphero_x = x;
-	self->sphero_y = y;
+	lzs_pipeline_searchsphero(self->pipeline, x, y);
+}
+
+int lzs_renderer_addsphero(lzs_renderer_t* self, float x, float y)
+{
+	assert(self);
+	LOGD("debug x=%f, y=%f", x, y);
+
+	return lzs_pipeline_addsphero(self->pipeline, x, y);
 }
 
 void lzs_renderer_calibratesphero(lzs_renderer_t* self, float x1, float y1, float x2, float y2)
 {
 	assert(self);
-	LOGD("debug x=%f, y=%f, radius=%f", x, y, radius);
+	LOGD("debug x1=%f, y1=%f, x2=%f, y2=%f", x1, y1, x2, y2);
 
-	// try to adjust sphero heading to match compass
-	self->sphero_heading_offset = self->phone_heading - self->sphero_heading;
+	lzs_pipeline_calibratesphero(self->pipeline);
 }
 
 void lzs_renderer_spheroorientation(lzs_renderer_t* self, float pitch, float roll, float yaw)
 {
 	assert(self);
 	LOGD("pitch=%f, roll=%f, yaw=%f", pitch, roll, yaw);
-	self->sphero_heading = -yaw;
+
+	lzs_pipeline_spheroorientation(self->pipeline, pitch, roll, yaw);
 }
 
 void lzs_renderer_phoneorientation(lzs_renderer_t* self, float pitch, float roll, float yaw)
 {
 	assert(self);
 	LOGD("pitch=%f, roll=%f, yaw=%f", pitch, roll, yaw);
-	self->phone_heading = yaw;
-	self->phone_slope   = 360.0f - roll;
+
+	lzs_pipeline_phoneorientation(self->pipeline, pitch, roll, yaw);
 }
 
-int lzs_renderer_spheroheading(lzs_renderer_t* self)
+void lzs_renderer_sensors(lzs_renderer_t* self, lzs_sensors_t* sensors)
 {
 	assert(self);
+	assert(sensors);
 	LOGD("debug");
 
-	return self->sphero_goal;
+	lzs_sensor_t records[LZS_SENSORS_BATCH];
+	int          count;
+	int          i;
+	do
+	{
+		count = lzs_sensors_drain(sensors, records, LZS_SENSORS_BATCH);
+		for(i = 0; i < count; ++i)
+		{
+			lzs_sensor_t* r = &records[i];
+			if(self->recorder)
+			{
+				lzs_recorder_sensor(self->recorder, r);
+			}
+
+			if(r->type == LZS_SENSOR_GYRO)
+			{
+				lzs_renderer_gyroevent(self, r->v[0], r->v[1], r->v[2], r->v[3]);
+			}
+			else if(r->type == LZS_SENSOR_ACCEL)
+			{
+				lzs_renderer_accelevent(self, r->v[0], r->v[1], r->v[2]);
+			}
+			else if(r->type == LZS_SENSOR_MAG)
+			{
+				lzs_renderer_magevent(self, r->v[0], r->v[1], r->v[2]);
+			}
+			else if(r->type == LZS_SENSOR_PHONE)
+			{
+				lzs_renderer_phoneorientation(self, r->v[0], r->v[1], r->v[2]);
+			}
+			else if(r->type == LZS_SENSOR_SPHERO)
+			{
+				lzs_renderer_spheroorientation(self, r->v[0], r->v[1], r->v[2]);
+			}
+		}
+	} while(count == LZS_SENSORS_BATCH);
+
+	self->sensors_overflow = (unsigned int) sensors->overflow;
 }
 
-float lzs_renderer_spherospeed(lzs_renderer_t* self)
+void lzs_renderer_gyroevent(lzs_renderer_t* self, float x, float y, float z, float dt)
 {
 	assert(self);
-	LOGD("debug");
+	LOGD("debug x=%f, y=%f, z=%f, dt=%f", x, y, z, dt);
+
+	#ifdef DEBUG_SENSORS
+		debug_sensors('g', x, y, z, dt);
+	#endif
+	lzs_fusion_gyro(&self->fusion, x, y, z, dt);
+	lzs_pipeline_gyro(self->pipeline, x, y, z);
+}
+
+void lzs_renderer_accelevent(lzs_renderer_t* self, float x, float y, float z)
+{
+	assert(self);
+	LOGD("debug x=%f, y=%f, z=%f", x, y, z);
+
+	#ifdef DEBUG_SENSORS
+		debug_sensors('a', x, y, z, 0.0f);
+	#endif
+	lzs_fusion_accel(&self->fusion, x, y, z);
+}
+
+void lzs_renderer_magevent(lzs_renderer_t* self, float x, float y, float z)
+{
+	assert(self);
+	LOGD("debug x=%f, y=%f, z=%f", x, y, z);
+
+	#ifdef DEBUG_SENSORS
+		debug_sensors('m', x, y, z, 0.0f);
+	#endif
+	lzs_fusion_mag(&self->fusion, x, y, z);
+}
+
+int lzs_renderer_spherocommand(lzs_renderer_t* self, int index,
+                               float* heading, float* speed)
+{
+	assert(self);
+	assert(heading);
+	assert(speed);
+	LOGD("debug index=%i", index);
+
+	// the ball of the tracker is steered by the control thread
+	if(index == 0)
+	{
+		lzs_command_t command;
+		if(lzs_control_take(self->control, &command) == 0)
+		{
+			return 0;
+		}
+
+		*heading = command.heading;
+		*speed   = command.speed;
+		return 1;
+	}
+
+	lzs_balls_t balls;
+	lzs_pipeline_balls(self->pipeline, &balls);
+	int i = index - 1;
+	if((i < 0) || (i >= balls.count))
+	{
+		return 0;
+	}
+
+	// the balls of the set take the goal of the last plane
+	// and skip the duplicates as in lzs_control_compute
+	lzs_ball_t* ball = &balls.ball[i];
+	float       h    = lzs_tracker_fixangle(ball->sphero_goal);
+	float       s    = ball->sphero_speed;
+	float       dh   = fabsf(lzs_tracker_fixangle(h - self->ball_heading[i] + 180.0f) - 180.0f);
+	if(self->ball_taken[i] &&
+	   (((s == 0.0f) && (self->ball_speed[i] == 0.0f)) ||
+	    ((dh < LZS_CONTROL_DHEADING) &&
+	     (fabsf(s - self->ball_speed[i]) < LZS_CONTROL_DSPEED))))
+	{
+		return 0;
+	}
+	self->ball_heading[i] = h;
+	self->ball_speed[i]   = s;
+	self->ball_taken[i]   = 1;
 
-	return self->sphero_speed;
+	*heading = h;
+	*speed   = s;
+	return 1;
 }
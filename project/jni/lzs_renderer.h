@@ -29,6 +29,11 @@
 #include "a3d/a3d_texfont.h"
 #include "a3d/a3d_texstring.h"
 #include "texgz/texgz_tex.h"
+#include "lzs_pipeline.h"
+#include "lzs_control.h"
+#include "lzs_fusion.h"
+#include "lzs_sensors.h"
+#include "lzs_overlay.h"
 
 /***********************************************************
 * public                                                   *
@@ -36,50 +41,59 @@
 
 typedef struct
 {
-	// x, y are in pixels
-	// X, Y, height are in feet
-	GLuint       texid;
-	float        sphero_x;
-	float        sphero_y;
-	float        sphero_X;
-	float        sphero_Y;
-	float        sphero_speed;
-	float        sphero_heading;
-	float        sphero_heading_offset;
-	float        sphero_goal;
-	float        phone_heading;
-	float        phone_slope;
-	float        phone_height;
-	float        phone_X;
-	float        phone_Y;
+	// tracker config loaded by lzs_renderer_new
+	lzs_config_t config;
 
-	// buffers for image processing
-	texgz_tex_t* buffer_color;   // RGBA-8888 or BGRA-8888
-	texgz_tex_t* buffer_gray;    // Luminance-FLOAT
-	texgz_tex_t* buffer_sx;      // Luminance-FLOAT
-	texgz_tex_t* buffer_sy;      // Luminance-FLOAT
+	GLuint          texid;
+	lzs_pipeline_t* pipeline;
+	lzs_control_t*  control;
+	lzs_recorder_t* recorder;
 
-	// string(s)
-	a3d_texfont_t*   font;
-	a3d_texstring_t* string_sphero;
-	a3d_texstring_t* string_phone;
+	// last command taken for each ball of the set where
+	// ball_taken is 0 until the first
+	float ball_heading[LZS_PIPELINE_BALLS];
+	float ball_speed[LZS_PIPELINE_BALLS];
+	int   ball_taken[LZS_PIPELINE_BALLS];
+
+	// sensors are drained from the ring before each frame
+	lzs_fusion_t fusion;
+	unsigned int sensors_overflow;
+
+	// HUD
+	lzs_overlay_t*     overlay;
+	a3d_texfont_t*     font;
+	lzs_overlaytext_t* string_sphero;
+	lzs_overlaytext_t* string_phone;
 
 	// fps state
-	a3d_texstring_t* string_fps;
-	double           t0;
-	int              frames;
+	lzs_overlaytext_t* string_fps;
+	lzs_overlaytext_t* string_pipeline;
+	lzs_overlaytext_t* string_timing;
+	double             t0;
+	int                frames;
+	unsigned int       dropped;
+	unsigned int       gate_frames;
+	unsigned int       gate_skipped;
+	unsigned int       budget_misses;
+	int                seconds;
 } lzs_renderer_t;
 
-lzs_renderer_t* lzs_renderer_new(const char* font);
+lzs_renderer_t* lzs_renderer_new(const char* font, const char* config);
 void            lzs_renderer_delete(lzs_renderer_t** _self);
 void            lzs_renderer_resize(lzs_renderer_t* self, int w, int h);
-void            lzs_renderer_drawbox(float top, float left, float bottom, float right, float r, float g, float b, int filled);
 void            lzs_renderer_draw(lzs_renderer_t* self);
+void            lzs_renderer_luma(lzs_renderer_t* self, const unsigned char* luma,
+                                  const unsigned char* chroma, int w, int h, int stride);
 void            lzs_renderer_searchsphero(lzs_renderer_t* self, float x, float y);
+int             lzs_renderer_addsphero(lzs_renderer_t* self, float x, float y);
 void            lzs_renderer_calibratesphero(lzs_renderer_t* self, float x1, float y1, float x2, float y2);
 void            lzs_renderer_spheroorientation(lzs_renderer_t* self, float pitch, float roll, float yaw);
 void            lzs_renderer_phoneorientation(lzs_renderer_t* self, float pitch, float roll, float yaw);
-int             lzs_renderer_spheroheading(lzs_renderer_t* self);
-float           lzs_renderer_spherospeed(lzs_renderer_t* self);
+void            lzs_renderer_sensors(lzs_renderer_t* self, lzs_sensors_t* sensors);
+void            lzs_renderer_gyroevent(lzs_renderer_t* self, float x, float y, float z, float dt);
+void            lzs_renderer_accelevent(lzs_renderer_t* self, float x, float y, float z);
+void            lzs_renderer_magevent(lzs_renderer_t* self, float x, float y, float z);
+int             lzs_renderer_spherocommand(lzs_renderer_t* self, int index,
+                                           float* heading, float* speed);
 
 #endif
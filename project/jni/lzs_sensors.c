@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_sensors.h"
+#include <stdlib.h>
+#include <assert.h>
+
+#define LOG_TAG "LaserShark"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+static lzs_sensor_t* lzs_sensors_records(lzs_sensors_t* self)
+{
+	assert(self);
+
+	return (lzs_sensor_t*) &self[1];
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+lzs_sensors_t* lzs_sensors_attach(void* buffer, int size)
+{
+	assert(buffer);
+	LOGD("debug size=%i", size);
+
+	if(size < (int) sizeof(lzs_sensors_t))
+	{
+		LOGE("invalid size=%i", size);
+		return NULL;
+	}
+
+	lzs_sensors_t* self     = (lzs_sensors_t*) buffer;
+	int            capacity = self->capacity;
+	int            max      = (size - (int) sizeof(lzs_sensors_t))/((int) sizeof(lzs_sensor_t));
+	if((capacity <= 0) || (capacity > max) || (capacity & (capacity - 1)))
+	{
+		LOGE("invalid capacity=%i, max=%i", capacity, max);
+		return NULL;
+	}
+	return self;
+}
+
+void lzs_sensors_commit(lzs_sensors_t* self, int head)
+{
+	assert(self);
+	LOGD("debug head=%i", head);
+
+	// the JNI call orders the records before the head
+	__sync_synchronize();
+	self->head = head;
+}
+
+int lzs_sensors_drain(lzs_sensors_t* self, lzs_sensor_t* records, int max)
+{
+	assert(self);
+	assert(records);
+	LOGD("debug max=%i", max);
+
+	unsigned int head = (unsigned int) self->head;
+	unsigned int tail = (unsigned int) self->tail;
+	__sync_synchronize();
+
+	unsigned int count = head - tail;
+	if(count > (unsigned int) self->capacity)
+	{
+		LOGE("invalid head=%u, tail=%u", head, tail);
+		self->tail = (int) head;
+		return 0;
+	}
+	if(count > (unsigned int) max)
+	{
+		count = (unsigned int) max;
+	}
+
+	lzs_sensor_t* ring = lzs_sensors_records(self);
+	unsigned int  mask = (unsigned int) (self->capacity - 1);
+	unsigned int  i;
+	for(i = 0; i < count; ++i)
+	{
+		records[i] = ring[(tail + i) & mask];
+	}
+
+	// release the records to Java
+	__sync_synchronize();
+	self->tail = (int) (tail + count);
+	return (int) count;
+}
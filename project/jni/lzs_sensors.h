@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef lzs_sensors_H
+#define lzs_sensors_H
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+// ring of timestamped sensor records shared with Java
+//
+// Java owns the memory (a direct ByteBuffer in native byte
+// order) and appends records without crossing JNI while the
+// head is published with one JNI call per batch and native
+// code drains the ring once per frame
+//
+// the layout must match SensorRing.java
+#define LZS_SENSOR_GYRO   0   // rad/s and dt in v[3]
+#define LZS_SENSOR_ACCEL  1   // m/s^2
+#define LZS_SENSOR_MAG    2   // uT
+#define LZS_SENSOR_PHONE  3   // pitch, roll, yaw in degrees
+#define LZS_SENSOR_SPHERO 4   // pitch, roll, yaw in degrees
+
+// records drained per call
+#define LZS_SENSORS_BATCH 32
+
+typedef struct
+{
+	double t;   // seconds
+	int    type;
+	float  v[4];
+	int    reserved;
+} lzs_sensor_t;
+
+// head and tail are free running counters and the capacity
+// is a power of two
+typedef struct
+{
+	int          capacity;   // written by Java before attach
+	volatile int head;       // written by lzs_sensors_commit
+	volatile int tail;       // written by lzs_sensors_drain
+	volatile int overflow;   // records dropped by Java
+	int          reserved[4];
+} lzs_sensors_t;
+
+lzs_sensors_t* lzs_sensors_attach(void* buffer, int size);
+void           lzs_sensors_commit(lzs_sensors_t* self, int head);
+int            lzs_sensors_drain(lzs_sensors_t* self, lzs_sensor_t* records, int max);
+
+#endif
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_session.h"
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <assert.h>
+
+#define LOG_TAG "LaserShark"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+lzs_session_t* lzs_session_new(const char* fname)
+{
+	assert(fname);
+	LOGD("debug fname=%s", fname);
+
+	lzs_session_t* self = (lzs_session_t*) malloc(sizeof(lzs_session_t));
+	if(self == NULL)
+	{
+		LOGE("malloc failed");
+		return NULL;
+	}
+
+	self->fd = open(fname, O_RDONLY);
+	if(self->fd < 0)
+	{
+		LOGE("open %s failed", fname);
+		goto fail_open;
+	}
+
+	struct stat st;
+	if((fstat(self->fd, &st) != 0) ||
+	   (st.st_size < (off_t) sizeof(lzs_recordfile_t)))
+	{
+		LOGE("invalid %s", fname);
+		goto fail_stat;
+	}
+	self->size = (size_t) st.st_size;
+
+	void* addr = mmap(NULL, self->size, PROT_READ, MAP_PRIVATE, self->fd, 0);
+	if(addr == MAP_FAILED)
+	{
+		LOGE("mmap %s failed", fname);
+		goto fail_mmap;
+	}
+	self->addr = (const unsigned char*) addr;
+
+	const lzs_recordfile_t* header = (const lzs_recordfile_t*) self->addr;
+	if((header->magic       != LZS_RECORD_MAGIC)   ||
+	   (header->version     != LZS_RECORD_VERSION) ||
+	   (header->header_size != sizeof(lzs_recordheader_t)))
+	{
+		LOGE("invalid header %s", fname);
+		goto fail_header;
+	}
+
+	// index the records
+	int    size   = 0;
+	size_t offset = sizeof(lzs_recordfile_t);
+	self->count   = 0;
+	self->offsets = NULL;
+	while(offset + sizeof(lzs_recordheader_t) <= self->size)
+	{
+		const lzs_recordheader_t* rh = (const lzs_recordheader_t*) (self->addr + offset);
+		size_t next = offset + sizeof(lzs_recordheader_t) + rh->size;
+		if(next > self->size)
+		{
+			LOGI("truncated record %i", self->count);
+			break;
+		}
+
+		if(self->count == size)
+		{
+			size = (size == 0) ? 1024 : 2*size;
+			size_t* tmp = (size_t*) realloc(self->offsets, size*sizeof(size_t));
+			if(tmp == NULL)
+			{
+				LOGE("realloc failed");
+				goto fail_index;
+			}
+			self->offsets = tmp;
+		}
+		self->offsets[self->count++] = offset;
+		offset = next;
+	}
+
+	// success
+	return self;
+
+	// failure
+	fail_index:
+		free(self->offsets);
+	fail_header:
+		munmap((void*) self->addr, self->size);
+	fail_mmap:
+	fail_stat:
+		close(self->fd);
+	fail_open:
+		free(self);
+	return NULL;
+}
+
+void lzs_session_delete(lzs_session_t** _self)
+{
+	assert(_self);
+
+	lzs_session_t* self = *_self;
+	if(self)
+	{
+		LOGD("debug");
+		free(self->offsets);
+		munmap((void*) self->addr, self->size);
+		close(self->fd);
+		free(self);
+		*_self = NULL;
+	}
+}
+
+const lzs_recordheader_t* lzs_session_record(const lzs_session_t* self, int i)
+{
+	assert(self);
+	assert((i >= 0) && (i < self->count));
+	LOGD("debug i=%i", i);
+
+	return (const lzs_recordheader_t*) (self->addr + self->offsets[i]);
+}
+
+const void* lzs_session_payload(const lzs_recordheader_t* header)
+{
+	assert(header);
+	LOGD("debug");
+
+	return (const void*) (header + 1);
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef lzs_session_H
+#define lzs_session_H
+
+#include <stddef.h>
+#include "lzs_recorder.h"
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+// maps a file written by lzs_recorder for random access
+// where a truncated last record is ignored
+typedef struct
+{
+	int                  fd;
+	const unsigned char* addr;
+	size_t               size;
+
+	// offset of each record
+	int     count;
+	size_t* offsets;
+} lzs_session_t;
+
+lzs_session_t*            lzs_session_new(const char* fname);
+void                      lzs_session_delete(lzs_session_t** _self);
+const lzs_recordheader_t* lzs_session_record(const lzs_session_t* self, int i);
+const void*               lzs_session_payload(const lzs_recordheader_t* header);
+
+#endif
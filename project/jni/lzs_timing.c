@@ -0,0 +1,309 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_timing.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+
+#define LOG_TAG "LaserShark"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+static const char* LZS_TIMING_NAMES[LZS_TIMING_COUNT] =
+{
+	"setup",
+	"readpixels",
+	"draw",
+	"detect",
+	"steer",
+	"reacquire",
+	"control",
+	"latency",
+	"set",
+};
+
+static int lzs_timing_bucket(unsigned int ns)
+{
+	if(ns < (1 << LZS_TIMING_SUB))
+	{
+		return (int) ns;
+	}
+
+	// e is the index of the leading one and the next
+	// LZS_TIMING_SUB bits select the sub-bucket
+	int e   = 31 - __builtin_clz(ns);
+	int sub = (int) (ns >> (e - LZS_TIMING_SUB)) & ((1 << LZS_TIMING_SUB) - 1);
+	return ((e - LZS_TIMING_SUB + 1) << LZS_TIMING_SUB) + sub;
+}
+
+static unsigned int lzs_timing_upper(int bucket)
+{
+	if(bucket < (1 << LZS_TIMING_SUB))
+	{
+		return (unsigned int) bucket;
+	}
+
+	int          e   = (bucket >> LZS_TIMING_SUB) + LZS_TIMING_SUB - 1;
+	unsigned int sub = (unsigned int) (bucket & ((1 << LZS_TIMING_SUB) - 1));
+	unsigned int lo  = (1U << e) + (sub << (e - LZS_TIMING_SUB));
+	return lo + ((1U << (e - LZS_TIMING_SUB)) - 1);
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+unsigned int lzs_timing_now(void)
+{
+	// wraps every 4.29 s which is fine for differences
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return 1000000000U*((unsigned int) ts.tv_sec) + (unsigned int) ts.tv_nsec;
+}
+
+void lzs_timing_reset(lzs_timing_t* self)
+{
+	assert(self);
+	LOGD("debug");
+
+	memset(self, 0, sizeof(lzs_timing_t));
+}
+
+void lzs_timing_record(lzs_timing_t* self, int stage, unsigned int ns)
+{
+	assert(self);
+	assert((stage >= 0) && (stage < LZS_TIMING_COUNT));
+
+	lzs_histogram_t* hist = &self->stage[stage];
+	++hist->buckets[lzs_timing_bucket(ns)];
+	++hist->count;
+	if(ns > hist->max)
+	{
+		hist->max = ns;
+	}
+}
+
+unsigned int lzs_timing_mark(lzs_timing_t* self, int stage, unsigned int t0)
+{
+	assert(self);
+
+	unsigned int t1 = lzs_timing_now();
+	lzs_timing_record(self, stage, t1 - t0);
+	return t1;
+}
+
+void lzs_timing_stats(const lzs_timing_t* self, int stage, lzs_timingstats_t* stats)
+{
+	assert(self);
+	assert((stage >= 0) && (stage < LZS_TIMING_COUNT));
+	assert(stats);
+	LOGD("debug stage=%i", stage);
+
+	// the count is summed from the snapshot of the buckets
+	const lzs_histogram_t* hist = &self->stage[stage];
+	unsigned int buckets[LZS_TIMING_BUCKETS];
+	unsigned int count = 0;
+	int i;
+	for(i = 0; i < LZS_TIMING_BUCKETS; ++i)
+	{
+		buckets[i] = hist->buckets[i];
+		count     += buckets[i];
+	}
+
+	memset(stats, 0, sizeof(lzs_timingstats_t));
+	stats->count = count;
+	stats->max   = hist->max;
+	if(count == 0)
+	{
+		return;
+	}
+
+	unsigned int n50 = (unsigned int) (0.50*count + 0.5);
+	unsigned int n95 = (unsigned int) (0.95*count + 0.5);
+	unsigned int n99 = (unsigned int) (0.99*count + 0.5);
+	unsigned int sum = 0;
+	for(i = 0; i < LZS_TIMING_BUCKETS; ++i)
+	{
+		unsigned int prev = sum;
+		sum += buckets[i];
+		if((prev < n50) && (sum >= n50))
+		{
+			stats->p50 = lzs_timing_upper(i);
+		}
+		if((prev < n95) && (sum >= n95))
+		{
+			stats->p95 = lzs_timing_upper(i);
+		}
+		if((prev < n99) && (sum >= n99))
+		{
+			stats->p99 = lzs_timing_upper(i);
+		}
+	}
+
+	// the bucket bound may exceed the largest sample
+	stats->p50 = (stats->p50 > stats->max) ? stats->max : stats->p50;
+	stats->p95 = (stats->p95 > stats->max) ? stats->max : stats->p95;
+	stats->p99 = (stats->p99 > stats->max) ? stats->max : stats->p99;
+}
+
+const char* lzs_timing_name(int stage)
+{
+	assert((stage >= 0) && (stage < LZS_TIMING_COUNT));
+	LOGD("debug stage=%i", stage);
+
+	return LZS_TIMING_NAMES[stage];
+}
+
+int lzs_timing_export(const lzs_timing_t* self, const char* fname)
+{
+	assert(self);
+	assert(fname);
+	LOGD("debug fname=%s", fname);
+
+	FILE* f = fopen(fname, "w");
+	if(f == NULL)
+	{
+		LOGE("fopen %s failed", fname);
+		return 0;
+	}
+
+	unsigned int header[5] =
+	{
+		LZS_TIMING_MAGIC,
+		LZS_TIMING_VERSION,
+		LZS_TIMING_COUNT,
+		LZS_TIMING_BUCKETS,
+		LZS_TIMING_SUB,
+	};
+	if(fwrite(header, sizeof(header), 1, f) != 1)
+	{
+		goto fail_write;
+	}
+
+	int i;
+	for(i = 0; i < LZS_TIMING_COUNT; ++i)
+	{
+		const lzs_histogram_t* hist = &self->stage[i];
+
+		char name[16];
+		memset(name, 0, 16);
+		strncpy(name, LZS_TIMING_NAMES[i], 15);
+
+		unsigned int values[2 + LZS_TIMING_BUCKETS];
+		values[0] = hist->count;
+		values[1] = hist->max;
+		int j;
+		for(j = 0; j < LZS_TIMING_BUCKETS; ++j)
+		{
+			values[2 + j] = hist->buckets[j];
+		}
+
+		if((fwrite(name, 16, 1, f) != 1) ||
+		   (fwrite(values, sizeof(values), 1, f) != 1))
+		{
+			goto fail_write;
+		}
+	}
+
+	fclose(f);
+
+	// success
+	return 1;
+
+	// failure
+	fail_write:
+		LOGE("fwrite %s failed", fname);
+		fclose(f);
+	return 0;
+}
+
+int lzs_timing_import(lzs_timing_t* self, const char* fname)
+{
+	assert(self);
+	assert(fname);
+	LOGD("debug fname=%s", fname);
+
+	FILE* f = fopen(fname, "r");
+	if(f == NULL)
+	{
+		LOGE("fopen %s failed", fname);
+		return 0;
+	}
+
+	unsigned int header[5];
+	if(fread(header, sizeof(header), 1, f) != 1)
+	{
+		goto fail_read;
+	}
+
+	if((header[0] != LZS_TIMING_MAGIC)   ||
+	   (header[1] != LZS_TIMING_VERSION) ||
+	   (header[2] != LZS_TIMING_COUNT)   ||
+	   (header[3] != LZS_TIMING_BUCKETS) ||
+	   (header[4] != LZS_TIMING_SUB))
+	{
+		LOGE("invalid header %s", fname);
+		fclose(f);
+		return 0;
+	}
+
+	lzs_timing_reset(self);
+
+	int i;
+	for(i = 0; i < LZS_TIMING_COUNT; ++i)
+	{
+		lzs_histogram_t* hist = &self->stage[i];
+
+		char         name[16];
+		unsigned int values[2 + LZS_TIMING_BUCKETS];
+		if((fread(name, 16, 1, f) != 1) ||
+		   (fread(values, sizeof(values), 1, f) != 1))
+		{
+			goto fail_read;
+		}
+
+		hist->count = values[0];
+		hist->max   = values[1];
+		int j;
+		for(j = 0; j < LZS_TIMING_BUCKETS; ++j)
+		{
+			hist->buckets[j] = values[2 + j];
+		}
+	}
+
+	fclose(f);
+
+	// success
+	return 1;
+
+	// failure
+	fail_read:
+		LOGE("fread %s failed", fname);
+		fclose(f);
+	return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef lzs_timing_H
+#define lzs_timing_H
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+// per-stage latency histograms which stay enabled
+//
+// each stage is recorded by a single thread so the counters
+// are updated without atomics and readers take a snapshot
+// which may lag by a few samples
+//
+// the gray, edge and peak passes are fused in lzs_kernel_peak
+// so they are timed together as detect and steer covers the
+// ground position, goal and prediction where the search of
+// the tracker set on the copied plane is timed as set
+#define LZS_TIMING_SETUP      0
+#define LZS_TIMING_READPIXELS 1
+#define LZS_TIMING_DRAW       2
+#define LZS_TIMING_DETECT     3
+#define LZS_TIMING_STEER      4
+#define LZS_TIMING_REACQUIRE  5
+#define LZS_TIMING_CONTROL    6
+#define LZS_TIMING_LATENCY    7   // capture to published result
+#define LZS_TIMING_SET        8
+#define LZS_TIMING_COUNT      9
+
+// log-linear buckets with 2^LZS_TIMING_SUB buckets per power
+// of two so percentiles are within 12.5% up to 4.29 s
+#define LZS_TIMING_SUB     3
+#define LZS_TIMING_BUCKETS 240
+
+// timing.bin is a header of five unsigned ints
+// magic, version, stages, buckets, sub
+// followed by each stage
+// char name[16], unsigned int count, max, buckets[]
+// in native byte order
+#define LZS_TIMING_MAGIC   0x54535A4C   // "LZST"
+#define LZS_TIMING_VERSION 1
+
+typedef struct
+{
+	volatile unsigned int count;
+	volatile unsigned int max;   // ns
+	volatile unsigned int buckets[LZS_TIMING_BUCKETS];
+} lzs_histogram_t;
+
+typedef struct
+{
+	lzs_histogram_t stage[LZS_TIMING_COUNT];
+} lzs_timing_t;
+
+// percentiles are the upper bound of the bucket in ns
+typedef struct
+{
+	unsigned int count;
+	unsigned int p50;
+	unsigned int p95;
+	unsigned int p99;
+	unsigned int max;
+} lzs_timingstats_t;
+
+unsigned int lzs_timing_now(void);
+void         lzs_timing_reset(lzs_timing_t* self);
+void         lzs_timing_record(lzs_timing_t* self, int stage, unsigned int ns);
+unsigned int lzs_timing_mark(lzs_timing_t* self, int stage, unsigned int t0);
+void         lzs_timing_stats(const lzs_timing_t* self, int stage, lzs_timingstats_t* stats);
+const char*  lzs_timing_name(int stage);
+int          lzs_timing_export(const lzs_timing_t* self, const char* fname);
+int          lzs_timing_import(lzs_timing_t* self, const char* fname);
+
+#endif
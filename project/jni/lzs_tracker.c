@@ -0,0 +1,1123 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_tracker.h"
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+#include "a3d/a3d_time.h"
+
+#define LOG_TAG "LaserShark"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+// converts crop pixels to screen coordinates
+static void lzs_tracker_screen(const lzs_crop_t* crop, float px, float py, float* x, float* y)
+{
+	assert(crop);
+	assert(x);
+	assert(y);
+
+	float dx = px - (float) crop->w / 2.0f;
+	float dy = py - (float) crop->h / 2.0f;
+	if(crop->format == LZS_CROP_LUMA)
+	{
+		*x = crop->x + crop->scale_x*dx;
+		*y = crop->y + crop->scale_y*dy;
+	}
+	else
+	{
+		*x = crop->x + dx;
+		*y = crop->y - dy;
+	}
+}
+
+// refines the peak to the circle center and returns 0 if
+// the circle is not supported
+static int lzs_tracker_circle(lzs_tracker_t* self, const lzs_crop_t* crop, float* x, float* y)
+{
+	assert(self);
+	assert(crop);
+	assert(x);
+	assert(y);
+	LOGD("debug");
+
+	// the center is within LZS_CIRCLE_RMAX of the edge and
+	// the opposite edge is within twice that
+	int half = LZS_CIRCLE_WINDOW/2;
+	int x0   = self->peak.x - half;
+	int y0   = self->peak.y - half;
+	int x1   = self->peak.x + half;
+	int y1   = self->peak.y + half;
+	x0 = (x0 < 0) ? 0 : x0;
+	y0 = (y0 < 0) ? 0 : y0;
+	x1 = (x1 > crop->w) ? crop->w : x1;
+	y1 = (y1 > crop->h) ? crop->h : y1;
+
+	lzs_center_t* center = &self->center;
+	int           ok;
+	if(crop->format == LZS_CROP_LUMA)
+	{
+		ok = lzs_circle_detectgray(self->circle, &crop->pixels[y0*crop->stride + x0],
+		                           crop->stride, x1 - x0, y1 - y0, center);
+	}
+	else
+	{
+		ok = lzs_circle_detect(self->circle, &crop->pixels[y0*crop->stride + 4*x0],
+		                       crop->stride, x1 - x0, y1 - y0, center);
+	}
+	if(ok == 0)
+	{
+		return 0;
+	}
+
+	*x = (float) x0 + center->x;
+	*y = (float) y0 + center->y;
+	return center->confidence >= LZS_CIRCLE_CONFIDENCE;
+}
+
+// the peak should lie within half the ball plus two sigma
+// of the prediction which may be off center when the crop
+// is limited to the screen
+static int lzs_tracker_gate(const lzs_tracker_t* self, float x, float y)
+{
+	assert(self);
+
+	if(self->predicted == 0)
+	{
+		return 1;
+	}
+	float gate = 0.5f*self->config.radius_ball + 2.0f*self->pred_sigma;
+	float dx   = x - self->pred_x;
+	float dy   = y - self->pred_y;
+	return dx*dx + dy*dy <= gate*gate;
+}
+
+static int lzs_tracker_consistent(lzs_tracker_t* self, const lzs_crop_t* crop,
+                                  float x, float y, int blob)
+{
+	assert(self);
+	assert(crop);
+	LOGD("debug x=%f, y=%f, blob=%i", x, y, blob);
+
+	// the blob area is not comparable with the edges
+	if(blob == 0)
+	{
+		// nothing to compare with before the first lock
+		if(self->mag_avg == 0.0f)
+		{
+			return self->peak.mag > 0;
+		}
+
+		// the ball edge is much stronger than the floor texture
+		if(lzs_tracker_accept(self, &self->peak) == 0)
+		{
+			return 0;
+		}
+	}
+
+	return lzs_tracker_gate(self, x, y);
+}
+
+// returns the index of the strongest candidate within the
+// prediction gate where the candidates were found on the
+// crop downsampled by 2^level
+static int lzs_tracker_select(lzs_tracker_t* self, const lzs_crop_t* crop,
+                              const lzs_peak_t* peaks, int count, int level)
+{
+	assert(self);
+	assert(crop);
+	assert(peaks);
+	LOGD("debug count=%i, level=%i", count, level);
+
+	if((count <= 1) || (self->predicted == 0))
+	{
+		return 0;
+	}
+
+	// the coarse pixels are centered on their block
+	float        c   = 0.5f*((float) ((1 << level) - 1));
+	unsigned int min = (unsigned int) (LZS_CANDIDATE_RATIO*((float) peaks[0].mag));
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		if(peaks[i].mag < min)
+		{
+			break;
+		}
+
+		float x;
+		float y;
+		lzs_tracker_screen(crop, (float) (peaks[i].x << level) + c,
+		                   (float) (peaks[i].y << level) + c, &x, &y);
+		if(lzs_tracker_gate(self, x, y))
+		{
+			return i;
+		}
+	}
+	return 0;
+}
+
+// candidates of the foreground edges of a LUMA crop which
+// are found on the coarse level when the pyramid is enabled
+static int lzs_tracker_foreground(lzs_tracker_t* self, const lzs_crop_t* crop,
+                                  lzs_peak_t* peaks)
+{
+	assert(self);
+	assert(crop);
+	assert(peaks);
+	LOGD("debug");
+
+	// the model is stabilized with the latest phone pose
+	lzs_background_t* background = self->background;
+	lzs_camera_pose(self->camera, self->phone_heading,
+	                self->phone_slope, self->phone_height);
+
+	lzs_pyramid_t* pyramid = self->pyramid;
+	if(pyramid == NULL)
+	{
+		return lzs_background_peaksgray(background, self->camera,
+		                                crop->pixels, crop->stride,
+		                                crop->w, crop->h, 0,
+		                                crop->x, crop->y,
+		                                crop->scale_x, crop->scale_y,
+		                                peaks, LZS_CANDIDATES);
+	}
+
+	// the model replaces the coarse candidates and the coarse
+	// pixels are centered on their block
+	int l = self->levels;
+	int n = 1 << l;
+	if(lzs_pyramid_coarsegray(pyramid, crop->pixels, crop->stride,
+	                          crop->w, crop->h) == 0)
+	{
+		return 0;
+	}
+	return lzs_background_peaksgray(background, self->camera,
+	                                pyramid->coarse, pyramid->pitch,
+	                                crop->w >> l, crop->h >> l, l,
+	                                crop->x + 0.5f*crop->scale_x*((float) (n - 1)),
+	                                crop->y + 0.5f*crop->scale_y*((float) (n - 1)),
+	                                crop->scale_x*((float) n), crop->scale_y*((float) n),
+	                                peaks, LZS_CANDIDATES);
+}
+
+// strongest edge of the crop near the prediction
+static void lzs_tracker_edge(lzs_tracker_t* self, const lzs_crop_t* crop, int foreground)
+{
+	assert(self);
+	assert(crop);
+	LOGD("debug foreground=%i", foreground);
+
+	// the luminance plane is already gray and the pyramid
+	// ranks the candidates on the coarse level
+	int            luma    = (crop->format == LZS_CROP_LUMA);
+	lzs_pyramid_t* pyramid = self->pyramid;
+	lzs_peak_t     peaks[LZS_CANDIDATES];
+	int            count;
+	if(foreground)
+	{
+		count = lzs_tracker_foreground(self, crop, peaks);
+	}
+	else if(pyramid)
+	{
+		int ok;
+		if(luma)
+		{
+			ok = lzs_pyramid_coarsegray(pyramid, crop->pixels, crop->stride,
+			                            crop->w, crop->h);
+		}
+		else
+		{
+			ok = lzs_pyramid_coarse(pyramid, crop->pixels, crop->stride,
+			                        crop->w, crop->h);
+		}
+		count = ok ? lzs_pyramid_candidates(pyramid, crop->w, crop->h,
+		                                    peaks, LZS_CANDIDATES) : 0;
+	}
+	else if(luma)
+	{
+		count = lzs_kernel_peaksgray(crop->pixels, crop->stride,
+		                             crop->w, crop->h, self->scratch,
+		                             peaks, LZS_CANDIDATES);
+	}
+	else
+	{
+		count = lzs_kernel_peaks(crop->pixels, crop->stride,
+		                         crop->w, crop->h, self->scratch,
+		                         peaks, LZS_CANDIDATES);
+	}
+
+	if(count == 0)
+	{
+		self->peak.x   = 0;
+		self->peak.y   = 0;
+		self->peak.mag = 0;
+		return;
+	}
+
+	int i = lzs_tracker_select(self, crop, peaks, count,
+	                           pyramid ? self->levels : 0);
+	if(pyramid && luma)
+	{
+		lzs_pyramid_refinegray(pyramid, crop->pixels, crop->stride,
+		                       crop->w, crop->h, &peaks[i], &self->peak);
+	}
+	else if(pyramid)
+	{
+		lzs_pyramid_refine(pyramid, crop->pixels, crop->stride,
+		                   crop->w, crop->h, &peaks[i], &self->peak);
+	}
+	else
+	{
+		self->peak = peaks[i];
+	}
+}
+
+// tracks the frame interval to predict the next crop and
+// returns the interval in usec or 0 when it is unknown
+static double lzs_tracker_interval(lzs_tracker_t* self, const lzs_crop_t* crop)
+{
+	assert(self);
+	assert(crop);
+
+	double dt = 0.0;
+	if((self->t > 0.0) && (crop->t > self->t) &&
+	   (crop->t - self->t < A3D_USEC))
+	{
+		dt = crop->t - self->t;
+		self->dt_frame = 0.9*self->dt_frame + 0.1*dt;
+	}
+	self->t = crop->t;
+	return dt;
+}
+
+// commanded ground velocity in ft/s
+static void lzs_tracker_velocity(const lzs_tracker_t* self, float* uX, float* uY)
+{
+	assert(self);
+	assert(uX);
+	assert(uY);
+
+	float w = (self->sphero_goal + self->sphero_heading_offset)*M_PI/180.0f;
+	*uX = LZS_MOTION_FTPS*self->sphero_speed*sinf(w);
+	*uY = LZS_MOTION_FTPS*self->sphero_speed*cosf(w);
+}
+
+// widens a window of radius r so the rows of the search
+// level of a BGRA crop have a fixed width in the kernel
+static int lzs_tracker_fixedradius(const lzs_tracker_t* self, int r)
+{
+	assert(self);
+
+	int levels = self->levels;
+	int w      = (2*r) >> levels;
+	int fw     = lzs_kernel_fixedwidth(w, (2*self->roi_limit) >> levels);
+	return (fw == w) ? r : (fw << levels)/2;
+}
+
+// moves the particles with the command and weighs them by
+// the crop in place of the detector
+static void lzs_tracker_filter(lzs_tracker_t* self, const lzs_crop_t* crop)
+{
+	assert(self);
+	assert(crop);
+	LOGD("debug");
+
+	lzs_particles_t* particles = self->particles;
+	double           dt        = lzs_tracker_interval(self, crop);
+	lzs_camera_pose(self->camera, self->phone_heading,
+	                self->phone_slope, self->phone_height);
+
+	// the cloud starts at the last position after a search
+	if(particles->init == 0)
+	{
+		float X;
+		float Y;
+		lzs_camera_ground(self->camera, 1, &self->sphero_x, &self->sphero_y, &X, &Y);
+		lzs_particles_reset(particles, X, Y);
+	}
+	else
+	{
+		float uX;
+		float uY;
+		lzs_tracker_velocity(self, &uX, &uY);
+		lzs_particles_predict(particles, (float) (dt/A3D_USEC), uX, uY);
+	}
+
+	// the maps are indexed by the screen position scaled to
+	// the cells of the crop
+	float n = (float) (1 << LZS_PARTICLES_LEVEL);
+	float w = 0.5f*((float) crop->w);
+	float h = 0.5f*((float) crop->h);
+	float ax;
+	float bx;
+	float ay;
+	float by;
+	if(crop->format == LZS_CROP_LUMA)
+	{
+		lzs_particles_edgesgray(particles, crop->pixels, crop->stride,
+		                        crop->w, crop->h);
+		if(lzs_tracker_hascolor(self, crop))
+		{
+			lzs_particles_colorsnv21(particles, self->color, crop->pixels,
+			                         crop->chroma, crop->stride,
+			                         crop->w, crop->h);
+		}
+		ax = 1.0f/(crop->scale_x*n);
+		bx = (w - crop->x/crop->scale_x)/n;
+		ay = 1.0f/(crop->scale_y*n);
+		by = (h - crop->y/crop->scale_y)/n;
+	}
+	else
+	{
+		lzs_particles_edges(particles, crop->pixels, crop->stride,
+		                    crop->w, crop->h);
+		if(lzs_tracker_hascolor(self, crop))
+		{
+			lzs_particles_colors(particles, self->color, crop->pixels,
+			                     crop->stride, crop->w, crop->h);
+		}
+		ax = 1.0f/n;
+		bx = (w - crop->x)/n;
+		ay = -1.0f/n;
+		by = (h + crop->y)/n;
+	}
+	int accept = lzs_particles_weigh(particles, self->camera, ax, bx, ay, by);
+
+	// the peak is the estimate in crop pixels
+	float px = n*(ax*particles->est_x + bx);
+	float py = n*(ay*particles->est_y + by);
+	self->peak.x   = (int) px;
+	self->peak.y   = (int) py;
+	self->peak.mag = (unsigned int) particles->energy;
+	LOGD("peak=%u, peak_x=%i, peak_y=%i", self->peak.mag, self->peak.x, self->peak.y);
+
+	if(accept == 0)
+	{
+		// the cloud spreads with the command until the ball
+		// returns
+		++self->lost_count;
+		if((self->lost == 0) && (self->lost_count >= LZS_PARTICLES_FRAMES))
+		{
+			LOGI("lost energy=%f, avg=%f", particles->energy, particles->energy_avg);
+			self->lost   = 1;
+			self->t_lost = crop->t;
+		}
+		return;
+	}
+
+	self->sphero_x   = particles->est_x;
+	self->sphero_y   = particles->est_y;
+	self->measured   = 1;
+	self->lost       = 0;
+	self->lost_count = 0;
+	lzs_particles_resample(particles);
+}
+
+// updates the track with the peak or blob found on the
+// crop where ok is 0 when the detector found nothing
+static void lzs_tracker_update(lzs_tracker_t* self, const lzs_crop_t* crop,
+                               int ok, int blob, int foreground)
+{
+	assert(self);
+	assert(crop);
+	LOGD("debug ok=%i, blob=%i, foreground=%i", ok, blob, foreground);
+
+	lzs_tracker_interval(self, crop);
+
+	float px = (float) self->peak.x;
+	float py = (float) self->peak.y;
+	if(blob)
+	{
+		px = self->blob.x;
+		py = self->blob.y;
+	}
+	else if(self->detector == LZS_DETECTOR_CIRCLE)
+	{
+		ok = lzs_tracker_circle(self, crop, &px, &py);
+	}
+
+	float x;
+	float y;
+	lzs_tracker_screen(crop, px, py, &x, &y);
+	if((ok == 0) || (lzs_tracker_consistent(self, crop, x, y, blob) == 0))
+	{
+		// the peak scan always finds something so weak or
+		// jumping peaks are ignored until the track is lost
+		++self->lost_count;
+		if((self->lost == 0) && (self->lost_count >= LZS_LOST_FRAMES))
+		{
+			LOGI("lost peak=%u, avg=%f", self->peak.mag, self->mag_avg);
+			self->lost   = 1;
+			self->t_lost = crop->t;
+		}
+		return;
+	}
+
+	// move sphero center to match peak
+	self->sphero_x   = x;
+	self->sphero_y   = y;
+	self->measured   = 1;
+	self->lost       = 0;
+	self->lost_count = 0;
+
+	// the edge statistics and the floor are only learned
+	// from the edges once the ball is found
+	if(blob)
+	{
+		return;
+	}
+	self->mag_avg = (self->mag_avg == 0.0f) ? (float) self->peak.mag :
+	                0.9f*self->mag_avg + 0.1f*(float) self->peak.mag;
+	if(foreground)
+	{
+		lzs_background_update(self->background, x, y,
+		                      LZS_BACKGROUND_EXCLUDE*self->config.radius_ball);
+	}
+}
+
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+lzs_tracker_t* lzs_tracker_new(const lzs_config_t* config)
+{
+	assert(config);
+	LOGD("debug");
+
+	lzs_tracker_t* self = (lzs_tracker_t*) malloc(sizeof(lzs_tracker_t));
+	if(self == NULL)
+	{
+		LOGE("malloc failed");
+		return NULL;
+	}
+
+	self->config                = *config;
+	self->sphero_x              = 0.5f*config->screen_w;
+	self->sphero_y              = 0.5f*config->screen_h;
+	self->sphero_X              = 0.0f;
+	self->sphero_Y              = 0.0f;
+	self->sphero_speed          = 0.0f;
+	self->sphero_heading        = 0.0f;
+	self->sphero_heading_offset = 0.0f;
+	self->sphero_goal           = 0.0f;
+	self->phone_heading         = 0.0f;
+	self->phone_slope           = 0.0f;
+	self->phone_height          = 5.0f;
+	self->phone_X               = 0.0f;
+	self->phone_Y               = 0.0f;
+	self->peak.x                = 0;
+	self->peak.y                = 0;
+	self->peak.mag              = 0;
+	self->radius                = (int) config->radius_ball;
+	self->levels                = 0;
+	self->pyramid               = NULL;
+	self->particles             = NULL;
+	self->detector              = LZS_DETECTOR_PEAK;
+	self->circle                = NULL;
+	self->color                 = NULL;
+	self->blob.x                = 0.0f;
+	self->blob.y                = 0.0f;
+	self->blob.area             = 0;
+	self->center.x              = 0.0f;
+	self->center.y              = 0.0f;
+	self->center.votes          = 0;
+	self->center.confidence     = 0.0f;
+	self->measured              = 0;
+	self->t                     = 0.0;
+	self->dt_frame              = A3D_USEC/30.0;
+	self->roi_x                 = self->sphero_x;
+	self->roi_y                 = self->sphero_y;
+	self->roi_radius            = self->radius;
+	self->roi_limit             = self->radius;
+	self->mag_avg               = 0.0f;
+	self->lost_count            = 0;
+	self->lost                  = 0;
+	self->t_lost                = 0.0;
+	self->predicted             = 0;
+	self->pred_x                = 0.0f;
+	self->pred_y                = 0.0f;
+	self->pred_sigma            = 0.0f;
+	lzs_motion_reset(&self->motion);
+
+	// allocate the buffer(s)
+	self->scratch = (unsigned char*) lzs_kernel_malloc(LZS_KERNEL_SCRATCH(LZS_CROP_MAX));
+	if(self->scratch == NULL)
+	{
+		goto fail_scratch;
+	}
+
+	self->camera = lzs_camera_new((int) config->screen_w, (int) config->screen_h,
+	                              0.5f*config->screen_w, 0.5f*config->screen_h,
+	                              LZS_CAMERA_FOVX, LZS_CAMERA_FOVY);
+	if(self->camera == NULL)
+	{
+		goto fail_camera;
+	}
+
+	// the background model is opt-in since it loses the
+	// ball more often on the dim and tile scenes of lzs_bench
+	self->background = NULL;
+	if(config->background)
+	{
+		self->background = lzs_background_new(LZS_CROP_MAX, LZS_CROP_MAX);
+		if(self->background == NULL)
+		{
+			goto fail_background;
+		}
+	}
+
+	lzs_kernel_select(LZS_KERNEL_BEST);
+	LOGI("kernel backend=%s", lzs_kernel_name(lzs_kernel_backend()));
+
+	// success
+	return self;
+
+	// failure
+	fail_background:
+		lzs_camera_delete(&self->camera);
+	fail_camera:
+		lzs_kernel_free(self->scratch);
+	fail_scratch:
+		free(self);
+	return NULL;
+}
+
+void lzs_tracker_delete(lzs_tracker_t** _self)
+{
+	assert(_self);
+
+	lzs_tracker_t* self = *_self;
+	if(self)
+	{
+		LOGD("debug");
+		lzs_circle_delete(&self->circle);
+		lzs_color_delete(&self->color);
+		lzs_pyramid_delete(&self->pyramid);
+		lzs_particles_delete(&self->particles);
+		lzs_background_delete(&self->background);
+		lzs_camera_delete(&self->camera);
+		lzs_kernel_free(self->scratch);
+		free(self);
+		*_self = NULL;
+	}
+}
+
+int lzs_tracker_window(lzs_tracker_t* self, int radius, int levels)
+{
+	assert(self);
+	LOGD("debug radius=%i, levels=%i", radius, levels);
+
+	if((radius < 2) || (radius > (int) LZS_RADIUS_MAX) ||
+	   (levels < 0) || (levels > LZS_PYRAMID_LEVELS))
+	{
+		LOGE("invalid radius=%i, levels=%i", radius, levels);
+		return 0;
+	}
+
+	// the crop must divide evenly into each level
+	int size = 2*radius;
+	size &= ~((1 << levels) - 1);
+
+	lzs_pyramid_t* pyramid = NULL;
+	if(levels > 0)
+	{
+		pyramid = lzs_pyramid_new(size, size, levels);
+		if(pyramid == NULL)
+		{
+			return 0;
+		}
+	}
+
+	lzs_pyramid_delete(&self->pyramid);
+	self->radius     = size/2;
+	self->levels     = levels;
+	self->pyramid    = pyramid;
+	self->roi_radius = self->radius;
+	self->roi_limit  = self->radius;
+	lzs_tracker_limitposition(&self->config, (float) self->radius, &self->roi_x, &self->roi_y);
+	return 1;
+}
+
+int lzs_tracker_detector(lzs_tracker_t* self, int detector)
+{
+	assert(self);
+	LOGD("debug detector=%i", detector);
+
+	if(detector == LZS_DETECTOR_PEAK)
+	{
+		self->detector = detector;
+		return 1;
+	}
+	else if(detector == LZS_DETECTOR_COLOR)
+	{
+		if(self->color == NULL)
+		{
+			self->color = lzs_color_new(LZS_COLOR_HUE, LZS_COLOR_TOLERANCE);
+			if(self->color == NULL)
+			{
+				return 0;
+			}
+		}
+		self->detector = detector;
+		return 1;
+	}
+	else if(detector != LZS_DETECTOR_CIRCLE)
+	{
+		LOGE("invalid detector=%i", detector);
+		return 0;
+	}
+
+	if(self->circle == NULL)
+	{
+		self->circle = lzs_circle_new(LZS_CIRCLE_WINDOW, LZS_CIRCLE_WINDOW,
+		                              LZS_CIRCLE_RMIN, LZS_CIRCLE_RMAX);
+		if(self->circle == NULL)
+		{
+			return 0;
+		}
+	}
+	self->detector = detector;
+	return 1;
+}
+
+int lzs_tracker_background(lzs_tracker_t* self, int enable)
+{
+	assert(self);
+	LOGD("debug enable=%i", enable);
+
+	if(enable == 0)
+	{
+		lzs_background_delete(&self->background);
+		return 1;
+	}
+
+	if(self->background == NULL)
+	{
+		self->background = lzs_background_new(LZS_CROP_MAX, LZS_CROP_MAX);
+		if(self->background == NULL)
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+int lzs_tracker_color(lzs_tracker_t* self, float hue, float tolerance)
+{
+	assert(self);
+	LOGD("debug hue=%f, tolerance=%f", hue, tolerance);
+
+	if((tolerance <= 0.0f) || (tolerance > 180.0f))
+	{
+		LOGE("invalid tolerance=%f", tolerance);
+		return 0;
+	}
+
+	if(self->color == NULL)
+	{
+		self->color = lzs_color_new(hue, tolerance);
+		return self->color != NULL;
+	}
+
+	// the tables are only rebuilt when the target changes
+	if((self->color->hue != hue) || (self->color->tolerance != tolerance))
+	{
+		lzs_color_target(self->color, hue, tolerance);
+	}
+	return 1;
+}
+
+int lzs_tracker_particles(lzs_tracker_t* self, int count)
+{
+	assert(self);
+	LOGD("debug count=%i", count);
+
+	if(count == 0)
+	{
+		lzs_particles_delete(&self->particles);
+		return 1;
+	}
+
+	if(self->particles && (self->particles->count == count))
+	{
+		return 1;
+	}
+
+	lzs_particles_t* particles = lzs_particles_new(count, LZS_CROP_MAX, LZS_CROP_MAX);
+	if(particles == NULL)
+	{
+		return 0;
+	}
+	lzs_particles_delete(&self->particles);
+	self->particles = particles;
+	return 1;
+}
+
+void lzs_tracker_crop(lzs_tracker_t* self, lzs_crop_t* crop)
+{
+	assert(self);
+	assert(crop);
+	LOGD("debug");
+
+	crop->x = self->roi_x;
+	crop->y = self->roi_y;
+	crop->w = 2*self->roi_radius;
+	crop->h = 2*self->roi_radius;
+}
+
+void lzs_tracker_detect(lzs_tracker_t* self, const lzs_crop_t* crop)
+{
+	assert(self);
+	assert(crop);
+	LOGD("debug");
+
+	if((crop->w > LZS_CROP_MAX) || (crop->h > LZS_CROP_MAX))
+	{
+		LOGE("invalid w=%i, h=%i", crop->w, crop->h);
+		return;
+	}
+
+	if(self->particles)
+	{
+		lzs_tracker_filter(self, crop);
+		return;
+	}
+
+	// the color detector only falls back to the edges when
+	// the crop has no color since a missing LED would leave
+	// the floor edges without a reference
+	int blob       = lzs_tracker_hascolor(self, crop);
+	int foreground = (crop->format == LZS_CROP_LUMA) && self->background;
+	int ok         = 1;
+	if(blob)
+	{
+		ok = lzs_tracker_blob(self, crop, &self->peak);
+	}
+	else
+	{
+		lzs_tracker_edge(self, crop, foreground);
+	}
+	LOGD("peak=%u, peak_x=%i, peak_y=%i", self->peak.mag, self->peak.x, self->peak.y);
+
+	lzs_tracker_update(self, crop, ok, blob, foreground);
+}
+
+void lzs_tracker_measure(lzs_tracker_t* self, const lzs_crop_t* crop,
+                         const lzs_peak_t* peak)
+{
+	assert(self);
+	assert(crop);
+	assert(peak);
+	LOGD("debug");
+
+	// the peak was found by the caller on the edges of crop
+	self->peak = *peak;
+	lzs_tracker_update(self, crop, 1, 0, 0);
+}
+
+int lzs_tracker_accept(lzs_tracker_t* self, const lzs_peak_t* peak)
+{
+	assert(self);
+	assert(peak);
+	LOGD("debug");
+
+	return (peak->mag > 0) &&
+	       ((float) peak->mag >= LZS_LOST_RATIO*self->mag_avg);
+}
+
+int lzs_tracker_hascolor(const lzs_tracker_t* self, const lzs_crop_t* crop)
+{
+	assert(self);
+	assert(crop);
+	LOGD("debug");
+
+	// a LUMA crop without chroma has no color
+	return (self->detector == LZS_DETECTOR_COLOR) && self->color &&
+	       ((crop->format == LZS_CROP_BGRA) || crop->chroma);
+}
+
+int lzs_tracker_blob(lzs_tracker_t* self, const lzs_crop_t* crop, lzs_peak_t* peak)
+{
+	assert(self);
+	assert(crop);
+	assert(peak);
+	LOGD("debug");
+
+	if(lzs_tracker_hascolor(self, crop) == 0)
+	{
+		return 0;
+	}
+
+	int ok;
+	if(crop->format == LZS_CROP_BGRA)
+	{
+		ok = lzs_color_detect(self->color, crop->pixels, crop->stride,
+		                      crop->w, crop->h, &self->blob);
+	}
+	else
+	{
+		ok = lzs_color_detectnv21(self->color, crop->pixels, crop->chroma,
+		                          crop->stride, crop->w, crop->h, &self->blob);
+	}
+	if(ok == 0)
+	{
+		peak->mag = 0;
+		return 0;
+	}
+
+	// the peak magnitude is the area of the blob
+	peak->x   = (int) (self->blob.x + 0.5f);
+	peak->y   = (int) (self->blob.y + 0.5f);
+	peak->mag = (unsigned int) self->blob.area;
+	return 1;
+}
+
+void lzs_tracker_reacquire(lzs_tracker_t* self, const lzs_crop_t* crop, const lzs_peak_t* peak)
+{
+	assert(self);
+	assert(crop);
+	assert(peak);
+	LOGD("debug");
+
+	// restart the track at the peak
+	float x;
+	float y;
+	lzs_tracker_screen(crop, (float) peak->x, (float) peak->y, &x, &y);
+	lzs_tracker_searchsphero(self, x, y);
+	self->peak = *peak;
+	self->t    = crop->t;
+	LOGI("reacquired x=%f, y=%f, peak=%u", x, y, peak->mag);
+}
+
+void lzs_tracker_steer(lzs_tracker_t* self)
+{
+	assert(self);
+	LOGD("debug");
+
+	// project the phone center and sphero to the ground
+	float px[2] = { 0.5f*self->config.screen_w, self->sphero_x };
+	float py[2] = { 0.5f*self->config.screen_h, self->sphero_y };
+	float pX[2];
+	float pY[2];
+	lzs_camera_pose(self->camera, self->phone_heading,
+	                self->phone_slope, self->phone_height);
+	lzs_camera_ground(self->camera, 2, px, py, pX, pY);
+	self->phone_X  = pX[0];
+	self->phone_Y  = pY[0];
+	self->sphero_X = pX[1];
+	self->sphero_Y = pY[1];
+
+	// compute goal and speed
+	lzs_tracker_command(&self->config, self->phone_X - self->sphero_X,
+	                    self->phone_Y - self->sphero_Y,
+	                    self->sphero_heading, self->sphero_heading_offset,
+	                    &self->sphero_goal, &self->sphero_speed);
+
+	// update the motion model with the commanded velocity
+	if(self->measured)
+	{
+		float uX;
+		float uY;
+		lzs_tracker_velocity(self, &uX, &uY);
+		lzs_motion_update(&self->motion, self->t,
+		                  self->sphero_x, self->sphero_y,
+		                  self->sphero_X, self->sphero_Y,
+		                  self->sphero_speed, uX, uY);
+		self->measured = 0;
+	}
+
+	// predict the next search region
+	float x;
+	float y;
+	float sigma;
+	self->predicted = lzs_motion_predict(&self->motion, self->t + self->dt_frame,
+	                                     self->sphero_speed, &x, &y, &sigma);
+	if(self->predicted)
+	{
+		self->pred_x     = x;
+		self->pred_y     = y;
+		self->pred_sigma = sigma;
+
+		// three sigma plus the ball rounded for the pyramid
+		// and widened to the fixed width rows of the kernel
+		int r = (int) (self->config.radius_ball + 3.0f*sigma);
+		r = (r + 3) & ~3;
+		if(r > self->roi_limit)
+		{
+			r = self->roi_limit;
+		}
+		r = lzs_tracker_fixedradius(self, r);
+		self->roi_x      = x;
+		self->roi_y      = y;
+		self->roi_radius = r;
+	}
+	else
+	{
+		self->roi_x      = self->sphero_x;
+		self->roi_y      = self->sphero_y;
+		self->roi_radius = self->radius;
+	}
+
+	// keep the next search region on screen
+	lzs_tracker_limitposition(&self->config, (float) self->roi_radius, &self->roi_x, &self->roi_y);
+}
+
+void lzs_tracker_searchsphero(lzs_tracker_t* self, float x, float y)
+{
+	assert(self);
+	LOGD("debug x=%f, y=%f", x, y);
+
+	lzs_tracker_limitposition(&self->config, (float) self->radius, &x, &y);
+	self->sphero_x   = x;
+	self->sphero_y   = y;
+	self->roi_x      = x;
+	self->roi_y      = y;
+	self->roi_radius = self->radius;
+	self->measured   = 0;
+	self->lost       = 0;
+	self->lost_count = 0;
+	self->predicted  = 0;
+	lzs_motion_reset(&self->motion);
+
+	// the ball may have been learned while the track was off
+	if(self->background)
+	{
+		lzs_background_reset(self->background);
+	}
+
+	// the cloud is restarted at x, y by the next detect
+	if(self->particles)
+	{
+		self->particles->init = 0;
+	}
+}
+
+void lzs_tracker_calibratesphero(lzs_tracker_t* self, float x1, float y1, float x2, float y2)
+{
+	assert(self);
+	LOGD("debug x1=%f, y1=%f, x2=%f, y2=%f", x1, y1, x2, y2);
+
+	// try to adjust sphero heading to match compass
+	self->sphero_heading_offset = self->phone_heading - self->sphero_heading;
+}
+
+void lzs_tracker_spheroorientation(lzs_tracker_t* self, float pitch, float roll, float yaw)
+{
+	assert(self);
+	LOGD("pitch=%f, roll=%f, yaw=%f", pitch, roll, yaw);
+	self->sphero_heading = -yaw;
+}
+
+void lzs_tracker_phoneorientation(lzs_tracker_t* self, float pitch, float roll, float yaw)
+{
+	assert(self);
+	LOGD("pitch=%f, roll=%f, yaw=%f", pitch, roll, yaw);
+	self->phone_heading = yaw;
+	self->phone_slope   = 360.0f - roll;
+}
+
+int lzs_tracker_spheroheading(lzs_tracker_t* self)
+{
+	assert(self);
+	LOGD("debug");
+
+	return self->sphero_goal;
+}
+
+float lzs_tracker_spherospeed(lzs_tracker_t* self)
+{
+	assert(self);
+	LOGD("debug");
+
+	return self->sphero_speed;
+}
+
+void lzs_tracker_command(const lzs_config_t* config,
+                         float dx, float dy, float heading, float heading_offset,
+                         float* goal, float* speed)
+{
+	assert(config);
+	assert(goal);
+	assert(speed);
+	LOGD("debug dx=%f, dy=%f, heading=%f, heading_offset=%f", dx, dy, heading, heading_offset);
+
+	float a = lzs_tracker_fixangle(atan2f(dx, dy) * 180.0f / M_PI);
+	*goal   = a - heading_offset;
+
+	float dotp = cosf((a - heading) * M_PI / 180.0f);
+	if(dotp > 0.0f)
+	{
+		// linearly interpolate speed based on the turning angle
+		*speed = config->speed_max*dotp + config->speed_min*(1.0f - dotp);
+	}
+	else
+	{
+		// go slow to turn around
+		*speed = config->speed_min;
+	}
+}
+
+float lzs_tracker_fixangle(float angle)
+{
+	while(angle >= 360.0f)
+	{
+		angle -= 360.0f;
+	}
+	while(angle < 0.0f)
+	{
+		angle += 360.0f;
+	}
+	return angle;
+}
+
+void lzs_tracker_limitposition(const lzs_config_t* config,
+                               float r, float* x, float* y)
+{
+	assert(config);
+	assert(x);
+	assert(y);
+
+	// limit region to screen
+	if(*x - r < 0.0f)
+	{
+		*x = r;
+	}
+	if(*x + r >= config->screen_w)
+	{
+		*x = config->screen_w - r - 1;
+	}
+	if(*y - r < 0.0f)
+	{
+		*y = r;
+	}
+	if(*y + r >= config->screen_h)
+	{
+		*y = config->screen_h - r - 1;
+	}
+}
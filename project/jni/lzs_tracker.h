@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef lzs_tracker_H
+#define lzs_tracker_H
+
+#include "lzs_kernel.h"
+#include "lzs_pyramid.h"
+#include "lzs_motion.h"
+#include "lzs_circle.h"
+#include "lzs_camera.h"
+#include "lzs_background.h"
+#include "lzs_color.h"
+#include "lzs_particles.h"
+#include "lzs_config.h"
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+// the screen, ball and speed limits are kept in the config
+// of the tracker (see lzs_config.h) and the search window
+// must fit on screen
+#define LZS_RADIUS_MAX ((float) LZS_CONFIG_SEARCH_MAX)
+
+// the track is lost after LZS_LOST_FRAMES peaks that are
+// weaker than LZS_LOST_RATIO of the average or too far from
+// the prediction
+#define LZS_LOST_RATIO  0.25f
+#define LZS_LOST_FRAMES 3
+
+// the peak search ranks up to LZS_CANDIDATES local maxima
+// and takes the strongest within the prediction gate unless
+// it is weaker than LZS_CANDIDATE_RATIO of the first
+#define LZS_CANDIDATES      8
+#define LZS_CANDIDATE_RATIO 0.5f
+
+// the peak detector uses the strongest edge while the
+// circle detector votes for the center near that edge and
+// the color detector uses the centroid of the LED which
+// falls back to the peak for LUMA crops without chroma
+#define LZS_DETECTOR_PEAK   0
+#define LZS_DETECTOR_CIRCLE 1
+#define LZS_DETECTOR_COLOR  2
+
+// the floor edges are not learned within this many ball
+// radii of the measured position which may be on the rim
+#define LZS_BACKGROUND_EXCLUDE 2.5f
+
+// circle centers with less support are rejected
+#define LZS_CIRCLE_CONFIDENCE 0.1f
+
+#define LZS_CROP_MAX (2*LZS_CONFIG_SEARCH_MAX)
+
+// a BGRA crop has the rows in the bottom-up order that
+// glReadPixels produces while a LUMA crop keeps the top-down
+// rows of the Y plane of the camera preview
+#define LZS_CROP_BGRA 0
+#define LZS_CROP_LUMA 1
+
+// crop of the camera centered on x, y in screen coordinates
+// and t is the capture time in usec
+//
+// scale_x, scale_y are the screen pixels per crop pixel of
+// a LUMA crop since the preview size may differ from the
+// screen and BGRA crops are always in screen pixels
+//
+// chroma is the optional VU plane of an NV21 preview for a
+// LUMA crop at an even origin where each row of VU pairs
+// covers two rows of pixels with the same stride
+typedef struct
+{
+	double         t;
+	float          x;
+	float          y;
+	int            w;
+	int            h;
+	int            stride;
+	int            format;
+	float          scale_x;
+	float          scale_y;
+	unsigned char* pixels;
+	unsigned char* chroma;
+} lzs_crop_t;
+
+// the tracker does not depend on GL so that it may be
+// profiled on the host with recorded frames
+typedef struct
+{
+	// copy of the config passed to lzs_tracker_new
+	lzs_config_t config;
+
+	// x, y are in pixels
+	// X, Y, height are in feet
+	float sphero_x;
+	float sphero_y;
+	float sphero_X;
+	float sphero_Y;
+	float sphero_speed;
+	float sphero_heading;
+	float sphero_heading_offset;
+	float sphero_goal;
+	float phone_heading;
+	float phone_slope;
+	float phone_height;
+	float phone_X;
+	float phone_Y;
+
+	// the pose is applied by lzs_tracker_steer
+	lzs_camera_t* camera;
+
+	// peak from the last detect
+	lzs_peak_t peak;
+
+	// see LZS_DETECTOR_*
+	int           detector;
+	lzs_circle_t* circle;
+	lzs_center_t  center;
+	lzs_color_t*  color;
+	lzs_blob_t    blob;
+
+	// optional floor model which suppresses the floor edges
+	// in the peak search of LUMA crops
+	lzs_background_t* background;
+
+	// optional particle filter which replaces the detector
+	// and tracks the ball through the crop as a cloud of
+	// hypotheses (see lzs_particles.h)
+	lzs_particles_t* particles;
+
+	// search window radius in pixels where levels > 0
+	// enables the pyramid search
+	int            radius;
+	int            levels;
+	lzs_pyramid_t* pyramid;
+
+	// the next crop is centered on the predicted position
+	// and shrinks from radius to config.radius_ball as the
+	// prediction becomes more certain where roi_limit may
+	// cap the predicted crop below radius
+	lzs_motion_t motion;
+	int          measured;
+	double       t;
+	double       dt_frame;
+	float        roi_x;
+	float        roi_y;
+	int          roi_radius;
+	int          roi_limit;
+	int          predicted;
+	float        pred_x;
+	float        pred_y;
+	float        pred_sigma;
+
+	// lost track detection
+	float  mag_avg;
+	int    lost_count;
+	int    lost;
+	double t_lost;
+
+	// buffer for image processing
+	unsigned char* scratch;   // see LZS_KERNEL_SCRATCH
+} lzs_tracker_t;
+
+lzs_tracker_t* lzs_tracker_new(const lzs_config_t* config);
+void           lzs_tracker_delete(lzs_tracker_t** _self);
+int            lzs_tracker_window(lzs_tracker_t* self, int radius, int levels);
+int            lzs_tracker_detector(lzs_tracker_t* self, int detector);
+int            lzs_tracker_background(lzs_tracker_t* self, int enable);
+int            lzs_tracker_color(lzs_tracker_t* self, float hue, float tolerance);
+int            lzs_tracker_particles(lzs_tracker_t* self, int count);
+void           lzs_tracker_crop(lzs_tracker_t* self, lzs_crop_t* crop);
+void           lzs_tracker_detect(lzs_tracker_t* self, const lzs_crop_t* crop);
+void           lzs_tracker_measure(lzs_tracker_t* self, const lzs_crop_t* crop,
+                                   const lzs_peak_t* peak);
+int            lzs_tracker_accept(lzs_tracker_t* self, const lzs_peak_t* peak);
+int            lzs_tracker_hascolor(const lzs_tracker_t* self, const lzs_crop_t* crop);
+int            lzs_tracker_blob(lzs_tracker_t* self, const lzs_crop_t* crop, lzs_peak_t* peak);
+void           lzs_tracker_reacquire(lzs_tracker_t* self, const lzs_crop_t* crop, const lzs_peak_t* peak);
+void           lzs_tracker_steer(lzs_tracker_t* self);
+void           lzs_tracker_searchsphero(lzs_tracker_t* self, float x, float y);
+void           lzs_tracker_calibratesphero(lzs_tracker_t* self, float x1, float y1, float x2, float y2);
+void           lzs_tracker_spheroorientation(lzs_tracker_t* self, float pitch, float roll, float yaw);
+void           lzs_tracker_phoneorientation(lzs_tracker_t* self, float pitch, float roll, float yaw);
+int            lzs_tracker_spheroheading(lzs_tracker_t* self);
+float          lzs_tracker_spherospeed(lzs_tracker_t* self);
+void           lzs_tracker_command(const lzs_config_t* config,
+                                   float dx, float dy, float heading, float heading_offset,
+                                   float* goal, float* speed);
+float          lzs_tracker_fixangle(float angle);
+void           lzs_tracker_limitposition(const lzs_config_t* config,
+                                         float r, float* x, float* y);
+
+#endif
@@ -0,0 +1,666 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "lzs_trackerset.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+
+#define LOG_TAG "LaserShark"
+#include "a3d/a3d_log.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+static void lzs_trackerset_window(lzs_trackerset_t* self, int i,
+                                  float scale_x, float scale_y, double t)
+{
+	assert(self);
+	LOGD("debug i=%i", i);
+
+	// see lzs_pipeline_luma
+	lzs_tracker_t* tracker = self->trackers[i];
+	int w    = self->luma_w;
+	int h    = self->luma_h;
+	int size = 2*tracker->radius;
+	int cw   = (int) (2.0f*((float) tracker->roi_radius)/scale_x) & ~1;
+	int ch   = (int) (2.0f*((float) tracker->roi_radius)/scale_y) & ~1;
+	cw = (cw > size) ? size : cw;
+	ch = (ch > size) ? size : ch;
+	cw = (cw > w) ? w : cw;
+	ch = (ch > h) ? h : ch;
+
+	int x0 = (int) (tracker->roi_x/scale_x) - cw/2;
+	int y0 = (int) (tracker->roi_y/scale_y) - ch/2;
+	x0 = (x0 < 0) ? 0 : x0;
+	y0 = (y0 < 0) ? 0 : y0;
+	x0 = (x0 + cw > w) ? w - cw : x0;
+	y0 = (y0 + ch > h) ? h - ch : y0;
+
+	self->win_x0[i] = x0;
+	self->win_y0[i] = y0;
+	self->win_x1[i] = x0 + cw;
+	self->win_y1[i] = y0 + ch;
+
+	// the crop is a view of the window in the frame
+	lzs_crop_t* crop = &self->crops[i];
+	crop->t       = t;
+	crop->x       = scale_x*((float) (x0 + cw/2));
+	crop->y       = scale_y*((float) (y0 + ch/2));
+	crop->w       = cw;
+	crop->h       = ch;
+	crop->stride  = self->luma_stride;
+	crop->format  = LZS_CROP_LUMA;
+	crop->scale_x = scale_x;
+	crop->scale_y = scale_y;
+	crop->pixels  = (unsigned char*) &self->luma[y0*self->luma_stride + x0];
+	crop->chroma  = NULL;
+}
+
+static int lzs_trackerset_root(int* parent, int i)
+{
+	assert(parent);
+
+	while(parent[i] != i)
+	{
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
+static void lzs_trackerset_cluster(lzs_trackerset_t* self)
+{
+	assert(self);
+	LOGD("debug");
+
+	// join the overlapping windows
+	int n = self->count;
+	int parent[LZS_TRACKERSET_MAX];
+	int i;
+	int j;
+	for(i = 0; i < n; ++i)
+	{
+		parent[i]        = i;
+		self->overlap[i] = 0;
+	}
+	for(i = 0; i < n; ++i)
+	{
+		for(j = i + 1; j < n; ++j)
+		{
+			if((self->win_x0[i] < self->win_x1[j]) &&
+			   (self->win_x0[j] < self->win_x1[i]) &&
+			   (self->win_y0[i] < self->win_y1[j]) &&
+			   (self->win_y0[j] < self->win_y1[i]))
+			{
+				self->overlap[i] |= 1 << j;
+				self->overlap[j] |= 1 << i;
+
+				int ri = lzs_trackerset_root(parent, i);
+				int rj = lzs_trackerset_root(parent, j);
+				parent[(ri > rj) ? ri : rj] = (ri > rj) ? rj : ri;
+			}
+		}
+	}
+
+	// members are kept in ball order
+	int index[LZS_TRACKERSET_MAX];
+	self->nclusters = 0;
+	for(i = 0; i < n; ++i)
+	{
+		int r = lzs_trackerset_root(parent, i);
+		lzs_trackercluster_t* c;
+		if(r == i)
+		{
+			index[i] = self->nclusters++;
+			c        = &self->clusters[index[i]];
+			c->x0    = self->win_x0[i];
+			c->y0    = self->win_y0[i];
+			c->x1    = self->win_x1[i];
+			c->y1    = self->win_y1[i];
+			c->count = 0;
+		}
+		else
+		{
+			c = &self->clusters[index[r]];
+			c->x0 = (self->win_x0[i] < c->x0) ? self->win_x0[i] : c->x0;
+			c->y0 = (self->win_y0[i] < c->y0) ? self->win_y0[i] : c->y0;
+			c->x1 = (self->win_x1[i] > c->x1) ? self->win_x1[i] : c->x1;
+			c->y1 = (self->win_y1[i] > c->y1) ? self->win_y1[i] : c->y1;
+		}
+		c->members[c->count++] = i;
+	}
+}
+
+// floor(a/b) where b > 0
+static int lzs_trackerset_floordiv(int a, int b)
+{
+	return (a >= 0) ? a/b : -((b - 1 - a)/b);
+}
+
+// limits [*x0, *x1) to the pixels of row y which are closer
+// to the center of window i than to window j where ties
+// belong to the lower index
+static void lzs_trackerset_split(lzs_trackerset_t* self, int i, int j,
+                                 int y, int* x0, int* x1)
+{
+	assert(self);
+	assert(x0);
+	assert(x1);
+
+	// twice the centers so the test is exact in integers
+	int xi = self->win_x0[i] + self->win_x1[i];
+	int yi = self->win_y0[i] + self->win_y1[i];
+	int xj = self->win_x0[j] + self->win_x1[j];
+	int yj = self->win_y0[j] + self->win_y1[j];
+
+	// |2p - ci|^2 - |2p - cj|^2 = a*x + k
+	int a = 4*(xj - xi);
+	int k = xi*xi - xj*xj + yi*yi - yj*yj + 4*y*(yj - yi);
+	int r = ((i < j) ? 0 : -1) - k;
+	if(a == 0)
+	{
+		if(r < 0)
+		{
+			*x1 = *x0;
+		}
+	}
+	else if(a > 0)
+	{
+		int b = lzs_trackerset_floordiv(r, a) + 1;
+		*x1 = (b < *x1) ? b : *x1;
+	}
+	else
+	{
+		int b = -lzs_trackerset_floordiv(r, -a);
+		*x0 = (b > *x0) ? b : *x0;
+	}
+}
+
+// returns the intervals of row y that belong to window i
+// which are the pixels inside the border of window i that
+// are not closer to another window that also contains them
+static int lzs_trackerset_intervals(lzs_trackerset_t* self,
+                                    int i, int y, int* x0, int* x1)
+{
+	assert(self);
+	assert(x0);
+	assert(x1);
+
+	int n = 1;
+	x0[0] = self->win_x0[i] + 1;
+	x1[0] = self->win_x1[i] - 1;
+
+	unsigned int overlap = self->overlap[i];
+	while(overlap && (n > 0))
+	{
+		int j = __builtin_ctz(overlap);
+		overlap &= overlap - 1;
+		if((y <= self->win_y0[j]) || (y >= self->win_y1[j] - 1))
+		{
+			continue;
+		}
+
+		// remove the pixels that belong to window j
+		int r0 = self->win_x0[j] + 1;
+		int r1 = self->win_x1[j] - 1;
+		lzs_trackerset_split(self, j, i, y, &r0, &r1);
+		if(r0 >= r1)
+		{
+			continue;
+		}
+
+		int count = n;
+		int k;
+		for(k = 0; k < count; ++k)
+		{
+			if((r1 <= x0[k]) || (r0 >= x1[k]))
+			{
+				continue;
+			}
+
+			// keep the part after the removed pixels
+			if(r1 < x1[k])
+			{
+				x0[n] = r1;
+				x1[n] = x1[k];
+				++n;
+			}
+			x1[k] = (r0 > x0[k]) ? r0 : x0[k];
+		}
+
+		// drop the empty intervals and keep the rest in
+		// order so the first row-major peak is preserved
+		int e = 0;
+		for(k = 0; k < n; ++k)
+		{
+			if(x0[k] >= x1[k])
+			{
+				continue;
+			}
+
+			int a = x0[k];
+			int b = x1[k];
+			int l = e++;
+			while((l > 0) && (x0[l - 1] > a))
+			{
+				x0[l] = x0[l - 1];
+				x1[l] = x1[l - 1];
+				--l;
+			}
+			x0[l] = a;
+			x1[l] = b;
+		}
+		n = e;
+	}
+	return n;
+}
+
+static void lzs_trackerset_scan(lzs_trackerset_t* self, int id,
+                                const lzs_trackercluster_t* c)
+{
+	assert(self);
+	assert(c);
+	LOGD("debug id=%i", id);
+
+	// a window that overlaps no other is a separate crop
+	if(c->count == 1)
+	{
+		int            i       = c->members[0];
+		lzs_tracker_t* tracker = self->trackers[i];
+		lzs_tracker_detect(tracker, &self->crops[i]);
+		self->peak_x[i]   = 0;
+		self->peak_y[i]   = 0;
+		self->peak_mag[i] = tracker->peak.mag;
+
+		// a window without edges has no peak position as in
+		// the shared windows below
+		if(tracker->peak.mag > 0)
+		{
+			self->peak_x[i] = self->win_x0[i] + tracker->peak.x;
+			self->peak_y[i] = self->win_y0[i] + tracker->peak.y;
+		}
+		return;
+	}
+
+	// the one pixel border of each window has no edge
+	// response as in lzs_kernel_peakgray and each pixel of
+	// the cluster is passed through the kernel at most once
+	unsigned char* scratch = self->workers[id].scratch;
+	int            stride  = self->luma_stride;
+	int x0[LZS_TRACKERSET_MAX + 1];
+	int x1[LZS_TRACKERSET_MAX + 1];
+	int m;
+	for(m = 0; m < c->count; ++m)
+	{
+		int        i = c->members[m];
+		lzs_peak_t peak;
+		peak.x   = 0;
+		peak.y   = 0;
+		peak.mag = 0;
+
+		int y;
+		for(y = self->win_y0[i] + 1; y < self->win_y1[i] - 1; ++y)
+		{
+			const unsigned char* row = &self->luma[y*stride];
+			int                  n   = lzs_trackerset_intervals(self, i, y, x0, x1);
+			int k;
+			for(k = 0; k < n; ++k)
+			{
+				lzs_kernel_peakgrayrow(row, stride, x0[k], x1[k], y,
+				                       scratch, &peak);
+			}
+		}
+
+		self->peak_x[i]   = peak.x;
+		self->peak_y[i]   = peak.y;
+		self->peak_mag[i] = peak.mag;
+
+		// the tracker measures the peak in its crop
+		peak.x -= self->win_x0[i];
+		peak.y -= self->win_y0[i];
+		lzs_tracker_measure(self->trackers[i], &self->crops[i], &peak);
+	}
+}
+
+static void lzs_trackerset_run(lzs_trackerset_t* self, int id)
+{
+	assert(self);
+	LOGD("debug id=%i", id);
+
+	while(1)
+	{
+		int c = __sync_fetch_and_add(&self->next, 1);
+		if(c >= self->nclusters)
+		{
+			break;
+		}
+		lzs_trackerset_scan(self, id, &self->clusters[c]);
+	}
+}
+
+static void* lzs_trackerset_thread(void* arg)
+{
+	assert(arg);
+	LOGD("debug");
+
+	lzs_trackerset_t* self = (lzs_trackerset_t*) arg;
+	while(1)
+	{
+		sem_wait(&self->start);
+		if(self->running == 0)
+		{
+			break;
+		}
+
+		int id = __sync_add_and_fetch(&self->ids, 1);
+		lzs_trackerset_run(self, id);
+		sem_post(&self->done);
+	}
+	return NULL;
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+lzs_trackerset_t* lzs_trackerset_new(const lzs_config_t* config, int maxw, int nthreads)
+{
+	assert(config);
+	LOGD("debug maxw=%i, nthreads=%i", maxw, nthreads);
+
+	// use every core by default
+	if(nthreads <= 0)
+	{
+		nthreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	if(nthreads < 1)
+	{
+		nthreads = 1;
+	}
+	else if(nthreads > LZS_TRACKERSET_THREADS)
+	{
+		nthreads = LZS_TRACKERSET_THREADS;
+	}
+
+	lzs_trackerset_t* self = (lzs_trackerset_t*) malloc(sizeof(lzs_trackerset_t));
+	if(self == NULL)
+	{
+		LOGE("malloc failed");
+		return NULL;
+	}
+	memset(self, 0, sizeof(lzs_trackerset_t));
+	self->config   = *config;
+	self->nthreads = nthreads;
+	self->maxw     = maxw;
+
+	int i;
+	for(i = 0; i < nthreads; ++i)
+	{
+		self->workers[i].scratch = (unsigned char*) lzs_kernel_malloc(LZS_KERNEL_SCRATCH(maxw));
+		if(self->workers[i].scratch == NULL)
+		{
+			goto fail_scratch;
+		}
+	}
+
+	if(sem_init(&self->start, 0, 0) != 0)
+	{
+		LOGE("sem_init failed");
+		goto fail_start;
+	}
+
+	if(sem_init(&self->done, 0, 0) != 0)
+	{
+		LOGE("sem_init failed");
+		goto fail_done;
+	}
+
+	// worker 0 is the caller
+	self->running = 1;
+	int started;
+	for(started = 1; started < nthreads; ++started)
+	{
+		if(pthread_create(&self->workers[started].thread, NULL,
+		                  lzs_trackerset_thread, (void*) self) != 0)
+		{
+			LOGE("pthread_create failed");
+			goto fail_thread;
+		}
+	}
+
+	lzs_kernel_select(LZS_KERNEL_BEST);
+
+	// success
+	return self;
+
+	// failure
+	fail_thread:
+		self->running = 0;
+		__sync_synchronize();
+		for(i = 1; i < started; ++i)
+		{
+			sem_post(&self->start);
+		}
+		for(i = 1; i < started; ++i)
+		{
+			pthread_join(self->workers[i].thread, NULL);
+		}
+		sem_destroy(&self->done);
+	fail_done:
+		sem_destroy(&self->start);
+	fail_start:
+	fail_scratch:
+		for(i = 0; i < nthreads; ++i)
+		{
+			lzs_kernel_free(self->workers[i].scratch);
+		}
+		free(self);
+	return NULL;
+}
+
+void lzs_trackerset_delete(lzs_trackerset_t** _self)
+{
+	assert(_self);
+
+	lzs_trackerset_t* self = *_self;
+	if(self)
+	{
+		LOGD("debug");
+
+		self->running = 0;
+		__sync_synchronize();
+
+		int i;
+		for(i = 1; i < self->nthreads; ++i)
+		{
+			sem_post(&self->start);
+		}
+		for(i = 1; i < self->nthreads; ++i)
+		{
+			pthread_join(self->workers[i].thread, NULL);
+		}
+		sem_destroy(&self->done);
+		sem_destroy(&self->start);
+
+		for(i = 0; i < self->count; ++i)
+		{
+			lzs_tracker_delete(&self->trackers[i]);
+		}
+		for(i = 0; i < self->nthreads; ++i)
+		{
+			lzs_kernel_free(self->workers[i].scratch);
+		}
+		free(self);
+		*_self = NULL;
+	}
+}
+
+int lzs_trackerset_add(lzs_trackerset_t* self, float x, float y)
+{
+	assert(self);
+	LOGD("debug x=%f, y=%f", x, y);
+
+	if(self->count >= LZS_TRACKERSET_MAX)
+	{
+		LOGE("invalid count=%i", self->count);
+		return -1;
+	}
+
+	// the shared scan replaces the floor model
+	lzs_tracker_t* tracker = lzs_tracker_new(&self->config);
+	if(tracker == NULL)
+	{
+		return -1;
+	}
+
+	if((lzs_tracker_window(tracker, self->config.search_radius,
+	                       self->config.search_levels) == 0) ||
+	   (lzs_tracker_background(tracker, 0) == 0))
+	{
+		lzs_tracker_delete(&tracker);
+		return -1;
+	}
+
+	int i = self->count++;
+	self->trackers[i] = tracker;
+	lzs_tracker_searchsphero(tracker, x, y);
+	return i;
+}
+
+void lzs_trackerset_luma(lzs_trackerset_t* self, const unsigned char* luma,
+                         int w, int h, int stride, double t)
+{
+	assert(self);
+	assert(luma);
+	LOGD("debug w=%i, h=%i, stride=%i", w, h, stride);
+
+	if((w < 3) || (h < 3) || (w > self->maxw))
+	{
+		LOGE("invalid w=%i, h=%i", w, h);
+		return;
+	}
+
+	self->luma        = luma;
+	self->luma_w      = w;
+	self->luma_h      = h;
+	self->luma_stride = stride;
+
+	// the preview is stretched to fill the screen
+	float scale_x = self->config.screen_w/((float) w);
+	float scale_y = self->config.screen_h/((float) h);
+	int i;
+	for(i = 0; i < self->count; ++i)
+	{
+		lzs_trackerset_window(self, i, scale_x, scale_y, t);
+	}
+	lzs_trackerset_cluster(self);
+
+	// the helpers only wake for a large set
+	int n = (self->nclusters >= LZS_TRACKERSET_PARALLEL) ? self->nthreads : 1;
+	self->next = 0;
+	self->ids  = 0;
+	__sync_synchronize();
+	for(i = 1; i < n; ++i)
+	{
+		sem_post(&self->start);
+	}
+	lzs_trackerset_run(self, 0);
+	for(i = 1; i < n; ++i)
+	{
+		sem_wait(&self->done);
+	}
+	__sync_synchronize();
+
+	for(i = 0; i < self->count; ++i)
+	{
+		lzs_tracker_steer(self->trackers[i]);
+	}
+}
+
+void lzs_trackerset_searchsphero(lzs_trackerset_t* self, int i, float x, float y)
+{
+	assert(self);
+	assert((i >= 0) && (i < self->count));
+	LOGD("debug i=%i, x=%f, y=%f", i, x, y);
+
+	lzs_tracker_searchsphero(self->trackers[i], x, y);
+}
+
+void lzs_trackerset_calibratesphero(lzs_trackerset_t* self, int i)
+{
+	assert(self);
+	assert((i >= 0) && (i < self->count));
+	LOGD("debug i=%i", i);
+
+	lzs_tracker_calibratesphero(self->trackers[i], 0.0f, 0.0f, 0.0f, 0.0f);
+}
+
+void lzs_trackerset_spheroorientation(lzs_trackerset_t* self, int i,
+                                      float pitch, float roll, float yaw)
+{
+	assert(self);
+	assert((i >= 0) && (i < self->count));
+	LOGD("debug i=%i, pitch=%f, roll=%f, yaw=%f", i, pitch, roll, yaw);
+
+	lzs_tracker_spheroorientation(self->trackers[i], pitch, roll, yaw);
+}
+
+void lzs_trackerset_phonepose(lzs_trackerset_t* self,
+                              float heading, float slope, float height)
+{
+	assert(self);
+	LOGD("debug heading=%f, slope=%f, height=%f", heading, slope, height);
+
+	// the phone is shared by every ball
+	int i;
+	for(i = 0; i < self->count; ++i)
+	{
+		lzs_tracker_t* tracker = self->trackers[i];
+		tracker->phone_heading = heading;
+		tracker->phone_slope   = slope;
+		tracker->phone_height  = height;
+	}
+}
+
+int lzs_trackerset_spheroheading(lzs_trackerset_t* self, int i)
+{
+	assert(self);
+	assert((i >= 0) && (i < self->count));
+	LOGD("debug i=%i", i);
+
+	return lzs_tracker_spheroheading(self->trackers[i]);
+}
+
+float lzs_trackerset_spherospeed(lzs_trackerset_t* self, int i)
+{
+	assert(self);
+	assert((i >= 0) && (i < self->count));
+	LOGD("debug i=%i", i);
+
+	// a lost ball stops
+	lzs_tracker_t* tracker = self->trackers[i];
+	return tracker->lost ? 0.0f : lzs_tracker_spherospeed(tracker);
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef lzs_trackerset_H
+#define lzs_trackerset_H
+
+#include <pthread.h>
+#include <semaphore.h>
+#include "lzs_tracker.h"
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+// tracker for several balls in the same preview
+//
+// each ball keeps its own lzs_tracker_t for the prediction,
+// the gate, the lost track detection and the steering while
+// the set places the search windows in the preview and
+// merges the windows that overlap into clusters whose rows
+// are passed through the edge kernel once where each pixel
+// of a cluster belongs to the nearest window
+//
+// a window that overlaps no other is searched by its tracker
+// as a separate crop (with the pyramid of the config) so a
+// few scattered balls cost the same as separate trackers
+//
+// clusters are dealt out to the threads when there are at
+// least LZS_TRACKERSET_PARALLEL of them
+#define LZS_TRACKERSET_MAX      16
+#define LZS_TRACKERSET_THREADS  4
+#define LZS_TRACKERSET_PARALLEL 4
+
+typedef struct
+{
+	// bounding box of the member windows
+	int x0;
+	int y0;
+	int x1;
+	int y1;
+
+	int count;
+	int members[LZS_TRACKERSET_MAX];
+} lzs_trackercluster_t;
+
+typedef struct
+{
+	pthread_t      thread;
+	unsigned char* scratch;   // see LZS_KERNEL_SCRATCH
+} lzs_trackersetworker_t;
+
+typedef struct
+{
+	// copy of the config passed to lzs_trackerset_new
+	lzs_config_t config;
+
+	int            count;
+	lzs_tracker_t* trackers[LZS_TRACKERSET_MAX];
+
+	// search window [x0, x1) x [y0, y1) of each tracker in
+	// preview pixels and its crop of the current frame
+	int        win_x0[LZS_TRACKERSET_MAX];
+	int        win_y0[LZS_TRACKERSET_MAX];
+	int        win_x1[LZS_TRACKERSET_MAX];
+	int        win_y1[LZS_TRACKERSET_MAX];
+	lzs_crop_t crops[LZS_TRACKERSET_MAX];
+
+	// bit j of overlap[i] is set when windows i and j overlap
+	unsigned int overlap[LZS_TRACKERSET_MAX];
+
+	// peak from the last frame in preview pixels
+	int          peak_x[LZS_TRACKERSET_MAX];
+	int          peak_y[LZS_TRACKERSET_MAX];
+	unsigned int peak_mag[LZS_TRACKERSET_MAX];
+
+	// clusters of the current frame where next is shared
+	// by the threads
+	int                  nclusters;
+	lzs_trackercluster_t clusters[LZS_TRACKERSET_MAX];
+	volatile int         next;
+
+	// current frame
+	const unsigned char* luma;
+	int                  luma_w;
+	int                  luma_h;
+	int                  luma_stride;
+
+	// worker 0 is the caller
+	int                    nthreads;
+	lzs_trackersetworker_t workers[LZS_TRACKERSET_THREADS];
+	sem_t                  start;
+	sem_t                  done;
+	volatile int           running;
+	volatile int           ids;
+	int                    maxw;
+} lzs_trackerset_t;
+
+lzs_trackerset_t* lzs_trackerset_new(const lzs_config_t* config, int maxw, int nthreads);
+void              lzs_trackerset_delete(lzs_trackerset_t** _self);
+int               lzs_trackerset_add(lzs_trackerset_t* self, float x, float y);
+void              lzs_trackerset_luma(lzs_trackerset_t* self, const unsigned char* luma,
+                                      int w, int h, int stride, double t);
+void              lzs_trackerset_searchsphero(lzs_trackerset_t* self, int i, float x, float y);
+void              lzs_trackerset_calibratesphero(lzs_trackerset_t* self, int i);
+void              lzs_trackerset_spheroorientation(lzs_trackerset_t* self, int i,
+                                                   float pitch, float roll, float yaw);
+void              lzs_trackerset_phonepose(lzs_trackerset_t* self,
+                                           float heading, float slope, float height);
+int               lzs_trackerset_spheroheading(lzs_trackerset_t* self, int i);
+float             lzs_trackerset_spherospeed(lzs_trackerset_t* self, int i);
+
+#endif
@@ -72,9 +72,30 @@ public class LaserShark extends Activity implements SensorEventListener
 	private boolean mAccelerometerReady  = false;
 	private boolean mMagneticReady       = false;
 
+	// sensor records are batched for native code and the
+	// ring lives as long as the process
+	private static SensorRing mSensorRing;
+
 	// calibration
 	private boolean mIsCalibrated = false;
 
+	// the native control thread publishes {heading, speed}
+	// at LZS_CONTROL_HZ and the mailbox is polled at the same
+	// rate so a command is only sent when it changes
+	private static final int DRIVE_MS = 20;
+	private float[] mCommand = new float[2];
+
+	// the poll is reposted on one handler with one runnable
+	// so driving does not allocate on the UI thread
+	private final Handler  mDriveHandler  = new Handler();
+	private final Runnable mDriveRunnable = new Runnable()
+	{
+		public void run()
+		{
+			drive();
+		}
+	};
+
 	private final DeviceMessenger.AsyncDataListener mDataListener = new DeviceMessenger.AsyncDataListener()
 	{
 		@Override
@@ -88,7 +109,8 @@ public class LaserShark extends Activity implements SensorEventListener
 				float pitch = (float)ballData.getAttitudeData().getAttitudeSensor().pitch;
 				float roll  = (float)ballData.getAttitudeData().getAttitudeSensor().roll;
 				float yaw   = (float)ballData.getAttitudeData().getAttitudeSensor().yaw;
-				NativeSpheroOrientation(pitch, roll, yaw);
+				mSensorRing.append(SensorRing.SPHERO, SensorRing.now(),
+				                   pitch, roll, yaw, 0.0f);
 			}
 		}
 	};
@@ -106,11 +128,8 @@ public class LaserShark extends Activity implements SensorEventListener
 	// Native interface
 	private native void  NativeTouchOne(float x1, float y1);
 	private native void  NativeTouchTwo(float x1, float y1, float x2, float y2);
-	private native void  NativeGyroEvent(float v0, float v1, float v2, float dt);
-	private native void  NativeSpheroOrientation(float pitch, float roll, float yaw);
-	private native void  NativePhoneOrientation(float pitch, float roll, float yaw);
-	private native int   NativeSpheroHeading();
-	private native float NativeSpheroSpeed();
+	private native boolean NativeSpheroCommand(int index, float[] command);
+	private native int     NativeAddSphero(float x, float y);
 
 	public Robot getRobot()
 	{
@@ -141,18 +160,21 @@ public class LaserShark extends Activity implements SensorEventListener
 	{
 		if(mRobot != null)
 		{
-			if(mIsCalibrated)
-			{
-				RollCommand.sendCommand(mRobot, (float) NativeSpheroHeading(), NativeSpheroSpeed());
-			}
-			else
+			// the connected robot is ball 0
+			if(NativeSpheroCommand(0, mCommand))
 			{
-				RollCommand.sendStop(mRobot);
+				if(mIsCalibrated)
+				{
+					RollCommand.sendCommand(mRobot, mCommand[0], mCommand[1]);
+				}
+				else
+				{
+					RollCommand.sendStop(mRobot);
+				}
 			}
 
-			// send delayed message on a handler to drive
-			final Handler handler = new Handler();
-			handler.postDelayed(new Runnable() { public void run() { drive(); } }, 100);
+			// poll the mailbox again
+			mDriveHandler.postDelayed(mDriveRunnable, DRIVE_MS);
 		}
 	}
 
@@ -170,6 +192,9 @@ public class LaserShark extends Activity implements SensorEventListener
 	@Override
 	protected void onStop()
 	{
+		// stop polling the mailbox
+		mDriveHandler.removeCallbacks(mDriveRunnable);
+
 		// rotate "normal"
 		RotationRateCommand.sendCommand(mRobot, 0.6f);
 
@@ -255,6 +280,7 @@ public class LaserShark extends Activity implements SensorEventListener
 			                                    SetDataStreamingCommand.DATA_STREAMING_MASK_IMU_YAW_ANGLE_FILTERED, 0);
 
 			// start the ball
+			mDriveHandler.removeCallbacks(mDriveRunnable);
 			drive();
 		}
 	}
@@ -264,6 +290,11 @@ public class LaserShark extends Activity implements SensorEventListener
 	{
 		super.onCreate(savedInstanceState);
 
+		if(mSensorRing == null)
+		{
+			mSensorRing = new SensorRing();
+		}
+
 		A3DResource r = new A3DResource(this, R.raw.timestamp);
 		r.Add(R.raw.whitrabt, "whitrabt.tex.gz");
 
@@ -289,6 +320,7 @@ public class LaserShark extends Activity implements SensorEventListener
 
 		mAccelerometerReady = false;
 		mMagneticReady      = false;
+		mSensorRing.resetEventTime();
 
 		SensorManager sm = (SensorManager) getSystemService(Context.SENSOR_SERVICE);
 		mGyro = sm.getDefaultSensor(Sensor.TYPE_GYROSCOPE);
@@ -296,7 +328,7 @@ public class LaserShark extends Activity implements SensorEventListener
 		{
 			sm.registerListener(this,
 			                    mGyro,
-			                    SensorManager.SENSOR_DELAY_NORMAL);
+			                    SensorManager.SENSOR_DELAY_FASTEST);
 		}
 		mGyroTimestamp = 0L;
 
@@ -305,7 +337,7 @@ public class LaserShark extends Activity implements SensorEventListener
 		{
 			sm.registerListener(this,
 			                    mMagnetic,
-			                    SensorManager.SENSOR_DELAY_GAME);
+			                    SensorManager.SENSOR_DELAY_FASTEST);
 		}
 
 		mAccelerometer = sm.getDefaultSensor(Sensor.TYPE_ACCELEROMETER);
@@ -313,7 +345,7 @@ public class LaserShark extends Activity implements SensorEventListener
 		{
 			sm.registerListener(this,
 			                    mAccelerometer,
-			                    SensorManager.SENSOR_DELAY_GAME);
+			                    SensorManager.SENSOR_DELAY_FASTEST);
 		}
 	}
 
@@ -329,6 +361,7 @@ public class LaserShark extends Activity implements SensorEventListener
 			mAccelerometer = null;
 			mMagnetic = null;
 		}
+		mSensorRing.flush();
 
 		mWakeLock.release();
 		Surface.PauseRenderer();
@@ -394,6 +427,14 @@ public class LaserShark extends Activity implements SensorEventListener
 				}
 				mIsCalibrated = true;
 			}
+			else if(count == 3)
+			{
+				// the third finger adds a ball to the tracker set
+				if(action == MotionEvent.ACTION_POINTER_3_DOWN)
+				{
+					NativeAddSphero(event.getX(2), event.getY(2));
+				}
+			}
 			// limit touch events to 30Hz
 			Thread.sleep((long) (1000.0F/30.0F));
 		}
@@ -411,12 +452,15 @@ public class LaserShark extends Activity implements SensorEventListener
 
 	public void onSensorChanged(SensorEvent event)
 	{
+		// the native filter fuses all three sensors and
+		// SensorManager is only used without a gyro
 		if(event.sensor.getType() == Sensor.TYPE_GYROSCOPE)
 		{
 			if(mGyroTimestamp != 0L)
 			{
 				float dt = (event.timestamp - mGyroTimestamp) * NS2S;
-				NativeGyroEvent(event.values[0], event.values[1], event.values[2], dt);
+				mSensorRing.append(SensorRing.GYRO, mSensorRing.eventTime(event.timestamp),
+				                   event.values[0], event.values[1], event.values[2], dt);
 			}
 			mGyroTimestamp = event.timestamp;
 		}
@@ -426,6 +470,8 @@ public class LaserShark extends Activity implements SensorEventListener
 			mAccelerometerValues[1] = event.values[1];
 			mAccelerometerValues[2] = event.values[2];
 			mAccelerometerReady = true;
+			mSensorRing.append(SensorRing.ACCEL, mSensorRing.eventTime(event.timestamp),
+			                   event.values[0], event.values[1], event.values[2], 0.0f);
 		}
 		else if(event.sensor.getType() == Sensor.TYPE_MAGNETIC_FIELD)
 		{
@@ -433,16 +479,19 @@ public class LaserShark extends Activity implements SensorEventListener
 			mMagneticValues[1] = event.values[1];
 			mMagneticValues[2] = event.values[2];
 			mMagneticReady = true;
+			mSensorRing.append(SensorRing.MAG, mSensorRing.eventTime(event.timestamp),
+			                   event.values[0], event.values[1], event.values[2], 0.0f);
 		}
 
-		if(mAccelerometerReady && mMagneticReady)
+		if((mGyro == null) && mAccelerometerReady && mMagneticReady)
 		{
 			SensorManager.getRotationMatrix(mRotation, mInclination, mAccelerometerValues, mMagneticValues);
 			SensorManager.getOrientation(mRotation, mOrientation);
 			float azmuth = mOrientation[0] * RAD2DEG;
 			float pitch  = mOrientation[1] * RAD2DEG;
 			float roll   = mOrientation[2] * RAD2DEG;
-			NativePhoneOrientation(pitch, roll, azmuth);
+			mSensorRing.append(SensorRing.PHONE, mSensorRing.eventTime(event.timestamp),
+			                   pitch, roll, azmuth, 0.0f);
 		}
 	}
 
@@ -33,6 +33,7 @@ import android.graphics.SurfaceTexture;
 import com.jeffboody.a3d.A3DNativeRenderer;
 
 public class LaserSharkRenderer extends A3DNativeRenderer
+implements Camera.PreviewCallback
 {
 	private static final String TAG = "LaserSharkRenderer";
 
@@ -42,8 +43,16 @@ public class LaserSharkRenderer extends A3DNativeRenderer
 	private SurfaceTexture mSurfaceTexture;
 	private LaserShark     mLaserShark;
 
+	// the Y plane of the preview is tracked rather than
+	// reading back the rendered camera texture
+	private static final boolean USE_LUMA     = true;
+	private static final int     LUMA_BUFFERS = 2;
+	private int                  mPreviewWidth;
+	private int                  mPreviewHeight;
+
 	// Native interface
-	private native int NativeGetTexture();
+	private native int  NativeGetTexture();
+	private native void NativeLuma(byte[] data, int width, int height);
 
 	// Renderer implementation
 	public LaserSharkRenderer(Context context, LaserShark laser_shark)
@@ -105,14 +114,35 @@ public class LaserSharkRenderer extends A3DNativeRenderer
 			mCamera = null;
 			return;
 		}
+
+		// NV21 is a full size Y plane followed by the
+		// interleaved VU plane at half resolution
+		if(USE_LUMA)
+		{
+			mPreviewWidth  = width;
+			mPreviewHeight = height;
+			int size = width*height*ImageFormat.getBitsPerPixel(ImageFormat.NV21)/8;
+			for(int i = 0; i < LUMA_BUFFERS; ++i)
+			{
+				mCamera.addCallbackBuffer(new byte[size]);
+			}
+			mCamera.setPreviewCallbackWithBuffer(this);
+		}
 		mCamera.startPreview();
 	}
 
+	@Override
+	public void onPreviewFrame(byte[] data, Camera camera)
+	{
+		NativeLuma(data, mPreviewWidth, mPreviewHeight);
+		camera.addCallbackBuffer(data);
+	}
+
 	@Override
 	public void DestroySurface()
 	{
 		mCamera.stopPreview();
-		mCamera.setPreviewCallback(null);
+		mCamera.setPreviewCallbackWithBuffer(null);
 		mCamera.release();
 		mCamera = null;
 		mSurfaceTexture = null;
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2012 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+package com.jeffboody.LaserShark;
+
+import android.os.SystemClock;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
+// ring of timestamped sensor records shared with native code
+// which is drained once per frame (see lzs_sensors.h)
+public class SensorRing
+{
+	public static final int GYRO   = 0;
+	public static final int ACCEL  = 1;
+	public static final int MAG    = 2;
+	public static final int PHONE  = 3;
+	public static final int SPHERO = 4;
+
+	// layout
+	private static final int HEADER   = 32;
+	private static final int RECORD   = 32;
+	private static final int CAPACITY = 1024;
+	private static final int TAIL     = 8;
+	private static final int OVERFLOW = 12;
+
+	// the head is published after BATCH records or COMMIT_NS
+	private static final int  BATCH     = 16;
+	private static final long COMMIT_NS = 10000000L;
+
+	private ByteBuffer mBuffer;
+	private int        mHead;
+	private int        mCommitted;
+	private long       mCommitTime;
+	private int        mOverflow;
+
+	// offset from SensorEvent.timestamp to the ring clock
+	private long    mEventOffset;
+	private boolean mEventReady;
+
+	// Native interface
+	private native void NativeAttach(ByteBuffer buffer);
+	private native void NativeCommit(int head);
+
+	public SensorRing()
+	{
+		mBuffer = ByteBuffer.allocateDirect(HEADER + RECORD*CAPACITY);
+		mBuffer.order(ByteOrder.nativeOrder());
+		mBuffer.putInt(0, CAPACITY);
+		NativeAttach(mBuffer);
+	}
+
+	// every record is stamped with System.nanoTime() since
+	// elapsedRealtimeNanos() needs API 17
+	public static long now()
+	{
+		return System.nanoTime();
+	}
+
+	// SensorEvent.timestamp counts from boot on most devices
+	// but matches System.nanoTime() on others so the base is
+	// chosen from the first event after a reset and the
+	// offset holds while the wake lock keeps the phone awake
+	public synchronized long eventTime(long timestamp)
+	{
+		if(mEventReady == false)
+		{
+			long now  = now();
+			long boot = SystemClock.elapsedRealtime()*1000000L;
+			if(Math.abs(timestamp - now) <= Math.abs(timestamp - boot))
+			{
+				mEventOffset = 0L;
+			}
+			else
+			{
+				mEventOffset = now - boot;
+			}
+			mEventReady = true;
+		}
+		return timestamp + mEventOffset;
+	}
+
+	// the offset changes when the phone sleeps so it is
+	// measured again when the sensors are registered
+	public synchronized void resetEventTime()
+	{
+		mEventReady = false;
+	}
+
+	// the phone sensors and the Sphero stream append from
+	// different threads
+	public synchronized void append(int type, long timestamp,
+	                                float v0, float v1, float v2, float v3)
+	{
+		// drop the newest record when native falls behind
+		int tail = mBuffer.getInt(TAIL);
+		if(mHead - tail >= CAPACITY)
+		{
+			++mOverflow;
+			mBuffer.putInt(OVERFLOW, mOverflow);
+			return;
+		}
+
+		int pos = HEADER + RECORD*(mHead & (CAPACITY - 1));
+		mBuffer.putDouble(pos, ((double) timestamp)*1.0e-9);
+		mBuffer.putInt(pos + 8, type);
+		mBuffer.putFloat(pos + 12, v0);
+		mBuffer.putFloat(pos + 16, v1);
+		mBuffer.putFloat(pos + 20, v2);
+		mBuffer.putFloat(pos + 24, v3);
+		++mHead;
+
+		long now = now();
+		if((mHead - mCommitted >= BATCH) || (now - mCommitTime >= COMMIT_NS))
+		{
+			commit(now);
+		}
+	}
+
+	public synchronized void flush()
+	{
+		if(mHead != mCommitted)
+		{
+			commit(now());
+		}
+	}
+
+	private void commit(long now)
+	{
+		NativeCommit(mHead);
+		mCommitted  = mHead;
+		mCommitTime = now;
+	}
+}